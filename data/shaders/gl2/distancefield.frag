@@ -16,13 +16,14 @@ uniform sampler2D tu0_2D;
 uniform vec4 color_tint;
 
 varying vec2 texcoord;
+varying vec4 vcolor;
 
 OUT(vec4 FragColor)
 
 void main()
 {
 	vec4 texcolor = texture2D(tu0_2D, texcoord);
-	texcolor.rgb *= color_tint.rgb;
+	texcolor.rgb *= color_tint.rgb * vcolor.rgb;
 	float distanceFactor = texcolor.a;
 	
 	//anti-aliasing
@@ -56,7 +57,7 @@ void main()
 	float glowFactor = smoothstep(0.0, 1.0, distanceFactor);
 	texcolor = mix(vec4(0.0, 0.0, 0.0, glowFactor), texcolor, texcolor.a);
 	
-	texcolor.a *= color_tint.a;
+	texcolor.a *= color_tint.a * vcolor.a;
 	
 	FragColor = vec4(texcolor.rgb,texcolor.a);
     //FragColor = vec4(texcolor.rgb*color_tint.a,texcolor.a);
@@ -3,8 +3,21 @@
 #define varying out
 #endif
 
+#ifdef _INSTANCED_
+#if __VERSION__ > 120
+#define InstanceID gl_InstanceID
+#else
+#extension GL_ARB_draw_instanced : require
+#define InstanceID gl_InstanceIDARB
+#endif
+uniform mat4 ProjectionMatrix;
+uniform mat4 InstanceMatrix[_INSTANCED_];
+#define ModelViewMatrix InstanceMatrix[InstanceID]
+#define ModelViewProjMatrix (ProjectionMatrix * InstanceMatrix[InstanceID])
+#else
 uniform mat4 ModelViewProjMatrix;
 uniform mat4 ModelViewMatrix;
+#endif
 uniform mat3 ReflectionMatrix;
 uniform vec3 light_direction;
 
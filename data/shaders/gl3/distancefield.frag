@@ -5,12 +5,13 @@ uniform vec4 colorTint;
 
 in vec3 normal;
 in vec3 uv;
+in vec4 vcolor;
 out vec4 outputColor;
 
 void main()
 {
 	vec4 texcolor = texture(diffuseSampler, uv.xy);
-	texcolor.rgb *= colorTint.rgb;
+	texcolor.rgb *= colorTint.rgb * vcolor.rgb;
 	float distanceFactor = texcolor.a;
 	
 	//anti-aliasing
@@ -20,7 +21,7 @@ void main()
 	float glowFactor = smoothstep(0.0, 1.0, distanceFactor);
 	texcolor = mix(vec4(0.0, 0.0, 0.0, glowFactor), texcolor, texcolor.a);
 	
-	texcolor.a *= colorTint.a;
+	texcolor.a *= colorTint.a * vcolor.a;
 	
 	outputColor = texcolor;
 }
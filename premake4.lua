@@ -146,9 +146,15 @@ solution "VDrift"
 		links {"mingw32"}
 		linkoptions {"-static-libstdc++", "-static-libgcc"}
 
+	-- no fused multiply-add contraction, deterministic physics needs identical
+	-- results across builds, this includes the bundled bullet sources
 	configuration {"vs*"}
 		defines {"__PRETTY_FUNCTION__=__FUNCSIG__", "_USE_MATH_DEFINES", "NOMINMAX"}
 		buildoptions {"/wd4100", "/wd4127", "/wd4244", "/wd4245", "/wd4305", "/wd4355", "/wd4512", "/wd4800"}
+		buildoptions {"/fp:precise"}
+
+	configuration {"not vs*"}
+		buildoptions {"-ffp-contract=off"}
 
 	configuration {"vs*", "Debug"}
 		linkoptions {"/NODEFAULTLIB:\"msvcrt.lib\""}
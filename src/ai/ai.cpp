@@ -18,6 +18,8 @@
 /************************************************************************/
 
 #include "ai.h"
+#include "thread_pool.h"
+#include "physics/cardynamics.h"
 #include <cassert>
 // AI implementations:
 #include "ai_car_standard.h"
@@ -50,6 +52,7 @@ unsigned Ai::AddCar(unsigned carid, float difficulty, const std::string & type)
 
 	AiCar * aicar = factory->Create(carid, difficulty);
 	ai_cars.push_back(aicar);
+	ai_types.push_back(type);
 
 	return ai_cars.size() - 1;
 }
@@ -61,13 +64,41 @@ void Ai::ClearCars()
 		delete ai_car;
 	}
 	ai_cars.clear();
+	ai_types.clear();
+	speed_profiles.clear();
 }
 
-void Ai::Update(float dt, const CarDynamics cars[], const int cars_num)
+void Ai::InitSpeedProfile(unsigned id, const std::string & car_class, const CarDynamics & car, const std::vector<RoadStrip> & roads)
 {
-	for (auto ai_car : ai_cars)
+	assert(id < ai_cars.size());
+	auto & profile = speed_profiles[ai_types[id] + " " + car_class];
+	if (!profile)
+		profile = ai_cars[id]->CreateSpeedProfile(car, roads);
+	ai_cars[id]->SetSpeedProfile(profile);
+}
+
+void Ai::Update(float dt, const CarDynamics cars[], const int cars_num, ThreadPool & pool)
+{
+	snapshot.Update(cars, cars_num);
+
+	auto update = [&](unsigned i)
+	{
+		// kinematic cars follow the racing line on their own
+		AiCar * ai_car = ai_cars[i];
+		if (!cars[ai_car->GetCarId()].IsKinematic())
+			ai_car->Update(dt, cars, snapshot);
+	};
+
+	// a few cars are not worth waking up the workers
+	const unsigned parallel_min = 8;
+	if (ai_cars.size() < parallel_min)
+	{
+		for (unsigned i = 0; i < ai_cars.size(); ++i)
+			update(i);
+	}
+	else
 	{
-		ai_car->Update(dt, cars, cars_num);
+		pool.ParallelFor(ai_cars.size(), update);
 	}
 }
 
@@ -21,11 +21,13 @@
 #define _AI_H
 
 #include "ai_car.h"
+#include "ai_snapshot.h"
 #include <string>
 #include <vector>
 #include <map>
 
 class AiFactory;
+class ThreadPool;
 
 /// Manages all Ai cars.
 class Ai
@@ -37,9 +39,13 @@ public:
 
 	unsigned AddCar(unsigned carid, float difficulty, const std::string & type = default_type);
 
+	/// speed profiles are shared by ai cars of same type and car class, created on first use
+	void InitSpeedProfile(unsigned id, const std::string & car_class, const CarDynamics & car, const std::vector<RoadStrip> & roads);
+
 	void ClearCars();
 
-	void Update(float dt, const CarDynamics cars[], const int cars_num);
+	/// ai cars are updated in parallel on the pool, results do not depend on thread count
+	void Update(float dt, const CarDynamics cars[], const int cars_num, ThreadPool & pool);
 
 	const std::vector<float> & GetInputs(unsigned id) const;
 
@@ -53,6 +59,9 @@ public:
 
 private:
 	std::vector <AiCar*> ai_cars;
+	std::vector <std::string> ai_types;
+	std::map <std::string, std::shared_ptr<const AiSpeedProfile> > speed_profiles;
+	AiSnapshot snapshot;
 	std::map <std::string, AiFactory*> ai_factories;
 };
 
@@ -21,9 +21,13 @@
 #define _AI_CAR_H
 
 #include "physics/carinput.h"
+#include <memory>
 #include <vector>
 
 class CarDynamics;
+class AiSnapshot;
+class AiSpeedProfile;
+class RoadStrip;
 
 /// AI Car controller interface.
 class AiCar
@@ -37,7 +41,16 @@ public:
 
 	const std::vector<float> & GetInputs() const;
 
-	virtual void Update(float dt, const CarDynamics cars[], const unsigned cars_num) = 0;
+	/// Cars and snapshot are shared by all ai cars which may be updated concurrently,
+	/// an implementation may only modify its own state.
+	virtual void Update(float dt, const CarDynamics cars[], const AiSnapshot & snapshot) = 0;
+
+	/// Optional speed profile along the roads, shared by the ai cars of same type and car class.
+	virtual std::shared_ptr<const AiSpeedProfile> CreateSpeedProfile(
+		const CarDynamics & car,
+		const std::vector<RoadStrip> & roads) const;
+
+	void SetSpeedProfile(std::shared_ptr<const AiSpeedProfile> profile);
 
 	/// This is optional for drawing debug stuff.
 	/// It will only be called, when VISUALIZE_AI_DEBUG macro is defined.
@@ -50,6 +63,8 @@ protected:
 	/// Contains the car inputs, which is the output of the AI.
 	/// The vector is indexed by CARINPUT values.
 	std::vector <float> inputs;
+
+	std::shared_ptr<const AiSpeedProfile> speed_profile;
 };
 
 
@@ -76,6 +91,18 @@ inline const std::vector<float> & AiCar::GetInputs() const
 	return inputs;
 }
 
+inline std::shared_ptr<const AiSpeedProfile> AiCar::CreateSpeedProfile(
+	const CarDynamics & /*car*/,
+	const std::vector<RoadStrip> & /*roads*/) const
+{
+	return std::shared_ptr<const AiSpeedProfile>();
+}
+
+inline void AiCar::SetSpeedProfile(std::shared_ptr<const AiSpeedProfile> profile)
+{
+	speed_profile = profile;
+}
+
 inline void AiCar::Visualize()
 {
 	// optional
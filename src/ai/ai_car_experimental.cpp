@@ -18,6 +18,7 @@
 /************************************************************************/
 
 #include "ai_car_experimental.h"
+#include "ai_snapshot.h"
 #include "physics/cardynamics.h"
 #include "physics/dynamicsworld.h"
 #include "minmax.h"
@@ -95,13 +96,13 @@ float AiCarExperimental::RateLimit(float old_value, float new_value, float rate_
 		return new_value;
 }
 
-void AiCarExperimental::Update(float dt, const CarDynamics cars[], const unsigned cars_num)
+void AiCarExperimental::Update(float dt, const CarDynamics cars[], const AiSnapshot & snapshot)
 {
 	float lastThrottle = inputs[CarInput::THROTTLE];
 	float lastBreak = inputs[CarInput::BRAKE];
 	fill(inputs.begin(), inputs.end(), 0);
 
-	AnalyzeOthers(dt, cars, cars_num);
+	AnalyzeOthers(dt, snapshot);
 	UpdateGasBrake(cars[carid]);
 	UpdateSteer(cars[carid], dt);
 	float rateLimit = THROTTLE_RATE_LIMIT * dt;
@@ -448,30 +449,11 @@ float AiCarExperimental::RayCastDistance(const CarDynamics & car, Vec3 direction
 	return dist;
 }
 
-const RoadPatch * AiCarExperimental::GetNearestPatch(const CarDynamics & car, const RoadPatch * /*helper*/)
+const RoadPatch * AiCarExperimental::GetNearestPatch(const CarDynamics & car, const RoadPatch * helper)
 {
-	// At the moment this is very slow!
-	// TODO: Implement backward chaining for BEZIER, to just look around the helper if passed.
- 	const btVector3 c = car.GetPosition();
-	const RoadPatch * p_end = car.getDynamicsWorld()->GetSectorPatch(0);
-	const RoadPatch * p = p_end->GetNextPatch();
-	const RoadPatch * p_nearest = 0;
-	float v_nearDist = 1000000.0f;
-	while(p != 0 && p != p_end)
-	{
-		Vec3 v(p->GetPoint(2,2));
-		v[0] -= c[1];
-		v[2] -= c[0];
-		float dist = v[0]*v[0]+v[2]*v[2];
-		if(dist < v_nearDist){
-			v_nearDist = dist;
-			p_nearest = p;
-
-		}
-		p = p->GetNextPatch();
-	}
-	assert(p_nearest);
-	return p_nearest;
+	// spatial index lookup over all road patches, falls back to helper if track has no roads
+	const RoadPatch * patch = car.getDynamicsWorld()->GetNearestPatch(car.GetPosition());
+	return patch ? patch : helper;
 }
 
 bool AiCarExperimental::Recover(const CarDynamics & car, float dt, const RoadPatch * /*patch*/)
@@ -532,6 +514,8 @@ void AiCarExperimental::UpdateSteer(const CarDynamics & car, float dt)
 		// if car is off track, steer the car towards the last patch it was on
 		// this should get the car back on track
 		curr_patch_ptr = last_patch;
+		if (!curr_patch_ptr)
+			return;
 
 		// recover to the road.
 		if (Recover(car, dt, curr_patch_ptr))
@@ -623,14 +607,6 @@ void AiCarExperimental::UpdateSteer(const CarDynamics & car, float dt)
 	inputs[CarInput::STEER_RIGHT] = steer_value;
 }
 
-float AiCarExperimental::GetHorizontalDistanceAlongPatch(const RoadPatch & patch, Vec3 carposition)
-{
-	Vec3 leftside = (patch.GetPoint(0,0) + patch.GetPoint(3,0))*0.5f;
-	Vec3 rightside = (patch.GetPoint(0,3) + patch.GetPoint(3,3))*0.5f;
-	Vec3 patchwidthvector = rightside - leftside;
-	return patchwidthvector.Normalize().dot(carposition-leftside);
-}
-
 float AiCarExperimental::RampBetween(float val, float startat, float endat)
 {
 	assert(endat > startat);
@@ -690,69 +666,51 @@ float AiCarExperimental::BrakeFromOthers(float speed_diff)
 	return bias;
 }
 
-void AiCarExperimental::AnalyzeOthers(float dt, const CarDynamics cars[], const unsigned cars_num)
+void AiCarExperimental::AnalyzeOthers(float dt, const AiSnapshot & snapshot)
 {
 	const float half_carlength = 1.25;
+	const float neighbour_range = 100; // road distance to other cars we care about
 	const btVector3 throttle_axis = Direction::forward;
-	const CarDynamics & car = cars[carid];
+	const AiSnapshot::Car & car = snapshot.GetCar(carid);
 
-	if (othercars.size() < cars_num)
-		othercars.resize(cars_num);
+	if (othercars.size() < snapshot.size())
+		othercars.resize(snapshot.size());
 
-	for (unsigned i = 0; i < cars_num; ++i)
+	// cars outside of the neighbour range are ignored
+	for (auto & info : othercars)
 	{
-		if (i == carid)
-			continue;
+		info.active_last = info.active;
+		info.active = false;
+	}
 
-		const CarDynamics & icar = cars[i];
+	snapshot.ForEachNeighbour(carid, neighbour_range, [&](unsigned i)
+	{
+		const AiSnapshot::Car & icar = snapshot.GetCar(i);
 		OtherCarInfo & info = othercars[i];
 
 		// find direction of other cars in our frame
-		btVector3 relative_position = icar.GetCenterOfMass() - car.GetCenterOfMass();
-		relative_position = quatRotate(car.GetOrientation().inverse(), relative_position);
+		btVector3 relative_position = quatRotate(car.orientation_inv, icar.position - car.position);
 
 		// only make a move if the other car is within our distance limit
 		float fore_position = relative_position.dot(throttle_axis);
 
-		btVector3 myvel = quatRotate(car.GetOrientation().inverse(), car.GetVelocity());
-		btVector3 othervel = quatRotate(icar.GetOrientation().inverse(), icar.GetVelocity());
-		float speed_diff = othervel.dot(throttle_axis) - myvel.dot(throttle_axis);
-
 		const float fore_position_offset = -half_carlength;
-		if (fore_position > fore_position_offset)
+		if (fore_position > fore_position_offset && icar.patch && car.patch)
 		{
-			const RoadPatch * othercarpatch = GetCurrentPatch(icar);
-			const RoadPatch * mycarpatch = GetCurrentPatch(car);
+			float speed_diff = icar.local_velocity.dot(throttle_axis) - car.local_velocity.dot(throttle_axis);
+			float speed_diff_denom = Clamp(speed_diff, -100.f, -0.01f);
+			float eta = (fore_position - fore_position_offset) / -speed_diff_denom;
 
-			if (othercarpatch && mycarpatch)
-			{
-				Vec3 mypos = ToMathVector<float>(car.GetCenterOfMass());
-				Vec3 otpos = ToMathVector<float>(icar.GetCenterOfMass());
-				float my_track_placement = GetHorizontalDistanceAlongPatch(*mycarpatch, mypos);
-				float their_track_placement = GetHorizontalDistanceAlongPatch(*othercarpatch, otpos);
-
-				float speed_diff_denom = Clamp(speed_diff, -100.f, -0.01f);
-				float eta = (fore_position - fore_position_offset) / -speed_diff_denom;
-
-				if (!info.active)
-					info.eta = eta;
-				else
-					info.eta = RateLimit(info.eta, eta, 10.f*dt, 10000.f*dt);
-
-				info.horizontal_distance = their_track_placement - my_track_placement;
-				info.fore_distance = fore_position;
-				info.active = true;
-			}
+			if (!info.active_last)
+				info.eta = eta;
 			else
-			{
-				info.active = false;
-			}
-		}
-		else
-		{
-			info.active = false;
+				info.eta = RateLimit(info.eta, eta, 10.f*dt, 10000.f*dt);
+
+			info.horizontal_distance = icar.track_placement - car.track_placement;
+			info.fore_distance = fore_position;
+			info.active = true;
 		}
-	}
+	});
 }
 
 float AiCarExperimental::SteerAwayFromOthers(float carspeed)
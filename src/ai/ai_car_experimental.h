@@ -42,7 +42,7 @@ public:
 
 	~AiCarExperimental();
 
-	void Update(float dt, const CarDynamics cars[], const unsigned cars_num) override;
+	void Update(float dt, const CarDynamics cars[], const AiSnapshot & snapshot) override;
 
 #ifdef VISUALIZE_AI_DEBUG
 	void Visualize() override;
@@ -55,12 +55,13 @@ private:
 
 	struct OtherCarInfo
 	{
-		OtherCarInfo() : active(false) {}
+		OtherCarInfo() : active(false), active_last(false) {}
 
 		float horizontal_distance;
 		float fore_distance;
 		float eta;
 		bool active;
+		bool active_last;
 	};
 	std::vector <OtherCarInfo> othercars;
 
@@ -76,7 +77,7 @@ private:
 
 	void UpdateSteer(const CarDynamics & car, float dt);
 
-	void AnalyzeOthers(float dt, const CarDynamics cars[], const unsigned cars_num);
+	void AnalyzeOthers(float dt, const AiSnapshot & snapshot);
 
 	///< returns a float that should be added into the steering wheel command
 	float SteerAwayFromOthers(float carspeed);
@@ -102,13 +103,11 @@ private:
 
 	static void TrimPatch(RoadPatch & patch, float trimleft_front, float trimright_front, float trimleft_back, float trimright_back);
 
-	static float GetHorizontalDistanceAlongPatch(const RoadPatch & patch, Vec3 carposition);
-
 	static float RampBetween(float val, float startat, float endat);
 
 	/// This will return the nearest patch to the car.
 	/// This is only useful if the car is outside of the road.
-	/// Optionally, you can pass a helper RoadPatch to improve performance, which should be near to the car, but maybe not the nearest.
+	/// The helper patch is returned if the track has no road patches.
 	static const RoadPatch * GetNearestPatch(const CarDynamics & car, const RoadPatch * helper = 0);
 
 	bool Recover(const CarDynamics & car, float dt, const RoadPatch * patch);
@@ -18,11 +18,14 @@
 /************************************************************************/
 
 #include "ai_car_standard.h"
+#include "ai_snapshot.h"
+#include "ai_speed_profile.h"
 #include "physics/cardynamics.h"
 #include "physics/dynamicsworld.h"
 #include "minmax.h"
 #include "tobullet.h"
 #include "track.h"
+#include "roadstrip.h"
 #include "unittest.h"
 
 #include <cassert>
@@ -89,9 +92,9 @@ float AiCarStandard::RateLimit(float old_value, float new_value, float rate_limi
 		return new_value;
 }
 
-void AiCarStandard::Update(float dt, const CarDynamics cars[], const unsigned cars_num)
+void AiCarStandard::Update(float dt, const CarDynamics cars[], const AiSnapshot & snapshot)
 {
-	AnalyzeOthers(dt, cars, cars_num);
+	AnalyzeOthers(dt, snapshot);
 	UpdateGasBrake(cars[carid]);
 	UpdateSteer(cars[carid]);
 }
@@ -287,14 +290,34 @@ void AiCarStandard::UpdateGasBrake(const CarDynamics & car)
 		return;
 	}
 
+	const Vec3 car_velocity = ToMathVector<float>(car.GetVelocity());
+
+	// profiled patches know their speed limits and how fast we may be to brake for the ones ahead
+	float speed_limit = 0, brake_speed = 0;
+	if (speed_profile && speed_profile->Get(curr_patch_ptr, speed_limit, brake_speed))
+	{
+		// the revised patch is centered on the racing line
+		const Vec3 racing_line = curr_patch_ptr->GetNextPatch()->GetRacingLine() - curr_patch_ptr->GetRacingLine();
+		if (racing_line.MagnitudeSquared() > 1E-8f)
+		{
+			float currentspeed = car_velocity.dot(racing_line.Normalize());
+			UpdateGasBrake(currentspeed, speed_limit * difficulty, gas_value, brake_value);
+			if (currentspeed > brake_speed)
+			{
+				brake_value = 1;
+				gas_value = 0;
+			}
+			SetGasBrake(gas_value, brake_value);
+			return;
+		}
+	}
+
 	RoadPatch curr_patch = RevisePatch(curr_patch_ptr);
 
 	const Vec3 patch_direction = GetPatchDirection(curr_patch).Normalize();
-	const Vec3 car_velocity = ToMathVector<float>(car.GetVelocity());
 	float currentspeed = car_velocity.dot(patch_direction);
 
 	// check speed against speed limit of current patch
-	float speed_limit = 0;
 	if (!curr_patch.GetNextPatch())
 	{
 		speed_limit = CalcSpeedLimit(car, &curr_patch, 0, 0);
@@ -306,31 +329,7 @@ void AiCarStandard::UpdateGasBrake(const CarDynamics & car)
 		speed_limit = CalcSpeedLimit(car, &curr_patch, &next_patch, width);
 	}
 	speed_limit *= difficulty;
-
-	float speed_diff = speed_limit - currentspeed;
-	if (speed_diff < 0)
-	{
-		if (-speed_diff < MIN_SPEED_DIFF) //no need to brake if diff is small
-		{
-			brake_value = 0;
-		}
-		else
-		{
-			brake_value = -speed_diff / MAX_SPEED_DIFF;
-			if (brake_value > 1) brake_value = 1;
-		}
-		gas_value = 0;
-	}
-	else if (std::isnan(speed_diff) || speed_diff > MAX_SPEED_DIFF)
-	{
-		gas_value = 1;
-		brake_value = 0;
-	}
-	else
-	{
-		gas_value = speed_diff / MAX_SPEED_DIFF;
-		brake_value = 0.;
-	}
+	UpdateGasBrake(currentspeed, speed_limit, gas_value, brake_value);
 
 	// check upto maxlookahead distance
 	float maxlookahead = car.GetBrakeDistance(currentspeed, 0, FRICTION_FACTOR_LONG) + 10;
@@ -383,6 +382,39 @@ void AiCarStandard::UpdateGasBrake(const CarDynamics & car)
 		}
 	}
 
+	SetGasBrake(gas_value, brake_value);
+}
+
+void AiCarStandard::UpdateGasBrake(float currentspeed, float speed_limit, float & gas_value, float & brake_value)
+{
+	float speed_diff = speed_limit - currentspeed;
+	if (speed_diff < 0)
+	{
+		if (-speed_diff < MIN_SPEED_DIFF) //no need to brake if diff is small
+		{
+			brake_value = 0;
+		}
+		else
+		{
+			brake_value = -speed_diff / MAX_SPEED_DIFF;
+			if (brake_value > 1) brake_value = 1;
+		}
+		gas_value = 0;
+	}
+	else if (std::isnan(speed_diff) || speed_diff > MAX_SPEED_DIFF)
+	{
+		gas_value = 1;
+		brake_value = 0;
+	}
+	else
+	{
+		gas_value = speed_diff / MAX_SPEED_DIFF;
+		brake_value = 0.;
+	}
+}
+
+void AiCarStandard::SetGasBrake(float gas_value, float brake_value)
+{
 	gas_value = RateLimit(inputs[CarInput::THROTTLE], gas_value, THROTTLE_RATE_LIMIT, THROTTLE_RATE_LIMIT);
 	brake_value = RateLimit(inputs[CarInput::BRAKE], brake_value, BRAKE_RATE_LIMIT, BRAKE_RATE_LIMIT);
 
@@ -390,6 +422,44 @@ void AiCarStandard::UpdateGasBrake(const CarDynamics & car)
 	inputs[CarInput::BRAKE] = brake_value;
 }
 
+std::shared_ptr<const AiSpeedProfile> AiCarStandard::CreateSpeedProfile(
+	const CarDynamics & car,
+	const std::vector<RoadStrip> & roads) const
+{
+	// same limits and braking distances as the lookahead in UpdateGasBrake
+	auto profile = std::make_shared<AiSpeedProfile>();
+	auto brake_distance = [&car](float initial_speed, float final_speed)
+	{
+		return car.GetBrakeDistance(initial_speed, final_speed, FRICTION_FACTOR_LONG);
+	};
+	for (const auto & road : roads)
+	{
+		if (!road.GetClosed())
+			continue;
+
+		const std::vector<RoadPatch> & patches = road.GetPatches();
+		std::vector<float> corner_speed(patches.size()), length(patches.size());
+		for (size_t i = 0; i < patches.size(); ++i)
+		{
+			const RoadPatch & patch = patches[i];
+			RoadPatch revised = RevisePatch(&patch);
+			if (!patch.GetNextPatch())
+			{
+				corner_speed[i] = CalcSpeedLimit(car, &revised, 0, 0);
+			}
+			else
+			{
+				RoadPatch next_patch = RevisePatch(patch.GetNextPatch());
+				float width = GetPatchWidthVector(patch).Magnitude();
+				corner_speed[i] = CalcSpeedLimit(car, &revised, &next_patch, width);
+			}
+			length[i] = GetPatchDirection(revised).Magnitude();
+		}
+		profile->AddRoad(road, corner_speed, length, brake_distance);
+	}
+	return profile;
+}
+
 float AiCarStandard::CalcSpeedLimit(
 	const CarDynamics & car,
 	const RoadPatch * patch,
@@ -508,14 +578,6 @@ void AiCarStandard::UpdateSteer(const CarDynamics & car)
 	inputs[CarInput::STEER_RIGHT] = steer_value;
 }
 
-float AiCarStandard::GetHorizontalDistanceAlongPatch(const RoadPatch & patch, Vec3 carposition)
-{
-	Vec3 leftside = (patch.GetPoint(0,0) + patch.GetPoint(3,0))*0.5f;
-	Vec3 rightside = (patch.GetPoint(0,3) + patch.GetPoint(3,3))*0.5f;
-	Vec3 patchwidthvector = rightside - leftside;
-	return patchwidthvector.Normalize().dot(carposition-leftside);
-}
-
 float AiCarStandard::RampBetween(float val, float startat, float endat)
 {
 	assert(endat > startat);
@@ -575,69 +637,51 @@ float AiCarStandard::BrakeFromOthers(float speed_diff)
 	return bias;
 }
 
-void AiCarStandard::AnalyzeOthers(float dt, const CarDynamics cars[], const unsigned cars_num)
+void AiCarStandard::AnalyzeOthers(float dt, const AiSnapshot & snapshot)
 {
 	const float half_carlength = 1.25;
+	const float neighbour_range = 100; // road distance to other cars we care about
 	const btVector3 throttle_axis = Direction::forward;
-	const CarDynamics & car = cars[carid];
+	const AiSnapshot::Car & car = snapshot.GetCar(carid);
 
-	if (othercars.size() < cars_num)
-		othercars.resize(cars_num);
+	if (othercars.size() < snapshot.size())
+		othercars.resize(snapshot.size());
 
-	for (unsigned i = 0; i != cars_num; ++i)
+	// cars outside of the neighbour range are ignored
+	for (auto & info : othercars)
 	{
-		if (i == carid)
-			continue;
+		info.active_last = info.active;
+		info.active = false;
+	}
 
-		const CarDynamics & icar = cars[i];
+	snapshot.ForEachNeighbour(carid, neighbour_range, [&](unsigned i)
+	{
+		const AiSnapshot::Car & icar = snapshot.GetCar(i);
 		OtherCarInfo & info = othercars[i];
 
 		// find direction of other cars in our frame
-		btVector3 relative_position = icar.GetCenterOfMass() - car.GetCenterOfMass();
-		relative_position = quatRotate(car.GetOrientation().inverse(), relative_position);
+		btVector3 relative_position = quatRotate(car.orientation_inv, icar.position - car.position);
 
 		// only make a move if the other car is within our distance limit
 		float fore_position = relative_position.dot(throttle_axis);
 
-		btVector3 myvel = quatRotate(car.GetOrientation().inverse(), car.GetVelocity());
-		btVector3 othervel = quatRotate(icar.GetOrientation().inverse(), icar.GetVelocity());
-		float speed_diff = othervel.dot(throttle_axis) - myvel.dot(throttle_axis);
-
 		const float fore_position_offset = -half_carlength;
-		if (fore_position > fore_position_offset)
+		if (fore_position > fore_position_offset && icar.patch && car.patch)
 		{
-			const RoadPatch * othercarpatch = GetCurrentPatch(icar);
-			const RoadPatch * mycarpatch = GetCurrentPatch(car);
+			float speed_diff = icar.local_velocity.dot(throttle_axis) - car.local_velocity.dot(throttle_axis);
+			float speed_diff_denom = Clamp(speed_diff, -100.f, -0.01f);
+			float eta = (fore_position - fore_position_offset) / -speed_diff_denom;
 
-			if (othercarpatch && mycarpatch)
-			{
-				Vec3 mypos = ToMathVector<float>(car.GetCenterOfMass());
-				Vec3 otpos = ToMathVector<float>(icar.GetCenterOfMass());
-				float my_track_placement = GetHorizontalDistanceAlongPatch(*mycarpatch, mypos);
-				float their_track_placement = GetHorizontalDistanceAlongPatch(*othercarpatch, otpos);
-
-				float speed_diff_denom = Clamp(speed_diff, -100.f, -0.01f);
-				float eta = (fore_position - fore_position_offset) / -speed_diff_denom;
-
-				if (!info.active)
-					info.eta = eta;
-				else
-					info.eta = RateLimit(info.eta, eta, 10.f*dt, 10000.f*dt);
-
-				info.horizontal_distance = their_track_placement - my_track_placement;
-				info.fore_distance = fore_position;
-				info.active = true;
-			}
+			if (!info.active_last)
+				info.eta = eta;
 			else
-			{
-				info.active = false;
-			}
-		}
-		else
-		{
-			info.active = false;
+				info.eta = RateLimit(info.eta, eta, 10.f*dt, 10000.f*dt);
+
+			info.horizontal_distance = icar.track_placement - car.track_placement;
+			info.fore_distance = fore_position;
+			info.active = true;
 		}
-	}
+	});
 }
 
 float AiCarStandard::SteerAwayFromOthers(float carspeed)
@@ -42,7 +42,12 @@ public:
 
 	~AiCarStandard();
 
-	void Update(float dt, const CarDynamics cars[], const unsigned cars_num) override;
+	void Update(float dt, const CarDynamics cars[], const AiSnapshot & snapshot) override;
+
+	/// corner and brake speed limits of the closed roads along the racing line
+	std::shared_ptr<const AiSpeedProfile> CreateSpeedProfile(
+		const CarDynamics & car,
+		const std::vector<RoadStrip> & roads) const override;
 
 #ifdef VISUALIZE_AI_DEBUG
 	void Visualize() override;
@@ -53,17 +58,24 @@ private:
 
 	struct OtherCarInfo
 	{
-		OtherCarInfo() : active(false) {}
+		OtherCarInfo() : active(false), active_last(false) {}
 
 		float horizontal_distance;
 		float fore_distance;
 		float eta;
 		bool active;
+		bool active_last;
 	};
 	std::vector <OtherCarInfo> othercars;
 
 	void UpdateGasBrake(const CarDynamics & car);
 
+	/// gas and brake proportional to the difference of speed limit and current speed
+	static void UpdateGasBrake(float currentspeed, float speed_limit, float & gas_value, float & brake_value);
+
+	/// rate limit and set gas and brake inputs
+	void SetGasBrake(float gas_value, float brake_value);
+
 	static float CalcSpeedLimit(
 		const CarDynamics & car,
 		const RoadPatch * patch,
@@ -72,7 +84,7 @@ private:
 
 	void UpdateSteer(const CarDynamics & car);
 
-	void AnalyzeOthers(float dt, const CarDynamics cars[], const unsigned cars_num);
+	void AnalyzeOthers(float dt, const AiSnapshot & snapshot);
 
 	///< returns a float that should be added into the steering wheel command
 	float SteerAwayFromOthers(float carspeed);
@@ -80,7 +92,7 @@ private:
 	///< returns a float that should be added into the brake command. speed_diff is the difference between the desired speed and speed limit of this area of the track
 	float BrakeFromOthers(float speed_diff);
 
-	RoadPatch RevisePatch(const RoadPatch * origpatch);
+	static RoadPatch RevisePatch(const RoadPatch * origpatch);
 
 	static float RateLimit(float old_value, float new_value, float rate_limit_pos, float rate_limit_neg);
 
@@ -98,8 +110,6 @@ private:
 
 	static void TrimPatch(RoadPatch & patch, float trimleft_front, float trimright_front, float trimleft_back, float trimright_back);
 
-	static float GetHorizontalDistanceAlongPatch(const RoadPatch & patch, Vec3 carposition);
-
 	static float RampBetween(float val, float startat, float endat);
 
 #ifdef VISUALIZE_AI_DEBUG
@@ -0,0 +1,201 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "ai_snapshot.h"
+#include "physics/cardynamics.h"
+#include "roadpatch.h"
+#include "tobullet.h"
+#include "unittest.h"
+
+#include <algorithm>
+#include <functional>
+
+static const RoadPatch * GetCurrentPatch(const CarDynamics & car)
+{
+	const RoadPatch * patch = car.GetWheelContact(WheelPosition(0)).GetPatch();
+	if (!patch)
+		patch = car.GetWheelContact(WheelPosition(1)).GetPatch();
+	return patch;
+}
+
+void AiSnapshot::Update(const CarDynamics dynamics[], unsigned cars_num)
+{
+	cars.resize(cars_num);
+	for (unsigned i = 0; i < cars_num; ++i)
+	{
+		const CarDynamics & dynamic = dynamics[i];
+		Car & car = cars[i];
+		car.position = dynamic.GetCenterOfMass();
+		car.orientation_inv = dynamic.GetOrientation().inverse();
+		car.local_velocity = quatRotate(car.orientation_inv, dynamic.GetVelocity());
+		car.patch = GetCurrentPatch(dynamic);
+		car.track_placement = 0;
+		car.track_distance = 0;
+		car.road = 0;
+		car.road_length = 0;
+		car.road_closed = false;
+
+		if (!car.patch)
+			continue;
+
+		const RoadPatch & patch = *car.patch;
+		const Vec3 position = ToMathVector<float>(car.position);
+		const Vec3 left = (patch.GetPoint(0, 0) + patch.GetPoint(3, 0)) * 0.5f;
+		const Vec3 right = (patch.GetPoint(0, 3) + patch.GetPoint(3, 3)) * 0.5f;
+		car.track_placement = (right - left).Normalize().dot(position - left);
+
+		if (patch.GetRoadStart() && patch.GetRoadLength() > 0)
+		{
+			const Vec3 back = patch.GetBL();
+			const Vec3 forward = patch.GetFL() - back;
+			float dist_from_back = 0;
+			if (forward.MagnitudeSquared() > 1E-8f)
+				dist_from_back = forward.Normalize().dot(position - back);
+
+			car.track_distance = patch.GetDistFromStart() + dist_from_back;
+			car.road = patch.GetRoadStart();
+			car.road_length = patch.GetRoadLength();
+			car.road_closed = patch.IsRoadClosed();
+		}
+	}
+	Sort();
+}
+
+void AiSnapshot::Update(const std::vector<Car> & new_cars)
+{
+	cars = new_cars;
+	Sort();
+}
+
+void AiSnapshot::Sort()
+{
+	const unsigned cars_num = cars.size();
+	rank.assign(cars_num, -1);
+	order.clear();
+	unsorted.clear();
+	for (unsigned i = 0; i < cars_num; ++i)
+	{
+		if (cars[i].road && cars[i].road_length > 0)
+			order.push_back(i);
+		else
+			unsorted.push_back(i);
+	}
+
+	// cars are grouped by road, ties are ordered by car id to keep the order
+	// independent of the sort implementation, the order of the roads
+	// themselves does not matter as neighbours are never on another road
+	std::sort(order.begin(), order.end(), [this](unsigned a, unsigned b)
+	{
+		const Car & ca = cars[a];
+		const Car & cb = cars[b];
+		if (ca.road != cb.road)
+			return std::less<const RoadPatch *>()(ca.road, cb.road);
+		return ca.track_distance < cb.track_distance ||
+			(ca.track_distance == cb.track_distance && a < b);
+	});
+
+	road_begin.resize(order.size());
+	road_end.resize(order.size());
+	for (unsigned r = 0, begin = 0; r < order.size(); ++r)
+	{
+		rank[order[r]] = r;
+		if (cars[order[r]].road != cars[order[begin]].road)
+			begin = r;
+		road_begin[r] = begin;
+	}
+	for (unsigned r = order.size(), end = order.size(); r-- > 0;)
+	{
+		road_end[r] = end;
+		if (road_begin[r] == r)
+			end = r;
+	}
+}
+
+static std::vector<unsigned> GetNeighbours(const AiSnapshot & snapshot, unsigned carid, float range)
+{
+	std::vector<unsigned> ids;
+	snapshot.ForEachNeighbour(carid, range, [&ids](unsigned i) { ids.push_back(i); });
+	std::sort(ids.begin(), ids.end());
+	return ids;
+}
+
+QT_TEST(ai_snapshot_test)
+{
+	std::vector<AiSnapshot::Car> cars(6);
+	for (auto & car : cars)
+	{
+		car.patch = 0;
+		car.track_placement = 0;
+		car.track_distance = 0;
+		car.road = 0;
+		car.road_length = 0;
+		car.road_closed = false;
+	}
+	RoadPatch closed_road, open_road, other_road;
+
+	// closed road, cars 0 and 1 are on both sides of the start line
+	cars[0].track_distance = 990;
+	cars[1].track_distance = 5;
+	cars[2].track_distance = 500;
+	for (unsigned i = 0; i < 3; ++i)
+	{
+		cars[i].road = &closed_road;
+		cars[i].road_length = 1000;
+		cars[i].road_closed = true;
+	}
+
+	// open road, cars 3 and 4 are at both ends
+	cars[3].track_distance = 790;
+	cars[4].track_distance = 5;
+	for (unsigned i = 3; i < 5; ++i)
+	{
+		cars[i].road = &open_road;
+		cars[i].road_length = 800;
+		cars[i].road_closed = false;
+	}
+
+	// car 5 has no road distance
+
+	AiSnapshot snapshot;
+	snapshot.Update(cars);
+
+	const float range = 30;
+	QT_CHECK(GetNeighbours(snapshot, 0, range) == std::vector<unsigned>({1, 5}));
+	QT_CHECK(GetNeighbours(snapshot, 1, range) == std::vector<unsigned>({0, 5}));
+	QT_CHECK(GetNeighbours(snapshot, 2, range) == std::vector<unsigned>({5}));
+	QT_CHECK(GetNeighbours(snapshot, 3, range) == std::vector<unsigned>({5}));
+	QT_CHECK(GetNeighbours(snapshot, 4, range) == std::vector<unsigned>({5}));
+	QT_CHECK(GetNeighbours(snapshot, 5, range) == std::vector<unsigned>({0, 1, 2, 3, 4}));
+	QT_CHECK(GetNeighbours(snapshot, 2, 600) == std::vector<unsigned>({0, 1, 5}));
+	QT_CHECK(GetNeighbours(snapshot, 4, 1000) == std::vector<unsigned>({3, 5}));
+
+	// a road of the same length is still another road
+	cars[4].road = &other_road;
+	cars[4].road_length = 1000;
+	cars[4].track_distance = 995;
+	snapshot.Update(cars);
+	QT_CHECK(GetNeighbours(snapshot, 0, range) == std::vector<unsigned>({1, 5}));
+	QT_CHECK(GetNeighbours(snapshot, 4, range) == std::vector<unsigned>({5}));
+	QT_CHECK(GetNeighbours(snapshot, 3, 1000) == std::vector<unsigned>({5}));
+
+	// a single car on a closed road does not see itself
+	cars.resize(1);
+	snapshot.Update(cars);
+	QT_CHECK(GetNeighbours(snapshot, 0, 2000).empty());
+}
@@ -0,0 +1,130 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _AI_SNAPSHOT_H
+#define _AI_SNAPSHOT_H
+
+#include "LinearMath/btVector3.h"
+#include "LinearMath/btQuaternion.h"
+
+#include <vector>
+
+class CarDynamics;
+class RoadPatch;
+
+/// Per tick state of all cars, shared read only by the ai cars.
+/// Cars on a road with known distances are sorted by road and distance along the road,
+/// so neighbour queries only visit the cars within range of each other.
+class AiSnapshot
+{
+public:
+	struct Car
+	{
+		btVector3 position;             ///< center of mass
+		btQuaternion orientation_inv;   ///< inverse orientation
+		btVector3 local_velocity;       ///< velocity in car frame
+		const RoadPatch * patch;        ///< current patch, null if off track
+		float track_placement;          ///< horizontal distance across the current patch
+		float track_distance;           ///< distance along the road
+		const RoadPatch * road;         ///< first patch of the road, null if road distances are unknown
+		float road_length;              ///< length of the road
+		bool road_closed;               ///< road loops back to its start
+	};
+
+	void Update(const CarDynamics cars[], unsigned cars_num);
+
+	/// update from car states, cars with the same road start patch are on the same road
+	void Update(const std::vector<Car> & cars);
+
+	unsigned size() const
+	{
+		return cars.size();
+	}
+
+	const Car & GetCar(unsigned carid) const
+	{
+		return cars[carid];
+	}
+
+	/// call fn(id) for the other cars within range along the road of car carid
+	/// distances wrap around the start of closed roads only, cars on other roads are skipped
+	/// cars without road distance are always visited, if carid has none all cars are visited
+	template <typename Fn>
+	void ForEachNeighbour(unsigned carid, float range, Fn fn) const;
+
+private:
+	std::vector<Car> cars;
+	std::vector<unsigned> order;    ///< sorted cars by road and road distance
+	std::vector<int> rank;          ///< car position in order, -1 if not sorted
+	std::vector<unsigned> road_begin; ///< position in order of the first car on the same road, by rank
+	std::vector<unsigned> road_end;   ///< position in order after the last car on the same road, by rank
+	std::vector<unsigned> unsorted; ///< cars without road distance
+
+	void Sort();
+};
+
+template <typename Fn>
+inline void AiSnapshot::ForEachNeighbour(unsigned carid, float range, Fn fn) const
+{
+	if (rank[carid] < 0)
+	{
+		for (unsigned i = 0; i < cars.size(); ++i)
+		{
+			if (i != carid)
+				fn(i);
+		}
+		return;
+	}
+
+	// walk ahead and back along the road, wrapping around at the start of closed roads
+	const Car & car = cars[carid];
+	const unsigned begin = road_begin[rank[carid]];
+	const unsigned n = road_end[rank[carid]] - begin;
+	const unsigned r = rank[carid] - begin;
+	const unsigned ahead_max = car.road_closed ? n : n - r;
+	unsigned ahead = 1;
+	for (; ahead < ahead_max; ++ahead)
+	{
+		const unsigned i = order[begin + (r + ahead) % n];
+		float d = cars[i].track_distance - car.track_distance;
+		if (d < 0)
+			d += car.road_length;
+		if (d > range)
+			break;
+		fn(i);
+	}
+	const unsigned back_max = car.road_closed ? n - ahead + 1 : r + 1;
+	for (unsigned back = 1; back < back_max; ++back)
+	{
+		const unsigned i = order[begin + (r + n - back) % n];
+		float d = car.track_distance - cars[i].track_distance;
+		if (d < 0)
+			d += car.road_length;
+		if (d > range)
+			break;
+		fn(i);
+	}
+
+	for (auto i : unsorted)
+	{
+		fn(i);
+	}
+}
+
+#endif // _AI_SNAPSHOT_H
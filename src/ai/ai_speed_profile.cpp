@@ -0,0 +1,212 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "ai_speed_profile.h"
+#include "physics/speedprofile.h"
+#include "roadstrip.h"
+#include "unittest.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <sstream>
+
+// highest initial speed to brake down to final speed within distance
+static float GetBrakeSpeed(const AiSpeedProfile::BrakeDistance & brake_distance, float final_speed, float distance)
+{
+	float lo = final_speed;
+	float hi = final_speed + 100;
+	if (brake_distance(hi, final_speed) <= distance)
+		return hi;
+
+	for (int i = 0; i < 24; ++i)
+	{
+		float v = (lo + hi) * 0.5f;
+		if (brake_distance(v, final_speed) > distance)
+			hi = v;
+		else
+			lo = v;
+	}
+	return lo;
+}
+
+void AiSpeedProfile::AddRoad(
+	const RoadStrip & road,
+	const std::vector<float> & corner_speed,
+	const std::vector<float> & length,
+	const BrakeDistance & brake_distance)
+{
+	const std::vector<RoadPatch> & patches = road.GetPatches();
+	const unsigned n = patches.size();
+	assert(road.GetClosed());
+	assert(corner_speed.size() == n && length.size() == n);
+	if (n == 0)
+		return;
+
+	// index of the next patch, follows the patch links
+	const RoadPatch * first = &patches[0];
+	std::vector<unsigned> next(n);
+	for (unsigned i = 0; i < n; ++i)
+	{
+		const RoadPatch * p = patches[i].GetNextPatch();
+		if (!p || p < first || p >= first + n)
+			return;
+		next[i] = p - first;
+	}
+
+	// patch links have to form a single loop
+	std::vector<unsigned> order(n);
+	std::vector<bool> visited(n, false);
+	for (unsigned i = 0, p = 0; i < n; ++i, p = next[p])
+	{
+		if (visited[p])
+			return;
+		visited[p] = true;
+		order[i] = p;
+	}
+
+	// speed limits in link order, the segment to the next patch
+	// is braked and accelerated over the braking length of the next patch
+	std::vector<float> limit(n), distance(n);
+	for (unsigned k = 0; k < n; ++k)
+	{
+		limit[k] = corner_speed[order[k]];
+		distance[k] = length[next[order[k]]];
+	}
+	auto brake_speed = [&brake_distance](float final_speed, float distance)
+	{
+		return GetBrakeSpeed(brake_distance, final_speed, distance);
+	};
+	LimitSpeedProfile(limit.data(), distance.data(), n, true, brake_speed);
+
+	// brake speed only depends on the limits ahead
+	Road r;
+	r.patches = first;
+	r.corner_speed = corner_speed;
+	r.brake_speed.resize(n);
+	for (unsigned k = 0; k < n; ++k)
+		r.brake_speed[order[k]] = brake_speed(limit[(k + 1) % n], distance[k]);
+
+	roads.push_back(r);
+}
+
+bool AiSpeedProfile::Get(const RoadPatch * patch, float & corner_speed, float & brake_speed) const
+{
+	const Road * road = GetRoad(patch);
+	if (!road)
+		return false;
+
+	const unsigned i = patch - road->patches;
+	corner_speed = road->corner_speed[i];
+	brake_speed = road->brake_speed[i];
+	return true;
+}
+
+const AiSpeedProfile::Road * AiSpeedProfile::GetRoad(const RoadPatch * patch) const
+{
+	for (const auto & road : roads)
+	{
+		if (patch >= road.patches && patch < road.patches + road.corner_speed.size())
+			return &road;
+	}
+	return 0;
+}
+
+QT_TEST(ai_speed_profile_test)
+{
+	// closed ring road of 40 patches with a single slow corner after the start
+	const unsigned n = 40;
+	const float radius = 100, half_width = 5;
+	std::stringstream road_data;
+	road_data << n << "\n";
+	for (unsigned i = 0; i < n; ++i)
+	{
+		const float a0 = 2 * M_PI * i / n;
+		const float a1 = 2 * M_PI * (i + 1) / n;
+		const Vec3 bl(std::cos(a0) * (radius - half_width), std::sin(a0) * (radius - half_width), 0);
+		const Vec3 br(std::cos(a0) * (radius + half_width), std::sin(a0) * (radius + half_width), 0);
+		const Vec3 fl(std::cos(a1) * (radius - half_width), std::sin(a1) * (radius - half_width), 0);
+		const Vec3 fr(std::cos(a1) * (radius + half_width), std::sin(a1) * (radius + half_width), 0);
+		Bezier patch;
+		patch.SetFromCorners(fl, fr, bl, br);
+		for (int x = 0; x < 4; ++x)
+		{
+			for (int y = 0; y < 4; ++y)
+			{
+				const Vec3 & p = patch.GetPoint(x, y);
+				road_data << p[1] << " " << p[2] << " " << p[0] << "\n";
+			}
+		}
+	}
+	RoadStrip road;
+	std::ostringstream error;
+	QT_CHECK(road.ReadFrom(road_data, false, error));
+	QT_CHECK(road.GetClosed());
+	QT_CHECK_EQUAL(road.GetPatches().size(), n);
+
+	// constant deceleration car
+	const float decel = 10;
+	auto brake_distance = [decel](float initial_speed, float final_speed)
+	{
+		return initial_speed > final_speed ? (initial_speed * initial_speed - final_speed * final_speed) / (2 * decel) : 0;
+	};
+
+	const unsigned corner = 2;
+	std::vector<float> corner_speed(n, 60), length(n, 15);
+	corner_speed[corner] = 10;
+
+	AiSpeedProfile profile;
+	QT_CHECK(profile.empty());
+	profile.AddRoad(road, corner_speed, length, brake_distance);
+	QT_CHECK(!profile.empty());
+
+	const auto & patches = road.GetPatches();
+	std::vector<float> corner_limit(n), brake_limit(n);
+	for (unsigned i = 0; i < n; ++i)
+		QT_CHECK(profile.Get(&patches[i], corner_limit[i], brake_limit[i]));
+	QT_CHECK(corner_limit == corner_speed);
+
+	// braking zone ahead of the corner, carried across the start line
+	const float tolerance = 0.01f;
+	QT_CHECK_CLOSE(brake_limit[corner - 1], std::sqrt(10.0f * 10 + 2 * decel * 15), tolerance);
+	QT_CHECK_CLOSE(brake_limit[corner - 2], std::sqrt(10.0f * 10 + 2 * decel * 30), tolerance);
+	QT_CHECK_CLOSE(brake_limit[n - 1], std::sqrt(10.0f * 10 + 2 * decel * 45), tolerance);
+
+	// the speed the car may have on each patch never needs more than the braking
+	// deceleration to get down to the limit of the next patch
+	for (unsigned i = 0; i < n; ++i)
+	{
+		const unsigned j = (i + 1) % n;
+		const float vi = std::min(corner_limit[i], brake_limit[i]);
+		const float vj = std::min(corner_limit[j], brake_limit[j]);
+		QT_CHECK(brake_distance(vi, vj) <= length[j] * (1 + tolerance));
+	}
+
+	// out of the corner the limit does not restrict acceleration, the throttle
+	// is limited by the car and the patch limits only, up to the next braking zone
+	// which starts 11 patches ahead of the corner
+	QT_CHECK_CLOSE(brake_limit[corner], std::sqrt(60.0f * 60 + 2 * decel * 15), tolerance);
+	for (unsigned i = corner + 1; i < n; ++i)
+		QT_CHECK_EQUAL(brake_limit[i] > corner_limit[i], i + 11 < n + corner);
+
+	// patches of other roads are not profiled
+	RoadPatch other;
+	float c = 0, b = 0;
+	QT_CHECK(!profile.Get(&other, c, b));
+}
@@ -0,0 +1,67 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _AI_SPEED_PROFILE_H
+#define _AI_SPEED_PROFILE_H
+
+#include <functional>
+#include <vector>
+
+class RoadPatch;
+class RoadStrip;
+
+/// Speed limits along closed roads for one car class, computed once after track load
+/// and looked up by patch in constant time. Corner speed is the speed limit of the
+/// patch itself, brake speed is the highest speed at which the car can still slow
+/// down to the corner speeds of all patches ahead.
+class AiSpeedProfile
+{
+public:
+	/// brake_distance(initial_speed, final_speed) of the car
+	typedef std::function<float (float, float)> BrakeDistance;
+
+	/// add closed road with per patch corner speed and braking length, indexed like road patches
+	/// braking length of a patch is the distance available to slow down to its corner speed
+	void AddRoad(
+		const RoadStrip & road,
+		const std::vector<float> & corner_speed,
+		const std::vector<float> & length,
+		const BrakeDistance & brake_distance);
+
+	/// return false if patch is not on a road of the profile
+	bool Get(const RoadPatch * patch, float & corner_speed, float & brake_speed) const;
+
+	bool empty() const
+	{
+		return roads.empty();
+	}
+
+private:
+	struct Road
+	{
+		const RoadPatch * patches;
+		std::vector<float> corner_speed;
+		std::vector<float> brake_speed;
+	};
+
+	const Road * GetRoad(const RoadPatch * patch) const;
+	std::vector<Road> roads;
+};
+
+#endif // _AI_SPEED_PROFILE_H
@@ -104,6 +104,7 @@ bool CarSound::Load(
 
 			info.sound_source = sound.AddSource(soundptr, 0, true, true);
 			sound.SetSourceGain(info.sound_source, 0);
+			sound.SetSourcePriority(info.sound_source, 2);
 		}
 
 		// set blend start and end locations -- requires multiple passes
@@ -166,6 +167,7 @@ bool CarSound::Load(
 		content.load(soundptr, carpath, "engine");
 		enginesounds.push_back(EngineSoundInfo());
 		enginesounds.back().sound_source = sound.AddSource(soundptr, 0, true, true);
+		sound.SetSourcePriority(enginesounds.back().sound_source, 2);
 	}
 
 	//set up tire squeal sounds
@@ -174,6 +176,7 @@ bool CarSound::Load(
 		std::shared_ptr<SoundBuffer> soundptr;
 		content.load(soundptr, carpath, "tire_squeal");
 		tiresqueal[i] = sound.AddSource(soundptr, i * 0.25, true, true);
+		sound.SetSourcePriority(tiresqueal[i], 1.5);
 	}
 
 	//set up tire gravel sounds
@@ -212,6 +215,7 @@ bool CarSound::Load(
 		std::shared_ptr<SoundBuffer> soundptr;
 		content.load(soundptr, carpath, "crash");
 		crashsound = sound.AddSource(soundptr, 0, true, false);
+		sound.SetSourcePriority(crashsound, 2);
 	}
 
 	//set up gear sound
@@ -239,6 +243,7 @@ bool CarSound::Load(
 		std::shared_ptr<SoundBuffer> soundptr;
 		content.load(soundptr, carpath, "wind");
 		roadnoise = sound.AddSource(soundptr, 0, true, true);
+		sound.SetSourcePriority(roadnoise, 0.5);
 	}
 
 	psound = &sound;
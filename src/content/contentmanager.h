@@ -241,7 +241,7 @@ inline bool ContentManager::_load(
 template <class T>
 inline void ContentManager::_getdefault(std::shared_ptr<T> & sptr)
 {
-	sptr = Factory<T>(factory_cached).getDefault();
+	sptr = getFactory<T>().getDefault();
 }
 
 template <class T>
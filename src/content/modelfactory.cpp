@@ -20,9 +20,13 @@
 #include "modelfactory.h"
 #include "graphics/model_joe03.h"
 #include <fstream>
+#include <ostream>
 
 Factory<Model>::Factory() :
-	m_default(new Model())
+	m_default(new Model()),
+	m_lods(0),
+	m_optimize(false),
+	m_overdraw(false)
 {
 	// init default model
 	std::ostringstream error;
@@ -32,6 +36,19 @@ Factory<Model>::Factory() :
 	m_default->Load(va, error);
 }
 
+void Factory<Model>::init(bool optimize, bool overdraw, unsigned lods)
+{
+	m_optimize = optimize;
+	m_overdraw = overdraw;
+	m_lods = lods;
+}
+
+void Factory<Model>::genLods(Model & model)
+{
+	if (m_lods && model.GetLodCount() == 1)
+		model.GenLods(m_lods);
+}
+
 template <>
 bool Factory<Model>::create(
 	std::shared_ptr<Model>& sptr,
@@ -47,6 +64,7 @@ bool Factory<Model>::create(
 		std::shared_ptr<ModelJoe03> temp(new ModelJoe03());
 		if (temp->Load(abspath, error))
 		{
+			optimize(*temp);
 			sptr = temp;
 			return true;
 		}
@@ -66,6 +84,7 @@ bool Factory<Model>::create(
 	std::shared_ptr<ModelJoe03> temp(new ModelJoe03());
 	if (temp->Load(name, error, &pack))
 	{
+		optimize(*temp);
 		sptr = temp;
 		return true;
 	}
@@ -94,3 +113,25 @@ const std::shared_ptr<Model> & Factory<Model>::getDefault() const
 {
 	return m_default;
 }
+
+void Factory<Model>::logStats(std::ostream & log)
+{
+	if (m_stats_before.triangles)
+	{
+		log << "Optimized " << m_stats_after.triangles << " triangles: "
+			<< m_stats_before << " -> " << m_stats_after << std::endl;
+	}
+	m_stats_before = MeshOptimize::Stats();
+	m_stats_after = MeshOptimize::Stats();
+}
+
+void Factory<Model>::optimize(Model & model)
+{
+	if (!m_optimize)
+		return;
+
+	MeshOptimize::Stats before, after;
+	model.Optimize(m_overdraw, before, after);
+	m_stats_before += before;
+	m_stats_after += after;
+}
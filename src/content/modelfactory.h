@@ -21,6 +21,7 @@
 #define _MODELFACTORY_H
 
 #include "contentfactory.h"
+#include "graphics/mesh_optimize.h"
 
 class Model;
 
@@ -32,6 +33,14 @@ public:
 
 	Factory();
 
+	/// reorder loaded meshes for gpu vertex cache and fetch efficiency
+	/// overdraw adds the overdraw pass on top of the vertex cache pass
+	/// number of simplified levels of detail to generate for static scenery
+	void init(bool optimize, bool overdraw, unsigned lods);
+
+	/// generate levels of detail, only once per model
+	void genLods(Model & model);
+
 	template <class P>
 	bool create(
 		std::shared_ptr<Model> & sptr,
@@ -43,8 +52,18 @@ public:
 
 	const std::shared_ptr<Model> & getDefault() const;
 
+	/// log and reset accumulated mesh optimization stats
+	void logStats(std::ostream & log);
+
 private:
 	std::shared_ptr<Model> m_default;
+	MeshOptimize::Stats m_stats_before;
+	MeshOptimize::Stats m_stats_after;
+	unsigned m_lods;
+	bool m_optimize;
+	bool m_overdraw;
+
+	void optimize(Model & model);
 };
 
 #endif // _MODELFACTORY_H
@@ -32,11 +32,12 @@ Factory<Texture>::Factory() :
 	// ctor
 }
 
-void Factory<Texture>::init(int max_size, bool use_srgb, bool compress)
+void Factory<Texture>::init(int max_size, bool use_srgb, bool compress, const std::string & cache_path)
 {
 	m_size = max_size;
 	m_srgb = use_srgb;
 	m_compress = compress;
+	m_cache.Init(cache_path);
 
 	// init default texture
 	std::ostringstream error;
@@ -74,9 +75,24 @@ bool Factory<Texture>::create(
 		info_temp.srgb = info.compress && m_srgb; 			// non compressible means non color data
 		info_temp.compress = info.compress && m_compress;	// allow to disable compression
 		info_temp.maxsize = TextureInfo::Size(m_size);
+
+		// cached textures are loaded as dds, fall back to the source on failure
+		const std::string cachepath = m_cache.GetPath(abspath, info_temp);
+		if (!cachepath.empty() && std::ifstream(cachepath.c_str()))
+		{
+			std::ostringstream cache_error;
+			std::shared_ptr<Texture> temp(new Texture());
+			if (temp->Load(cachepath, info_temp, cache_error))
+			{
+				sptr = temp;
+				return true;
+			}
+		}
+
 		std::shared_ptr<Texture> temp(new Texture());
 		if (temp->Load(abspath, info_temp, error))
 		{
+			m_cache.Add(abspath, info_temp, cachepath);
 			sptr = temp;
 			return true;
 		}
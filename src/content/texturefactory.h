@@ -22,6 +22,7 @@
 
 #include "contentfactory.h"
 #include "graphics/textureinfo.h"
+#include "graphics/texture_cache.h"
 
 class Texture;
 
@@ -36,7 +37,8 @@ public:
 	/// in general all textures on disk will be in the SRGB colorspace, so if the renderer wants to do
 	/// gamma correct lighting, it will want all textures to be gamma corrected using the SRGB flag
 	/// limit texture size to max size
-	void init(int max_size, bool use_srgb, bool compress);
+	/// cache_path is the texture cache directory, empty to disable caching
+	void init(int max_size, bool use_srgb, bool compress, const std::string & cache_path = std::string());
 
 	template <class P>
 	bool create(
@@ -56,6 +58,7 @@ public:
 private:
 	std::shared_ptr<Texture> m_default;
 	std::shared_ptr<Texture> m_zero;
+	TextureCache m_cache;
 	int m_size;
 	bool m_compress;
 	bool m_srgb;
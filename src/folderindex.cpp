@@ -0,0 +1,268 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "folderindex.h"
+#include "pathmanager.h"
+#include "thread_pool.h"
+#include "unittest.h"
+
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <list>
+#include <sstream>
+
+static const char folder_index_header[] = "folderindex 3";
+
+// upper bound of the entries of a folder in an index file
+static const size_t folder_index_max_entries = 1 << 16;
+
+static bool GetModificationTime(const std::string & path, long long & mtime)
+{
+	struct stat s;
+	if (stat(path.c_str(), &s) != 0)
+		return false;
+	mtime = s.st_mtime;
+	return true;
+}
+
+static std::string GetMetaFile(const std::string & metafile, const std::string & name)
+{
+	std::string path = metafile;
+	const size_t n = path.find('*');
+	if (n != std::string::npos)
+		path.replace(n, 1, name);
+	return path;
+}
+
+FolderIndex::FolderIndex() :
+	modified(false)
+{
+	// ctor
+}
+
+bool FolderIndex::Load(const std::string & filename)
+{
+	std::ifstream in(filename.c_str());
+	return in && Read(in);
+}
+
+bool FolderIndex::Save(const std::string & filename)
+{
+	if (!modified)
+		return true;
+
+	// write to a temporary file first, a concurrent reader never sees a partial index
+	const std::string tempfile = filename + ".tmp";
+	bool written;
+	{
+		std::ofstream out(tempfile.c_str());
+		Write(out);
+		written = bool(out.flush());
+	}
+	if (!written || std::rename(tempfile.c_str(), filename.c_str()) != 0)
+	{
+		std::remove(tempfile.c_str());
+		return false;
+	}
+
+	modified = false;
+	return true;
+}
+
+const std::vector<FolderIndex::Entry> & FolderIndex::Update(
+	const PathManager & pathmanager,
+	const std::string & path,
+	const std::string & metafile,
+	bool read_info,
+	ThreadPool * pool)
+{
+	std::vector<Entry> & entries = folders[path];
+
+	std::list<std::string> names;
+	if (!pathmanager.GetFileList(path, names))
+	{
+		if (!entries.empty())
+			modified = true;
+		entries.clear();
+		return entries;
+	}
+
+	// a metadata file changed within the last second may change again
+	// with the same modification time, read it again next time
+	const long long now = std::time(0);
+
+	// reuse unchanged entries, collect new and changed ones
+	std::vector<Entry> current;
+	std::vector<Entry> changed;
+	current.reserve(names.size());
+	for (const auto & name : names)
+	{
+		Entry entry;
+		entry.name = name;
+		if (!GetModificationTime(path + "/" + name + "/" + GetMetaFile(metafile, name), entry.mtime))
+			continue;
+		if (entry.mtime >= now - 1)
+			entry.mtime = 0;
+
+		auto i = std::lower_bound(entries.begin(), entries.end(), entry,
+			[](const Entry & a, const Entry & b) { return a.name < b.name; });
+		if (i != entries.end() && i->name == name && i->mtime == entry.mtime && entry.mtime != 0)
+			current.push_back(*i);
+		else
+			changed.push_back(entry);
+	}
+
+	if (!changed.empty() || current.size() != entries.size())
+		modified = true;
+
+	// read metadata of changed entries, entries without info only need to exist
+	const unsigned read_count = read_info ? changed.size() : 0;
+	auto read = [&](unsigned n)
+	{
+		Entry & entry = changed[n];
+		std::ifstream file((path + "/" + entry.name + "/" + GetMetaFile(metafile, entry.name)).c_str());
+		if (file)
+			std::getline(file, entry.info);
+	};
+	if (pool)
+	{
+		pool->ParallelFor(read_count, read);
+	}
+	else
+	{
+		for (unsigned n = 0; n < read_count; ++n)
+			read(n);
+	}
+
+	current.insert(current.end(), changed.begin(), changed.end());
+	std::sort(current.begin(), current.end(),
+		[](const Entry & a, const Entry & b) { return a.name < b.name; });
+	entries.swap(current);
+
+	return entries;
+}
+
+bool FolderIndex::Read(std::istream & in)
+{
+	std::string header;
+	if (!std::getline(in, header) || header != folder_index_header)
+		return false;
+
+	std::map<std::string, std::vector<Entry> > newfolders;
+	std::string path;
+	size_t count = 0;
+	while (std::getline(in, path) && in >> count && in.ignore())
+	{
+		if (count > folder_index_max_entries)
+			return false;
+
+		std::vector<Entry> & entries = newfolders[path];
+		entries.resize(count);
+		for (auto & entry : entries)
+		{
+			if (!(in >> entry.mtime && in.ignore() &&
+				std::getline(in, entry.name) &&
+				std::getline(in, entry.info)))
+				return false;
+		}
+	}
+
+	folders.swap(newfolders);
+	modified = false;
+	return true;
+}
+
+void FolderIndex::Write(std::ostream & out) const
+{
+	out << folder_index_header << "\n";
+	for (const auto & folder : folders)
+	{
+		out << folder.first << "\n" << folder.second.size() << "\n";
+		for (const auto & entry : folder.second)
+		{
+			out << entry.mtime << "\n" << entry.name << "\n" << entry.info << "\n";
+		}
+	}
+}
+
+QT_TEST(folderindex_test)
+{
+	const std::string data =
+		"folderindex 3\n"
+		"data/tracks\n"
+		"2\n"
+		"1234\n"
+		"track a\n"
+		"Track A\n"
+		"5678\n"
+		"track_b\n"
+		"\n";
+
+	FolderIndex index;
+	std::istringstream in(data);
+	QT_CHECK(index.Read(in));
+
+	std::ostringstream out;
+	index.Write(out);
+	QT_CHECK_EQUAL(out.str(), data);
+
+	// truncated index is rejected
+	std::istringstream bad(data.substr(0, data.size() - 14));
+	FolderIndex badindex;
+	QT_CHECK(!badindex.Read(bad));
+	std::istringstream badheader("folderindex 2\n");
+	QT_CHECK(!badindex.Read(badheader));
+	std::istringstream badcount("folderindex 3\ndata/tracks\n4000000000\n");
+	QT_CHECK(!badindex.Read(badcount));
+
+	// cars are listed without reading their metadata
+	PathManager pathmanager;
+	FolderIndex cars;
+	const std::vector<FolderIndex::Entry> & entries = cars.Update(pathmanager, "data/cars", "*.car", false);
+	auto car = std::find_if(entries.begin(), entries.end(),
+		[](const FolderIndex::Entry & e) { return e.name == "3S"; });
+	QT_CHECK(car != entries.end() && car->info.empty());
+	QT_CHECK(std::none_of(entries.begin(), entries.end(),
+		[](const FolderIndex::Entry & e) { return e.name == "SConscript"; }));
+
+	// tracks are listed with the first line of their metadata
+	FolderIndex tracks;
+	const unsigned count = tracks.Update(pathmanager, "data/tracks", "about.txt", true).size();
+	QT_CHECK(count > 0);
+	for (const auto & entry : tracks.Update(pathmanager, "data/tracks", "about.txt", true))
+		QT_CHECK(!entry.info.empty());
+
+	QT_CHECK_EQUAL(tracks.Update(pathmanager, "data/tracks", "about.txt", true).size(), count);
+
+	// an entry is dropped as soon as its metadata file is removed
+	const std::string path = "folderindex_test";
+	const std::string carfile = path + "/A/A.car";
+	PathManager::MakeDir(path);
+	PathManager::MakeDir(path + "/A");
+	std::ofstream(carfile.c_str()) << "car\n";
+	FolderIndex index2;
+	QT_CHECK_EQUAL(index2.Update(pathmanager, path, "*.car", true).size(), 1);
+	std::remove(carfile.c_str());
+	QT_CHECK_EQUAL(index2.Update(pathmanager, path, "*.car", true).size(), 0);
+	PathManager::RemoveDir(path + "/A");
+	PathManager::RemoveDir(path);
+}
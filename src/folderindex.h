@@ -0,0 +1,75 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _FOLDERINDEX_H
+#define _FOLDERINDEX_H
+
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+class PathManager;
+class ThreadPool;
+
+/// Cached listing of content folders like cars and tracks. Each entry folder
+/// has a metadata file, the index stores its first line and modification time.
+/// An update lists the folder and checks the modification time of every metadata
+/// file, only metadata files that are new or changed since the last update are
+/// read. The index is kept on disk between runs.
+class FolderIndex
+{
+public:
+	struct Entry
+	{
+		std::string name;	///< entry folder name
+		std::string info;	///< first line of the metadata file
+		long long mtime;	///< metadata file modification time, 0 to read it again
+	};
+
+	FolderIndex();
+
+	/// load index from file, returns false if there is no valid index
+	bool Load(const std::string & filename);
+
+	/// save index to file if it has been modified
+	bool Save(const std::string & filename);
+
+	/// refresh the entries of folder path, metafile is the metadata file path
+	/// relative to an entry folder with * replaced by the entry name,
+	/// entries without metadata file are skipped, if read_info is set
+	/// the metadata of changed entries is read on the pool
+	/// returns entries sorted by name
+	const std::vector<Entry> & Update(
+		const PathManager & pathmanager,
+		const std::string & path,
+		const std::string & metafile,
+		bool read_info,
+		ThreadPool * pool = 0);
+
+	bool Read(std::istream & in);
+
+	void Write(std::ostream & out) const;
+
+private:
+	std::map<std::string, std::vector<Entry> > folders;
+	bool modified;
+};
+
+#endif // _FOLDERINDEX_H
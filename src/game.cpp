@@ -29,6 +29,8 @@
 #include "utils.h"
 #include "graphics/graphics_gl2.h"
 #include "graphics/graphics_gl3v.h"
+#include "graphics/bcndecode_parallel.h"
+#include "graphics/instance_batch.h"
 #include "cfg/ptree.h"
 #include "svn_sourceforge.h"
 #include "game_downloader.h"
@@ -38,6 +40,11 @@
 #include "hsvtorgb.h"
 #include "camera_orbit.h"
 #include "tokenize.h"
+#include "thread_pool.h"
+#include "uniformcurve.h"
+#include "sound/soundrender.h"
+#include "joeserialize.h"
+#include "textstream.h"
 
 #include <fstream>
 #include <string>
@@ -47,6 +54,12 @@
 #include <sstream>
 #include <algorithm>
 #include <cstdio>
+#include <cfenv>
+#include <iomanip>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
 
 #ifdef _WIN32
 	#define OS_NAME "Windows"
@@ -71,19 +84,43 @@ static T cast(const std::string &str) {
 	return t;
 }
 
-static std::string GetTimeString(float time)
+// fractional values are formatted with the classic locale, snprintf would use the gui locale
+static const char * FormatTime(float time, TextStream & s)
 {
+	s.Reset();
 	if (time != 0)
 	{
 		int minutes = time * (1 / 60.0f);
 		float seconds = time - minutes * 60;
-		std::ostringstream s;
 		s << std::setfill('0');
 		s << std::setw(2) << minutes << ":";
 		s << std::fixed << std::setprecision(3) << std::setw(6) << seconds;
-		return s.str();
 	}
-	return "--:--.---";
+	else
+	{
+		s << "--:--.---";
+	}
+	return s.c_str();
+}
+
+static const char * FormatFloat(float value, TextStream & s)
+{
+	s.Reset();
+	s << value;
+	return s.c_str();
+}
+
+// Same floating point environment on every machine: round to nearest and
+// no flushing of denormals to zero. Ai and tire tables run on the shared
+// thread pool, its workers get the same environment.
+static void SetDeterministicFloatingPoint()
+{
+	std::fesetround(FE_TONEAREST);
+#if defined(__SSE__) || defined(_M_X64)
+	const unsigned int denormals_are_zero = 0x0040;
+	_mm_setcsr(_mm_getcsr() & ~(_MM_FLUSH_ZERO_ON | denormals_are_zero));
+#endif
+	ThreadPool::Shared().SetFloatingPointEnvironment();
 }
 
 Game::Game(std::ostream & info_out, std::ostream & error_out) :
@@ -106,6 +143,7 @@ Game::Game(std::ostream & info_out, std::ostream & error_out) :
 	profilingmode(false),
 	benchmode(false),
 	dumpfps(false),
+	deterministic(false),
 	pause(true),
 	controlgrab_id(0),
 	controlgrab(false),
@@ -282,6 +320,7 @@ bool Game::InitCoreSubsystems()
 {
 	pathmanager.Init(info_output, error_output);
 	http.SetTemporaryFolder(pathmanager.GetTemporaryFolder());
+	folderindex.Load(pathmanager.GetFolderIndexFile());
 
 	settings.Load(pathmanager.GetSettingsFile(), error_output);
 
@@ -390,8 +429,22 @@ bool Game::InitCoreSubsystems()
 	//graphics->SetLocalTime(settings.GetSkyTime());
 	//graphics->SetLocalTimeSpeed(settings.GetSkyTimeSpeed());
 
+	// Bound the texture cache, least recently used files are removed first
+	if (settings.GetTextureCache())
+		pathmanager.PruneFiles(pathmanager.GetTextureCachePath(),
+			(unsigned long long)std::max(settings.GetTextureCacheSize(), 0) << 20);
+
+	// Bound the track map cache, a 256x256 map takes 256 KiB
+	pathmanager.PruneFiles(pathmanager.GetTrackMapCachePath(), 32ull << 20);
+
+	// Bound the racing line cache, a line takes 16 bytes per road patch
+	pathmanager.PruneFiles(pathmanager.GetRacingLineCachePath(), 16ull << 20);
+
 	// Init content factories
-	content.getFactory<Texture>().init(texture_size, using_gl3, settings.GetTextureCompress());
+	content.getFactory<Texture>().init(
+		texture_size, using_gl3, settings.GetTextureCompress(),
+		settings.GetTextureCache() ? pathmanager.GetTextureCachePath() : std::string());
+	content.getFactory<Model>().init(settings.GetMeshOptimize(), settings.GetMeshOverdraw(), std::max(settings.GetMeshLods(), 0));
 	content.getFactory<PTree>().init(read_ini, write_ini, content);
 
 	// Init content paths
@@ -456,6 +509,10 @@ bool Game::InitGUI()
 	for (auto & s : signals)
 		s.disconnect();
 
+	// new labels have to receive the current values
+	for (auto & s : signal_text)
+		s.clear();
+
 	if (!gui.Load(
 		menufiles,
 		valuelists,
@@ -559,6 +616,64 @@ bool Game::ParseArguments(std::list <std::string> & args)
 	}
 	arghelp["-cartest CAR"] = "Run car performance testing on given CAR.";
 
+	if (argmap.find("-bcnbenchmark") != argmap.end())
+	{
+		BcnDecodeBenchmark(info_output, ThreadPool::Shared());
+		continue_game = false;
+	}
+	arghelp["-bcnbenchmark"] = "Measure software texture decoder throughput.";
+
+	if (argmap.find("-curvebenchmark") != argmap.end())
+	{
+		UniformCurveBenchmark(info_output);
+		continue_game = false;
+	}
+	arghelp["-curvebenchmark"] = "Compare spline and table lookup of engine torque curves.";
+
+	if (argmap.find("-soundbenchmark") != argmap.end())
+	{
+		SoundBenchmark(info_output);
+		continue_game = false;
+	}
+	arghelp["-soundbenchmark"] = "Measure offline sound mixer throughput for a range of voice counts.";
+
+	if (argmap.find("-trackmapbenchmark") != argmap.end())
+	{
+		pathmanager.Init(info_output, error_output);
+		std::list <std::string> tracks;
+		pathmanager.GetFileList(pathmanager.GetReadOnlyTracksPath(), tracks);
+		TrackMap::Benchmark(pathmanager.GetReadOnlyTracksPath(), tracks, info_output);
+		continue_game = false;
+	}
+	arghelp["-trackmapbenchmark"] = "Measure track map rasterization time on the road data of all tracks.";
+
+	if (argmap.find("-drawbenchmark") != argmap.end())
+	{
+		pathmanager.Init(info_output, error_output);
+		std::list <std::string> tracks;
+		pathmanager.GetFileList(pathmanager.GetReadOnlyTracksPath(), tracks);
+		InstanceBatcher::Benchmark(pathmanager.GetReadOnlyTracksPath(), tracks, info_output);
+		continue_game = false;
+	}
+	arghelp["-drawbenchmark"] = "Count static object draw calls of all tracks with and without instancing.";
+
+	if (!argmap["-soundrender"].empty())
+	{
+		SoundRenderScript script;
+		SoundRenderStats stats;
+		SoundInfo device(512, 44100, 2, 2);
+		std::vector<unsigned char> stream;
+		if (SoundRender(script, device, &stream, stats, error_output))
+		{
+			std::ofstream file(argmap["-soundrender"].c_str(), std::ios::binary);
+			SoundWriteWav(device, stream, file);
+			info_output << "Rendered " << stats.audio_seconds << "s of " << stats.voices << " voices in "
+				<< stats.cpu_seconds << "s, " << stats.Throughput() << " voice s/cpu s" << std::endl;
+		}
+		continue_game = false;
+	}
+	arghelp["-soundrender FILE"] = "Render a scripted sound scene without audio device into wav FILE.";
+
 	if (!argmap["-profile"].empty())
 	{
 		pathmanager.SetProfile(argmap["-profile"]);
@@ -579,6 +694,23 @@ bool Game::ParseArguments(std::list <std::string> & args)
 	}
 	arghelp["-dumpfps"] = "Continually dump the framerate to the log.";
 
+	if (argmap.find("-deterministic") != argmap.end() || !argmap["-statehash"].empty())
+	{
+		info_output << "Entering deterministic physics mode." << std::endl;
+		SetDeterministicFloatingPoint();
+		replay.SetDeterministic(true);
+		deterministic = true;
+	}
+	arghelp["-deterministic"] = "Reproduce physics bit for bit from identical inputs, replays play back inputs only.";
+
+	if (!argmap["-statehash"].empty())
+	{
+		statehash_output.open(argmap["-statehash"].c_str());
+		if (!statehash_output)
+			error_output << "Failed to open state hash log: " << argmap["-statehash"] << std::endl;
+	}
+	arghelp["-statehash FILE"] = "Log physics state hash per tick to FILE, implies -deterministic.";
+
 
 	if (!argmap["-resolution"].empty())
 	{
@@ -872,7 +1004,7 @@ void Game::AdvanceGameLogic()
 	{
 		PROFILER.beginBlock("ai");
 		ai.Visualize();
-		ai.Update(timestep, &car_dynamics[0], car_dynamics.size());
+		ai.Update(timestep, &car_dynamics[0], car_dynamics.size(), ThreadPool::Shared());
 		PROFILER.endBlock("ai");
 
 		//PROFILER.beginBlock("input");
@@ -880,9 +1012,13 @@ void Game::AdvanceGameLogic()
 		//PROFILER.endBlock("input");
 
 		PROFILER.beginBlock("physics");
+		UpdatePhysicsLod(timestep);
 		dynamics.update(timestep);
 		PROFILER.endBlock("physics");
 
+		if (statehash_output.is_open())
+			LogStateHash();
+
 		PROFILER.beginBlock("car");
 		ProcessCameraInputs();
 		UpdateCars(timestep);
@@ -1300,6 +1436,51 @@ void Game::UpdateCars(float dt)
 			UpdateSkidMarks(i);
 }
 
+void Game::UpdatePhysicsLod(float dt)
+{
+	physics_lod_time.resize(car_dynamics.size(), 0.0f);
+
+	// hysteresis and min time per state avoid toggling cars at the threshold
+	const float demote_distance = settings.GetPhysicsLodDistance();
+	const float promote_distance = demote_distance * 0.75f;
+	const float min_state_time = 1.0f;
+
+	// replays and deterministic mode rely on the full simulation, the
+	// kinematic model also depends on the camera position
+	const bool lod_enabled = demote_distance > 0 && !timer.Staging() &&
+		!replay.GetRecording() && !replay.GetPlaying() && !deterministic;
+
+	btVector3 viewer[2];
+	viewer[0] = car_dynamics[player_car_id].GetPosition();
+	viewer[1] = active_camera ? ToBulletVector(active_camera->GetPosition()) : viewer[0];
+
+	for (int i = 0; i < car_dynamics.size(); ++i)
+	{
+		CarDynamics & car = car_dynamics[i];
+		physics_lod_time[i] += dt;
+
+		const bool ai_car = (i != (int)player_car_id) && !car_info[i].driver.empty();
+		const bool finished = race_laps > 0 && (int)timer.GetCurrentLap(i) > race_laps;
+		const bool enabled = lod_enabled && ai_car && !finished;
+		const btVector3 & position = car.GetPosition();
+		const float distance = Min(position.distance(viewer[0]), position.distance(viewer[1]));
+
+		if (car.IsKinematic())
+		{
+			if (!enabled || (distance < promote_distance && physics_lod_time[i] > min_state_time))
+			{
+				car.SetKinematic(false);
+				physics_lod_time[i] = 0;
+			}
+		}
+		else if (enabled && distance > demote_distance && physics_lod_time[i] > min_state_time)
+		{
+			if (car.SetKinematic(true))
+				physics_lod_time[i] = 0;
+		}
+	}
+}
+
 void Game::ProcessCarInputs()
 {
 	bool player_control = car_info[player_car_id].driver.empty();
@@ -1445,6 +1626,47 @@ void Game::ProcessCameraInputs()
 	graphics->SetCloseShadow(incar ? 1.0 : 5.0);
 }
 
+void Game::PrintSolverStats(std::ostream & out)
+{
+	unsigned ticks = 0, substeps = 0, iterations = 0, kinematic = 0, sleeping = 0;
+	for (int i = 0; i < car_dynamics.size(); ++i)
+	{
+		kinematic += car_dynamics[i].IsKinematic();
+		sleeping += car_dynamics[i].IsSleeping();
+		const CarDynamics::SolverStats & stats = car_dynamics[i].GetSolverStats();
+		ticks += stats.ticks;
+		substeps += stats.substeps;
+		iterations += stats.iterations;
+		car_dynamics[i].ResetSolverStats();
+	}
+
+	out << "Driveline solver\n";
+	out << "Cars: " << car_dynamics.size() << "\n";
+	out << "Kinematic: " << kinematic << "\n";
+	out << "Sleeping: " << sleeping << "\n";
+	if (ticks > 0)
+	{
+		out << std::fixed << std::setprecision(2);
+		out << "Substeps: " << float(substeps) / ticks << "\n";
+		out << "Iterations: " << float(iterations) / ticks << "\n";
+	}
+
+	int bodies_active = 0, bodies_sleeping = 0;
+	dynamics.getActivationStats(bodies_active, bodies_sleeping);
+	out << "Bodies awake: " << bodies_active << "\n";
+	out << "Bodies sleeping: " << bodies_sleeping << "\n";
+}
+
+void Game::LogStateHash()
+{
+	// cars are hashed in load order, which is also their update order
+	joeserialize::HashSerializer hash;
+	for (int i = 0; i < car_dynamics.size(); ++i)
+		car_dynamics[i].SerializeSnapshot(hash);
+
+	statehash_output << frame << " " << std::hex << hash.GetHash() << std::dec << "\n";
+}
+
 void Game::UpdateHUD(const size_t carid, const std::vector<float> & carinputs)
 {
 	const CarDynamics & car = car_dynamics[carid];
@@ -1475,62 +1697,80 @@ void Game::UpdateHUD(const size_t carid, const std::vector<float> & carinputs)
 			std::ostringstream gpu_profile;
 			graphics->printProfilingInfo(gpu_profile);
 
+			std::ostringstream physics_profile;
+			PrintSolverStats(physics_profile);
+
 			signals[DEBUG0](PROFILER.getAvgSummary(quickprof::MICROSECONDS));
 			signals[DEBUG1](gpu_profile.str());
+			signals[DEBUG2](physics_profile.str());
+
+			size_t voices_real, voices_virtual;
+			sound.GetVoiceStats(voices_real, voices_virtual);
+			std::ostringstream sound_profile;
+			sound_profile << "Sound voices\n";
+			sound_profile << "Real: " << voices_real << "\n";
+			sound_profile << "Virtual: " << voices_virtual << "\n";
+			signals[DEBUG3](sound_profile.str());
 		}
 	}
 
+	// hud values are formatted into fixed buffers, only changed values are sent
+	char str[64];
+	TextStream text;
+
 	if (settings.GetInputGraph())
 	{
-		std::ostringstream steeringstr, throttlestr, brakestr;
-		steeringstr << carinputs[CarInput::STEER_RIGHT] - carinputs[CarInput::STEER_LEFT];
-		throttlestr << carinputs[CarInput::THROTTLE];
-		brakestr << carinputs[CarInput::BRAKE];
-
-		signals[STEER](steeringstr.str());
-		signals[ACCEL](throttlestr.str());
-		signals[BRAKE](brakestr.str());
+		SetSignal(STEER, FormatFloat(carinputs[CarInput::STEER_RIGHT] - carinputs[CarInput::STEER_LEFT], text));
+		SetSignal(ACCEL, FormatFloat(carinputs[CarInput::THROTTLE], text));
+		SetSignal(BRAKE, FormatFloat(carinputs[CarInput::BRAKE], text));
 	}
 
+	SetSignal(TIME0, FormatTime(timer.GetTime(carid), text));
+	SetSignal(TIME1, FormatTime(timer.GetLastLap(carid), text));
+	SetSignal(TIME2, FormatTime(timer.GetBestLap(carid), text));
+
 	std::pair <int, int> curplace = timer.GetCarPlace(carid);
-	std::ostringstream placestr;
-	placestr << curplace.first << " / " << curplace.second;
+	std::snprintf(str, sizeof(str), "%d / %d", curplace.first, curplace.second);
+	SetSignal(POS, str);
 
 	int cur_lap = Clamp(timer.GetCurrentLap(carid), 1, race_laps);
-	std::ostringstream lapstr;
 	if (race_laps > 0)
-		lapstr << cur_lap << " / " << race_laps;
+		std::snprintf(str, sizeof(str), "%d / %d", cur_lap, race_laps);
 	else
-		lapstr << "0 / 0";
+		std::snprintf(str, sizeof(str), "0 / 0");
+	SetSignal(LAP, str);
 
 	int score = timer.GetDriftScore(carid);
-	std::ostringstream scorestr;
-	scorestr << score;
+	std::snprintf(str, sizeof(str), "%d", score);
+	SetSignal(SCORE, str);
 
-	std::ostringstream msgstr;
+	str[0] = 0;
 	if (race_laps > 0)
 	{
 		float stagingtimeleft = timer.GetStagingTimeLeft();
 		if (stagingtimeleft > 0.5f)
-			msgstr << (int)stagingtimeleft + 1;
+			std::snprintf(str, sizeof(str), "%d", (int)stagingtimeleft + 1);
 		else if (stagingtimeleft > 0)
-			msgstr << lang("Ready");
+			std::snprintf(str, sizeof(str), "%s", lang("Ready"));
 		else if (stagingtimeleft < 0 && stagingtimeleft > -1)
-			msgstr << lang("GO");
+			std::snprintf(str, sizeof(str), "%s", lang("GO"));
 		else if (timer.GetCurrentLap(carid) > race_laps)
-			msgstr << ((curplace.first == 1) ? lang("You won!") : lang("You lost"));
+			std::snprintf(str, sizeof(str), "%s", (curplace.first == 1) ? lang("You won!") : lang("You lost"));
 	}
-	if (msgstr.tellp() <= 0 && timer.GetIsDrifting(carid))
-		msgstr << "+" << (int)timer.GetThisDriftScore(carid);
+	if (str[0] == 0 && timer.GetIsDrifting(carid))
+		std::snprintf(str, sizeof(str), "+%d", (int)timer.GetThisDriftScore(carid));
+	SetSignal(MSG, str);
 
 	int gear = car.GetTransmission().GetGear();
-	std::ostringstream gearstr;
 	if (gear == -1)
-		gearstr << "R";
+		SetSignal(GEAR, "R");
 	else if (gear == 0)
-		gearstr << "N";
+		SetSignal(GEAR, "N");
 	else
-		gearstr << gear;
+	{
+		std::snprintf(str, sizeof(str), "%d", gear);
+		SetSignal(GEAR, str);
+	}
 
 	float speed_scale = (settings.GetMPH() ? 2.237f : 3.6f);
 	float speed = std::abs(car.GetSpeedMPS()) * speed_scale;
@@ -1542,49 +1782,36 @@ void Game::UpdateHUD(const size_t carid, const std::vector<float> & carinputs)
 	float tachometer = car.GetEngine().GetRPMLimit();
 	tachometer = Clamp(std::ceil(tachometer / 2000.0f) * 2000.0f, 8000.0f, 20000.0f);
 
-	std::ostringstream speedostr, speednstr, speedstr;
-	speedostr << int(speedometer);
-	speednstr << speed / speedometer;
-	speedstr << std::setfill('0') << std::setw(3) << int(speed);
-
-	std::ostringstream shiftstr, tachostr, rpmnstr, rpmrstr, rpmstr;
-	shiftstr << int(rpm >= rpmred);
-	tachostr << int(tachometer);
-	rpmnstr << rpm / tachometer;
-	rpmrstr << rpmred / tachometer;
-	rpmstr << int(rpm);
+	SetSignal(SHIFT, (rpm >= rpmred) ? "1" : "0");
 
-	std::ostringstream absstr, tcsstr, gasstr, nosstr;
-	absstr << (car.GetABSActive() ? 1.0 : 0.3);
-	tcsstr << (car.GetTCSActive() ? 1.0 : 0.3);
-	gasstr << (car.GetFuelAmount() ? 0.3 : 1.0);
-	nosstr << ((car.GetNosAmount() && carinputs[CarInput::NOS]) ? 1.0 : 0.3);
+	std::snprintf(str, sizeof(str), "%d", int(speedometer));
+	SetSignal(SPEEDO, str);
+	SetSignal(SPEEDN, FormatFloat(speed / speedometer, text));
+	std::snprintf(str, sizeof(str), "%03d", int(speed));
+	SetSignal(SPEED, str);
 
-	signals[TIME0](GetTimeString(timer.GetTime(carid)));
-	signals[TIME1](GetTimeString(timer.GetLastLap(carid)));
-	signals[TIME2](GetTimeString(timer.GetBestLap(carid)));
+	std::snprintf(str, sizeof(str), "%d", int(tachometer));
+	SetSignal(TACHO, str);
+	SetSignal(RPMN, FormatFloat(rpm / tachometer, text));
+	SetSignal(RPMR, FormatFloat(rpmred / tachometer, text));
+	std::snprintf(str, sizeof(str), "%d", int(rpm));
+	SetSignal(RPM, str);
 
-	signals[POS](placestr.str());
-	signals[LAP](lapstr.str());
-	signals[SCORE](scorestr.str());
-	signals[MSG](msgstr.str());
-
-	signals[GEAR](gearstr.str());
-	signals[SHIFT](shiftstr.str());
-
-	signals[SPEEDO](speedostr.str());
-	signals[SPEEDN](speednstr.str());
-	signals[SPEED](speedstr.str());
+	SetSignal(ABS, car.GetABSActive() ? "1" : "0.3");
+	SetSignal(TCS, car.GetTCSActive() ? "1" : "0.3");
+	SetSignal(GAS, car.GetFuelAmount() ? "0.3" : "1");
+	SetSignal(NOS, (car.GetNosAmount() && carinputs[CarInput::NOS]) ? "1" : "0.3");
+}
 
-	signals[TACHO](tachostr.str());
-	signals[RPMN](rpmnstr.str());
-	signals[RPMR](rpmrstr.str());
-	signals[RPM](rpmstr.str());
+void Game::SetSignal(GameSignal signal, const char * text)
+{
+	// string compare and assign reuse the stored buffer
+	std::string & value = signal_text[signal];
+	if (value == text)
+		return;
 
-	signals[ABS](absstr.str());
-	signals[TCS](tcsstr.str());
-	signals[GAS](gasstr.str());
-	signals[NOS](nosstr.str());
+	value = text;
+	signals[signal](value);
 }
 
 bool Game::NewGame(bool playreplay, bool addopponents, int num_laps)
@@ -1799,7 +2026,8 @@ bool Game::LoadCar(
 
 	if (!info.driver.empty())
 	{
-		ai.AddCar(carid, info.ailevel, info.driver);
+		unsigned aiid = ai.AddCar(carid, info.ailevel, info.driver);
+		ai.InitSpeedProfile(aiid, info.name + " " + info.variant + " " + info.tire, car, track.GetRoadList());
 		car.SetSteeringAssist(true);
 		car.SetAutoReverse(true);
 		car.SetAutoClutch(true);
@@ -1817,6 +2045,14 @@ bool Game::LoadCar(
 		car.SetTCS(settings.GetTCS());
 	}
 
+	CarDynamics::SolverConfig solver;
+	solver.adaptive = settings.GetDrivelineAdaptive();
+	solver.max_residual = settings.GetDrivelineTolerance();
+	car.SetSolverConfig(solver);
+
+	if (settings.GetTireTables())
+		car.InitTireTables(ThreadPool::Shared(), info_output);
+
 	info_output << "Car loading was successful: " << info.name << std::endl;
 
 	return true;
@@ -1833,6 +2069,7 @@ bool Game::LoadTrack(const std::string & trackname)
 		pathmanager.GetTracksDir()+"/"+trackname,
 		pathmanager.GetEffectsTextureDir(),
 		pathmanager.GetTrackPartsPath(),
+		pathmanager.GetRacingLineCachePath(),
 		settings.GetAnisotropy(),
 		settings.GetTrackReverse(),
 		settings.GetTrackDynamic(),
@@ -1861,6 +2098,8 @@ bool Game::LoadTrack(const std::string & trackname)
 		return false;
 	}
 
+	content.getFactory<Model>().logStats(info_output);
+
 	// Set racing line visibility.
 	track.SetRacingLineVisibility(settings.GetRacingline());
 
@@ -1871,6 +2110,7 @@ bool Game::LoadTrack(const std::string & trackname)
 			track.GetRoadList(),
 			trackname,
 			pathmanager.GetHUDTextureDir(),
+			pathmanager.GetTrackMapCachePath(),
 			content,
 			error_output))
 	{
@@ -1915,6 +2155,7 @@ void Game::LoadGarage()
 		pathmanager.GetTracksDir()+"/"+settings.GetMenuRoom(),
 		pathmanager.GetEffectsTextureDir(),
 		pathmanager.GetTrackPartsPath(),
+		pathmanager.GetRacingLineCachePath(),
 		settings.GetAnisotropy(),
 		track_reverse, track_dynamic,
 		graphics->GetShadows()))
@@ -2046,43 +2287,33 @@ void Game::CalculateFPS()
 
 	if (settings.GetShowFps())
 	{
-		std::ostringstream fpsstr;
-		fpsstr << (int)fps_avg;
-		signals[FPS](fpsstr.str());
+		char fpsstr[16];
+		std::snprintf(fpsstr, sizeof(fpsstr), "%d", (int)fps_avg);
+		SetSignal(FPS, fpsstr);
 	}
 }
 
 static void PopulateCarSet(
 	std::set<std::pair<std::string, std::string> > & set,
 	const std::string & path,
-	const PathManager & pathmanager)
+	const PathManager & pathmanager,
+	FolderIndex & folderindex)
 {
-	std::list<std::string> folders;
-	pathmanager.GetFileList(path, folders);
-	for (const auto & folder : folders)
+	for (const auto & entry : folderindex.Update(pathmanager, path, "*.car", false))
 	{
-		std::ifstream file((path + "/" + folder + "/" + folder + ".car").c_str());
-		if (file)
-			set.emplace(folder, folder);
+		set.emplace(entry.name, entry.name);
 	}
 }
 
 static void PopulateTrackSet(
 	std::set<std::pair<std::string, std::string> > & set,
 	const std::string & path,
-	const PathManager & pathmanager)
+	const PathManager & pathmanager,
+	FolderIndex & folderindex)
 {
-	std::list<std::string> folders;
-	pathmanager.GetFileList(path, folders);
-	for (const auto & folder : folders)
+	for (const auto & entry : folderindex.Update(pathmanager, path, "about.txt", true, &ThreadPool::Shared()))
 	{
-		std::ifstream file((path + "/" + folder + "/about.txt").c_str());
-		if (file)
-		{
-			std::string name;
-			getline(file, name);
-			set.emplace(folder, name);
-		}
+		set.emplace(entry.name, entry.info);
 	}
 }
 
@@ -2099,8 +2330,9 @@ void Game::PopulateTrackList(GuiOption::List & tracklist)
 {
 	// Use set to avoid duplicate entries.
 	std::set<std::pair<std::string, std::string> > trackset;
-	PopulateTrackSet(trackset, pathmanager.GetReadOnlyTracksPath(), pathmanager);
-	PopulateTrackSet(trackset, pathmanager.GetWriteableTracksPath(), pathmanager);
+	PopulateTrackSet(trackset, pathmanager.GetReadOnlyTracksPath(), pathmanager, folderindex);
+	PopulateTrackSet(trackset, pathmanager.GetWriteableTracksPath(), pathmanager, folderindex);
+	folderindex.Save(pathmanager.GetFolderIndexFile());
 
 	tracklist.clear();
 	for (const auto & track : trackset)
@@ -2115,8 +2347,9 @@ void Game::PopulateCarList(GuiOption::List & carlist)
 {
 	// Use set to avoid duplicate entries.
 	std::set <std::pair<std::string, std::string> > carset;
-	PopulateCarSet(carset, pathmanager.GetReadOnlyCarsPath(), pathmanager);
-	PopulateCarSet(carset, pathmanager.GetWriteableCarsPath(), pathmanager);
+	PopulateCarSet(carset, pathmanager.GetReadOnlyCarsPath(), pathmanager, folderindex);
+	PopulateCarSet(carset, pathmanager.GetWriteableCarsPath(), pathmanager, folderindex);
+	folderindex.Save(pathmanager.GetFolderIndexFile());
 
 	carlist.clear();
 	for (const auto & car : carset)
@@ -2560,14 +2793,16 @@ void Game::UpdateParticleGraphics()
 		float znear = 0.1f; // hardcoded in graphics
 		float zfar = settings.GetViewDistance();
 		float fovy = active_camera->GetFOV() > 0 ? active_camera->GetFOV() : settings.GetFOV();
-		float sy = std::sin(fovy * float(M_PI/360.0));
+		float aspect = float(settings.GetResolutionX()) / settings.GetResolutionY();
+		tire_smoke.UpdateGraphics(camorient, campos, znear, zfar, fovy, aspect);
+
 		// compute sin(fov/2) of screen diagonal
+		float sy = std::sin(fovy * float(M_PI/360.0));
 		float rx = settings.GetResolutionX();
 		float ry = settings.GetResolutionY();
 		float rx2 = rx * rx;
 		float ry2 = ry * ry;
 		float s = sy * std::sqrt((rx2 + ry2) / (sy * sy * rx2 + ry2));
-		tire_smoke.UpdateGraphics(camorient, campos, znear, zfar);
 		skid_marks.UpdateGraphics(active_camera->GetOrientation(), campos, znear, zfar, s);
 	}
 }
@@ -2683,6 +2918,7 @@ void Game::LeaveGame()
 	car_dynamics.clear();
 	car_graphics.clear();
 	car_sounds.clear();
+	physics_lod_time.clear();
 	sound.Update(true);
 	trackmap.Unload();
 	timer.Unload();
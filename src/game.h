@@ -26,6 +26,7 @@
 #include "eventsystem.h"
 #include "settings.h"
 #include "pathmanager.h"
+#include "folderindex.h"
 #include "track.h"
 #include "mathvector.h"
 #include "quaternion.h"
@@ -58,7 +59,7 @@
 #include "BulletCollision/BroadphaseCollision/btDbvtBroadphase.h"
 #include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h"
 
-#include <iosfwd>
+#include <fstream>
 #include <string>
 #include <list>
 #include <map>
@@ -106,6 +107,9 @@ private:
 
 	void UpdateCars(float dt);
 
+	/// Switch distant ai cars between full and kinematic simulation
+	void UpdatePhysicsLod(float dt);
+
 	void ProcessCarInputs();
 
 	/// Updates camera, call after physics update
@@ -113,6 +117,13 @@ private:
 
 	void UpdateHUD(const size_t carid, const std::vector<float> & carinputs);
 
+	/// Print car simulation states, average driveline solver effort per car
+	/// and rigid body activation counts, reset the solver counters
+	void PrintSolverStats(std::ostream & out);
+
+	/// Write a hash of all car states for the current tick to the state hash log
+	void LogStateHash();
+
 	void UpdateTimer();
 
 	/// Check eventsystem state and update GUI
@@ -303,6 +314,10 @@ private:
 		SIGNALNUM
 	};
 	Signald<const std::string &> signals[SIGNALNUM];
+	std::string signal_text[SIGNALNUM]; ///< last value sent per signal
+
+	/// send text to the signal listeners if it differs from the last value sent
+	void SetSignal(GameSignal signal, const char * text);
 
 	std::ostream & info_output;
 	std::ostream & error_output;
@@ -314,6 +329,7 @@ private:
 	const float timestep; ///< simulation time step
 
 	PathManager pathmanager;
+	FolderIndex folderindex;
 	Settings settings;
 	Window window;
 	Graphics * graphics;
@@ -336,7 +352,9 @@ private:
 	bool profilingmode;
 	bool benchmode;
 	bool dumpfps;
+	bool deterministic;
 	bool pause;
+	std::ofstream statehash_output;
 
 	std::vector <EventSystem::Joystick> controlgrab_joystick_state;
 	std::pair <int,int> controlgrab_mouse_coords;
@@ -354,6 +372,7 @@ private:
 	std::vector <CarGraphics> car_graphics;
 	std::vector <CarSound> car_sounds;
 	std::vector <CarInfo> car_info;
+	std::vector <float> physics_lod_time;
 	size_t player_car_id;
 	size_t camera_car_id;
 	size_t car_edit_id;
@@ -768,112 +768,122 @@ static void decode_bc6_block(rgb32f *col, const uint8_t* src, int sign) {
 	}
 }
 
-typedef struct {
-	uint8_t * dst;		// destination buffer
-	int width, height;  // destination size
-	int xoff, yoff;		// destination offset
-	int x, y;			// pixel to be written
-	int8_t ystep;		// flip on the y-axis if ystep < 0
-} DecoderState;
-
-static void put_block(DecoderState *state, const uint8_t *col, int sz, int C) {
-	int width = state->width;
-	int height = state->height;
-	int xmax = width + state->xoff;
-	int ymax = height + state->yoff;
-	int j, i, y, x;
-	uint8_t *dst;
-	for (j = 0; j < 4; j++) {
-		y = state->y + j;
-		if (C) {
-			if (y >= height) {
-				continue;
-			}
-			if (state->ystep < 0) {
-				y = state->yoff + ymax - y - 1;
-			}
-			dst = state->dst + sz * (width * y);
-			for (i = 0; i < 4; i++) {
-				x = state->x + i;
-				if (x >= width) {
-					continue;
+static int bcn_block_size(int bcn) {
+	return (bcn == 1 || bcn == 4) ? 8 : 16;
+}
+
+static int bcn_pixel_size(int bcn) {
+	return (bcn == 4) ? (int)sizeof(lum) : (bcn == 6) ? (int)sizeof(rgb32f) : (int)sizeof(rgba);
+}
+
+/* Decode a range of block rows straight into the destination rows.
+   Blocks are decoded into whole pixels with table lookups, edge blocks
+   are clipped on copy, so there is no per-pixel bounds check. */
+static void decode_bcn_rows(
+	uint8_t *dst, const uint8_t *src,
+	int width, int height, int bcn, int sign, int yflip,
+	int row_begin, int row_end)
+{
+	const int bw = (width + 3) / 4;
+	const int bsize = bcn_block_size(bcn);
+	const int psize = bcn_pixel_size(bcn);
+	const int pitch = width * psize;
+	int by, bx, j, rows, cols;
+	for (by = row_begin; by < row_end; by++) {
+		const uint8_t *ptr = src + by * bw * bsize;
+		rows = height - by * 4;
+		if (rows > 4) rows = 4;
+		for (bx = 0; bx < bw; bx++, ptr += bsize) {
+			union {
+				rgba c[16];
+				lum l[16];
+				rgb32f f[16];
+			} col;
+			switch (bcn) {
+			case 1: decode_bc1_block(col.c, ptr); break;
+			case 2: decode_bc2_block(col.c, ptr); break;
+			case 3: decode_bc3_block(col.c, ptr); break;
+			case 4: decode_bc4_block(col.l, ptr); break;
+			case 5:
+				decode_bc5_block(col.c, ptr);
+				for (j = 0; j < 16; j++) {
+					col.c[j].b = 0;
+					col.c[j].a = 0xff;
 				}
-				memcpy(dst + sz * x, col + sz * (j * 4 + i), sz);
+				break;
+			case 6: decode_bc6_block(col.f, ptr, sign); break;
+			case 7:
+				memset(col.c, 0, sizeof(col.c));
+				decode_bc7_block(col.c, ptr);
+				break;
 			}
-		} else {
-			if (state->ystep < 0) {
-				y = state->yoff + ymax - y - 1;
+			cols = width - bx * 4;
+			if (cols > 4) cols = 4;
+			for (j = 0; j < rows; j++) {
+				int y = by * 4 + j;
+				if (yflip) y = height - 1 - y;
+				memcpy(dst + y * pitch + bx * 4 * psize, (const uint8_t *)&col + j * 4 * psize, cols * psize);
 			}
-			x = state->x;
-			dst = state->dst + sz * (width * y + x);
-			memcpy(dst, col + sz * (j * 4), 4 * sz);
 		}
 	}
-	state->x += 4;
-	if (state->x >= xmax) {
-		state->y += 4;
-		state->x = state->xoff;
-	}
 }
 
-static int decode_bcn(DecoderState *state, const uint8_t *src, int src_size, int bcn, int sign) {
-	int c = (state->width & 3) | (state->height & 3) ? 1 : 0;
-	int ymax = state->height + state->yoff;
-	const uint8_t *ptr = src;
-	switch (bcn) {
-#define DECODE_LOOP(NN, SZ, TY)											\
-	case NN:															\
-		while (src_size >= SZ) {										\
-			TY col[16];													\
-			memset(col, 0, 16 * sizeof(col[0]));						\
-			decode_bc##NN##_block(col, ptr);							\
-			put_block(state, (const uint8_t *)col, sizeof(col[0]), c);	\
-			ptr += SZ;													\
-			src_size -= SZ;												\
-			if (state->y >= ymax) return -1;							\
-		}																\
-		break
-	DECODE_LOOP(1, 8, rgba);
-	DECODE_LOOP(2, 16, rgba);
-	DECODE_LOOP(3, 16, rgba);
-	DECODE_LOOP(4, 8, lum);
-	DECODE_LOOP(5, 16, rgba);
-	case 6:
-		while (src_size >= 16) {
-			rgb32f col[16];
-			decode_bc6_block(col, ptr, sign);
-			put_block(state, (const uint8_t *)col, sizeof(col[0]), c);
-			ptr += 16;
-			src_size -= 16;
-			if (state->y >= ymax) return -1;
-		}
-		break;
-	DECODE_LOOP(7, 16, rgba);
-#undef DECODE_LOOP
-	}
-	return (int)(ptr - src);
+static int bcn_check(
+	int dst_size, int src_size,
+	int width, int height, int bcn)
+{
+	if (bcn < 1 || bcn > 7)
+		return -1;
+
+	if (dst_size < bcn_pixel_size(bcn) * width * height)
+		return -1;
+
+	const int size = BcnBlockRowSize(width, bcn) * ((height + 3) / 4);
+	if (src_size < size)
+		return -1;
+
+	return size;
 }
 
-int BcnDecode(
+int BcnBlockRowSize(int width, int bcn)
+{
+	return ((width + 3) / 4) * bcn_block_size(bcn);
+}
+
+int BcnDecodeRows(
 	void *dst, int dst_size,
 	const void *src, int src_size,
 	int width, int height,
-	int bcn, int sign, int yflip)
+	int bcn, int sign, int yflip,
+	int row_begin, int row_end)
 {
 	if (width == 0 || height == 0)
 		return 0;
 
-	if (dst_size < 4 * width * height)
+	if (bcn_check(dst_size, src_size, width, height, bcn) < 0)
 		return -1;
 
-	if (bcn < 1 || bcn > 6)
+	const int rows = (height + 3) / 4;
+	if (row_begin < 0 || row_end > rows || row_begin > row_end)
 		return -1;
 
-	DecoderState state = {0};
-	state.width = width;
-	state.height = height;
-	state.dst = (uint8_t*)dst;
-	state.ystep = yflip ? -1 : 1;
+	decode_bcn_rows((uint8_t*)dst, (const uint8_t*)src, width, height, bcn, sign, yflip, row_begin, row_end);
+	return 0;
+}
+
+int BcnDecode(
+	void *dst, int dst_size,
+	const void *src, int src_size,
+	int width, int height,
+	int bcn, int sign, int yflip)
+{
+	if (width == 0 || height == 0)
+		return 0;
+
+	const int size = bcn_check(dst_size, src_size, width, height, bcn);
+	if (size < 0)
+		return -1;
 
-	return decode_bcn(&state, (const uint8_t*)src, src_size, bcn, sign);
+	decode_bcn_rows((uint8_t*)dst, (const uint8_t*)src, width, height, bcn, sign, yflip, 0, (height + 3) / 4);
+	return size;
 }
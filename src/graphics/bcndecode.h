@@ -3,12 +3,26 @@
 
 // bcn = 1, 2, 3, 5, 7: 4 bytes-per-pixel
 // bcn = 4, 1 byte-per-pixel
-// bcn = 6, 16 bytes-per-pixel (32-bit float)
+// bcn = 6, 12 bytes-per-pixel (3 x 32-bit float)
 // sign = 0, bc6 data is unsigned
+// returns the number of consumed bytes, -1 on failure
 int BcnDecode(
 	void *dst, int dst_size,
 	const void *src, int src_size,
 	int width, int height,
 	int bcn, int sign, int yflip);
 
+// decode block rows [row_begin, row_end) of the image, a block row is 4 pixel rows
+// dst and src point to the whole image, distinct row ranges can be decoded concurrently
+// returns 0 on success, -1 on failure
+int BcnDecodeRows(
+	void *dst, int dst_size,
+	const void *src, int src_size,
+	int width, int height,
+	int bcn, int sign, int yflip,
+	int row_begin, int row_end);
+
+// size in bytes of a row of blocks
+int BcnBlockRowSize(int width, int bcn);
+
 #endif //_BCN_DECODE_H
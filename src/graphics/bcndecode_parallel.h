@@ -0,0 +1,48 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _BCN_DECODE_PARALLEL_H
+#define _BCN_DECODE_PARALLEL_H
+
+#include <iosfwd>
+
+class ThreadPool;
+
+/// Compressed image, e.g. a mip level or cube face, see BcnDecode.
+struct BcnImage
+{
+	void * dst;
+	int dst_size;
+	const void * src;
+	int src_size;
+	int width;
+	int height;
+};
+
+/// Decode images on the thread pool, images are split into chunks of block rows
+/// so that small mip levels and large base levels balance across threads.
+/// Returns false if any of the images failed to decode.
+bool BcnDecodeParallel(
+	const BcnImage images[], unsigned count,
+	int bcn, int sign, ThreadPool & pool);
+
+/// Print decoder throughput of all formats, single threaded and on the thread pool.
+void BcnDecodeBenchmark(std::ostream & out, ThreadPool & pool);
+
+#endif // _BCN_DECODE_PARALLEL_H
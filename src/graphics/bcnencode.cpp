@@ -0,0 +1,393 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+
+#include "bcnencode.h"
+#include "bcndecode.h"
+#include "unittest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// decoded 565 color, matches the decoder bit expansion
+static void Expand565(unsigned c, int rgb[3])
+{
+	const int r = (c >> 11) & 31;
+	const int g = (c >> 5) & 63;
+	const int b = c & 31;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+static unsigned Quantize565(const float rgb[3])
+{
+	const int r = std::min(31, std::max(0, int(rgb[0] * (31.0f / 255.0f) + 0.5f)));
+	const int g = std::min(63, std::max(0, int(rgb[1] * (63.0f / 255.0f) + 0.5f)));
+	const int b = std::min(31, std::max(0, int(rgb[2] * (31.0f / 255.0f) + 0.5f)));
+	return (r << 11) | (g << 5) | b;
+}
+
+// four color palette, index 0 = c0, 1 = c1, 2 = 2/3 c0 + 1/3 c1, 3 = 1/3 c0 + 2/3 c1
+static void Palette565(unsigned c0, unsigned c1, int palette[4][3])
+{
+	Expand565(c0, palette[0]);
+	Expand565(c1, palette[1]);
+	for (int k = 0; k < 3; ++k)
+	{
+		palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+		palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+	}
+}
+
+// assign nearest palette entries, returns squared error
+static unsigned FitIndices(const unsigned char block[16][4], const int palette[4][3], unsigned char indices[16])
+{
+	unsigned error = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		unsigned best = ~0u;
+		for (int j = 0; j < 4; ++j)
+		{
+			const int dr = block[i][0] - palette[j][0];
+			const int dg = block[i][1] - palette[j][1];
+			const int db = block[i][2] - palette[j][2];
+			const unsigned d = dr * dr + dg * dg + db * db;
+			if (d < best)
+			{
+				best = d;
+				indices[i] = j;
+			}
+		}
+		error += best;
+	}
+	return error;
+}
+
+// least squares endpoints for given indices
+static bool RefitEndpoints(const unsigned char block[16][4], const unsigned char indices[16], float e0[3], float e1[3])
+{
+	static const float w0[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+	float aa = 0, bb = 0, ab = 0;
+	float ax[3] = {0, 0, 0};
+	float bx[3] = {0, 0, 0};
+	for (int i = 0; i < 16; ++i)
+	{
+		const float a = w0[indices[i]];
+		const float b = 1.0f - a;
+		aa += a * a;
+		bb += b * b;
+		ab += a * b;
+		for (int k = 0; k < 3; ++k)
+		{
+			ax[k] += a * block[i][k];
+			bx[k] += b * block[i][k];
+		}
+	}
+	const float det = aa * bb - ab * ab;
+	if (std::abs(det) < 1E-6f)
+		return false;
+
+	const float inv = 1.0f / det;
+	for (int k = 0; k < 3; ++k)
+	{
+		e0[k] = (ax[k] * bb - bx[k] * ab) * inv;
+		e1[k] = (bx[k] * aa - ax[k] * ab) * inv;
+	}
+	return true;
+}
+
+static void EncodeColorBlock(const unsigned char block[16][4], unsigned char dst[8])
+{
+	// principal axis of the block colors
+	float mean[3] = {0, 0, 0};
+	for (int i = 0; i < 16; ++i)
+		for (int k = 0; k < 3; ++k)
+			mean[k] += block[i][k];
+	for (int k = 0; k < 3; ++k)
+		mean[k] *= 1.0f / 16.0f;
+
+	float cov[6] = {0, 0, 0, 0, 0, 0};
+	for (int i = 0; i < 16; ++i)
+	{
+		const float r = block[i][0] - mean[0];
+		const float g = block[i][1] - mean[1];
+		const float b = block[i][2] - mean[2];
+		cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+		cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+	}
+
+	float axis[3] = {1, 1, 1};
+	for (int n = 0; n < 4; ++n)
+	{
+		const float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+		const float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+		const float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+		const float m = std::max(std::abs(x), std::max(std::abs(y), std::abs(z)));
+		if (m < 1E-6f)
+			break;
+		axis[0] = x / m; axis[1] = y / m; axis[2] = z / m;
+	}
+	const float len2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+	float tmin = 0, tmax = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		const float t = (
+			(block[i][0] - mean[0]) * axis[0] +
+			(block[i][1] - mean[1]) * axis[1] +
+			(block[i][2] - mean[2]) * axis[2]) / len2;
+		tmin = std::min(tmin, t);
+		tmax = std::max(tmax, t);
+	}
+
+	float e0[3], e1[3];
+	for (int k = 0; k < 3; ++k)
+	{
+		e0[k] = mean[k] + axis[k] * tmax;
+		e1[k] = mean[k] + axis[k] * tmin;
+	}
+
+	unsigned c0 = Quantize565(e0);
+	unsigned c1 = Quantize565(e1);
+	int palette[4][3];
+	unsigned char indices[16];
+	Palette565(c0, c1, palette);
+	unsigned error = FitIndices(block, palette, indices);
+
+	// one least squares refinement step
+	if (error > 0 && RefitEndpoints(block, indices, e0, e1))
+	{
+		const unsigned r0 = Quantize565(e0);
+		const unsigned r1 = Quantize565(e1);
+		int rpalette[4][3];
+		unsigned char rindices[16];
+		Palette565(r0, r1, rpalette);
+		const unsigned rerror = FitIndices(block, rpalette, rindices);
+		if (rerror < error)
+		{
+			c0 = r0;
+			c1 = r1;
+			std::copy(rindices, rindices + 16, indices);
+		}
+	}
+
+	// four color mode requires c0 > c1
+	if (c0 < c1)
+	{
+		std::swap(c0, c1);
+		for (int i = 0; i < 16; ++i)
+			indices[i] ^= 1;
+	}
+	else if (c0 == c1)
+	{
+		std::fill(indices, indices + 16, 0);
+	}
+
+	unsigned lut = 0;
+	for (int i = 0; i < 16; ++i)
+		lut |= unsigned(indices[i]) << (2 * i);
+
+	dst[0] = c0 & 0xff;
+	dst[1] = c0 >> 8;
+	dst[2] = c1 & 0xff;
+	dst[3] = c1 >> 8;
+	dst[4] = lut & 0xff;
+	dst[5] = (lut >> 8) & 0xff;
+	dst[6] = (lut >> 16) & 0xff;
+	dst[7] = lut >> 24;
+}
+
+// single channel block with eight interpolated values
+static void EncodeChannelBlock(const unsigned char block[16][4], int channel, unsigned char dst[8])
+{
+	int a0 = 0, a1 = 255;
+	for (int i = 0; i < 16; ++i)
+	{
+		a0 = std::max(a0, int(block[i][channel]));
+		a1 = std::min(a1, int(block[i][channel]));
+	}
+
+	unsigned long long lut = 0;
+	if (a0 > a1)
+	{
+		int values[8];
+		values[0] = a0;
+		values[1] = a1;
+		for (int j = 1; j < 7; ++j)
+			values[j + 1] = ((7 - j) * a0 + j * a1) / 7;
+
+		for (int i = 0; i < 16; ++i)
+		{
+			const int v = block[i][channel];
+			int best = 256, index = 0;
+			for (int j = 0; j < 8; ++j)
+			{
+				const int d = std::abs(v - values[j]);
+				if (d < best)
+				{
+					best = d;
+					index = j;
+				}
+			}
+			lut |= (unsigned long long)index << (3 * i);
+		}
+	}
+
+	dst[0] = a0;
+	dst[1] = a1;
+	for (int i = 0; i < 6; ++i)
+		dst[2 + i] = (lut >> (8 * i)) & 0xff;
+}
+
+unsigned BcnEncodedSize(unsigned width, unsigned height, int bcn)
+{
+	const unsigned blocks = ((width + 3) / 4) * ((height + 3) / 4);
+	return blocks * ((bcn == 1 || bcn == 4) ? 8 : 16);
+}
+
+bool BcnEncode(
+	unsigned char dst[], const unsigned char src[],
+	unsigned width, unsigned height, int bcn)
+{
+	if (bcn != 1 && bcn != 3 && bcn != 4 && bcn != 5)
+		return false;
+
+	unsigned char block[16][4];
+	for (unsigned by = 0; by < height; by += 4)
+	{
+		for (unsigned bx = 0; bx < width; bx += 4)
+		{
+			for (unsigned j = 0; j < 4; ++j)
+			{
+				const unsigned y = std::min(by + j, height - 1);
+				for (unsigned i = 0; i < 4; ++i)
+				{
+					const unsigned x = std::min(bx + i, width - 1);
+					const unsigned char * p = src + (y * width + x) * 4;
+					std::copy(p, p + 4, block[j * 4 + i]);
+				}
+			}
+
+			if (bcn == 1)
+			{
+				EncodeColorBlock(block, dst);
+				dst += 8;
+			}
+			else if (bcn == 3)
+			{
+				EncodeChannelBlock(block, 3, dst);
+				EncodeColorBlock(block, dst + 8);
+				dst += 16;
+			}
+			else if (bcn == 4)
+			{
+				EncodeChannelBlock(block, 0, dst);
+				dst += 8;
+			}
+			else
+			{
+				EncodeChannelBlock(block, 0, dst);
+				EncodeChannelBlock(block, 1, dst + 8);
+				dst += 16;
+			}
+		}
+	}
+	return true;
+}
+
+// root mean square error of channel over width x height rgba images
+static float Rmse(const unsigned char a[], const unsigned char b[], unsigned count, int channel)
+{
+	double sum = 0;
+	for (unsigned i = 0; i < count; ++i)
+	{
+		const int d = int(a[i * 4 + channel]) - int(b[i * 4 + channel]);
+		sum += d * d;
+	}
+	return std::sqrt(sum / count);
+}
+
+QT_TEST(bcn_encode_test)
+{
+	// smooth gradients with some noise, npot size to exercise edge blocks
+	const unsigned w = 70, h = 38;
+	std::vector<unsigned char> image(w * h * 4);
+	unsigned seed = 1;
+	for (unsigned y = 0; y < h; ++y)
+	{
+		for (unsigned x = 0; x < w; ++x)
+		{
+			seed = seed * 1103515245 + 12345;
+			const int noise = int((seed >> 16) & 7) - 4;
+			unsigned char * p = &image[(y * w + x) * 4];
+			p[0] = std::min(255, std::max(0, int(x * 255 / w) + noise));
+			p[1] = std::min(255, std::max(0, int(y * 255 / h) + noise));
+			p[2] = std::min(255, std::max(0, int((x + y) * 255 / (w + h)) - noise));
+			p[3] = (x / 8 + y / 8) % 2 ? 255 : int(x * 3);
+		}
+	}
+
+	std::vector<unsigned char> decoded(w * h * 4);
+
+	std::vector<unsigned char> bc1(BcnEncodedSize(w, h, 1));
+	QT_CHECK_EQUAL(bc1.size(), 18u * 10u * 8u);
+	QT_CHECK(BcnEncode(bc1.data(), image.data(), w, h, 1));
+	BcnDecode(decoded.data(), decoded.size(), bc1.data(), bc1.size(), w, h, 1, 0, 0);
+	QT_CHECK_LESS(Rmse(image.data(), decoded.data(), w * h, 0), 6.0f);
+	QT_CHECK_LESS(Rmse(image.data(), decoded.data(), w * h, 1), 6.0f);
+	QT_CHECK_LESS(Rmse(image.data(), decoded.data(), w * h, 2), 6.0f);
+	QT_CHECK_EQUAL(Rmse(decoded.data(), std::vector<unsigned char>(w * h * 4, 255).data(), w * h, 3), 0.0f);
+
+	std::vector<unsigned char> bc3(BcnEncodedSize(w, h, 3));
+	QT_CHECK(BcnEncode(bc3.data(), image.data(), w, h, 3));
+	BcnDecode(decoded.data(), decoded.size(), bc3.data(), bc3.size(), w, h, 3, 0, 0);
+	QT_CHECK_LESS(Rmse(image.data(), decoded.data(), w * h, 0), 6.0f);
+	QT_CHECK_LESS(Rmse(image.data(), decoded.data(), w * h, 3), 2.0f);
+
+	std::vector<unsigned char> bc4(BcnEncodedSize(w, h, 4));
+	QT_CHECK_EQUAL(bc4.size(), bc1.size());
+	QT_CHECK(BcnEncode(bc4.data(), image.data(), w, h, 4));
+	std::vector<unsigned char> red(w * h);
+	BcnDecode(red.data(), red.size(), bc4.data(), bc4.size(), w, h, 4, 0, 0);
+	for (unsigned i = 0; i < w * h; ++i)
+		decoded[i * 4] = red[i];
+	QT_CHECK_LESS(Rmse(image.data(), decoded.data(), w * h, 0), 2.0f);
+
+	std::vector<unsigned char> bc5(BcnEncodedSize(w, h, 5));
+	QT_CHECK(BcnEncode(bc5.data(), image.data(), w, h, 5));
+	BcnDecode(decoded.data(), decoded.size(), bc5.data(), bc5.size(), w, h, 5, 0, 0);
+	QT_CHECK_LESS(Rmse(image.data(), decoded.data(), w * h, 0), 2.0f);
+	QT_CHECK_LESS(Rmse(image.data(), decoded.data(), w * h, 1), 2.0f);
+
+	// uniform block is reproduced within 565 precision
+	const unsigned char gray[4] = {100, 150, 200, 255};
+	std::vector<unsigned char> flat(16 * 4);
+	for (unsigned i = 0; i < 16; ++i)
+		std::copy(gray, gray + 4, &flat[i * 4]);
+	unsigned char block[8];
+	QT_CHECK(BcnEncode(block, flat.data(), 4, 4, 1));
+	BcnDecode(decoded.data(), 16 * 4, block, 8, 4, 4, 1, 0, 0);
+	QT_CHECK_LESS(std::abs(decoded[0] - 100), 5);
+	QT_CHECK_LESS(std::abs(decoded[1] - 150), 3);
+	QT_CHECK_LESS(std::abs(decoded[2] - 200), 5);
+
+	QT_CHECK(!BcnEncode(block, flat.data(), 4, 4, 2));
+}
@@ -0,0 +1,35 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+
+#ifndef _BCN_ENCODE_H
+#define _BCN_ENCODE_H
+
+/// Encoded size in bytes of a width x height image, bcn = 1, 3, 4, 5
+unsigned BcnEncodedSize(unsigned width, unsigned height, int bcn);
+
+/// Encode rgba pixels (4 bytes-per-pixel, tightly packed rows) into blocks.
+/// bcn = 1: opaque rgb, bcn = 3: rgb and alpha, bcn = 4: red, bcn = 5: red and green.
+/// Partial edge blocks are padded with edge pixels.
+/// Returns false for unsupported bcn.
+bool BcnEncode(
+	unsigned char dst[], const unsigned char src[],
+	unsigned width, unsigned height, int bcn);
+
+#endif //_BCN_ENCODE_H
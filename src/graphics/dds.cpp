@@ -82,12 +82,18 @@ typedef uint32_t uint32;
 #define FOURCC_DXT4 0x34545844
 #define FOURCC_DXT5 0x35545844
 #define FOURCC_DX10 0x30315844
+#define FOURCC_ATI1 0x31495441
+#define FOURCC_ATI2 0x32495441
 
+#define GL_RED 0x1903
+#define GL_RG 0x8227
 #define GL_BGR 0x80E0
 #define GL_BGRA 0x80E1
 #define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
 #define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
 #define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#define GL_COMPRESSED_RED_RGTC1 0x8DBB
+#define GL_COMPRESSED_RG_RGTC2 0x8DBD
 #define GL_TEXTURE_2D 0x0DE1
 #define GL_TEXTURE_CUBE_MAP 0x8513
 
@@ -221,6 +227,16 @@ static int parse_dds(
                 calcSize = ((width ? ((width + 3) / 4) : 1) * 16) *
                            (height ? ((height + 3) / 4) : 1);
                 break;
+            case FOURCC_ATI1:
+                _glfmt = GL_COMPRESSED_RED_RGTC1;
+                calcSize = ((width ? ((width + 3) / 4) : 1) * 8) *
+                           (height ? ((height + 3) / 4) : 1);
+                break;
+            case FOURCC_ATI2:
+                _glfmt = GL_COMPRESSED_RG_RGTC2;
+                calcSize = ((width ? ((width + 3) / 4) : 1) * 16) *
+                           (height ? ((height + 3) / 4) : 1);
+                break;
 
             // !!! FIXME: DX10 is an extended header, introduced by DirectX 10.
             //case FOURCC_DX10: do_something(); break;
@@ -258,7 +274,30 @@ static int parse_dds(
         calcSize = ((width * header.ddspf.dwRGBBitCount) + 7) / 8;
     } // else if
 
-    //else if (header.ddspf.dwFlags & DDPF_LUMINANCE)  // !!! FIXME
+    // luminance (alpha) is loaded as red (green).
+    else if (header.ddspf.dwFlags & DDPF_LUMINANCE)
+    {
+        if (header.ddspf.dwRBitMask != 0x000000FF)
+            return 0;  // unsupported.
+
+        if (header.ddspf.dwFlags & DDPF_ALPHAPIXELS)
+        {
+            if ( (header.ddspf.dwRGBBitCount != 16) ||
+                 (header.ddspf.dwABitMask != 0x0000FF00) )
+                return 0;  // unsupported.
+            _glfmt = GL_RG;
+        } // if
+        else
+        {
+            if (header.ddspf.dwRGBBitCount != 8)
+                return 0;  // unsupported.
+            _glfmt = GL_RED;
+        } // else
+
+        calcSizeFlag = DDSD_PITCH;
+        calcSize = ((width * header.ddspf.dwRGBBitCount) + 7) / 8;
+    } // else if
+
     //else if (header.ddspf.dwFlags & DDPF_YUV)  // !!! FIXME
     //else if (header.ddspf.dwFlags & DDPF_ALPHA)  // !!! FIXME
     else
@@ -315,4 +354,119 @@ int ReadDDS(
     return 1;
 } // readDDS
 
+static void writeui32(uint8 *&ptr, uint32 val)
+{
+    ptr[0] = (uint8) (val >> 0);
+    ptr[1] = (uint8) (val >> 8);
+    ptr[2] = (uint8) (val >> 16);
+    ptr[3] = (uint8) (val >> 24);
+    ptr += sizeof (val);
+} // writeui32
+
+int WriteDDSHeader(
+    void *_ptr, const unsigned long _len,
+    unsigned int _glfmt,
+    unsigned int _w, unsigned int _h,
+    unsigned int _miplevels)
+{
+    if (_len < 4 + DDS_HEADERSIZE)
+        return 0;
+
+    uint32 flags = DDSD_REQ;
+    uint32 caps = DDSCAPS_TEXTURE;
+    uint32 pitchOrLinearSize = 0;
+    uint32 pfFlags = 0, fourCC = 0, bitCount = 0;
+    uint32 rMask = 0, gMask = 0, bMask = 0, aMask = 0;
+    switch (_glfmt)
+    {
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+            fourCC = FOURCC_DXT1;
+            pitchOrLinearSize = ((_w + 3) / 4) * ((_h + 3) / 4) * 8;
+            break;
+        case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+            fourCC = FOURCC_DXT3;
+            pitchOrLinearSize = ((_w + 3) / 4) * ((_h + 3) / 4) * 16;
+            break;
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+            fourCC = FOURCC_DXT5;
+            pitchOrLinearSize = ((_w + 3) / 4) * ((_h + 3) / 4) * 16;
+            break;
+        case GL_COMPRESSED_RED_RGTC1:
+            fourCC = FOURCC_ATI1;
+            pitchOrLinearSize = ((_w + 3) / 4) * ((_h + 3) / 4) * 8;
+            break;
+        case GL_COMPRESSED_RG_RGTC2:
+            fourCC = FOURCC_ATI2;
+            pitchOrLinearSize = ((_w + 3) / 4) * ((_h + 3) / 4) * 16;
+            break;
+        case GL_BGRA:
+            aMask = 0xFF000000;
+            pfFlags |= DDPF_ALPHAPIXELS;
+            // fall through
+        case GL_BGR:
+            pfFlags |= DDPF_RGB;
+            bitCount = (_glfmt == GL_BGRA) ? 32 : 24;
+            rMask = 0x00FF0000;
+            gMask = 0x0000FF00;
+            bMask = 0x000000FF;
+            pitchOrLinearSize = (_w * bitCount + 7) / 8;
+            break;
+        case GL_RG:
+            aMask = 0x0000FF00;
+            pfFlags |= DDPF_ALPHAPIXELS;
+            // fall through
+        case GL_RED:
+            pfFlags |= DDPF_LUMINANCE;
+            bitCount = (_glfmt == GL_RG) ? 16 : 8;
+            rMask = 0x000000FF;
+            pitchOrLinearSize = (_w * bitCount + 7) / 8;
+            break;
+        default:
+            return 0;  // unsupported data format.
+    } // switch
+
+    if (fourCC)
+    {
+        pfFlags = DDPF_FOURCC;
+        flags |= DDSD_LINEARSIZE;
+    } // if
+    else
+    {
+        flags |= DDSD_PITCH;
+    } // else
+
+    if (_miplevels > 1)
+    {
+        flags |= DDSD_MIPMAPCOUNT;
+        caps |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+    } // if
+
+    uint8 *ptr = (uint8 *) _ptr;
+    writeui32(ptr, DDS_MAGIC);
+    writeui32(ptr, DDS_HEADERSIZE);
+    writeui32(ptr, flags);
+    writeui32(ptr, _h);
+    writeui32(ptr, _w);
+    writeui32(ptr, pitchOrLinearSize);
+    writeui32(ptr, 0);  // depth
+    writeui32(ptr, _miplevels);
+    for (unsigned int i = 0; i < 11; i++)
+        writeui32(ptr, 0);
+    writeui32(ptr, DDS_PIXFMTSIZE);
+    writeui32(ptr, pfFlags);
+    writeui32(ptr, fourCC);
+    writeui32(ptr, bitCount);
+    writeui32(ptr, rMask);
+    writeui32(ptr, gMask);
+    writeui32(ptr, bMask);
+    writeui32(ptr, aMask);
+    writeui32(ptr, caps);
+    writeui32(ptr, 0);  // caps2
+    writeui32(ptr, 0);  // caps3
+    writeui32(ptr, 0);  // caps4
+    writeui32(ptr, 0);  // reserved2
+
+    return (int) (ptr - (uint8 *) _ptr);
+} // WriteDDSHeader
+
 // end of dds.cpp
@@ -10,4 +10,12 @@ int ReadDDS(
 	unsigned int &_w, unsigned int &_h,
 	unsigned int &_miplevels);
 
+// Write magic value and header of a 2d texture with miplevels into _ptr.
+// Returns the number of bytes written, 0 on failure.
+int WriteDDSHeader(
+	void *_ptr, const unsigned long _len,
+	unsigned int _glfmt,
+	unsigned int _w, unsigned int _h,
+	unsigned int _miplevels);
+
 #endif //_DDS_H
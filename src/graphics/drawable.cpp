@@ -20,6 +20,7 @@
 #include "drawable.h"
 #include "texture.h"
 #include "model.h"
+#include <algorithm>
 #include <cmath>
 
 Drawable::Drawable() :
@@ -32,6 +33,7 @@ Drawable::Drawable() :
 	decal(false),
 	drawenabled(true),
 	cull(false),
+	lod(0),
 	textures_changed(true),
 	uniforms_changed(true)
 {
@@ -159,8 +161,26 @@ RenderModelExt & Drawable::GenRenderModelData(const DrawableAttributes & draw_at
 	return render_model;
 }
 
+void Drawable::SelectLod(const Vec3 & campos, float pixel_scale)
+{
+	if (!model || model->GetLodCount() < 2)
+		return;
+
+	const float distance = std::max((center - campos).Magnitude() - radius, 1E-3f);
+	const unsigned level = model->SelectLod(lod, pixel_scale / distance);
+
+	// levels are bound together with the model
+	const VertexBuffer::Segment & sg = model->GetLodVertexBufferSegment(level);
+	if (sg.age == model->GetVertexBufferSegment().age)
+	{
+		lod = level;
+		vsegment = sg;
+	}
+}
+
 void Drawable::SetModel(Model & newmodel)
 {
+	lod = 0;
 	model = &newmodel;
 	radius = newmodel.GetAabb().GetRadius();
 	center = newmodel.GetAabb().GetCenter();
@@ -80,6 +80,11 @@ public:
 	const VertexBuffer::Segment & GetVertexBufferSegment() const;
 	void SetVertexBufferSegment(const VertexBuffer::Segment & segment);
 
+	/// select model level of detail by projected size, for statically bound models
+	/// pixel_scale is the screen height in pixels divided by the vertical fov
+	void SelectLod(const Vec3 & campos, float pixel_scale);
+	unsigned GetLod() const;
+
 private:
 	unsigned tex_id[3];
 	VertexBuffer::Segment vsegment;
@@ -94,6 +99,7 @@ private:
 	bool decal;
 	bool drawenabled;
 	bool cull;
+	unsigned char lod;
 
 	bool textures_changed;
 	bool uniforms_changed;
@@ -190,4 +196,9 @@ inline void Drawable::SetVertexBufferSegment(const VertexBuffer::Segment & segme
 	vsegment = segment;
 }
 
+inline unsigned Drawable::GetLod() const
+{
+	return lod;
+}
+
 #endif // _DRAWABLE_H
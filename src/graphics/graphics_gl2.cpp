@@ -28,6 +28,7 @@
 #include "model.h"
 #include "sky.h"
 #include "tokenize.h"
+#include "utils.h"
 
 /// array end ptr
 template <typename T, size_t N>
@@ -185,6 +186,8 @@ static void AttachCubeSide(int i, FrameBufferObject & reflection_fbo, std::ostre
 	CheckForOpenGLErrors("cubemap generation: FBO cube side attachment", error_output);
 }
 
+const char * const GraphicsGL2::instanced_suffix = "/instanced";
+
 GraphicsGL2::GraphicsGL2() :
 	initialized(false),
 	max_anisotropy(0),
@@ -198,6 +201,7 @@ GraphicsGL2::GraphicsGL2() :
 	contrast(1.0),
 	reflection_status(REFLECTION_DISABLED),
 	renderconfigfile("basic.conf"),
+	instancing(false),
 	renderscene(vertex_buffer),
 	postprocess(vertex_buffer, screen_quad),
 	light_direction(1,1,1),
@@ -297,6 +301,9 @@ bool GraphicsGL2::Init(
 	glGetIntegerv(GL_MAX_DRAW_BUFFERS, &mrt);
 	info_output << "Maximum draw buffers (" << mrtreq << " required): " << mrt << std::endl;
 
+	instancing = VertexBuffer::InstancingSupported();
+	info_output << "Instanced drawing: " << (instancing ? "enabled" : "disabled") << std::endl;
+
 	bool use_fbos = GLC_ARB_framebuffer_object && mrt >= mrtreq && maxattach >= mrtreq;
 	if (renderconfigfile != "basic.conf" && !use_fbos)
 	{
@@ -450,6 +457,8 @@ void GraphicsGL2::DrawScene(std::ostream & error_output)
 	// vertex object might have been modified ouside, reset it
 	glstate.ResetVertexObject();
 
+	renderscene.ResetDrawStats();
+
 	// draw the passes
 	for (const auto & pass : passes)
 	{
@@ -464,6 +473,14 @@ void GraphicsGL2::DrawScene(std::ostream & error_output)
 	glstate.BindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+void GraphicsGL2::printProfilingInfo(std::ostream & out) const
+{
+	const RenderInputScene::DrawStats & stats = renderscene.GetDrawStats();
+	out << "Drawables: " << stats.drawables << std::endl;
+	out << "Draw calls: " << stats.draw_calls << std::endl;
+	out << "Instanced draw calls: " << stats.instanced_calls << std::endl;
+}
+
 int GraphicsGL2::GetMaxAnisotropy() const
 {
 	return max_anisotropy;
@@ -818,6 +835,28 @@ bool GraphicsGL2::SetupFrameBufferObjectsAndShaders(std::ostream & info_output,
 			{
 				return false;
 			}
+
+			// load instanced variant of scene shaders supporting it
+			if (instancing && pass.draw.back() != "postprocess" &&
+				Utils::LoadFileIntoString(shaderpath + "/" + cs->vertex, error_output).find("_INSTANCED_") != std::string::npos)
+			{
+				std::ostringstream instanced_define;
+				instanced_define << "_INSTANCED_ " << RenderInputScene::max_instances;
+				defines.push_back(instanced_define.str());
+
+				std::ostringstream instanced_error;
+				const std::string instanced_name = cs->name + instanced_suffix;
+				if (!shaders[instanced_name].Load(
+					glsl_330, outputs.size(),
+					shaderpath + "/" + cs->vertex,
+					shaderpath + "/" + cs->fragment,
+					defines, uniforms, attributes,
+					info_output, instanced_error))
+				{
+					info_output << "Instancing disabled for shader: " << cs->name << std::endl;
+					shaders.erase(instanced_name);
+				}
+			}
 		}
 	}
 	return true;
@@ -994,6 +1033,9 @@ bool GraphicsGL2::InitScenePass(
 	}
 	pass.shader = &si->second;
 
+	auto sii = shaders.find(pass_config.shader + instanced_suffix);
+	pass.shader_instanced = (sii != shaders.end()) ? &sii->second : NULL;
+
 	// set camera
 	std::string camera_name = pass_config.camera;
 	auto bci = cameras.find(camera_name);
@@ -1004,6 +1046,10 @@ bool GraphicsGL2::InitScenePass(
 	}
 	pass.camera = &bci->second;
 
+	// drawables hold a single level of detail that all passes draw,
+	// it is picked by the main camera and reused by shadow and reflection passes
+	pass.select_lod = (camera_name == "default");
+
 	if (pass.postprocess)
 		return true;
 
@@ -1104,8 +1150,17 @@ void GraphicsGL2::CullScenePass(
 					auto cull = MakeFrustumCullerPersp(frustum.frustum, cam->pos, ct);
 
 					// cull static drawlist
+					const size_t static_begin = draw_list.drawables.size();
 					pass.static_draw_lists[i]->Query(cull, draw_list.drawables);
 
+					// select static drawables level of detail for the main camera
+					if (pass.select_lod)
+					{
+						const float pixel_scale = height / fov;
+						for (size_t n = static_begin; n < draw_list.drawables.size(); ++n)
+							draw_list.drawables[n]->SelectLod(cam->pos, pixel_scale);
+					}
+
 					// cull dynamic drawlist
 					for (const auto & drawable : *pass.dynamic_draw_lists[i])
 					{
@@ -1149,7 +1204,7 @@ void GraphicsGL2::DrawScenePass(
 	const GraphicsPass & pass,
 	std::ostream & error_output)
 {
-	renderscene.SetShader(*pass.shader);
+	renderscene.SetShader(*pass.shader, pass.shader_instanced);
 	renderscene.SetTextures(glstate, pass.textures, error_output);
 	renderscene.SetColorMask(glstate, pass.write_color, pass.write_alpha);
 	renderscene.SetDepthMode(glstate, pass.depth_test, pass.write_depth);
@@ -103,6 +103,8 @@ public:
 
 	void SetLocalTimeSpeed(float value) override;
 
+	void printProfilingInfo(std::ostream & out) const override;
+
 	// Allow external code to use gl state manager.
 	GraphicsState & GetState();
 
@@ -154,6 +156,10 @@ private:
 	typedef std::map <std::string, Shader> ShaderMap;
 	ShaderMap shaders;
 
+	// instanced shader variants are stored with a name suffix
+	static const char * const instanced_suffix;
+	bool instancing;
+
 	// vertex data buffer
 	VertexBuffer vertex_buffer;
 
@@ -207,6 +213,7 @@ private:
 		GraphicsCamera * sub_cameras[6];
 		RenderOutput * output;
 		Shader * shader;
+		Shader * shader_instanced;
 		BlendMode::Enum blend_mode;
 		GLenum depth_test;
 		bool write_depth;
@@ -216,6 +223,7 @@ private:
 		bool clear_color;
 		bool postprocess;
 		bool cull;
+		bool select_lod;
 	};
 	std::vector<GraphicsPass> passes;
 
@@ -38,6 +38,7 @@ GraphicsGL3::GraphicsGL3(StringIdMap & map) :
 	logNextGlFrame(false),
 	initialized(false),
 	fixed_skybox(true),
+	lastCameraFov(90),
 	light_direction(0,0,1),
 	closeshadow(5.f)
 {
@@ -236,6 +237,7 @@ void GraphicsGL3::SetupScene(
 	std::ostream & error_output)
 {
 	lastCameraPosition = cam_position;
+	lastCameraFov = fov;
 
 	const float nearDistance = 0.1;
 
@@ -443,7 +445,7 @@ void GraphicsGL3::AssembleDrawList(const std::vector <Drawable*> & drawables, st
 }
 
 // if frustum is NULL, don't do frustum or contribution culling
-void GraphicsGL3::AssembleDrawList(const AabbTreeNodeAdapter <Drawable> & adapter, std::vector <RenderModelExt*> & out, Frustum * frustum, const Vec3 & camPos)
+void GraphicsGL3::AssembleDrawList(const AabbTreeNodeAdapter <Drawable> & adapter, std::vector <RenderModelExt*> & out, Frustum * frustum, const Vec3 & camPos, bool group, bool select_lod)
 {
 	static std::vector <Drawable*> queryResults;
 	queryResults.clear();
@@ -453,12 +455,31 @@ void GraphicsGL3::AssembleDrawList(const AabbTreeNodeAdapter <Drawable> & adapte
 		float ct = ContributionCullThreshold(float(h));
 		auto cull = MakeFrustumCullerPersp(frustum->frustum, camPos, ct);
 		adapter.Query(cull, queryResults);
+
+		// select static drawables level of detail, only the main camera picks it
+		if (select_lod)
+		{
+			const float pixel_scale = float(h) / (lastCameraFov * float(M_PI / 180));
+			for (auto d : queryResults)
+				d->SelectLod(camPos, pixel_scale);
+		}
 	}
 	else
 	{
 		adapter.Query(Aabb<float>::IntersectAlways(), queryResults);
 	}
 
+	if (group)
+	{
+		// consecutive drawables share vertex array and texture bindings
+		batcher.Build(queryResults, queryResults.size() + 1);
+		for (auto d : batcher.GetDrawables())
+		{
+			out.push_back(&d->GenRenderModelData(drawAttribs));
+		}
+		return;
+	}
+
 	for (auto d : queryResults)
 	{
 		out.push_back(&d->GenRenderModelData(drawAttribs));
@@ -524,7 +545,14 @@ void GraphicsGL3::AssembleDrawMap(std::ostream & /*error_output*/)
 					// assemble static entries
 					auto staticDrawablesPtr = static_drawlist.GetByName(drawGroupString);
 					if (staticDrawablesPtr)
-						AssembleDrawList(*staticDrawablesPtr, outDrawList, frustumPtr, lastCameraPosition);
+					{
+						// grouping reorders the static drawables of a draw group, which only
+						// "noblend" groups tolerate: with depth testing their result doesn't
+						// depend on draw order, while blended groups must keep the tree order
+						const bool opaque = drawGroupString.find("noblend") != std::string::npos;
+						const bool select_lod = getCameraForPass(passName) == "default";
+						AssembleDrawList(*staticDrawablesPtr, outDrawList, frustumPtr, lastCameraPosition, opaque, select_lod);
+					}
 
 					// if it's requesting the full screen rect draw group, feed it our special drawable
 					if (drawGroupString == "full screen rect")
@@ -27,6 +27,7 @@
 #include "texture.h"
 #include "vertexarray.h"
 #include "frustum.h"
+#include "instance_batch.h"
 #include "graphics_config_condition.h"
 #include "gl3v/glwrapper.h"
 #include "gl3v/renderer.h"
@@ -116,6 +117,7 @@ private:
 	bool initialized;
 	bool fixed_skybox;
 	Vec3 lastCameraPosition;
+	float lastCameraFov; ///< vertical field of view of the default camera in degrees
 	Vec3 light_direction;
 
 	struct CameraMatrices
@@ -163,9 +165,14 @@ private:
 	// this is complicated but it lets us do culling per camera position and draw group combination
 	std::map <StringId, std::map <StringId, std::vector <RenderModelExt*> *> > drawMap;
 
+	// static drawables grouping
+	InstanceBatcher batcher;
+
 	// drawlist assembly functions
 	void AssembleDrawList(const std::vector <Drawable*> & drawables, std::vector <RenderModelExt*> & out, Frustum * frustum, const Vec3 & camPos);
-	void AssembleDrawList(const AabbTreeNodeAdapter <Drawable> & adapter, std::vector <RenderModelExt*> & out, Frustum * frustum, const Vec3 & camPos);
+	/// group drawables sharing vertex data and textures if group is set, this changes
+	/// their draw order and is only used for opaque ("noblend") draw groups
+	void AssembleDrawList(const AabbTreeNodeAdapter <Drawable> & adapter, std::vector <RenderModelExt*> & out, Frustum * frustum, const Vec3 & camPos, bool group, bool select_lod);
 	void AssembleDrawMap(std::ostream & error_output);
 
 	// a map that stores which camera each pass uses
@@ -0,0 +1,322 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+
+#include "instance_batch.h"
+#include "drawable.h"
+#include "unittest.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+
+static int Compare(unsigned a, unsigned b)
+{
+	return (a < b) ? -1 : (b < a) ? 1 : 0;
+}
+
+static int Compare(const Drawable & a, const Drawable & b)
+{
+	const VertexBuffer::Segment & sa = a.GetVertexBufferSegment();
+	const VertexBuffer::Segment & sb = b.GetVertexBufferSegment();
+	int c;
+	if ((c = Compare(sa.vbuffer, sb.vbuffer))) return c;
+	if ((c = Compare(sa.ioffset, sb.ioffset))) return c;
+	if ((c = Compare(sa.icount, sb.icount))) return c;
+	if ((c = Compare(sa.voffset, sb.voffset))) return c;
+	if ((c = Compare(sa.vcount, sb.vcount))) return c;
+	if ((c = Compare(sa.object, sb.object))) return c;
+	if ((c = Compare(a.GetTexture0(), b.GetTexture0()))) return c;
+	if ((c = Compare(a.GetTexture1(), b.GetTexture1()))) return c;
+	if ((c = Compare(a.GetTexture2(), b.GetTexture2()))) return c;
+	if ((c = Compare(a.GetDecal(), b.GetDecal()))) return c;
+	if ((c = Compare(a.GetCull(), b.GetCull()))) return c;
+	const Vec4 & ca = a.GetColor();
+	const Vec4 & cb = b.GetColor();
+	for (int i = 0; i < 4; ++i)
+	{
+		if (ca[i] < cb[i]) return -1;
+		if (cb[i] < ca[i]) return 1;
+	}
+	return 0;
+}
+
+bool InstanceBatcher::Equal(const Drawable & a, const Drawable & b)
+{
+	return Compare(a, b) == 0;
+}
+
+bool InstanceBatcher::Less(const Drawable & a, const Drawable & b)
+{
+	return Compare(a, b) < 0;
+}
+
+void InstanceBatcher::Build(const std::vector<Drawable*> & drawlist, unsigned max_instances)
+{
+	assert(max_instances > 0);
+
+	entries.resize(drawlist.size());
+	for (unsigned i = 0; i < drawlist.size(); ++i)
+	{
+		entries[i].drawable = drawlist[i];
+		entries[i].index = i;
+	}
+
+	// stable sort keeps drawlist order within a batch
+	std::stable_sort(entries.begin(), entries.end(),
+		[](const Entry & a, const Entry & b) { return Less(*a.drawable, *b.drawable); });
+
+	// split into runs of equal drawables, at most max_instances long
+	ranges.clear();
+	for (unsigned i = 0; i < entries.size(); )
+	{
+		unsigned n = 1;
+		while (i + n < entries.size() && n < max_instances &&
+			Equal(*entries[i].drawable, *entries[i + n].drawable))
+		{
+			++n;
+		}
+		Range r;
+		r.first = entries[i].index;
+		r.offset = i;
+		r.count = n;
+		ranges.push_back(r);
+		i += n;
+	}
+
+	// restore drawlist order of batches
+	std::sort(ranges.begin(), ranges.end(),
+		[](const Range & a, const Range & b) { return a.first < b.first; });
+
+	batches.resize(ranges.size());
+	drawables.resize(entries.size());
+	unsigned offset = 0;
+	for (unsigned i = 0; i < ranges.size(); ++i)
+	{
+		const Range & r = ranges[i];
+		batches[i].offset = offset;
+		batches[i].count = r.count;
+		for (unsigned j = 0; j < r.count; ++j)
+			drawables[offset + j] = entries[r.offset + j].drawable;
+		offset += r.count;
+	}
+}
+
+// read next token of a track object list, skipping comment lines
+static bool ReadToken(std::istream & in, std::string & token)
+{
+	while (in >> token)
+	{
+		if (token[0] != '#')
+			return true;
+		in.ignore(1024, '\n');
+	}
+	return false;
+}
+
+static unsigned GetId(std::map<std::string, unsigned> & ids, const std::string & name)
+{
+	return ids.insert(std::make_pair(name, unsigned(ids.size() + 1))).first->second;
+}
+
+void InstanceBatcher::Benchmark(
+	const std::string & trackspath,
+	const std::list<std::string> & tracks,
+	std::ostream & out)
+{
+	// draw calls of the whole track, nothing is culled
+	// batch size limit of RenderInputScene::max_instances
+	const unsigned max_instances = 16;
+	const int iterations = 100;
+
+	out << std::left << std::setw(24) << "track" << std::right
+		<< std::setw(12) << "drawables"
+		<< std::setw(12) << "draw calls"
+		<< std::setw(12) << "group ms" << std::endl;
+
+	for (const auto & track : tracks)
+	{
+		const std::string objectpath = trackspath + "/" + track + "/objects";
+		std::ifstream list((objectpath + "/list.txt").c_str());
+		std::string token;
+		if (!ReadToken(list, token))
+			continue;
+
+		// object parameters as read by Track::Loader::ContinueOld
+		const int params = std::atoi(token.c_str());
+		if (params < 17)
+			continue;
+
+		// opaque static draw lists: normal, normal without lighting, skybox
+		// equal models and textures get equal vertex segments and texture ids
+		std::vector<Drawable> scene;
+		std::vector<int> layers;
+		std::map<std::string, unsigned> models, textures;
+		std::vector<std::string> p(params);
+		while (ReadToken(list, p[0]))
+		{
+			for (int i = 1; i < params; ++i)
+				ReadToken(list, p[i]);
+
+			const std::string & texture = p[1];
+			const bool nolighting = p[3] == "1";
+			const bool skybox = p[4] == "1";
+			const int transparent_blend = std::atoi(p[5].c_str());
+			const std::string & clamp = p[15];
+			if (transparent_blend == 1)
+				continue;
+
+			const std::string base = texture.substr(0, std::max<int>(0, texture.length() - 4));
+			const std::string misc1 = base + "-misc1.png";
+			const std::string misc2 = base + "-misc2.png";
+			const bool has_misc1 = std::ifstream((objectpath + "/" + misc1).c_str()).good();
+			const bool has_misc2 = std::ifstream((objectpath + "/" + misc2).c_str()).good();
+
+			VertexBuffer::Segment sg;
+			sg.vbuffer = 1;
+			sg.object = 1;
+			sg.ioffset = GetId(models, p[0]);
+			scene.push_back(Drawable());
+			scene.back().SetVertexBufferSegment(sg);
+			scene.back().SetTextures(
+				GetId(textures, texture + clamp),
+				has_misc1 ? GetId(textures, misc1 + clamp) : 0,
+				has_misc2 ? GetId(textures, misc2 + clamp) : 0);
+			scene.back().SetCull(transparent_blend != 2);
+			layers.push_back(skybox ? 2 : nolighting ? 1 : 0);
+		}
+		if (scene.empty())
+			continue;
+
+		std::vector<Drawable*> drawlists[3];
+		for (unsigned i = 0; i < scene.size(); ++i)
+			drawlists[layers[i]].push_back(&scene[i]);
+
+		InstanceBatcher batcher;
+		unsigned draw_calls = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < iterations; ++i)
+		{
+			draw_calls = 0;
+			for (const auto & drawlist : drawlists)
+			{
+				batcher.Build(drawlist, max_instances);
+				draw_calls += batcher.GetBatches().size();
+			}
+		}
+		const auto end = std::chrono::steady_clock::now();
+		const double ms = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+
+		out << std::left << std::setw(24) << track << std::right
+			<< std::setw(12) << scene.size()
+			<< std::setw(12) << draw_calls
+			<< std::setw(12) << std::fixed << std::setprecision(3) << ms << std::endl;
+	}
+}
+
+QT_TEST(instance_batch_test)
+{
+	// track like scene: a few repeated objects (trees, cones, barriers)
+	// with two texture variations, interleaved with unique geometry
+	const unsigned model_count = 4;
+	const unsigned unique_count = 100;
+	const unsigned instance_count = 900;
+	const unsigned max_instances = 16;
+
+	std::vector<Drawable> scene(unique_count + instance_count);
+	for (unsigned i = 0; i < scene.size(); ++i)
+	{
+		VertexBuffer::Segment sg;
+		sg.vbuffer = 1;
+		sg.object = 1;
+		sg.vcount = 24;
+		sg.icount = 36;
+		if (i % 10 == 0)
+		{
+			// unique
+			sg.ioffset = 1000 + i * 36 * 4;
+			sg.voffset = 1000 + i * 24;
+			scene[i].SetTextures(1, 2);
+		}
+		else
+		{
+			// instance
+			const unsigned m = i % model_count;
+			sg.ioffset = m * 36 * 4;
+			sg.voffset = m * 24;
+			scene[i].SetTextures(10 + (i / model_count) % 2, 20);
+		}
+		scene[i].SetVertexBufferSegment(sg);
+
+		Mat4 transform;
+		transform.Translate(float(i), 0, 0);
+		scene[i].SetTransform(transform);
+	}
+
+	std::vector<Drawable*> drawlist(scene.size());
+	for (unsigned i = 0; i < scene.size(); ++i)
+		drawlist[i] = &scene[i];
+
+	InstanceBatcher batcher;
+	batcher.Build(drawlist, max_instances);
+
+	const auto & batches = batcher.GetBatches();
+	const auto & drawables = batcher.GetDrawables();
+	QT_CHECK_EQUAL(drawables.size(), drawlist.size());
+
+	// draw calls: 1000 individual draws vs 100 unique draws
+	// plus 4 groups of 100 and 4 groups of 125 instances
+	const unsigned draw_calls = batches.size();
+	QT_CHECK_EQUAL(draw_calls, unique_count + 4 * 7 + 4 * 8);
+
+	unsigned prev_first = 0;
+	unsigned instances = 0;
+	for (unsigned i = 0; i < batches.size(); ++i)
+	{
+		const auto & b = batches[i];
+		QT_CHECK(b.count > 0 && b.count <= max_instances);
+		QT_CHECK_EQUAL(b.offset, instances);
+		for (unsigned j = 1; j < b.count; ++j)
+		{
+			QT_CHECK(InstanceBatcher::Equal(*drawables[b.offset], *drawables[b.offset + j]));
+			QT_CHECK_LESS(drawables[b.offset + j - 1], drawables[b.offset + j]);
+		}
+
+		// batches keep drawlist order of their first drawable
+		const unsigned first = drawables[b.offset] - &scene[0];
+		QT_CHECK(i == 0 || first > prev_first);
+		prev_first = first;
+		instances += b.count;
+	}
+	QT_CHECK_EQUAL(instances, drawlist.size());
+
+	// every drawable is submitted exactly once
+	std::vector<Drawable*> sorted(drawables);
+	std::sort(sorted.begin(), sorted.end());
+	QT_CHECK(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+
+	// rebuild reuses storage
+	batcher.Build(std::vector<Drawable*>(), max_instances);
+	QT_CHECK(batcher.GetBatches().empty());
+	QT_CHECK(batcher.GetDrawables().empty());
+}
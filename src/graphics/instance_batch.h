@@ -0,0 +1,95 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _INSTANCE_BATCH_H
+#define _INSTANCE_BATCH_H
+
+#include <list>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class Drawable;
+
+/// \class InstanceBatcher
+/// \brief Groups drawables sharing vertex data, textures and render state,
+/// so that each group can be submitted as a single instanced draw call.
+/// Only the gl2 renderer draws groups instanced, the gl3 renderer draws
+/// the members of a group one by one in group order.
+class InstanceBatcher
+{
+public:
+	struct Batch
+	{
+		unsigned offset;	///< first instance index into GetDrawables()
+		unsigned count;		///< instance count
+	};
+
+	/// \brief Group drawlist into batches of at most max_instances
+	/// Batches are ordered by their first drawable in drawlist.
+	void Build(const std::vector<Drawable*> & drawlist, unsigned max_instances);
+
+	/// \brief Batch ranges into GetDrawables()
+	const std::vector<Batch> & GetBatches() const;
+
+	/// \brief Drawables in batch order
+	const std::vector<Drawable*> & GetDrawables() const;
+
+	/// \brief Drawables can be drawn as instances of each other
+	static bool Equal(const Drawable & a, const Drawable & b);
+
+	/// \brief Strict weak ordering consistent with Equal
+	static bool Less(const Drawable & a, const Drawable & b);
+
+	/// \brief Report draw calls of the opaque static objects of the listed tracks
+	/// with and without grouping, and the time it takes to group them
+	static void Benchmark(
+		const std::string & trackspath,
+		const std::list<std::string> & tracks,
+		std::ostream & out);
+
+private:
+	struct Entry
+	{
+		Drawable * drawable;
+		unsigned index;
+	};
+	struct Range
+	{
+		unsigned first;
+		unsigned offset;
+		unsigned count;
+	};
+	std::vector<Entry> entries;
+	std::vector<Range> ranges;
+	std::vector<Batch> batches;
+	std::vector<Drawable*> drawables;
+};
+
+inline const std::vector<InstanceBatcher::Batch> & InstanceBatcher::GetBatches() const
+{
+	return batches;
+}
+
+inline const std::vector<Drawable*> & InstanceBatcher::GetDrawables() const
+{
+	return drawables;
+}
+
+#endif // _INSTANCE_BATCH_H
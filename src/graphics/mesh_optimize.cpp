@@ -0,0 +1,828 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "mesh_optimize.h"
+#include "unittest.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <ostream>
+#include <vector>
+
+namespace MeshOptimize
+{
+
+std::ostream & operator<<(std::ostream & os, const Stats & stats)
+{
+	os << "acmr " << stats.Acmr() << ", atvr " << stats.Atvr();
+	return os;
+}
+
+Stats Analyze(
+	const unsigned indices[], unsigned index_count,
+	unsigned vertex_count, unsigned cache_size)
+{
+	assert(index_count % 3 == 0);
+	assert(cache_size > 0);
+
+	// timestamp based fifo, a vertex is cached if it has been
+	// inserted less than cache_size misses ago
+	std::vector<unsigned> timestamps(vertex_count, 0);
+	std::vector<bool> used(vertex_count, false);
+	unsigned time = cache_size + 1;
+
+	Stats stats;
+	stats.triangles = index_count / 3;
+	for (unsigned i = 0; i < index_count; ++i)
+	{
+		const unsigned v = indices[i];
+		assert(v < vertex_count);
+		if (!used[v])
+		{
+			used[v] = true;
+			stats.vertices++;
+		}
+		if (time - timestamps[v] > cache_size)
+		{
+			timestamps[v] = time++;
+			stats.misses++;
+		}
+	}
+	return stats;
+}
+
+// Tom Forsyth, Linear-Speed Vertex Cache Optimisation
+static const unsigned forsyth_cache_size = 32;
+static const unsigned forsyth_valence_size = 32;
+
+struct ForsythTables
+{
+	float cache[forsyth_cache_size];
+	float valence[forsyth_valence_size];
+
+	ForsythTables()
+	{
+		const float decay_power = 1.5f;
+		const float last_tri_score = 0.75f;
+		const float valence_scale = 2.0f;
+		const float valence_power = 0.5f;
+
+		for (unsigned i = 0; i < forsyth_cache_size; ++i)
+		{
+			if (i < 3)
+			{
+				// vertices used by the last triangle get a fixed score
+				// to discourage using them in the next triangle directly
+				cache[i] = last_tri_score;
+			}
+			else
+			{
+				const float scale = 1.0f / (forsyth_cache_size - 3);
+				cache[i] = std::pow(1.0f - (i - 3) * scale, decay_power);
+			}
+		}
+
+		valence[0] = 0.0f;
+		for (unsigned i = 1; i < forsyth_valence_size; ++i)
+			valence[i] = valence_scale * std::pow(float(i), -valence_power);
+	}
+};
+
+static float VertexScore(const ForsythTables & tables, int cache_pos, unsigned live_tris)
+{
+	// no triangles left, vertex is irrelevant
+	if (live_tris == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cache_pos >= 0)
+		score = tables.cache[cache_pos];
+
+	// boost vertices with few triangles left to get rid of lone triangles
+	if (live_tris < forsyth_valence_size)
+		score += tables.valence[live_tris];
+	else
+		score += 2.0f / std::sqrt(float(live_tris));
+
+	return score;
+}
+
+void OptimizeVertexCache(
+	unsigned result[], const unsigned indices[], unsigned index_count,
+	unsigned vertex_count)
+{
+	assert(index_count % 3 == 0);
+	static const ForsythTables tables;
+
+	const unsigned tri_count = index_count / 3;
+	if (tri_count == 0)
+		return;
+
+	// build vertex to triangle adjacency
+	std::vector<unsigned> live_tris(vertex_count, 0);
+	for (unsigned i = 0; i < index_count; ++i)
+	{
+		assert(indices[i] < vertex_count);
+		live_tris[indices[i]]++;
+	}
+
+	std::vector<unsigned> adjacency_offset(vertex_count + 1, 0);
+	for (unsigned v = 0; v < vertex_count; ++v)
+		adjacency_offset[v + 1] = adjacency_offset[v] + live_tris[v];
+
+	std::vector<unsigned> adjacency(index_count);
+	std::vector<unsigned> adjacency_fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+	for (unsigned i = 0; i < index_count; ++i)
+		adjacency[adjacency_fill[indices[i]]++] = i / 3;
+
+	// initial scores
+	std::vector<int> cache_pos(vertex_count, -1);
+	std::vector<float> vertex_score(vertex_count);
+	for (unsigned v = 0; v < vertex_count; ++v)
+		vertex_score[v] = VertexScore(tables, -1, live_tris[v]);
+
+	std::vector<float> tri_score(tri_count);
+	std::vector<bool> emitted(tri_count, false);
+	for (unsigned t = 0; t < tri_count; ++t)
+	{
+		const unsigned * tri = indices + t * 3;
+		tri_score[t] = vertex_score[tri[0]] + vertex_score[tri[1]] + vertex_score[tri[2]];
+	}
+
+	// copy the input, result is allowed to alias indices
+	const std::vector<unsigned> input(indices, indices + index_count);
+
+	unsigned cache[forsyth_cache_size + 3];
+	unsigned cache_count = 0;
+
+	unsigned best_tri = unsigned(std::max_element(tri_score.begin(), tri_score.end()) - tri_score.begin());
+	unsigned search_cursor = 0;
+
+	for (unsigned out = 0; out < tri_count; ++out)
+	{
+		// fall back to the next unused triangle in input order
+		if (best_tri == ~0u)
+		{
+			while (emitted[search_cursor])
+				++search_cursor;
+			best_tri = search_cursor;
+		}
+
+		const unsigned * tri = &input[best_tri * 3];
+		result[out * 3 + 0] = tri[0];
+		result[out * 3 + 1] = tri[1];
+		result[out * 3 + 2] = tri[2];
+		emitted[best_tri] = true;
+
+		// remove emitted triangle from vertex adjacency
+		for (unsigned k = 0; k < 3; ++k)
+		{
+			const unsigned v = tri[k];
+			unsigned * adj = &adjacency[adjacency_offset[v]];
+			const unsigned count = live_tris[v];
+			for (unsigned j = 0; j < count; ++j)
+			{
+				if (adj[j] == best_tri)
+				{
+					adj[j] = adj[count - 1];
+					break;
+				}
+			}
+			live_tris[v]--;
+		}
+
+		// push triangle vertices to the front of the lru cache
+		unsigned new_cache[forsyth_cache_size + 3];
+		unsigned new_count = 0;
+		for (unsigned k = 0; k < 3; ++k)
+			new_cache[new_count++] = tri[k];
+		for (unsigned j = 0; j < cache_count; ++j)
+		{
+			const unsigned v = cache[j];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				new_cache[new_count++] = v;
+		}
+
+		// update vertex scores, evicted vertices get out of cache score
+		for (unsigned j = 0; j < new_count; ++j)
+		{
+			const unsigned v = new_cache[j];
+			const int pos = (j < forsyth_cache_size) ? int(j) : -1;
+			cache_pos[v] = pos;
+			vertex_score[v] = VertexScore(tables, pos, live_tris[v]);
+		}
+
+		// update scores of triangles touching the cache, pick the best one
+		float best_score = -1.0f;
+		best_tri = ~0u;
+		for (unsigned j = 0; j < new_count; ++j)
+		{
+			const unsigned v = new_cache[j];
+			const unsigned * adj = &adjacency[adjacency_offset[v]];
+			for (unsigned a = 0; a < live_tris[v]; ++a)
+			{
+				const unsigned t = adj[a];
+				const unsigned * at = &input[t * 3];
+				const float score = vertex_score[at[0]] + vertex_score[at[1]] + vertex_score[at[2]];
+				tri_score[t] = score;
+				if (score > best_score)
+				{
+					best_score = score;
+					best_tri = t;
+				}
+			}
+		}
+
+		cache_count = std::min(new_count, forsyth_cache_size);
+		std::copy(new_cache, new_cache + cache_count, cache);
+	}
+}
+
+struct Cluster
+{
+	unsigned begin;
+	unsigned end;
+	float sort_key;
+
+	bool operator<(const Cluster & other) const
+	{
+		// front to back: clusters facing away from the mesh center first
+		return sort_key > other.sort_key;
+	}
+};
+
+void OptimizeOverdraw(
+	unsigned indices[], unsigned index_count,
+	const float positions[], unsigned vertex_count,
+	unsigned cache_size)
+{
+	assert(index_count % 3 == 0);
+	const unsigned tri_count = index_count / 3;
+	if (tri_count < 2)
+		return;
+
+	// split at hard boundaries, where the triangle misses with all vertices
+	std::vector<Cluster> clusters;
+	std::vector<unsigned> timestamps(vertex_count, 0);
+	unsigned time = cache_size + 1;
+	for (unsigned t = 0; t < tri_count; ++t)
+	{
+		unsigned misses = 0;
+		for (unsigned k = 0; k < 3; ++k)
+		{
+			const unsigned v = indices[t * 3 + k];
+			if (time - timestamps[v] > cache_size)
+			{
+				timestamps[v] = time++;
+				misses++;
+			}
+		}
+		if (t == 0 || misses == 3)
+		{
+			Cluster c;
+			c.begin = t;
+			c.end = t;
+			c.sort_key = 0;
+			clusters.push_back(c);
+		}
+		clusters.back().end = t + 1;
+	}
+
+	if (clusters.size() < 2)
+		return;
+
+	// area weighted cluster centroids and normals
+	std::vector<float> centroids(clusters.size() * 3, 0.0f);
+	std::vector<float> normals(clusters.size() * 3, 0.0f);
+	float mesh_center[3] = {0, 0, 0};
+	float mesh_area = 0;
+	for (unsigned c = 0; c < clusters.size(); ++c)
+	{
+		float * centroid = &centroids[c * 3];
+		float * normal = &normals[c * 3];
+		float area = 0;
+		for (unsigned t = clusters[c].begin; t < clusters[c].end; ++t)
+		{
+			const float * p0 = positions + indices[t * 3 + 0] * 3;
+			const float * p1 = positions + indices[t * 3 + 1] * 3;
+			const float * p2 = positions + indices[t * 3 + 2] * 3;
+			const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+			const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+			const float n[3] = {
+				e1[1] * e2[2] - e1[2] * e2[1],
+				e1[2] * e2[0] - e1[0] * e2[2],
+				e1[0] * e2[1] - e1[1] * e2[0]};
+			const float a = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			for (unsigned k = 0; k < 3; ++k)
+			{
+				centroid[k] += (p0[k] + p1[k] + p2[k]) * (1 / 3.0f) * a;
+				normal[k] += n[k];
+			}
+			area += a;
+		}
+
+		for (unsigned k = 0; k < 3; ++k)
+			mesh_center[k] += centroid[k];
+		mesh_area += area;
+
+		if (area > 0)
+		{
+			for (unsigned k = 0; k < 3; ++k)
+				centroid[k] /= area;
+		}
+	}
+
+	if (mesh_area > 0)
+	{
+		for (unsigned k = 0; k < 3; ++k)
+			mesh_center[k] /= mesh_area;
+	}
+
+	for (unsigned c = 0; c < clusters.size(); ++c)
+	{
+		const float * centroid = &centroids[c * 3];
+		const float * normal = &normals[c * 3];
+		const float len = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		float dot = 0;
+		for (unsigned k = 0; k < 3; ++k)
+			dot += (centroid[k] - mesh_center[k]) * normal[k];
+		clusters[c].sort_key = (len > 0) ? dot / len : 0;
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end());
+
+	const std::vector<unsigned> input(indices, indices + index_count);
+	unsigned out = 0;
+	for (const auto & c : clusters)
+	{
+		for (unsigned i = c.begin * 3; i < c.end * 3; ++i)
+			indices[out++] = input[i];
+	}
+	assert(out == index_count);
+}
+
+// symmetric 4x4 plane quadric, weighted by triangle area
+struct Quadric
+{
+	float a00, a11, a22, a10, a20, a21;
+	float b0, b1, b2, c;
+	float w;
+
+	Quadric() : a00(0), a11(0), a22(0), a10(0), a20(0), a21(0), b0(0), b1(0), b2(0), c(0), w(0) {}
+
+	void AddPlane(const float n[3], float d, float weight)
+	{
+		a00 += weight * n[0] * n[0];
+		a11 += weight * n[1] * n[1];
+		a22 += weight * n[2] * n[2];
+		a10 += weight * n[1] * n[0];
+		a20 += weight * n[2] * n[0];
+		a21 += weight * n[2] * n[1];
+		b0 += weight * n[0] * d;
+		b1 += weight * n[1] * d;
+		b2 += weight * n[2] * d;
+		c += weight * d * d;
+		w += weight;
+	}
+
+	Quadric & operator+=(const Quadric & q)
+	{
+		a00 += q.a00; a11 += q.a11; a22 += q.a22;
+		a10 += q.a10; a20 += q.a20; a21 += q.a21;
+		b0 += q.b0; b1 += q.b1; b2 += q.b2;
+		c += q.c;
+		w += q.w;
+		return *this;
+	}
+
+	// weighted squared distance of p to the planes
+	float Error(const float p[3]) const
+	{
+		const float x = p[0], y = p[1], z = p[2];
+		float r = a00 * x * x + a11 * y * y + a22 * z * z;
+		r += 2 * (a10 * x * y + a20 * x * z + a21 * y * z);
+		r += 2 * (b0 * x + b1 * y + b2 * z);
+		r += c;
+		return std::abs(r);
+	}
+};
+
+static void TriangleNormal(const float * p0, const float * p1, const float * p2, float n[3])
+{
+	const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+	const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+	n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+	n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+	n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+struct Collapse
+{
+	unsigned from;
+	unsigned to;
+	float error;
+
+	bool operator<(const Collapse & other) const
+	{
+		return error < other.error;
+	}
+};
+
+unsigned Simplify(
+	unsigned result[], const unsigned indices[], unsigned index_count,
+	const float positions[], unsigned vertex_count,
+	unsigned target_index_count, float max_error, float * result_error)
+{
+	assert(index_count % 3 == 0);
+
+	std::vector<unsigned> current(indices, indices + index_count);
+	float error = 0;
+
+	// mesh extent for relative errors
+	float vmin[3] = {0, 0, 0}, vmax[3] = {0, 0, 0};
+	for (unsigned v = 0; v < vertex_count; ++v)
+	{
+		for (unsigned k = 0; k < 3; ++k)
+		{
+			const float x = positions[v * 3 + k];
+			vmin[k] = (v == 0 || x < vmin[k]) ? x : vmin[k];
+			vmax[k] = (v == 0 || x > vmax[k]) ? x : vmax[k];
+		}
+	}
+	float extent = std::max(vmax[0] - vmin[0], std::max(vmax[1] - vmin[1], vmax[2] - vmin[2]));
+	if (extent <= 0)
+		extent = 1;
+	const float max_error_abs = max_error * extent;
+
+	// weld vertices by position, vertices sharing a position lie on an attribute seam
+	std::vector<unsigned> sorted(vertex_count);
+	for (unsigned v = 0; v < vertex_count; ++v)
+		sorted[v] = v;
+	std::sort(sorted.begin(), sorted.end(), [positions](unsigned a, unsigned b)
+	{
+		return std::lexicographical_compare(positions + a * 3, positions + a * 3 + 3, positions + b * 3, positions + b * 3 + 3);
+	});
+
+	std::vector<unsigned> weld(vertex_count);
+	std::vector<bool> locked(vertex_count, false);
+	for (unsigned i = 0; i < vertex_count; )
+	{
+		unsigned j = i + 1;
+		while (j < vertex_count && std::equal(positions + sorted[i] * 3, positions + sorted[i] * 3 + 3, positions + sorted[j] * 3))
+			++j;
+		for (unsigned k = i; k < j; ++k)
+		{
+			weld[sorted[k]] = sorted[i];
+			locked[sorted[k]] = (j - i > 1);
+		}
+		i = j;
+	}
+
+	// lock vertices on open or non-manifold edges
+	{
+		std::vector<unsigned long long> edges;
+		edges.reserve(index_count);
+		for (unsigned t = 0; t < index_count; t += 3)
+		{
+			for (unsigned k = 0; k < 3; ++k)
+			{
+				unsigned a = weld[current[t + k]];
+				unsigned b = weld[current[t + (k + 1) % 3]];
+				if (a > b)
+					std::swap(a, b);
+				edges.push_back((static_cast<unsigned long long>(a) << 32) | b);
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		for (unsigned i = 0; i < edges.size(); )
+		{
+			unsigned j = i + 1;
+			while (j < edges.size() && edges[j] == edges[i])
+				++j;
+			if (j - i != 2)
+			{
+				const unsigned a = unsigned(edges[i] >> 32);
+				const unsigned b = unsigned(edges[i] & 0xffffffff);
+				locked[a] = locked[b] = true;
+			}
+			i = j;
+		}
+		for (unsigned v = 0; v < vertex_count; ++v)
+		{
+			if (locked[weld[v]])
+				locked[v] = true;
+		}
+	}
+
+	// area weighted plane quadrics
+	std::vector<Quadric> quadrics(vertex_count);
+	for (unsigned t = 0; t < index_count; t += 3)
+	{
+		const float * p0 = positions + current[t + 0] * 3;
+		const float * p1 = positions + current[t + 1] * 3;
+		const float * p2 = positions + current[t + 2] * 3;
+		float n[3];
+		TriangleNormal(p0, p1, p2, n);
+		const float len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (len <= 0)
+			continue;
+		n[0] /= len; n[1] /= len; n[2] /= len;
+		const float d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+		for (unsigned k = 0; k < 3; ++k)
+			quadrics[current[t + k]].AddPlane(n, d, len * 0.5f);
+	}
+
+	std::vector<unsigned> remap(vertex_count);
+	std::vector<bool> touched(vertex_count);
+	std::vector<unsigned> adjacency_offset(vertex_count + 1);
+	std::vector<unsigned> adjacency;
+	std::vector<Collapse> collapses;
+	while (current.size() > target_index_count)
+	{
+		// vertex to triangle adjacency of the current mesh
+		std::fill(adjacency_offset.begin(), adjacency_offset.end(), 0);
+		for (unsigned i = 0; i < current.size(); ++i)
+			adjacency_offset[current[i] + 1]++;
+		for (unsigned v = 0; v < vertex_count; ++v)
+			adjacency_offset[v + 1] += adjacency_offset[v];
+		adjacency.resize(current.size());
+		{
+			std::vector<unsigned> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+			for (unsigned i = 0; i < current.size(); ++i)
+				adjacency[fill[current[i]]++] = i / 3;
+		}
+
+		// collapse candidates sorted by error
+		collapses.clear();
+		for (unsigned t = 0; t < current.size(); t += 3)
+		{
+			for (unsigned k = 0; k < 3; ++k)
+			{
+				const unsigned a = current[t + k];
+				const unsigned b = current[t + (k + 1) % 3];
+				for (unsigned e = 0; e < 2; ++e)
+				{
+					const unsigned from = e ? b : a;
+					const unsigned to = e ? a : b;
+					if (locked[from])
+						continue;
+					Quadric q = quadrics[from];
+					q += quadrics[to];
+					Collapse c;
+					c.from = from;
+					c.to = to;
+					c.error = (q.w > 0) ? std::sqrt(q.Error(positions + to * 3) / q.w) : 0;
+					collapses.push_back(c);
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end());
+
+		for (unsigned v = 0; v < vertex_count; ++v)
+			remap[v] = v;
+		std::fill(touched.begin(), touched.end(), false);
+
+		// apply independent collapses, each one removes about two triangles
+		const unsigned tri_budget = (current.size() - target_index_count) / 3;
+		unsigned tris_removed = 0;
+		unsigned collapsed = 0;
+		for (const auto & c : collapses)
+		{
+			if (tris_removed >= tri_budget || c.error > max_error_abs)
+				break;
+
+			if (touched[c.from] || touched[c.to])
+				continue;
+
+			// reject collapses flipping or degenerating triangles
+			const float * pto = positions + c.to * 3;
+			bool valid = true;
+			unsigned removed = 0;
+			for (unsigned a = adjacency_offset[c.from]; a < adjacency_offset[c.from + 1] && valid; ++a)
+			{
+				const unsigned * tri = &current[adjacency[a] * 3];
+				if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+				{
+					removed++;
+					continue;
+				}
+
+				const float * p[3];
+				const float * q[3];
+				for (unsigned k = 0; k < 3; ++k)
+				{
+					p[k] = positions + tri[k] * 3;
+					q[k] = (tri[k] == c.from) ? pto : p[k];
+				}
+				float n0[3], n1[3];
+				TriangleNormal(p[0], p[1], p[2], n0);
+				TriangleNormal(q[0], q[1], q[2], n1);
+				const float d = n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2];
+				const float l0 = n0[0] * n0[0] + n0[1] * n0[1] + n0[2] * n0[2];
+				const float l1 = n1[0] * n1[0] + n1[1] * n1[1] + n1[2] * n1[2];
+				valid = d > 0 && d * d > 0.25f * l0 * l1;
+			}
+			if (!valid)
+				continue;
+
+			remap[c.from] = c.to;
+			quadrics[c.to] += quadrics[c.from];
+			error = std::max(error, c.error);
+			tris_removed += removed;
+			collapsed++;
+
+			// neighbouring triangles changed, skip them until the next pass
+			for (unsigned a = adjacency_offset[c.from]; a < adjacency_offset[c.from + 1]; ++a)
+			{
+				const unsigned * tri = &current[adjacency[a] * 3];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = true;
+			}
+		}
+
+		if (collapsed == 0)
+			break;
+
+		// remap and drop degenerate triangles
+		unsigned count = 0;
+		for (unsigned t = 0; t < current.size(); t += 3)
+		{
+			const unsigned a = remap[current[t + 0]];
+			const unsigned b = remap[current[t + 1]];
+			const unsigned c = remap[current[t + 2]];
+			if (a == b || b == c || c == a)
+				continue;
+			current[count++] = a;
+			current[count++] = b;
+			current[count++] = c;
+		}
+		current.resize(count);
+	}
+
+	std::copy(current.begin(), current.end(), result);
+	if (result_error)
+		*result_error = error / extent;
+	return current.size();
+}
+
+unsigned OptimizeVertexFetch(
+	unsigned remap[], unsigned indices[], unsigned index_count,
+	unsigned vertex_count)
+{
+	std::fill(remap, remap + vertex_count, ~0u);
+
+	unsigned next = 0;
+	for (unsigned i = 0; i < index_count; ++i)
+	{
+		const unsigned v = indices[i];
+		assert(v < vertex_count);
+		if (remap[v] == ~0u)
+			remap[v] = next++;
+		indices[i] = remap[v];
+	}
+	return next;
+}
+
+}
+
+QT_TEST(mesh_optimize_test)
+{
+	// shuffled grid, worst case for the vertex cache
+	const unsigned n = 32;
+	const unsigned vertex_count = (n + 1) * (n + 1);
+	std::vector<float> positions;
+	for (unsigned y = 0; y <= n; ++y)
+	{
+		for (unsigned x = 0; x <= n; ++x)
+		{
+			positions.push_back(x);
+			positions.push_back(y);
+			positions.push_back(0);
+		}
+	}
+
+	std::vector<unsigned> indices;
+	for (unsigned y = 0; y < n; ++y)
+	{
+		for (unsigned x = 0; x < n; ++x)
+		{
+			const unsigned i = y * (n + 1) + x;
+			const unsigned quad[6] = {i, i + 1, i + n + 1, i + 1, i + n + 2, i + n + 1};
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+
+	unsigned seed = 12345;
+	for (unsigned t = indices.size() / 3 - 1; t > 0; --t)
+	{
+		seed = seed * 1103515245 + 12345;
+		const unsigned s = (seed >> 8) % (t + 1);
+		for (unsigned k = 0; k < 3; ++k)
+			std::swap(indices[t * 3 + k], indices[s * 3 + k]);
+	}
+
+	std::vector<unsigned> sorted_before;
+	for (unsigned t = 0; t < indices.size(); t += 3)
+		sorted_before.push_back(indices[t] * vertex_count * vertex_count + indices[t + 1] * vertex_count + indices[t + 2]);
+	std::sort(sorted_before.begin(), sorted_before.end());
+
+	const MeshOptimize::Stats before = MeshOptimize::Analyze(indices.data(), indices.size(), vertex_count);
+	QT_CHECK_EQUAL(before.triangles, n * n * 2);
+	QT_CHECK_EQUAL(before.vertices, vertex_count);
+	QT_CHECK_GREATER(before.Acmr(), 1.5f);
+
+	MeshOptimize::OptimizeVertexCache(indices.data(), indices.data(), indices.size(), vertex_count);
+	const MeshOptimize::Stats after = MeshOptimize::Analyze(indices.data(), indices.size(), vertex_count);
+	QT_CHECK_LESS(after.Acmr(), 0.8f);
+	QT_CHECK_LESS(after.Atvr(), 1.6f);
+
+	MeshOptimize::OptimizeOverdraw(indices.data(), indices.size(), positions.data(), vertex_count);
+
+	std::vector<unsigned> sorted_after;
+	for (unsigned t = 0; t < indices.size(); t += 3)
+		sorted_after.push_back(indices[t] * vertex_count * vertex_count + indices[t + 1] * vertex_count + indices[t + 2]);
+	std::sort(sorted_after.begin(), sorted_after.end());
+	QT_CHECK(sorted_before == sorted_after);
+
+	std::vector<unsigned> remap(vertex_count);
+	const unsigned used = MeshOptimize::OptimizeVertexFetch(remap.data(), indices.data(), indices.size(), vertex_count);
+	QT_CHECK_EQUAL(used, vertex_count);
+	QT_CHECK_EQUAL(indices[0], 0u);
+	unsigned max_index = 0;
+	bool first_use_order = true;
+	for (unsigned i = 0; i < indices.size(); ++i)
+	{
+		if (indices[i] > max_index + 1)
+			first_use_order = false;
+		max_index = std::max(max_index, indices[i]);
+	}
+	QT_CHECK(first_use_order);
+}
+
+QT_TEST(mesh_simplify_test)
+{
+	// flat grid interior collapses without error, border is kept
+	const unsigned n = 16;
+	const unsigned vertex_count = (n + 1) * (n + 1);
+	std::vector<float> positions;
+	for (unsigned y = 0; y <= n; ++y)
+	{
+		for (unsigned x = 0; x <= n; ++x)
+		{
+			positions.push_back(x);
+			positions.push_back(y);
+			positions.push_back(0);
+		}
+	}
+
+	std::vector<unsigned> indices;
+	for (unsigned y = 0; y < n; ++y)
+	{
+		for (unsigned x = 0; x < n; ++x)
+		{
+			const unsigned i = y * (n + 1) + x;
+			const unsigned quad[6] = {i, i + 1, i + n + 1, i + 1, i + n + 2, i + n + 1};
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+
+	std::vector<unsigned> simplified(indices.size());
+	float error = 1;
+	unsigned count = MeshOptimize::Simplify(
+		simplified.data(), indices.data(), indices.size(),
+		positions.data(), vertex_count, 0, 0.01f, &error);
+	QT_CHECK_LESS(count, indices.size() / 4);
+	QT_CHECK_GREATER(count, 0u);
+	QT_CHECK_LESS(error, 1E-6f);
+
+	// border vertices are still referenced
+	std::vector<bool> used(vertex_count, false);
+	for (unsigned i = 0; i < count; ++i)
+		used[simplified[i]] = true;
+	QT_CHECK(used[0] && used[n] && used[n * (n + 1)] && used[vertex_count - 1]);
+
+	// bumpy grid respects the error bound
+	for (unsigned v = 0; v < vertex_count; ++v)
+		positions[v * 3 + 2] = 0.5f * std::sin(positions[v * 3] * 0.7f) * std::cos(positions[v * 3 + 1] * 0.4f);
+	count = MeshOptimize::Simplify(
+		simplified.data(), indices.data(), indices.size(),
+		positions.data(), vertex_count, 0, 0.005f, &error);
+	QT_CHECK_LESS(count, indices.size());
+	QT_CHECK_LESS_OR_EQUAL(error, 0.005f);
+}
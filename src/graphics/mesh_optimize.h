@@ -0,0 +1,93 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _MESHOPTIMIZE_H
+#define _MESHOPTIMIZE_H
+
+#include <iosfwd>
+
+/// Triangle list post-processing for the gpu vertex pipeline.
+/// All functions operate on indexed triangle lists.
+namespace MeshOptimize
+{
+
+/// Post-transform cache efficiency of an index buffer.
+struct Stats
+{
+	unsigned triangles;
+	unsigned vertices;
+	unsigned misses;
+
+	Stats() : triangles(0), vertices(0), misses(0) {}
+
+	/// average cache miss ratio, transformed vertices per triangle (0.5 - 3.0)
+	float Acmr() const { return triangles ? float(misses) / triangles : 0.0f; }
+
+	/// average transform to vertex ratio, transformed vertices per vertex (1.0 - 6.0)
+	float Atvr() const { return vertices ? float(misses) / vertices : 0.0f; }
+
+	Stats & operator+=(const Stats & other)
+	{
+		triangles += other.triangles;
+		vertices += other.vertices;
+		misses += other.misses;
+		return *this;
+	}
+};
+
+std::ostream & operator<<(std::ostream & os, const Stats & stats);
+
+/// Simulate a fifo post-transform cache of given size.
+Stats Analyze(
+	const unsigned indices[], unsigned index_count,
+	unsigned vertex_count, unsigned cache_size = 16);
+
+/// Reorder triangles to maximize post-transform cache hits (Forsyth).
+/// Can be done in place (result == indices).
+void OptimizeVertexCache(
+	unsigned result[], const unsigned indices[], unsigned index_count,
+	unsigned vertex_count);
+
+/// Reorder triangle clusters front to back, view independent (Tipsify style).
+/// Clusters are split at cache restarts to preserve vertex cache efficiency.
+/// Call after OptimizeVertexCache.
+void OptimizeOverdraw(
+	unsigned indices[], unsigned index_count,
+	const float positions[], unsigned vertex_count,
+	unsigned cache_size = 16);
+
+/// Simplify by collapsing edges onto existing vertices (quadric error metric)
+/// until target_index_count is reached or the error would exceed max_error.
+/// Errors are relative to the mesh extent. Attribute seams and open borders
+/// are kept, so the result still references the same vertex set.
+/// Can be done in place. Returns the result index count.
+unsigned Simplify(
+	unsigned result[], const unsigned indices[], unsigned index_count,
+	const float positions[], unsigned vertex_count,
+	unsigned target_index_count, float max_error, float * result_error = 0);
+
+/// Renumber vertices in order of first use to improve vertex fetch locality.
+/// Returns the number of referenced vertices, remap[old] = new or ~0u if unused.
+unsigned OptimizeVertexFetch(
+	unsigned remap[], unsigned indices[], unsigned index_count,
+	unsigned vertex_count);
+
+}
+
+#endif
@@ -20,6 +20,7 @@
 #include "model.h"
 #include "joeserialize.h"
 
+#include <algorithm>
 #include <fstream>
 #include <string>
 #include <limits>
@@ -148,6 +149,80 @@ void Model::GenMeshMetrics()
 	generatedmetrics = true;
 }
 
+void Model::Optimize(bool reduce_overdraw, MeshOptimize::Stats & before, MeshOptimize::Stats & after)
+{
+	varray.Optimize(reduce_overdraw, before, after);
+	GenMeshMetrics();
+}
+
+void Model::GenLods(unsigned count)
+{
+	lods.clear();
+
+	// not worth it for small meshes
+	const unsigned min_faces = 128;
+	if (varray.GetNumIndices() < min_faces * 3 || !generatedmetrics)
+		return;
+
+	const Vec3 & half = aabb.GetExtent();
+	const float extent = 2 * std::max(half[0], std::max(half[1], half[2]));
+	const VertexArray * parent = &varray;
+	float ratio = 1.0f;
+	float max_error = 0.005f;
+	for (unsigned i = 0; i < count; ++i)
+	{
+		ratio *= 0.5f;
+		max_error *= 2;
+
+		Lod lod;
+		lod.error = varray.Simplify(ratio, max_error, lod.varray) * extent;
+
+		// stop if the mesh can't be reduced significantly any more
+		if (lod.varray.GetNumIndices() > parent->GetNumIndices() * 4 / 5 ||
+			lod.varray.GetNumIndices() == 0)
+			break;
+
+		lods.push_back(lod);
+		parent = &lods.back().varray;
+	}
+}
+
+const VertexArray & Model::GetLodVertexArray(unsigned level) const
+{
+	assert(level < GetLodCount());
+	return level ? lods[level - 1].varray : varray;
+}
+
+VertexBuffer::Segment & Model::GetLodVertexBufferSegment(unsigned level)
+{
+	assert(level < GetLodCount());
+	return level ? lods[level - 1].vbs : vbs;
+}
+
+unsigned Model::SelectLod(unsigned current, float pixels_per_unit) const
+{
+	// coarsest level with less than a pixel projected error
+	const float max_pixel_error = 1.0f;
+	const float hysteresis = 1.25f;
+
+	unsigned level = 0;
+	while (level < lods.size() && lods[level].error * pixels_per_unit < max_pixel_error)
+		++level;
+
+	// switch to coarser level once its error has dropped well below a pixel
+	while (level > current && lods[level - 1].error * pixels_per_unit * hysteresis > max_pixel_error)
+		--level;
+
+	if (level < current)
+	{
+		// keep current level until its error grows well above a pixel
+		if (lods[current - 1].error * pixels_per_unit < max_pixel_error * hysteresis)
+			return current;
+	}
+
+	return level;
+}
+
 void Model::Clear()
 {
 	ClearMeshData();
@@ -162,4 +237,5 @@ bool Model::Loaded() const
 void Model::ClearMeshData()
 {
 	varray.Clear();
+	lods.clear();
 }
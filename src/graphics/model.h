@@ -26,6 +26,7 @@
 
 #include <iosfwd>
 #include <string>
+#include <vector>
 
 /// Loading data into the mesh vertexarray is implemented by derived classes.
 class Model
@@ -61,6 +62,23 @@ public:
 	/// Recalculate mesh bounding box
 	void GenMeshMetrics();
 
+	/// Reorder mesh for gpu vertex cache and vertex fetch, before upload
+	/// reduce_overdraw also sorts triangle clusters front to back, at a small vertex cache cost
+	void Optimize(bool reduce_overdraw, MeshOptimize::Stats & before, MeshOptimize::Stats & after);
+
+	/// Generate up to count simplified levels of detail, level 0 is the model itself
+	void GenLods(unsigned count);
+
+	unsigned GetLodCount() const { return lods.size() + 1; }
+
+	const VertexArray & GetLodVertexArray(unsigned level) const;
+
+	VertexBuffer::Segment & GetLodVertexBufferSegment(unsigned level);
+
+	/// Select level of detail given the projected size in pixels per unit,
+	/// changes from the current level with hysteresis to avoid popping
+	unsigned SelectLod(unsigned current, float pixels_per_unit) const;
+
 	void Clear();
 
 	bool Loaded() const;
@@ -76,8 +94,16 @@ protected:
 	VertexArray varray;			///< to be filled by the derived classes
 
 private:
+	struct Lod
+	{
+		VertexArray varray;
+		VertexBuffer::Segment vbs;
+		float error;			///< geometric error in model units
+	};
+
 	VertexBuffer::Segment vbs;	///< vertex buffer segment
 	Aabb<float> aabb;			///< Metrics
+	std::vector<Lod> lods;		///< coarser levels of detail
 	bool generatedmetrics;
 
 	void ClearMetrics();
@@ -25,15 +25,18 @@
 #include "shader.h"
 #include "uniforms.h"
 #include "glutil.h"
+#include <algorithm>
 
 RenderInputScene::RenderInputScene(VertexBuffer & buffer):
 	vertex_buffer(buffer),
 	shadow_matrix(NULL),
 	shadow_count(0),
 	shader(NULL),
+	shader_instanced(NULL),
 	lod_far(1000),
 	fsaa(0),
-	contrast(1.0)
+	contrast(1.0),
+	blend(false)
 {
 	lightposition = Vec3(1, 0, 0);
 	Quat ldir;
@@ -46,9 +49,10 @@ RenderInputScene::~RenderInputScene()
 	//dtor
 }
 
-void RenderInputScene::SetShader(Shader & newshader)
+void RenderInputScene::SetShader(Shader & newshader, Shader * newshader_instanced)
 {
 	shader = &newshader;
+	shader_instanced = newshader_instanced;
 }
 
 void RenderInputScene::SetFSAA(unsigned value)
@@ -73,6 +77,7 @@ void RenderInputScene::SetDepthMode(GraphicsState & glstate, int mode, bool writ
 
 void RenderInputScene::SetBlendMode(GraphicsState & glstate, BlendMode::Enum mode)
 {
+	blend = (mode != BlendMode::DISABLED);
 	switch (mode)
 	{
 		case BlendMode::DISABLED:
@@ -179,37 +184,116 @@ void RenderInputScene::Render(GraphicsState & glstate, std::ostream & /*error_ou
 	(cam_rotation).RotateVector(lightvec);
 
 	shader->Enable();
+	SetUniforms(*shader, cube_matrix, lightvec);
+
+	// instancing draws each batch at the position of its first drawable,
+	// the changed draw order is only acceptable without blending
+	if (shader_instanced && !blend)
+		DrawInstanced(glstate, *drawlist_ptr, cube_matrix, lightvec);
+	else
+		Draw(glstate, *drawlist_ptr);
+}
+
+void RenderInputScene::SetUniforms(Shader & s, const float cube_matrix[9], const Vec3 & lightvec)
+{
 	if (shadow_matrix)
 	{
-		shader->SetUniformMat4f(Uniforms::ShadowMatrix, shadow_matrix[0].GetArray(), shadow_count);
+		s.SetUniformMat4f(Uniforms::ShadowMatrix, shadow_matrix[0].GetArray(), shadow_count);
 	}
-	shader->SetUniformMat4f(Uniforms::ProjectionMatrix, projMatrix.GetArray());
-	shader->SetUniformMat3f(Uniforms::ReflectionMatrix, cube_matrix);
-	shader->SetUniform3f(Uniforms::LightDirection, lightvec[0], lightvec[1], lightvec[2]);
-	shader->SetUniform1f(Uniforms::Contrast, contrast);
-
-	Draw(glstate, *drawlist_ptr);
+	s.SetUniformMat4f(Uniforms::ProjectionMatrix, projMatrix.GetArray());
+	s.SetUniformMat3f(Uniforms::ReflectionMatrix, cube_matrix);
+	s.SetUniform3f(Uniforms::LightDirection, lightvec[0], lightvec[1], lightvec[2]);
+	s.SetUniform1f(Uniforms::Contrast, contrast);
 }
 
 void RenderInputScene::Draw(GraphicsState & glstate, const std::vector <Drawable*> & drawlist)
 {
 	for (auto d : drawlist)
 	{
-		SetFlags(*d, glstate);
-		SetTextures(*d, glstate);
-		SetTransform(*d);
-		vertex_buffer.Draw(glstate.VertexObject(), d->GetVertexBufferSegment());
+		Draw(glstate, *d);
+	}
+	draw_stats.drawables += drawlist.size();
+	draw_stats.draw_calls += drawlist.size();
+}
+
+void RenderInputScene::DrawInstanced(
+	GraphicsState & glstate,
+	const std::vector <Drawable*> & drawlist,
+	const float cube_matrix[9],
+	const Vec3 & lightvec)
+{
+	batcher.Build(drawlist, max_instances);
+	const auto & batches = batcher.GetBatches();
+	const auto & drawables = batcher.GetDrawables();
+	draw_stats.drawables += drawables.size();
+
+	// singles and non-indexed geometry go through the regular shader
+	unsigned instanced_count = 0;
+	for (const auto & b : batches)
+	{
+		if (b.count > 1 && drawables[b.offset]->GetVertexBufferSegment().icount)
+		{
+			instanced_count++;
+			continue;
+		}
+		for (unsigned i = b.offset; i < b.offset + b.count; ++i)
+		{
+			Draw(glstate, *drawables[i]);
+		}
+		draw_stats.draw_calls += b.count;
+	}
+
+	if (!instanced_count)
+		return;
+
+	shader_instanced->Enable();
+	SetUniforms(*shader_instanced, cube_matrix, lightvec);
+
+	// color uniform cache is per program
+	drawable_color = Vec4(-1.0f);
+
+	for (const auto & b : batches)
+	{
+		const Drawable & d = *drawables[b.offset];
+		if (b.count < 2 || !d.GetVertexBufferSegment().icount)
+			continue;
+
+		instance_matrices.resize(b.count * 16);
+		for (unsigned i = 0; i < b.count; ++i)
+		{
+			const Mat4 mv = drawables[b.offset + i]->GetTransform().Multiply(viewMatrix);
+			const float * m = mv.GetArray();
+			std::copy(m, m + 16, &instance_matrices[i * 16]);
+		}
+
+		SetFlags(d, glstate, *shader_instanced);
+		SetTextures(d, glstate);
+		shader_instanced->SetUniformMat4f(Uniforms::InstanceMatrix, &instance_matrices[0], b.count);
+		vertex_buffer.DrawInstanced(glstate.VertexObject(), d.GetVertexBufferSegment(), b.count);
 	}
+	draw_stats.draw_calls += instanced_count;
+	draw_stats.instanced_calls += instanced_count;
+
+	// leave color cache valid for the regular shader
+	drawable_color = Vec4(-1.0f);
+}
+
+void RenderInputScene::Draw(GraphicsState & glstate, const Drawable & d)
+{
+	SetFlags(d, glstate, *shader);
+	SetTextures(d, glstate);
+	SetTransform(d);
+	vertex_buffer.Draw(glstate.VertexObject(), d.GetVertexBufferSegment());
 }
 
-void RenderInputScene::SetFlags(const Drawable & d, GraphicsState & glstate)
+void RenderInputScene::SetFlags(const Drawable & d, GraphicsState & glstate, Shader & s)
 {
 	glstate.DepthOffset(d.GetDecal());
 	glstate.CullFace(d.GetCull());
 	if (drawable_color != d.GetColor())
 	{
 		drawable_color = d.GetColor();
-		shader->SetUniform4f(Uniforms::ColorTint, &drawable_color[0]);
+		s.SetUniform4f(Uniforms::ColorTint, &drawable_color[0]);
 	}
 }
 
@@ -21,6 +21,7 @@
 #define _RENDER_INPUT_SCENE_H
 
 #include "render_input.h"
+#include "instance_batch.h"
 #include "mathvector.h"
 #include "quaternion.h"
 #include "matrix4.h"
@@ -37,11 +38,23 @@ class VertexBuffer;
 class RenderInputScene : public RenderInput
 {
 public:
+	/// maximum number of instances per instanced draw call
+	static const unsigned max_instances = 16;
+
+	struct DrawStats
+	{
+		unsigned drawables;			///< drawables submitted
+		unsigned draw_calls;		///< draw calls issued
+		unsigned instanced_calls;	///< instanced draw calls issued
+		DrawStats() : drawables(0), draw_calls(0), instanced_calls(0) {}
+	};
+
 	RenderInputScene(VertexBuffer & buffer);
 
 	~RenderInputScene();
 
-	void SetShader(Shader & newshader);
+	/// instanced shader variant is optional, it is used to batch drawables with blending disabled
+	void SetShader(Shader & newshader, Shader * newshader_instanced = NULL);
 
 	void SetFSAA(unsigned value);
 
@@ -71,12 +84,20 @@ public:
 
 	void Render(GraphicsState & glstate, std::ostream & error_output) override;
 
+	const DrawStats & GetDrawStats() const;
+
+	void ResetDrawStats();
+
 private:
 	VertexBuffer & vertex_buffer;
 	reseatable_reference <const std::vector <Drawable*> > drawlist_ptr;
 	const Mat4 * shadow_matrix;
 	unsigned int shadow_count;
 	Shader * shader;
+	Shader * shader_instanced;
+	InstanceBatcher batcher;
+	std::vector <float> instance_matrices;
+	DrawStats draw_stats;
 	Mat4 drawable_transform; // cache transform
 	Vec4 drawable_color; // cache color
 	Quat cam_rotation; // used for the skybox effect
@@ -88,14 +109,36 @@ private:
 	float lod_far; // used for distance culling
 	unsigned fsaa;
 	float contrast;
+	bool blend;
+
+	void SetUniforms(Shader & s, const float cube_matrix[9], const Vec3 & lightvec);
 
 	void Draw(GraphicsState & glstate, const std::vector <Drawable*> & drawlist);
 
-	void SetFlags(const Drawable & d, GraphicsState & glstate);
+	/// draw single drawables with shader, batches with shader_instanced
+	void DrawInstanced(
+		GraphicsState & glstate,
+		const std::vector <Drawable*> & drawlist,
+		const float cube_matrix[9],
+		const Vec3 & lightvec);
+
+	void Draw(GraphicsState & glstate, const Drawable & d);
+
+	void SetFlags(const Drawable & d, GraphicsState & glstate, Shader & s);
 
 	void SetTextures(const Drawable & d, GraphicsState & glstate);
 
 	void SetTransform(const Drawable & d);
 };
 
+inline const RenderInputScene::DrawStats & RenderInputScene::GetDrawStats() const
+{
+	return draw_stats;
+}
+
+inline void RenderInputScene::ResetDrawStats()
+{
+	draw_stats = DrawStats();
+}
+
 #endif // _RENDER_INPUT_SCENE_H
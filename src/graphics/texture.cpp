@@ -20,8 +20,9 @@
 #include "texture.h"
 #include "glcore.h"
 #include "glutil.h"
-#include "bcndecode.h"
+#include "bcndecode_parallel.h"
 #include "dds.h"
+#include "thread_pool.h"
 
 #ifdef __APPLE__
 #include <SDL2_image/SDL_image.h>
@@ -34,6 +35,7 @@
 #include <fstream>
 #include <vector>
 #include <cassert>
+#include <mutex>
 
 // averaging downsampler
 // bytespp is the size of a pixel (number of channels)
@@ -81,7 +83,7 @@ static void SampleDownAvg(
 	}
 }
 
-static void SampleDownAvg(
+void SampleDownAvg(
 	const unsigned bytespp,
 	const unsigned src_width,
 	const unsigned src_height,
@@ -122,6 +124,31 @@ static void SampleDownAvg(
 	}
 }
 
+unsigned GetTextureSize(TextureInfo::Size maxsize, unsigned size)
+{
+	if (maxsize == TextureInfo::SMALL)
+	{
+		if (size > 256)
+			return size / 4;
+		if (size > 128)
+			return size / 2;
+	}
+	else if (maxsize == TextureInfo::MEDIUM)
+	{
+		if (size > 256)
+			return size / 2;
+	}
+	return size;
+}
+
+SDL_Surface * DecodeImage(const std::string & path)
+{
+	// the texture cache decodes on worker threads while textures load
+	static std::mutex mutex;
+	std::lock_guard<std::mutex> lock(mutex);
+	return IMG_Load(path.c_str());
+}
+
 static void GetTextureFormat(
 	const SDL_Surface * surface,
 	const TextureInfo & info,
@@ -300,7 +327,7 @@ bool Texture::Load(const std::string & path, const TextureInfo & info, std::ostr
 	}
 	else
 	{
-		surface = IMG_Load(path.c_str());
+		surface = DecodeImage(path);
 	}
 
 	if (!surface)
@@ -318,28 +345,8 @@ bool Texture::Load(const std::string & path, const TextureInfo & info, std::ostr
 
 	// downsample if requested by application
 	std::vector<unsigned char> pixelsd;
-	unsigned wd = w;
-	unsigned hd = h;
-	if (info.maxsize == TextureInfo::SMALL)
-	{
-		if (w > 256)
-			wd = w / 4;
-		else if (w > 128)
-			wd = w / 2;
-
-		if (h > 256)
-			hd = h / 4;
-		else if (h > 128)
-			hd = h / 2;
-	}
-	else if (info.maxsize == TextureInfo::MEDIUM)
-	{
-		if (w > 256)
-			wd = w / 2;
-
-		if (h > 256)
-			hd = h / 2;
-	}
+	const unsigned wd = GetTextureSize(info.maxsize, w);
+	const unsigned hd = GetTextureSize(info.maxsize, h);
 	if (wd < w || hd < h)
 	{
 		pixelsd.resize(wd * hd * bytespp);
@@ -395,7 +402,7 @@ void Texture::Unload()
 
 bool Texture::LoadCube(const std::string & path, const TextureInfo & info, std::ostream & error)
 {
-	SDL_Surface * surface = IMG_Load(path.c_str());
+	SDL_Surface * surface = DecodeImage(path);
 	if (!surface)
 	{
 		error << "Error loading texture file: " << path << std::endl;
@@ -497,13 +504,17 @@ bool Texture::LoadDDS(const std::string & path, const TextureInfo & info, std::o
 
 	// gl3 renderer expects srgb
 	unsigned iformat = format;
+	if (format == GL_BGR)
+		iformat = info.srgb ? GL_SRGB8 : GL_RGB8;
+	else if (format == GL_BGRA)
+		iformat = info.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+	else if (format == GL_RED)
+		iformat = GL_R8;
+	else if (format == GL_RG)
+		iformat = GL_RG8;
 	if (info.srgb)
 	{
-		if (format == GL_BGR)
-			iformat = GL_SRGB8;
-		else if (format == GL_BGRA)
-			iformat = GL_SRGB8_ALPHA8;
-		else if (format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT)
+		if (format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT)
 			iformat = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
 		else if (format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT)
 			iformat = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT;
@@ -511,16 +522,25 @@ bool Texture::LoadDDS(const std::string & path, const TextureInfo & info, std::o
 			iformat = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
 	}
 
-	// handle the case s3tc is not supported
+	// handle the case s3tc/rgtc is not supported
 	std::vector<char> cdata;
 	unsigned cformat = info.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA;
 	unsigned ctype = 0;
+	bool csupported = GLC_EXT_texture_compression_s3tc;
 	switch (format) {
 		case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT: ctype = 1; break;
 		case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT: ctype = 2; break;
 		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: ctype = 3; break;
+		case GL_COMPRESSED_RED_RGTC1: ctype = 4; csupported = glcGetMajorVersion() >= 3; break;
+		case GL_COMPRESSED_RG_RGTC2: ctype = 5; csupported = glcGetMajorVersion() >= 3; break;
 	}
 
+	// bc4 decodes into one byte per pixel
+	const unsigned cpixel_size = (ctype == 4) ? 1 : 4;
+	const unsigned cdata_format = (ctype == 4) ? GL_RED : GL_RGBA;
+	if (ctype == 4)
+		cformat = GL_R8;
+
 	unsigned faces = 1;
 	unsigned itarget = target;
 	if (target == GL_TEXTURE_CUBE_MAP)
@@ -528,8 +548,62 @@ bool Texture::LoadDDS(const std::string & path, const TextureInfo & info, std::o
 		faces = 6;
 		itarget = GL_TEXTURE_CUBE_MAP_POSITIVE_X;
 	}
+	const bool compressed = (format != GL_BGR && format != GL_BGRA && format != GL_RED && format != GL_RG);
+	const unsigned blocklen = !compressed ?
+		16 * texlen / (width * height) :
+		(format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT || format == GL_COMPRESSED_RED_RGTC1 ? 8 : 16);
+
+	// decode all levels and faces at once if compression is not supported
+	std::vector<BcnImage> cimages;
+	if (compressed && !csupported)
+	{
+		unsigned long csize = 0;
+		const char * idata = texdata;
+		for (unsigned j = 0; j < faces; ++j)
+		{
+			unsigned iw = width;
+			unsigned ih = height;
+			for (unsigned i = 0; i < levels; ++i)
+			{
+				BcnImage image;
+				image.dst_size = iw * ih * cpixel_size;
+				image.src = idata;
+				image.src_size = ((iw + 3) / 4) * ((ih + 3) / 4) * blocklen;
+				image.width = iw;
+				image.height = ih;
+				cimages.push_back(image);
+
+				csize += image.dst_size;
+				idata += image.src_size;
+				iw = std::max(1u, iw / 2);
+				ih = std::max(1u, ih / 2);
+			}
+		}
+
+		cdata.resize(csize);
+		char * cptr = cdata.data();
+		for (auto & image : cimages)
+		{
+			image.dst = cptr;
+			cptr += image.dst_size;
+		}
+
+		if (!BcnDecodeParallel(cimages.data(), cimages.size(), ctype, 0, ThreadPool::Shared()))
+		{
+			error << "Failed BcnDecode " << path << std::endl;
+			glBindTexture(target, 0);
+			Unload();
+			return false;
+		}
+	}
+
+	// red and red-green rows are not 4 byte aligned
+	const bool unaligned = !compressed || (!csupported && cpixel_size == 1);
+	if (unaligned)
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
 	const char * idata = texdata;
-	const unsigned blocklen = 16 * texlen / (width * height);
+	const BcnImage * cimage = cimages.data();
 	for (unsigned j = 0; j < faces; ++j)
 	{
 		unsigned iw = width;
@@ -537,30 +611,18 @@ bool Texture::LoadDDS(const std::string & path, const TextureInfo & info, std::o
 		for (unsigned i = 0; i < levels; ++i)
 		{
 			unsigned ilen;
-			if (format == GL_BGR || format == GL_BGRA)
+			if (!compressed)
 			{
 				ilen = iw * ih * blocklen / 16;
 				glTexImage2D(itarget, i, iformat, iw, ih, 0, format, GL_UNSIGNED_BYTE, idata);
 			}
 			else
 			{
-				ilen = std::max(1u, iw / 4) * std::max(1u, ih / 4) * blocklen;
-				if (GLC_EXT_texture_compression_s3tc)
-				{
+				ilen = ((iw + 3) / 4) * ((ih + 3) / 4) * blocklen;
+				if (csupported)
 					glCompressedTexImage2D(itarget, i, iformat, iw, ih, 0, ilen, idata);
-				}
 				else
-				{
-					cdata.resize(iw * ih * 4);
-					if (BcnDecode(cdata.data(), cdata.size(), idata, ilen, iw, ih, ctype, 0, 0) < 0)
-					{
-						error << "Failed BcnDecode " << path << std::endl;
-						glBindTexture(target, 0);
-						Unload();
-						return false;
-					}
-					glTexImage2D(itarget, i, cformat, iw, ih, 0, cformat, GL_UNSIGNED_BYTE, cdata.data());
-				}
+					glTexImage2D(itarget, i, cformat, iw, ih, 0, cdata_format, GL_UNSIGNED_BYTE, (cimage++)->dst);
 			}
 			CheckForOpenGLErrors("Texture creation", error);
 
@@ -571,6 +633,9 @@ bool Texture::LoadDDS(const std::string & path, const TextureInfo & info, std::o
 		itarget++;
 	}
 
+	if (unaligned)
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
 	// force mipmaps for GL3
 	if (levels == 1 && GLC_ARB_framebuffer_object)
 		glGenerateMipmap(target);
@@ -26,6 +26,8 @@
 #include <iosfwd>
 #include <string>
 
+struct SDL_Surface;
+
 class Texture : public TextureInterface
 {
 public:
@@ -43,5 +45,26 @@ private:
 	bool LoadDDS(const std::string & path, const TextureInfo & info, std::ostream & error);
 };
 
+/// decode an image file, calls are serialized as SDL_image decoders are not thread safe
+SDL_Surface * DecodeImage(const std::string & path);
+
+/// texture dimension after applying the maxsize limit
+unsigned GetTextureSize(TextureInfo::Size maxsize, unsigned size);
+
+/// averaging downsampler
+/// bytespp is the size of a pixel (number of channels)
+/// dst width/height are multiples of src width, height in pixels
+/// pitch is size of a pixel row in bytes
+void SampleDownAvg(
+	const unsigned bytespp,
+	const unsigned src_width,
+	const unsigned src_height,
+	const unsigned src_pitch,
+	const unsigned char src[],
+	const unsigned dst_width,
+	const unsigned dst_height,
+	const unsigned dst_pitch,
+	unsigned char dst[]);
+
 #endif //_TEXTURE_H
 
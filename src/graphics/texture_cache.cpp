@@ -0,0 +1,418 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "texture_cache.h"
+#include "texture.h"
+#include "glcore.h"
+#include "bcnencode.h"
+#include "bcndecode.h"
+#include "dds.h"
+#include "thread_pool.h"
+#include "unittest.h"
+
+#ifdef __APPLE__
+#include <SDL2_image/SDL_image.h>
+#else
+#include <SDL2/SDL_image.h>
+#endif
+
+#include <cassert>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+// bump to invalidate cache files written by older versions
+static const uint64_t cache_version = 3;
+
+static uint64_t HashFnv1a(const char data[], unsigned long size, uint64_t hash = 14695981039346656037ull)
+{
+	for (unsigned long i = 0; i < size; ++i)
+	{
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// 2x2 box filter, odd dimensions clamp to the edge
+static void SampleDownHalf(
+	const unsigned char src[], unsigned src_width, unsigned src_height,
+	unsigned char dst[], unsigned dst_width, unsigned dst_height)
+{
+	for (unsigned y = 0; y < dst_height; ++y)
+	{
+		const unsigned y0 = std::min(2 * y, src_height - 1);
+		const unsigned y1 = std::min(2 * y + 1, src_height - 1);
+		for (unsigned x = 0; x < dst_width; ++x)
+		{
+			const unsigned x0 = std::min(2 * x, src_width - 1);
+			const unsigned x1 = std::min(2 * x + 1, src_width - 1);
+			const unsigned char * p00 = src + (y0 * src_width + x0) * 4;
+			const unsigned char * p01 = src + (y0 * src_width + x1) * 4;
+			const unsigned char * p10 = src + (y1 * src_width + x0) * 4;
+			const unsigned char * p11 = src + (y1 * src_width + x1) * 4;
+			for (unsigned i = 0; i < 4; ++i)
+				*dst++ = (p00[i] + p01[i] + p10[i] + p11[i] + 2) / 4;
+		}
+	}
+}
+
+TextureCache::TextureCache()
+{
+	// ctor
+}
+
+TextureCache::~TextureCache()
+{
+	// jobs reference the pending set, finish them first
+	m_pool.reset();
+}
+
+void TextureCache::Init(const std::string & path, unsigned thread_count)
+{
+	m_pool.reset();
+	m_path = path;
+	if (m_path.empty())
+		return;
+
+	if (thread_count == 0)
+		thread_count = std::max(2u, std::thread::hardware_concurrency()) - 1;
+	m_pool.reset(new ThreadPool(thread_count));
+}
+
+bool TextureCache::Enabled() const
+{
+	return !m_path.empty();
+}
+
+std::string TextureCache::GetPath(const std::string & source, const TextureInfo & info) const
+{
+	if (m_path.empty() || info.data || info.cube)
+		return std::string();
+
+	std::ifstream file(source.c_str(), std::ifstream::in | std::ifstream::binary);
+	if (!file)
+		return std::string();
+
+	// dds files are loaded directly
+	char magic[4];
+	if (!file.read(magic, 4) || IsDDS(magic, 4))
+		return std::string();
+
+	// key on the source content, an edited file never matches a stale entry
+	// even if the copy kept its size and modification time
+	const uint64_t settings[] = {cache_version, uint64_t(info.maxsize), uint64_t(info.compress)};
+	uint64_t hash = HashFnv1a((const char *)settings, sizeof(settings));
+	hash = HashFnv1a(magic, sizeof(magic), hash);
+	char buffer[1 << 16];
+	while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0)
+		hash = HashFnv1a(buffer, file.gcount(), hash);
+
+	std::ostringstream s;
+	s << m_path << "/" << std::hex << std::setw(16) << std::setfill('0') << hash << ".dds";
+	return s.str();
+}
+
+void TextureCache::Add(const std::string & source, const TextureInfo & info, const std::string & path)
+{
+	if (!m_pool || path.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_pending.insert(path).second)
+			return;
+	}
+
+	m_pool->Push([this, source, info, path]()
+	{
+		Create(source, info, path);
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pending.erase(path);
+	});
+}
+
+void TextureCache::Wait()
+{
+	if (m_pool)
+		m_pool->Wait();
+}
+
+void TextureCache::Encode(
+	const unsigned char rgba[], unsigned width, unsigned height,
+	unsigned channels, bool compress, std::vector<unsigned char> & dds)
+{
+	const unsigned size = width * height * 4;
+
+	bool opaque = true;
+	for (unsigned i = 3; i < size && opaque; i += 4)
+		opaque = (rgba[i] == 255);
+
+	// uncompressed red and red-green images keep their channel count
+	unsigned format = (channels == 1) ? GL_RED : (channels == 2) ? GL_RG : GL_BGRA;
+	const unsigned pixel_size = (channels <= 2) ? channels : 4;
+	int bcn = 0;
+	if (compress)
+	{
+		if (channels == 1)
+		{
+			format = GL_COMPRESSED_RED_RGTC1;
+			bcn = 4;
+		}
+		else if (channels == 2)
+		{
+			format = GL_COMPRESSED_RG_RGTC2;
+			bcn = 5;
+		}
+		else if (opaque)
+		{
+			format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+			bcn = 1;
+		}
+		else
+		{
+			format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			bcn = 3;
+		}
+	}
+
+	unsigned levels = 1;
+	for (unsigned s = std::max(width, height); s > 1; s /= 2)
+		levels++;
+
+	dds.resize(128);
+	const int header_size = WriteDDSHeader(dds.data(), dds.size(), format, width, height, levels);
+	assert(header_size == 128);
+	(void)header_size;
+
+	std::vector<unsigned char> level(rgba, rgba + size);
+	std::vector<unsigned char> next;
+	unsigned w = width;
+	unsigned h = height;
+	for (unsigned i = 0; i < levels; ++i)
+	{
+		const unsigned offset = dds.size();
+		if (bcn)
+		{
+			dds.resize(offset + BcnEncodedSize(w, h, bcn));
+			BcnEncode(&dds[offset], level.data(), w, h, bcn);
+		}
+		else
+		{
+			dds.resize(offset + w * h * pixel_size);
+			unsigned char * dst = &dds[offset];
+			const unsigned char * src = level.data();
+			for (unsigned j = 0; j < w * h; ++j, src += 4, dst += pixel_size)
+			{
+				if (pixel_size == 4)
+				{
+					dst[0] = src[2];
+					dst[1] = src[1];
+					dst[2] = src[0];
+					dst[3] = src[3];
+				}
+				else
+				{
+					dst[0] = src[0];
+					if (pixel_size == 2)
+						dst[1] = src[1];
+				}
+			}
+		}
+
+		if (i + 1 < levels)
+		{
+			const unsigned wn = std::max(1u, w / 2);
+			const unsigned hn = std::max(1u, h / 2);
+			next.resize(wn * hn * 4);
+			SampleDownHalf(level.data(), w, h, next.data(), wn, hn);
+			level.swap(next);
+			w = wn;
+			h = hn;
+		}
+	}
+}
+
+void TextureCache::Create(const std::string & source, const TextureInfo & info, const std::string & path)
+{
+	SDL_Surface * surface = DecodeImage(source);
+	if (!surface)
+		return;
+
+	const unsigned channels = surface->format->BytesPerPixel;
+	unsigned w = surface->w;
+	unsigned h = surface->h;
+	std::vector<unsigned char> rgba(w * h * 4);
+	if (channels >= 3)
+	{
+		SDL_Surface * converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+		if (!converted)
+		{
+			SDL_FreeSurface(surface);
+			return;
+		}
+		for (unsigned y = 0; y < h; ++y)
+		{
+			const unsigned char * src = (const unsigned char *)converted->pixels + y * converted->pitch;
+			std::copy(src, src + w * 4, &rgba[y * w * 4]);
+		}
+		SDL_FreeSurface(converted);
+	}
+	else
+	{
+		// red or red-green data, same channel layout as the uncached texture
+		for (unsigned y = 0; y < h; ++y)
+		{
+			const unsigned char * src = (const unsigned char *)surface->pixels + y * surface->pitch;
+			unsigned char * dst = &rgba[y * w * 4];
+			for (unsigned x = 0; x < w; ++x, src += channels, dst += 4)
+			{
+				dst[0] = src[0];
+				dst[1] = (channels == 2) ? src[1] : 0;
+				dst[2] = 0;
+				dst[3] = 255;
+			}
+		}
+	}
+	SDL_FreeSurface(surface);
+
+	// same compression rule as the uncached texture
+	const bool compress = info.compress && (w > 512 || h > 512);
+
+	const unsigned wd = GetTextureSize(info.maxsize, w);
+	const unsigned hd = GetTextureSize(info.maxsize, h);
+	if (wd < w || hd < h)
+	{
+		std::vector<unsigned char> rgbad(wd * hd * 4);
+		SampleDownAvg(4, w, h, w * 4, rgba.data(), wd, hd, wd * 4, rgbad.data());
+		rgba.swap(rgbad);
+		w = wd;
+		h = hd;
+	}
+
+	std::vector<unsigned char> dds;
+	Encode(rgba.data(), w, h, channels, compress, dds);
+
+	// write to temporary file first, a partial file must never be loaded
+	const std::string temppath = path + ".tmp";
+	{
+		std::ofstream file(temppath.c_str(), std::ofstream::out | std::ofstream::binary);
+		if (!file.write((const char *)dds.data(), dds.size()))
+			return;
+	}
+	if (std::rename(temppath.c_str(), path.c_str()) != 0)
+		std::remove(temppath.c_str());
+}
+
+QT_TEST(texture_cache_test)
+{
+	const unsigned w = 70, h = 38;
+	std::vector<unsigned char> rgba(w * h * 4);
+	for (unsigned y = 0; y < h; ++y)
+	{
+		for (unsigned x = 0; x < w; ++x)
+		{
+			unsigned char * p = &rgba[(y * w + x) * 4];
+			p[0] = x * 255 / w;
+			p[1] = y * 255 / h;
+			p[2] = 128;
+			p[3] = 255;
+		}
+	}
+
+	const struct { unsigned channels; bool compress; bool opaque; unsigned format; } tests[] = {
+		{4, false, true, GL_BGRA},
+		{4, true, true, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT},
+		{4, true, false, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT},
+		{2, true, true, GL_COMPRESSED_RG_RGTC2},
+		{1, true, true, GL_COMPRESSED_RED_RGTC1},
+		{2, false, true, GL_RG},
+		{1, false, true, GL_RED},
+	};
+	for (const auto & test : tests)
+	{
+		if (!test.opaque)
+			rgba[3] = 0;
+
+		std::vector<unsigned char> dds;
+		TextureCache::Encode(rgba.data(), w, h, test.channels, test.compress, dds);
+
+		const void * data = 0;
+		unsigned long size = 0;
+		unsigned format = 0, target = 0, width = 0, height = 0, levels = 0;
+		QT_CHECK(IsDDS(dds.data(), dds.size()));
+		QT_CHECK(ReadDDS(dds.data(), dds.size(), data, size, format, target, width, height, levels));
+		QT_CHECK_EQUAL(format, test.format);
+		QT_CHECK_EQUAL(target, unsigned(GL_TEXTURE_2D));
+		QT_CHECK_EQUAL(width, w);
+		QT_CHECK_EQUAL(height, h);
+		QT_CHECK_EQUAL(levels, 7u);
+
+		// mip chain fills the file
+		const unsigned pixel_size = test.channels <= 2 ? test.channels : 4;
+		unsigned long chain = 0;
+		for (unsigned i = 0, iw = w, ih = h; i < levels; ++i, iw = std::max(1u, iw / 2), ih = std::max(1u, ih / 2))
+			chain += test.compress ? BcnEncodedSize(iw, ih, test.format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ? 1 : test.format == GL_COMPRESSED_RED_RGTC1 ? 4 : 3) : iw * ih * pixel_size;
+		QT_CHECK_EQUAL(chain + 128, dds.size());
+
+		// top level round trip
+		std::vector<unsigned char> decoded(w * h * 4);
+		const unsigned char * texels = (const unsigned char *)data;
+		if (test.format == GL_COMPRESSED_RED_RGTC1)
+		{
+			std::vector<unsigned char> red(w * h);
+			QT_CHECK(BcnDecode(red.data(), red.size(), texels, size, w, h, 4, 0, 0) > 0);
+			for (unsigned i = 0; i < w * h; ++i)
+				decoded[i * 4] = red[i];
+		}
+		else if (test.compress)
+		{
+			const int bcn = test.format == GL_COMPRESSED_RG_RGTC2 ? 5 : test.format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ? 1 : 3;
+			QT_CHECK(BcnDecode(decoded.data(), decoded.size(), texels, size, w, h, bcn, 0, 0) > 0);
+		}
+		else if (pixel_size == 4)
+		{
+			for (unsigned i = 0; i < w * h * 4; i += 4)
+			{
+				decoded[i + 0] = texels[i + 2];
+				decoded[i + 1] = texels[i + 1];
+				decoded[i + 2] = texels[i + 0];
+				decoded[i + 3] = texels[i + 3];
+			}
+		}
+		else
+		{
+			QT_CHECK_EQUAL(size, w * h * pixel_size);
+			for (unsigned i = 0; i < w * h; ++i)
+				for (unsigned c = 0; c < pixel_size; ++c)
+					decoded[i * 4 + c] = texels[i * pixel_size + c];
+		}
+		unsigned max_error = 0;
+		const unsigned compared = test.channels < 3 ? test.channels : 3;
+		for (unsigned i = 0; i < w * h * 4; i += 4)
+			for (unsigned c = 0; c < compared; ++c)
+				max_error = std::max<unsigned>(max_error, std::abs(int(decoded[i + c]) - int(rgba[i + c])));
+		QT_CHECK(max_error < 16);
+
+		rgba[3] = 255;
+	}
+}
@@ -0,0 +1,77 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _TEXTURE_CACHE_H
+#define _TEXTURE_CACHE_H
+
+#include "textureinfo.h"
+
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+/// Disk cache of textures converted into dds files with a full mip chain.
+/// Entries are encoded on worker threads, the next load of the source
+/// texture can then go through the dds loader instead of decoding,
+/// downsampling and mipmapping the source image.
+class TextureCache
+{
+public:
+	TextureCache();
+
+	~TextureCache();
+
+	/// cache directory, empty path disables the cache
+	/// thread_count 0 uses all but one hardware thread
+	void Init(const std::string & path, unsigned thread_count = 0);
+
+	bool Enabled() const;
+
+	/// cache file path of a source texture, keyed by the source content and load settings
+	/// returns empty string if the texture can not be cached
+	std::string GetPath(const std::string & source, const TextureInfo & info) const;
+
+	/// queue creation of cache file path from source
+	void Add(const std::string & source, const TextureInfo & info, const std::string & path);
+
+	/// block until all queued cache files are written
+	void Wait();
+
+	/// convert rgba pixels into a dds file with a full mip chain
+	/// channels is the number of meaningful source channels (1 - 4)
+	/// compressed format is bc4 for 1, bc5 for 2 channels, bc1 for opaque and bc3 for translucent images
+	/// uncompressed format is red or red-green for 1 - 2 channels, bgra otherwise
+	static void Encode(
+		const unsigned char rgba[], unsigned width, unsigned height,
+		unsigned channels, bool compress, std::vector<unsigned char> & dds);
+
+private:
+	std::string m_path;
+	std::unique_ptr<ThreadPool> m_pool;
+	std::set<std::string> m_pending;
+	std::mutex m_mutex;
+
+	void Create(const std::string & source, const TextureInfo & info, const std::string & path);
+};
+
+#endif // _TEXTURE_CACHE_H
@@ -18,6 +18,7 @@
 /************************************************************************/
 
 #include "vertexarray.h"
+#include "mesh_optimize.h"
 #include "quaternion.h"
 #include "unittest.h"
 
@@ -177,6 +178,41 @@ void VertexArray::Add(
 	}
 }
 
+void VertexArray::Update(
+	const float newvert[], const float newtco[],
+	unsigned offset, unsigned vertcount,
+	const unsigned char newcol[])
+{
+	if (newvert)
+	{
+		assert((offset + vertcount) * 3 <= vertices.size());
+		std::memcpy(&vertices[offset * 3], newvert, sizeof(float) * 3 * vertcount);
+	}
+	if (newtco)
+	{
+		assert((offset + vertcount) * 2 <= texcoords.size());
+		std::memcpy(&texcoords[offset * 2], newtco, sizeof(float) * 2 * vertcount);
+	}
+	if (newcol)
+	{
+		assert((offset + vertcount) * 4 <= colors.size());
+		std::memcpy(&colors[offset * 4], newcol, 4 * vertcount);
+	}
+}
+
+void VertexArray::Truncate(unsigned vertcount, unsigned facecount)
+{
+	assert(vertcount * 3 <= vertices.size() && facecount <= faces.size());
+	vertices.resize(vertcount * 3);
+	if (!normals.empty())
+		normals.resize(vertcount * 3);
+	if (!texcoords.empty())
+		texcoords.resize(vertcount * 2);
+	if (!colors.empty())
+		colors.resize(vertcount * 4);
+	faces.resize(facecount);
+}
+
 void VertexArray::SetToBillboard(float x1, float y1, float x2, float y2)
 {
 	unsigned int bfaces[6];
@@ -633,6 +669,76 @@ void VertexArray::FixWindingOrder()
 	}
 }
 
+template <typename T>
+static void RemapData(std::vector<T> & vec, const std::vector<unsigned> & remap, unsigned count, unsigned stride)
+{
+	if (vec.empty())
+		return;
+
+	assert(vec.size() == remap.size() * stride);
+	std::vector<T> temp(count * stride);
+	for (unsigned i = 0; i < remap.size(); ++i)
+	{
+		if (remap[i] == ~0u)
+			continue;
+
+		for (unsigned j = 0; j < stride; ++j)
+			temp[remap[i] * stride + j] = vec[i * stride + j];
+	}
+	vec.swap(temp);
+}
+
+void VertexArray::Optimize(bool reduce_overdraw, MeshOptimize::Stats & before, MeshOptimize::Stats & after)
+{
+	const unsigned vcount = GetNumVertices();
+	before = MeshOptimize::Analyze(faces.data(), faces.size(), vcount);
+	if (faces.empty())
+	{
+		after = before;
+		return;
+	}
+
+	MeshOptimize::OptimizeVertexCache(faces.data(), faces.data(), faces.size(), vcount);
+
+	if (reduce_overdraw)
+		MeshOptimize::OptimizeOverdraw(faces.data(), faces.size(), vertices.data(), vcount);
+
+	std::vector<unsigned> remap(vcount);
+	const unsigned count = MeshOptimize::OptimizeVertexFetch(remap.data(), faces.data(), faces.size(), vcount);
+	RemapData(vertices, remap, count, 3);
+	RemapData(normals, remap, count, 3);
+	RemapData(texcoords, remap, count, 2);
+	RemapData(colors, remap, count, 4);
+
+	after = MeshOptimize::Analyze(faces.data(), faces.size(), count);
+}
+
+float VertexArray::Simplify(float index_ratio, float max_error, VertexArray & out) const
+{
+	out = *this;
+	if (faces.empty())
+		return 0;
+
+	const unsigned vcount = GetNumVertices();
+	const unsigned target = unsigned(faces.size() * index_ratio) / 3 * 3;
+	float error = 0;
+	const unsigned count = MeshOptimize::Simplify(
+		out.faces.data(), faces.data(), faces.size(),
+		vertices.data(), vcount, target, max_error, &error);
+	out.faces.resize(count);
+
+	MeshOptimize::OptimizeVertexCache(out.faces.data(), out.faces.data(), count, vcount);
+
+	std::vector<unsigned> remap(vcount);
+	const unsigned used = MeshOptimize::OptimizeVertexFetch(remap.data(), out.faces.data(), count, vcount);
+	RemapData(out.vertices, remap, used, 3);
+	RemapData(out.normals, remap, used, 3);
+	RemapData(out.texcoords, remap, used, 2);
+	RemapData(out.colors, remap, used, 4);
+
+	return error;
+}
+
 /* fixme
 QT_TEST(vertexarray_test)
 {
@@ -27,6 +27,11 @@
 
 class ModelObj;
 
+namespace MeshOptimize
+{
+	struct Stats;
+}
+
 class VertexArray
 {
 public:
@@ -61,6 +66,18 @@ public:
 		const float newnorm[] = 0, unsigned newnormcount = 0,
 		const unsigned char newcol[] = 0, unsigned newcolcount = 0);
 
+	/// overwrite vertcount vertex positions, texture coordinates and colors in place,
+	/// starting at vertex index offset, the array has to contain them already,
+	/// null arrays are left unchanged
+	void Update(
+		const float newvert[], const float newtco[],
+		unsigned offset, unsigned vertcount,
+		const unsigned char newcol[] = 0);
+
+	/// drop all vertices from index vertcount and all face indices from index facecount on,
+	/// the remaining faces must not reference dropped vertices
+	void Truncate(unsigned vertcount, unsigned facecount);
+
 	/// helper functions
 
 	void SetToBillboard(float x1, float y1, float x2, float y2);
@@ -158,6 +175,14 @@ public:
 	// set winding order to match normal direction, used by scale
 	void FixWindingOrder();
 
+	// reorder faces for vertex cache (and overdraw), vertices by first use
+	// drops unreferenced vertices, reports cache stats before and after
+	void Optimize(bool reduce_overdraw, MeshOptimize::Stats & before, MeshOptimize::Stats & after);
+
+	// build a simplified copy with at most index_ratio of the indices and a
+	// geometric error below max_error (relative to extent), returns the error
+	float Simplify(float index_ratio, float max_error, VertexArray & out) const;
+
 	template <class Serializer>
 	bool Serialize(Serializer & s)
 	{
@@ -145,15 +145,18 @@ struct VertexBuffer::BindStaticVertexData
 		Model * mo = drawable.GetModel();
 		assert(mo);
 
-		// early out if model already bound
+		// bind model and its levels of detail, unless already bound
 		Segment & sg = mo->GetVertexBufferSegment();
-		if (sg.age == ctx.age_static)
+		if (sg.age != ctx.age_static)
 		{
-			drawable.SetVertexBufferSegment(sg);
-			return;
+			for (unsigned int i = 0; i < mo->GetLodCount(); ++i)
+				Bind(mo->GetLodVertexArray(i), mo->GetLodVertexBufferSegment(i));
 		}
+		drawable.SetVertexBufferSegment(sg);
+	}
 
-		const VertexArray & va = mo->GetVertexArray();
+	void Bind(const VertexArray & va, Segment & sg)
+	{
 		const VertexFormat::Enum vf = va.GetVertexFormat();
 		const unsigned int vsize = VertexFormat::Get(vf).stride;
 		const unsigned int vcount = va.GetNumVertices();
@@ -193,7 +196,6 @@ struct VertexBuffer::BindStaticVertexData
 		sg.vformat = vf;
 		sg.object = obindex;
 		sg.age = ctx.age_static;
-		drawable.SetVertexBufferSegment(sg);
 
 		// store va for vertex data upload and update buffer counts
 		varrays[vf].push_back(&va);
@@ -361,6 +363,46 @@ void VertexBuffer::Draw(unsigned int & vbuffer, const Segment & s) const
 	}
 }
 
+bool VertexBuffer::InstancingSupported()
+{
+	return glDrawElementsInstanced && (!GLC_ARB_draw_elements_base_vertex || glDrawElementsInstancedBaseVertex);
+}
+
+void VertexBuffer::DrawInstanced(unsigned int & vbuffer, const Segment & s, unsigned int count) const
+{
+	if (s.vcount == 0 || s.icount == 0)
+		return;
+
+	const unsigned short age = (s.object != 0) ? age_static : age_dynamic;
+	if (s.age != age)
+	{
+		assert(0);
+		return;
+	}
+
+	if (vbuffer != s.vbuffer)
+		BindSegmentBuffer(vbuffer, s);
+
+	if (vbuffer == 0)
+	{
+		assert(0);
+		return;
+	}
+
+	if (GLC_ARB_draw_elements_base_vertex)
+	{
+		glDrawElementsInstancedBaseVertex(
+			GL_TRIANGLES, s.icount, GL_UNSIGNED_INT,
+			(const void *)(size_t)s.ioffset, count, s.voffset);
+	}
+	else
+	{
+		glDrawElementsInstanced(
+			GL_TRIANGLES, s.icount, GL_UNSIGNED_INT,
+			(const void *)(size_t)s.ioffset, count);
+	}
+}
+
 void VertexBuffer::BindSegmentBuffer(unsigned int & vbuffer, const Segment & s) const
 {
 	if (use_vao)
@@ -70,6 +70,15 @@ public:
 	/// \param segment is the segment to be drawn
 	void Draw(unsigned int & vbuffer, const Segment & segment) const;
 
+	/// \brief Draw count instances of an indexed vertex buffer segment
+	/// \param vbuffer is the currently bound vertex buffer / array object
+	/// \param segment is the segment to be drawn
+	/// \param count is the number of instances
+	void DrawInstanced(unsigned int & vbuffer, const Segment & segment, unsigned int count) const;
+
+	/// \brief Instanced draw calls are available
+	static bool InstancingSupported();
+
 private:
 	/// \brief Buffer objects store gpu buffer state
 	struct Object
@@ -77,6 +77,13 @@ bool Font::Load(
 	texinfo.repeatv = false;
 	content.load(font_texture, texpath, texname, texinfo);
 
+	return LoadInfo(fontinfopath, error_output);
+}
+
+bool Font::LoadInfo(
+	const std::string & fontinfopath,
+	std::ostream & error_output)
+{
 	std::ifstream fontinfo(fontinfopath.c_str());
 	if (!fontinfo)
 	{
@@ -49,6 +49,11 @@ public:
 		std::ostream & error_output,
 		bool mipmap = false);
 
+	/// load font metrics only, the font texture is left unset
+	bool LoadInfo(
+		const std::string & fontinfopath,
+		std::ostream & error_output);
+
 	const std::shared_ptr<Texture> & GetFontTexture() const
 	{
 		return font_texture;
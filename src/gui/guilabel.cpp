@@ -18,15 +18,16 @@
 /************************************************************************/
 
 #include "guilabel.h"
+#include "text_batch.h"
 #include <cassert>
 
 void GuiLabel::SetupDrawable(
 	SceneNode & scene,
-	const Font & font, int align,
+	TextBatch & batch, int align,
 	float scalex, float scaley,
 	float xywh[4], float z)
 {
-	m_font = &font;
+	m_batch = &batch;
 	m_x = xywh[0];
 	m_y = xywh[1];
 	m_w = xywh[2];
@@ -35,11 +36,22 @@ void GuiLabel::SetupDrawable(
 	m_scaley = scaley;
 	m_align = align;
 
-	m_draw = scene.GetDrawList().text.insert(Drawable());
-	Drawable & drawref = GetDrawable(scene);
-	drawref.SetDrawOrder(z);
+	m_id = batch.AddText(scene, z);
+	batch.SetColor(m_id, m_rgb[0], m_rgb[1], m_rgb[2], m_alpha);
+}
 
-	m_text_draw.Set(drawref, font, m_text, m_x, m_y, scalex, scaley, m_rgb[0], m_rgb[1], m_rgb[2]);
+void GuiLabel::Update(SceneNode & /*scene*/, float /*dt*/)
+{
+	if (m_update)
+	{
+		m_batch->SetColor(m_id, m_rgb[0], m_rgb[1], m_rgb[2], m_visible ? m_alpha : 0);
+		m_update = false;
+	}
+}
+
+void GuiLabel::SetAlpha(SceneNode & /*scene*/, float value)
+{
+	m_batch->SetColor(m_id, m_rgb[0], m_rgb[1], m_rgb[2], m_visible ? m_alpha * value : 0);
 }
 
 bool GuiLabel::GetProperty(const std::string & name, Delegated<const std::string &> & slot)
@@ -56,20 +68,20 @@ void GuiLabel::SetText(const std::string & text)
 {
 	if (m_text != text)
 	{
-		assert(m_font);
+		assert(m_batch);
 		m_text = text;
 
+		// left aligned text starts at the left border, right aligned ends at the right border
 		float x = m_x;
-		float textw = m_font->GetWidth(m_text) * m_scalex;
-		if (m_align == -1) x -= m_w * 0.5f;
-		else if (m_align == 0) x -= textw * 0.5f;
-		else if (m_align == 1) x -= (textw - m_w * 0.5f);
+		float anchor = 0.5f;
+		if (m_align == -1) x -= m_w * 0.5f, anchor = 0.0f;
+		else if (m_align == 1) x += m_w * 0.5f, anchor = 1.0f;
 
-		m_text_draw.Revise(*m_font, m_text, x, m_y, m_scalex, m_scaley);
+		m_textw = m_batch->SetText(m_id, m_text, x, m_y, m_scalex, m_scaley, anchor);
 	}
 }
 
 Drawable & GuiLabel::GetDrawable(SceneNode & scene)
 {
-	return scene.GetDrawList().text.get(m_draw);
+	return m_batch->GetDrawable(scene, m_id);
 }
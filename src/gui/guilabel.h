@@ -21,10 +21,8 @@
 #define _GUILABEL_H
 
 #include "guiwidget.h"
-#include "text_draw.h"
 
-class Texture;
-class Font;
+class TextBatch;
 
 class GuiLabel : public GuiWidget
 {
@@ -34,22 +32,29 @@ public:
 	// align: -1 left, 0 center, +1 right
 	void SetupDrawable(
 		SceneNode & scene,
-		const Font & font, int align,
+		TextBatch & batch, int align,
 		float scalex, float scaley,
 		float xywh[4], float z);
 
+	void Update(SceneNode & scene, float dt) override;
+
+	void SetAlpha(SceneNode & scene, float value) override;
+
 	bool GetProperty(const std::string & name, Delegated<const std::string &> & slot) override;
 
 	void SetText(const std::string & text);
 
+	/// width of the current text, cached on text change
+	float GetTextWidth() const { return m_textw; }
+
 private:
-	SceneNode::DrawableHandle m_draw;
-	TextDraw m_text_draw;
+	TextBatch * m_batch = 0;
+	unsigned m_id = 0;
 	std::string m_text;
-	const Font * m_font = 0;
 	float m_x = 0, m_y = 0;
 	float m_w = 0, m_h = 0;
 	float m_scalex = 0, m_scaley = 0;
+	float m_textw = 0;
 	int m_align = 0;
 
 	Drawable & GetDrawable(SceneNode & scene) override;
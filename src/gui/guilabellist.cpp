@@ -21,7 +21,7 @@
 #include "guilabel.h"
 
 void GuiLabelList::SetupDrawable(
-	SceneNode & scene, const Font & font, int align,
+	SceneNode & scene, TextBatch & batch, int align,
 	float scalex, float scaley, float z)
 {
 	m_elements.resize(m_rows * m_cols);
@@ -33,7 +33,7 @@ void GuiLabelList::SetupDrawable(
 		float xywh[4] = {x + m_elemw * 0.5f, y + m_elemh * 0.5f, m_elemw, m_elemh};
 
 		GuiLabel * element = new GuiLabel();
-		element->SetupDrawable(scene, font, align, scalex, scaley, xywh, z);
+		element->SetupDrawable(scene, batch, align, scalex, scaley, xywh, z);
 		m_elements[i] = element;
 	}
 }
@@ -22,7 +22,7 @@
 
 #include "guiwidgetlist.h"
 
-class Font;
+class TextBatch;
 
 class GuiLabelList : public GuiWidgetList
 {
@@ -31,7 +31,7 @@ public:
 
 	/// Create label elements. To be called after SetupList!
 	void SetupDrawable(
-		SceneNode & scene, const Font & font, int align,
+		SceneNode & scene, TextBatch & batch, int align,
 		float scalex, float scaley, float z);
 
 protected:
@@ -48,6 +48,11 @@ std::string GuiLanguage::operator()(const std::string & str) const
 	return gettext(str.c_str());
 }
 
+const char * GuiLanguage::operator()(const char * str) const
+{
+	return gettext(str);
+}
+
 std::string GuiLanguage::GetCodePage() const
 {
 	std::string cp = gettext("_CODEPAGE_");
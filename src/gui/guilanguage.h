@@ -37,6 +37,9 @@ public:
 	/// translation operator
 	std::string operator()(const std::string & str) const;
 
+	/// translation operator, returns a pointer into the message catalog
+	const char * operator()(const char * str) const;
+
 	/// get code page string from language id
 	std::string GetCodePage() const;
 
@@ -466,6 +466,9 @@ bool GuiPage::Load(
 
 	//error_output << "Loading " << path << std::endl;
 
+	// page labels are batched by draw order
+	text_batch.SetFont(font);
+
 	// load widgets and controls
 	active_control = 0;
 	std::map<std::string, GuiWidget*> widgetmap;			// labels, images, sliders
@@ -519,7 +522,7 @@ bool GuiPage::Load(
 				}
 
 				// init drawable
-				widget_list->SetupDrawable(node, font, align, scalex, scaley, r.z);
+				widget_list->SetupDrawable(node, text_batch, align, scalex, scaley, r.z);
 
 				widgetlistmap[section->first] = widget_list;
 				widget = widget_list;
@@ -534,7 +537,7 @@ bool GuiPage::Load(
 
 				GuiLabel * new_widget = new GuiLabel();
 				new_widget->SetupDrawable(
-					node, font, align, scalex, scaley, r.xywh, r.z);
+					node, text_batch, align, scalex, scaley, r.xywh, r.z);
 
 				Delegated<const std::string &> d;
 				d.bind<GuiLabel, &GuiLabel::SetText>(new_widget);
@@ -938,6 +941,7 @@ void GuiPage::Clear()
 		delete control;
 
 	node.Clear();
+	text_batch.Clear();
 	labels.clear();
 	controls.clear();
 	widgets.clear();
@@ -21,6 +21,7 @@
 #define _GUIPAGE_H
 
 #include "graphics/scenenode.h"
+#include "text_batch.h"
 #include "signalslot.h"
 
 #include <map>
@@ -92,6 +93,7 @@ private:
 	GuiControl * default_control;
 	GuiControl * active_control;
 	SceneNode node;
+	TextBatch text_batch;
 	std::string name;
 
 	// each control registers a ControlCb
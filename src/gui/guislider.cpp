@@ -19,13 +19,11 @@
 
 #include "guislider.h"
 #include "graphics/texture.h"
-#include <sstream>
+#include "textstream.h"
 
 void GuiSlider::SetValue(const std::string & valuestr)
 {
-	float value;
-	std::istringstream s(valuestr);
-	s >> value;
+	float value = ParseFloat(valuestr);
 
 	float half_width = (m_max_value - m_min_value) * 0.5f;
 	float center = m_min_value + half_width;
@@ -39,9 +37,7 @@ void GuiSlider::SetValue(const std::string & valuestr)
 
 void GuiSlider::SetMinValue(const std::string & valuestr)
 {
-	float value;
-	std::istringstream s(valuestr);
-	s >> value;
+	float value = ParseFloat(valuestr);
 
 	if (value > m_min_value || value < m_min_value)
 	{
@@ -52,9 +48,7 @@ void GuiSlider::SetMinValue(const std::string & valuestr)
 
 void GuiSlider::SetMaxValue(const std::string & valuestr)
 {
-	float value;
-	std::istringstream s(valuestr);
-	s >> value;
+	float value = ParseFloat(valuestr);
 
 	if (value > m_max_value || value < m_max_value)
 	{
@@ -20,6 +20,7 @@
 #include "guiwidget.h"
 #include "hsvtorgb.h"
 #include "graphics/drawable.h"
+#include "textstream.h"
 
 GuiWidget::GuiWidget() :
 	m_alpha(1),
@@ -99,10 +100,7 @@ void GuiWidget::SetVisible(const std::string & value)
 {
 	if (value.empty()) return;
 
-	bool v = false;
-	std::istringstream s(value);
-	s >> std::boolalpha >> v;
-	m_visible = v;
+	m_visible = (value == "true");
 	m_update = true;
 }
 
@@ -110,38 +108,26 @@ void GuiWidget::SetOpacity(const std::string & value)
 {
 	if (value.empty()) return;
 
-	std::istringstream s(value);
-	float v;
-	s >> v;
-	SetOpacity(v);
+	SetOpacity(ParseFloat(value));
 }
 
 void GuiWidget::SetHue(const std::string & value)
 {
 	if (value.empty()) return;
 
-	std::istringstream s(value);
-	float v;
-	s >> v;
-	SetHue(v);
+	SetHue(ParseFloat(value));
 }
 
 void GuiWidget::SetSat(const std::string & value)
 {
 	if (value.empty()) return;
 
-	std::istringstream s(value);
-	float v;
-	s >> v;
-	SetSat(v);
+	SetSat(ParseFloat(value));
 }
 
 void GuiWidget::SetVal(const std::string & value)
 {
 	if (value.empty()) return;
 
-	std::istringstream s(value);
-	float v;
-	s >> v;
-	SetVal(v);
+	SetVal(ParseFloat(value));
 }
@@ -0,0 +1,387 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "text_batch.h"
+#include "text_draw.h"
+#include "font.h"
+#include "graphics/texture.h"
+#include "minmax.h"
+#include "unittest.h"
+
+#include <algorithm>
+#include <cassert>
+
+// a layer is compacted once its holes exceed this many quads and a quarter of the layer
+static const unsigned max_hole_quads = 64;
+
+static void AppendQuads(
+	VertexArray & varray, unsigned count,
+	const float vertices[], const float texcoords[], const unsigned char colors[])
+{
+	std::vector<unsigned> faces(count * 6);
+	for (unsigned i = 0; i < count; ++i)
+	{
+		const unsigned v = i * 4;
+		unsigned * f = &faces[i * 6];
+		f[0] = v; f[1] = v + 1; f[2] = v + 2;
+		f[3] = v; f[4] = v + 2; f[5] = v + 3;
+	}
+	varray.Add(
+		&faces[0], faces.size(),
+		vertices, count * 12,
+		texcoords, count * 8,
+		0, 0,
+		colors, count * 16);
+}
+
+static void AppendQuads(VertexArray & varray, unsigned count)
+{
+	// unused glyph quads are degenerate
+	const std::vector<float> vertices(count * 12, 0.0f);
+	const std::vector<float> texcoords(count * 8, 0.0f);
+	const std::vector<unsigned char> colors(count * 16, 0);
+	AppendQuads(varray, count, &vertices[0], &texcoords[0], &colors[0]);
+}
+
+static void ClearQuads(VertexArray & varray, unsigned offset, unsigned count)
+{
+	if (count == 0) return;
+	const std::vector<float> vertices(count * 12, 0.0f);
+	varray.Update(&vertices[0], 0, offset * 4, count * 4);
+}
+
+TextBatch::TextBatch() :
+	font(0)
+{
+	// ctor
+}
+
+void TextBatch::SetFont(const Font & newfont)
+{
+	font = &newfont;
+}
+
+unsigned TextBatch::AddText(SceneNode & scene, float z)
+{
+	assert(font);
+
+	// texts are batched by draw order, so they keep their order against other drawables
+	unsigned layer_id = 0;
+	while (layer_id < layers.size() && layers[layer_id].z != z)
+		layer_id++;
+
+	if (layer_id == layers.size())
+	{
+		layers.push_back(Layer());
+		Layer & layer = layers.back();
+		layer.z = z;
+		layer.draw = scene.GetDrawList().text.insert(Drawable());
+		Drawable & drawref = scene.GetDrawList().text.get(layer.draw);
+		if (font->GetFontTexture())
+			drawref.SetTextures(font->GetFontTexture()->GetId());
+		drawref.SetVertArray(&layer.varray);
+		drawref.SetCull(false);
+		drawref.SetColor(1, 1, 1, 1);
+		drawref.SetDrawOrder(z);
+	}
+
+	ranges.push_back(Range());
+	ranges.back().layer = layer_id;
+	return ranges.size() - 1;
+}
+
+float TextBatch::SetText(
+	unsigned id, const std::string & text,
+	float x, float y, float scalex, float scaley,
+	float anchor)
+{
+	assert(font);
+	assert(id < ranges.size());
+	Range & range = ranges[id];
+
+	// stage glyph quads and measure the text width on the way
+	vertices.resize(text.size() * 12);
+	texcoords.resize(text.size() * 8);
+	unsigned count = 0;
+	float width = 0;
+	float cursorx = 0;
+	float cursory = y + scaley / 4;
+	for (char c : text)
+	{
+		if (c == '\n')
+		{
+			width = Max(width, cursorx);
+			cursorx = 0;
+			cursory += scaley;
+			continue;
+		}
+
+		float advance;
+		if (TextDraw::GetCharacterQuad(
+			*font, c, cursorx, cursory, scalex, scaley,
+			&vertices[count * 12], &texcoords[count * 8], advance))
+		{
+			cursorx += advance;
+			count++;
+		}
+	}
+	width = Max(width, cursorx);
+
+	const float dx = x - width * anchor;
+	for (unsigned i = 0; i < count * 4; ++i)
+	{
+		vertices[i * 3] += dx;
+	}
+
+	// glyphs of a longer previous text are cleared
+	Reserve(range, count);
+	const unsigned n = Max(count, range.count);
+	if (n > 0)
+	{
+		vertices.resize(n * 12);
+		texcoords.resize(n * 8);
+		std::fill(vertices.begin() + count * 12, vertices.end(), 0.0f);
+		std::fill(texcoords.begin() + count * 8, texcoords.end(), 0.0f);
+		StageColors(range, n);
+		layers[range.layer].varray.Update(&vertices[0], &texcoords[0], range.offset * 4, n * 4, &colors[0]);
+	}
+	range.count = count;
+
+	return width;
+}
+
+void TextBatch::SetColor(unsigned id, float r, float g, float b, float a)
+{
+	assert(id < ranges.size());
+	Range & range = ranges[id];
+
+	const unsigned char color[4] = {
+		(unsigned char)(Clamp(r, 0.0f, 1.0f) * 255 + 0.5f),
+		(unsigned char)(Clamp(g, 0.0f, 1.0f) * 255 + 0.5f),
+		(unsigned char)(Clamp(b, 0.0f, 1.0f) * 255 + 0.5f),
+		(unsigned char)(Clamp(a, 0.0f, 1.0f) * 255 + 0.5f)};
+	if (std::equal(color, color + 4, range.color))
+		return;
+
+	std::copy(color, color + 4, range.color);
+	if (range.count > 0)
+	{
+		StageColors(range, range.count);
+		layers[range.layer].varray.Update(0, 0, range.offset * 4, range.count * 4, &colors[0]);
+	}
+}
+
+void TextBatch::Clear()
+{
+	ranges.clear();
+	layers.clear();
+	font = 0;
+}
+
+Drawable & TextBatch::GetDrawable(SceneNode & scene, unsigned id)
+{
+	assert(id < ranges.size());
+	return scene.GetDrawList().text.get(layers[ranges[id].layer].draw);
+}
+
+unsigned TextBatch::GetQuadCount() const
+{
+	unsigned quads = 0;
+	for (const auto & layer : layers)
+		quads += layer.quads;
+	return quads;
+}
+
+void TextBatch::Reserve(Range & range, unsigned count)
+{
+	if (count <= range.capacity)
+		return;
+
+	Layer & layer = layers[range.layer];
+	const unsigned capacity = Max(count, Max(range.capacity * 2, 8u));
+	if (range.offset + range.capacity == layer.quads)
+	{
+		// last range grows in place
+		AppendQuads(layer.varray, capacity - range.capacity);
+	}
+	else
+	{
+		// move to the end, the old quads are left as a degenerate hole
+		ClearQuads(layer.varray, range.offset, range.count);
+		AppendQuads(layer.varray, capacity);
+		layer.holes += range.capacity;
+		range.offset = layer.quads;
+		range.count = 0;
+	}
+	layer.quads = range.offset + capacity;
+	range.capacity = capacity;
+
+	if (layer.holes > max_hole_quads && layer.holes * 4 > layer.quads)
+		Compact(layer, range.layer);
+}
+
+void TextBatch::Compact(Layer & layer, unsigned layer_id)
+{
+	std::vector<Range *> packed;
+	for (auto & range : ranges)
+	{
+		if (range.layer == layer_id)
+			packed.push_back(&range);
+	}
+	std::sort(packed.begin(), packed.end(),
+		[](const Range * a, const Range * b) { return a->offset < b->offset; });
+
+	const float * old_vertices;
+	const float * old_texcoords;
+	const unsigned char * old_colors;
+	unsigned old_count;
+	layer.varray.GetVertices(old_vertices, old_count);
+	layer.varray.GetTexCoords(old_texcoords, old_count);
+	layer.varray.GetColors(old_colors, old_count);
+
+	// ranges keep their capacity, their glyphs are copied to the packed offsets
+	std::vector<float> new_vertices;
+	std::vector<float> new_texcoords;
+	std::vector<unsigned char> new_colors;
+	unsigned offset = 0;
+	for (Range * range : packed)
+	{
+		const unsigned begin = range->offset;
+		const unsigned end = range->offset + range->capacity;
+		new_vertices.insert(new_vertices.end(), old_vertices + begin * 12, old_vertices + end * 12);
+		new_texcoords.insert(new_texcoords.end(), old_texcoords + begin * 8, old_texcoords + end * 8);
+		new_colors.insert(new_colors.end(), old_colors + begin * 16, old_colors + end * 16);
+		range->offset = offset;
+		offset += range->capacity;
+	}
+
+	layer.varray.Clear();
+	if (offset > 0)
+		AppendQuads(layer.varray, offset, &new_vertices[0], &new_texcoords[0], &new_colors[0]);
+	layer.quads = offset;
+	layer.holes = 0;
+}
+
+void TextBatch::StageColors(const Range & range, unsigned count)
+{
+	colors.resize(count * 16);
+	for (unsigned i = 0; i < count * 4; ++i)
+	{
+		unsigned char * c = &colors[i * 4];
+		c[0] = range.color[0];
+		c[1] = range.color[1];
+		c[2] = range.color[2];
+		c[3] = range.color[3];
+	}
+}
+
+static const float * GetQuadVertices(const TextBatch & batch, unsigned id)
+{
+	const float * vertices;
+	unsigned count;
+	batch.GetVertexArray(id).GetVertices(vertices, count);
+	assert(batch.GetQuadOffset(id) * 12 < count);
+	return vertices + batch.GetQuadOffset(id) * 12;
+}
+
+static const unsigned char * GetQuadColors(const TextBatch & batch, unsigned id)
+{
+	const unsigned char * colors;
+	unsigned count;
+	batch.GetVertexArray(id).GetColors(colors, count);
+	return colors + batch.GetQuadOffset(id) * 16;
+}
+
+QT_TEST(text_batch_test)
+{
+	Font font;
+	QT_CHECK(font.LoadInfo("data/skins/simple/fonts/freesans.txt", std::cerr));
+
+	SceneNode scene;
+	TextBatch batch;
+	batch.SetFont(font);
+
+	// texts are batched by draw order
+	const unsigned a = batch.AddText(scene, 1);
+	const unsigned b = batch.AddText(scene, 2);
+	const unsigned c = batch.AddText(scene, 1);
+	QT_CHECK_EQUAL(batch.GetLayerCount(), 2);
+	QT_CHECK_EQUAL(batch.GetDrawable(scene, a).GetDrawOrder(), 1);
+	QT_CHECK_EQUAL(batch.GetDrawable(scene, b).GetDrawOrder(), 2);
+	QT_CHECK(&batch.GetDrawable(scene, a) == &batch.GetDrawable(scene, c));
+	QT_CHECK(&batch.GetVertexArray(a) != &batch.GetVertexArray(b));
+
+	// ranges are reserved in the order texts are set
+	QT_CHECK(batch.SetText(a, "abc", 0, 0, 0.1f, 0.1f, 0) > 0);
+	batch.SetText(b, "abc", 0, 0, 0.1f, 0.1f, 0);
+	batch.SetText(c, "xy", 0, 0, 0.1f, 0.1f, 0);
+	QT_CHECK_EQUAL(batch.GetQuadOffset(a), 0);
+	QT_CHECK_EQUAL(batch.GetQuadOffset(b), 0);
+	QT_CHECK_EQUAL(batch.GetQuadOffset(c), 8);
+	QT_CHECK_EQUAL(batch.GetQuadCount(), 24);
+
+	// the last range grows in place, others move to the end and leave a hole
+	batch.SetText(c, "abcdefghijkl", 0, 0, 0.1f, 0.1f, 0);
+	QT_CHECK_EQUAL(batch.GetQuadOffset(c), 8);
+	const std::string long_text = "abcdefghijklmn";
+	batch.SetText(a, long_text, 0, 0, 0.1f, 0.1f, 0);
+	QT_CHECK_EQUAL(batch.GetQuadOffset(a), 24);
+	const float * hole;
+	unsigned count;
+	batch.GetVertexArray(c).GetVertices(hole, count);
+	QT_CHECK(std::all_of(hole, hole + 8 * 12, [](float v) { return v == 0; }));
+
+	// colors are per text
+	batch.SetColor(c, 1, 0, 0, 1);
+	const unsigned char red[4] = {255, 0, 0, 255};
+	const unsigned char white[4] = {255, 255, 255, 255};
+	QT_CHECK(std::equal(red, red + 4, GetQuadColors(batch, c)));
+	QT_CHECK(std::equal(red, red + 4, GetQuadColors(batch, c) + 11 * 16 + 12));
+	QT_CHECK(std::equal(white, white + 4, GetQuadColors(batch, a)));
+	QT_CHECK(std::equal(white, white + 4, GetQuadColors(batch, b)));
+
+	// a moved text keeps its color
+	batch.SetText(c, long_text + long_text, 0, 0, 0.1f, 0.1f, 0);
+	QT_CHECK(std::equal(red, red + 4, GetQuadColors(batch, c)));
+
+	// reference glyphs from a batch without moves
+	TextBatch ref_batch;
+	ref_batch.SetFont(font);
+	const unsigned ref = ref_batch.AddText(scene, 1);
+	ref_batch.SetText(ref, long_text, 0, 0, 0.1f, 0.1f, 0);
+	const float * ref_vertices = GetQuadVertices(ref_batch, ref);
+
+	// growing texts in turn leaves holes, which are compacted
+	std::string text;
+	for (int i = 0; i < 40; ++i)
+	{
+		text += "ab";
+		batch.SetText(i % 2 ? a : c, text, 0, 0, 0.1f, 0.1f, 0);
+		QT_CHECK(batch.GetQuadCount() <= (text.size() * 4 + 8) * 4 / 3 + max_hole_quads);
+	}
+	batch.SetText(a, long_text, 0, 0, 0.1f, 0.1f, 0);
+	const float * vertices = GetQuadVertices(batch, a);
+	QT_CHECK(std::equal(ref_vertices, ref_vertices + long_text.size() * 12, vertices));
+	QT_CHECK(std::equal(red, red + 4, GetQuadColors(batch, c)));
+	QT_CHECK(batch.GetQuadOffset(a) != batch.GetQuadOffset(c));
+
+	batch.Clear();
+	QT_CHECK_EQUAL(batch.GetLayerCount(), 0);
+	QT_CHECK_EQUAL(batch.GetQuadCount(), 0);
+}
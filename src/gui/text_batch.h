@@ -0,0 +1,126 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _TEXT_BATCH_H
+#define _TEXT_BATCH_H
+
+#include "graphics/scenenode.h"
+#include "graphics/vertexarray.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+
+class Font;
+
+/// All texts of a gui page sharing one font atlas, texts with the same draw order
+/// are drawn with a single drawable. Each text owns a range of glyph quads in the
+/// vertex array of its draw order and stores its color per vertex, so changing
+/// a text only rewrites its own range.
+class TextBatch
+{
+public:
+	TextBatch();
+
+	/// set the font, has to be called before adding texts
+	void SetFont(const Font & font);
+
+	/// add an empty text with draw order z, returns text id
+	/// the text is drawn by the batch drawable of its draw order
+	unsigned AddText(SceneNode & scene, float z);
+
+	/// set text glyphs starting at (x, y), the text is shifted left by anchor * text width
+	/// returns the text width
+	float SetText(
+		unsigned id, const std::string & text,
+		float x, float y, float scalex, float scaley,
+		float anchor);
+
+	/// set text color, zero alpha hides the text
+	void SetColor(unsigned id, float r, float g, float b, float a);
+
+	/// remove all texts, the drawables are removed with their scene node
+	void Clear();
+
+	/// drawable of the text draw order
+	Drawable & GetDrawable(SceneNode & scene, unsigned id);
+
+	/// number of draw orders, one drawable each
+	unsigned GetLayerCount() const;
+
+	/// glyph quads in the vertex arrays, including unused ones
+	unsigned GetQuadCount() const;
+
+	/// first glyph quad of the text in the vertex array of its draw order
+	unsigned GetQuadOffset(unsigned id) const;
+
+	const VertexArray & GetVertexArray(unsigned id) const;
+
+private:
+	struct Layer
+	{
+		float z = 0;
+		SceneNode::DrawableHandle draw;
+		VertexArray varray;
+		unsigned quads = 0;		///< glyph quads in the vertex array
+		unsigned holes = 0;		///< unused glyph quads left behind by moved ranges
+	};
+	struct Range
+	{
+		unsigned layer = 0;
+		unsigned offset = 0;	///< first glyph quad
+		unsigned capacity = 0;	///< reserved glyph quads
+		unsigned count = 0;		///< glyph quads in use
+		unsigned char color[4] = {255, 255, 255, 255};
+	};
+	std::vector<Range> ranges;
+	std::deque<Layer> layers; // drawables keep pointers to the layer vertex arrays
+	const Font * font;
+
+	// glyph staging buffers, reused between texts
+	std::vector<float> vertices;
+	std::vector<float> texcoords;
+	std::vector<unsigned char> colors;
+
+	/// reserve glyph quads for text, moves the range to the end of the array if it doesn't fit
+	void Reserve(Range & range, unsigned count);
+
+	/// pack the ranges of a layer, dropping the holes left by moved ranges
+	void Compact(Layer & layer, unsigned layer_id);
+
+	/// fill the color staging buffer for count quads
+	void StageColors(const Range & range, unsigned count);
+};
+
+inline unsigned TextBatch::GetLayerCount() const
+{
+	return layers.size();
+}
+
+inline unsigned TextBatch::GetQuadOffset(unsigned id) const
+{
+	return ranges[id].offset;
+}
+
+inline const VertexArray & TextBatch::GetVertexArray(unsigned id) const
+{
+	return layers[ranges[id].layer].varray;
+}
+
+#endif // _TEXT_BATCH_H
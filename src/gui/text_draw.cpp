@@ -20,13 +20,13 @@
 #include "text_draw.h"
 #include "graphics/texture.h"
 
-float TextDraw::RenderCharacter(
+bool TextDraw::GetCharacterQuad(
 	const Font & font, char c,
 	float x, float y, float scalex, float scaley,
-	VertexArray & output_array)
+	float v[12], float t[8], float & advance)
 {
 	const Font::CharInfo * ci = 0;
-	if (!font.GetCharInfo(c, ci)) return 0;
+	if (!font.GetCharInfo(c, ci)) return false;
 
 	float invsize = font.GetInvSize();
 	float x1 = x + ci->xoffset * invsize * scalex;
@@ -39,13 +39,37 @@ float TextDraw::RenderCharacter(
 	float v1 = ci->y;
 	float v2 = v1 + ci->height;
 
-	const float v[] = {x1, y1, 0, x2, y1, 0, x2, y2, 0, x1, y2, 0};
-	const float t[] = {u1, v1, u2, v1, u2, v2, u1, v2};
+	v[0] = x1; v[1] = y1; v[2] = 0;
+	v[3] = x2; v[4] = y1; v[5] = 0;
+	v[6] = x2; v[7] = y2; v[8] = 0;
+	v[9] = x1; v[10] = y2; v[11] = 0;
+
+	t[0] = u1; t[1] = v1;
+	t[2] = u2; t[3] = v1;
+	t[4] = u2; t[5] = v2;
+	t[6] = u1; t[7] = v2;
+
+	advance = ci->xadvance * invsize * scalex;
+	return true;
+}
+
+float TextDraw::RenderCharacter(
+	const Font & font, char c,
+	float x, float y, float scalex, float scaley,
+	VertexArray & output_array)
+{
+	float v[12], t[8], advance;
+	if (!GetCharacterQuad(font, c, x, y, scalex, scaley, v, t, advance)) return 0;
+
+	// text color is the drawable color, the font shader also multiplies vertex colors
+	const unsigned char col[16] = {
+		255, 255, 255, 255, 255, 255, 255, 255,
+		255, 255, 255, 255, 255, 255, 255, 255};
 	const unsigned int f[] = {0, 1, 2, 0, 2, 3};
 
-	output_array.Add(f, 6, v, 12, t, 8);
+	output_array.Add(f, 6, v, 12, t, 8, 0, 0, col, 16);
 
-	return ci->xadvance * invsize * scalex;
+	return advance;
 }
 
 float TextDraw::RenderText(
@@ -54,6 +54,13 @@ public:
 		return std::pair<float,float>(oldscalex, oldscaley);
 	}
 
+	/// get glyph quad vertices and texture coordinates and the cursor advance,
+	/// returns false if the font has no glyph for c
+	static bool GetCharacterQuad(
+		const Font & font, char c,
+		float x, float y, float scalex, float scaley,
+		float v[12], float t[8], float & advance);
+
 	static float RenderCharacter(
 		const Font & font, char c,
 		float x, float y, float scalex, float scaley,
@@ -328,6 +328,74 @@ QT_TEST(BinarySerializer_test)
 	QT_CHECK_EQUAL(player2.somepair.second, 4321);
 }
 
+QT_TEST(MemorySerializer_test)
+{
+	std::vector<unsigned char> buffer;
+	{
+		TestPlayer player1(true);
+		MemoryOutputSerializer out(buffer);
+		QT_CHECK(player1.Serialize(out));
+	}
+
+	// rewriting a cleared buffer keeps its allocation
+	const unsigned char * data = buffer.data();
+	const size_t size = buffer.size();
+	buffer.clear();
+	{
+		TestPlayer player1(true);
+		MemoryOutputSerializer out(buffer);
+		QT_CHECK(player1.Serialize(out));
+	}
+	QT_CHECK_EQUAL(buffer.data(), data);
+	QT_CHECK_EQUAL(buffer.size(), size);
+
+	TestPlayer player2(false);
+	{
+		MemoryInputSerializer in(buffer.data(), buffer.size());
+		QT_CHECK(player2.Serialize(in));
+		QT_CHECK_EQUAL(in.GetPosition(), buffer.size());
+	}
+	QT_CHECK_EQUAL(player2.position, TestVertex(1,1,1));
+	QT_CHECK_EQUAL(player2.animframe, 1337);
+	QT_CHECK_CLOSE(player2.x, 1.337, 0.000001);
+	QT_CHECK_EQUAL(player2.name, "Test player");
+	QT_CHECK_EQUAL(player2.complexlist.size(), 3);
+	QT_CHECK_EQUAL(player2.mymap["testing654"], TestVertex(6,5,4));
+	QT_CHECK_EQUAL(player2.player_description, "Hello there.\nHow are you??");
+	QT_CHECK_EQUAL(player2.alive, true);
+	QT_CHECK_EQUAL(player2.somepair.second, 4321);
+
+	// truncated data fails instead of reading past the end
+	TestPlayer player3(false);
+	MemoryInputSerializer in(buffer.data(), buffer.size() / 2);
+	QT_CHECK(!player3.Serialize(in));
+}
+
+QT_TEST(HashSerializer_test)
+{
+	// fnv-1a of a single zero int is the offset basis run through four zero bytes
+	{
+		HashSerializer hash;
+		int zero = 0;
+		QT_CHECK(hash.Serialize("zero", zero));
+		QT_CHECK_EQUAL(hash.GetHash(), 0x4D25767F9DCE13F5ull);
+	}
+
+	TestPlayer player1(true);
+	TestPlayer player2(true);
+
+	HashSerializer hash1, hash2;
+	QT_CHECK(player1.Serialize(hash1));
+	QT_CHECK(player2.Serialize(hash2));
+	QT_CHECK_EQUAL(hash1.GetHash(), hash2.GetHash());
+
+	// a single bit change is visible
+	player2.position.z = std::nextafter(player2.position.z, 2.0f);
+	HashSerializer hash3;
+	QT_CHECK(player2.Serialize(hash3));
+	QT_CHECK(hash1.GetHash() != hash3.GetHash());
+}
+
 QT_TEST(ReflectionSerializer_test)
 {
 	ReflectionSerializer reflection;
@@ -30,6 +30,8 @@
 #include <vector>
 #include <iomanip>
 #include <fstream>
+#include <cstdint>
+#include <cstring>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -1272,6 +1274,203 @@ class BinaryInputSerializer : public SerializerInput
 		}
 };
 
+///native byte order binary format appended to a caller owned buffer. meant for in-memory snapshots, the buffer capacity is reused when the same buffer is cleared and written again.
+class MemoryOutputSerializer : public SerializerOutput
+{
+	private:
+		std::vector<unsigned char> & buffer_;
+
+		template <typename T>
+		bool WriteData(const T & i)
+		{
+			size_t pos = buffer_.size();
+			buffer_.resize(pos + sizeof(T));
+			std::memcpy(&buffer_[pos], &i, sizeof(T));
+			return true;
+		}
+
+	public:
+		MemoryOutputSerializer(std::vector<unsigned char> & buffer) : buffer_(buffer) {}
+
+		using Serializer::Serialize;
+
+		virtual bool Serialize(const std::string & name, int & i)
+		{
+			(void) name;
+			return WriteData(i);
+		}
+
+		virtual bool Serialize(const std::string & name, unsigned int & i)
+		{
+			(void) name;
+			return WriteData(i);
+		}
+
+		virtual bool Serialize(const std::string & name, float & i)
+		{
+			(void) name;
+			return WriteData(i);
+		}
+
+		virtual bool Serialize(const std::string & name, double & i)
+		{
+			(void) name;
+			return WriteData(i);
+		}
+
+		virtual bool Serialize(const std::string & name, std::string & i)
+		{
+			(void) name;
+			unsigned int length = i.length();
+			WriteData(length);
+			buffer_.insert(buffer_.end(), i.begin(), i.end());
+			return true;
+		}
+};
+
+///reads data written by MemoryOutputSerializer on the same machine.
+class MemoryInputSerializer : public SerializerInput
+{
+	private:
+		const unsigned char * data_;
+		size_t size_;
+		size_t pos_;
+
+		template <typename T>
+		bool ReadData(T & i)
+		{
+			if (pos_ + sizeof(T) > size_)
+				return false;
+			std::memcpy(&i, data_ + pos_, sizeof(T));
+			pos_ += sizeof(T);
+			return true;
+		}
+
+	public:
+		MemoryInputSerializer(const unsigned char * data, size_t size) : data_(data), size_(size), pos_(0) {}
+
+		///number of bytes read so far
+		size_t GetPosition() const
+		{
+			return pos_;
+		}
+
+		using Serializer::Serialize;
+
+		virtual bool Serialize(const std::string & name, int & i)
+		{
+			(void) name;
+			return ReadData(i);
+		}
+
+		virtual bool Serialize(const std::string & name, unsigned int & i)
+		{
+			(void) name;
+			return ReadData(i);
+		}
+
+		virtual bool Serialize(const std::string & name, float & i)
+		{
+			(void) name;
+			return ReadData(i);
+		}
+
+		virtual bool Serialize(const std::string & name, double & i)
+		{
+			(void) name;
+			return ReadData(i);
+		}
+
+		virtual bool Serialize(const std::string & name, std::string & i)
+		{
+			(void) name;
+			unsigned int length = 0;
+			if (!ReadData(length) || pos_ + length > size_)
+				return false;
+			i.assign(reinterpret_cast<const char *>(data_ + pos_), length);
+			pos_ += length;
+			return true;
+		}
+};
+
+///64 bit FNV-1a hash of the serialized values, independent of host byte order. meant to compare object state between runs, values are hashed bit for bit, so 0.0 and -0.0 differ.
+class HashSerializer : public SerializerOutput
+{
+	private:
+		uint64_t hash_;
+
+		void HashBytes(uint64_t value, int n)
+		{
+			for (int k = 0; k < n; ++k)
+			{
+				hash_ ^= (value >> (8 * k)) & 0xFF;
+				hash_ *= 0x100000001B3ull;
+			}
+		}
+
+		template <typename T>
+		bool HashData(const T & i)
+		{
+			static_assert(sizeof(T) <= sizeof(uint64_t), "unsupported type size");
+			uint64_t value = 0;
+			if (sizeof(T) == sizeof(uint32_t))
+			{
+				uint32_t v;
+				std::memcpy(&v, &i, sizeof(T));
+				value = v;
+			}
+			else
+			{
+				std::memcpy(&value, &i, sizeof(T));
+			}
+			HashBytes(value, sizeof(T));
+			return true;
+		}
+
+	public:
+		HashSerializer() : hash_(0xCBF29CE484222325ull) {}
+
+		uint64_t GetHash() const
+		{
+			return hash_;
+		}
+
+		using Serializer::Serialize;
+
+		virtual bool Serialize(const std::string & name, int & i)
+		{
+			(void) name;
+			return HashData(i);
+		}
+
+		virtual bool Serialize(const std::string & name, unsigned int & i)
+		{
+			(void) name;
+			return HashData(i);
+		}
+
+		virtual bool Serialize(const std::string & name, float & i)
+		{
+			(void) name;
+			return HashData(i);
+		}
+
+		virtual bool Serialize(const std::string & name, double & i)
+		{
+			(void) name;
+			return HashData(i);
+		}
+
+		virtual bool Serialize(const std::string & name, std::string & i)
+		{
+			(void) name;
+			HashBytes(i.length(), 4);
+			for (size_t k = 0; k < i.length(); ++k)
+				HashBytes((unsigned char)i[k], 1);
+			return true;
+		}
+};
+
 ///serializer that provides a reflection interface so the application can use dynamic programming techniques.  the treemap class is used to store data.  this can be either an output or input serializer depending on its mode.  note that internally all data is stored as strings.  this class should not be used via the normal serialization method, but instead use the ReadFromObject and WriteToObject functions.
 class ReflectionSerializer : public Serializer
 {
@@ -28,6 +28,8 @@
 
 #include "k1999.h"
 #include "roadstrip.h"
+#include "joeserialize.h"
+#include "macros.h"
 
 #include <cassert>
 
@@ -95,15 +97,15 @@ void K1999::AdjustRadius(int prev, int i, int next, double TargetRInverse, doubl
 {
 	double OldLane = tLane[i];
 
-	double Width = Mag((txLeft[i]-txRight[i]),(tyLeft[i]-tyRight[i]));
+	double Width = tWidth[i];
 
 	//
 	// Start by aligning points for a reasonable initial lane
 	//
 	tLane[i] = (-(ty[next] - ty[prev]) * (txLeft[i] - tx[prev]) +
 			(tx[next] - tx[prev]) * (tyLeft[i] - ty[prev])) /
-			( (ty[next] - ty[prev]) * (txRight[i] - txLeft[i]) -
-			(tx[next] - tx[prev]) * (tyRight[i] - tyLeft[i]));
+			( (ty[next] - ty[prev]) * txEdge[i] -
+			(tx[next] - tx[prev]) * tyEdge[i]);
 
 	// the original algorithm allows going outside the track
 	/*
@@ -123,8 +125,8 @@ void K1999::AdjustRadius(int prev, int i, int next, double TargetRInverse, doubl
 	//
 	const double dLane = 0.0001;
 
-	double dx = dLane * (txRight[i] - txLeft[i]);
-	double dy = dLane * (tyRight[i] - tyLeft[i]);
+	double dx = dLane * txEdge[i];
+	double dy = dLane * tyEdge[i];
 
 	double dRInverse = GetRInverse(prev, tx[i] + dx, ty[i] + dy, next);
 
@@ -286,42 +288,41 @@ void K1999::CalcRaceLine()
 
 void K1999::LoadData(const RoadStrip & road)
 {
-	tx.clear();
-	ty.clear();
-	tRInverse.clear();
-	txLeft.clear();
-	tyLeft.clear();
-	txRight.clear();
-	tyRight.clear();
-	tLane.clear();
-
 	const std::vector<RoadPatch> & patchlist = road.GetPatches();
 	Divs = patchlist.size();
 
-	tx.reserve(Divs);
-	ty.reserve(Divs);
-	tRInverse.reserve(Divs);
-	txLeft.reserve(Divs);
-	tyLeft.reserve(Divs);
-	txRight.reserve(Divs);
-	tyRight.reserve(Divs);
-	tLane.reserve(Divs);
+	tx.resize(Divs);
+	ty.resize(Divs);
+	tRInverse.assign(Divs, 0.0);
+	txLeft.resize(Divs);
+	tyLeft.resize(Divs);
+	txRight.resize(Divs);
+	tyRight.resize(Divs);
+	tLane.assign(Divs, 0.5);
+	txEdge.resize(Divs);
+	tyEdge.resize(Divs);
+	tWidth.resize(Divs);
 
 	int count = 0;
 	for (const auto & p : patchlist)
 	{
-		txLeft.push_back(p.GetPoint(3,0)[1]);
-		tyLeft.push_back(-p.GetPoint(3,0)[0]);
-		txRight.push_back(p.GetPoint(3,3)[1]);
-		tyRight.push_back(-p.GetPoint(3,3)[0]);
-		tLane.push_back(0.5);
-		tx.push_back(0.0);
-		ty.push_back(0.0);
-		tRInverse.push_back(0.0);
-		UpdateTxTy(count);
-
+		txLeft[count] = p.GetPoint(3,0)[1];
+		tyLeft[count] = -p.GetPoint(3,0)[0];
+		txRight[count] = p.GetPoint(3,3)[1];
+		tyRight[count] = -p.GetPoint(3,3)[0];
 		count++;
 	}
+
+	// per division invariants of the smoothing passes, kept out of AdjustRadius
+	for (int i = 0; i < Divs; ++i)
+	{
+		txEdge[i] = txRight[i] - txLeft[i];
+		tyEdge[i] = tyRight[i] - tyLeft[i];
+		tWidth[i] = Mag(txEdge[i], tyEdge[i]);
+	}
+
+	for (int i = 0; i < Divs; ++i)
+		UpdateTxTy(i);
 }
 
 void K1999::UpdateRoadStrip(RoadStrip & road)
@@ -345,4 +346,39 @@ void K1999::UpdateRoadStrip(RoadStrip & road)
 	txRight.clear();
 	tyRight.clear();
 	tLane.clear();
+	txEdge.clear();
+	tyEdge.clear();
+	tWidth.clear();
+}
+
+bool K1999::SerializeRoad(joeserialize::Serializer & s)
+{
+	_SERIALIZE_(s, Divs);
+	_SERIALIZE_(s, txLeft);
+	_SERIALIZE_(s, tyLeft);
+	_SERIALIZE_(s, txRight);
+	_SERIALIZE_(s, tyRight);
+	return true;
+}
+
+bool K1999::Serialize(joeserialize::Serializer & s)
+{
+	int divs = Divs;
+	_SERIALIZE_(s, divs);
+	if (divs != Divs)
+		return false;
+	// element wise into the vectors sized by LoadData, so a corrupt
+	// cache file can't make us allocate an arbitrary list size
+	assert(int(tLane.size()) == Divs && int(tRInverse.size()) == Divs);
+	for (int i = 0; i < Divs; ++i)
+	{
+		if (!s.Serialize("lane", tLane[i]) || !s.Serialize("rinverse", tRInverse[i]))
+			return false;
+	}
+	if (s.GetIODirection() == joeserialize::Serializer::DIRECTION_INPUT)
+	{
+		for (int i = 0; i < Divs; ++i)
+			UpdateTxTy(i);
+	}
+	return true;
 }
@@ -33,6 +33,7 @@
 #include <iosfwd>
 
 class RoadStrip;
+namespace joeserialize { class Serializer; }
 
 class K1999
 {
@@ -45,6 +46,9 @@ private:
 	std::vector <double> txRight;
 	std::vector <double> tyRight;
 	std::vector <double> tLane;
+	std::vector <double> txEdge;
+	std::vector <double> tyEdge;
+	std::vector <double> tWidth;
 	int Divs;
 
 	void UpdateTxTy(int i);
@@ -63,6 +67,12 @@ public:
 	void LoadData(const RoadStrip & road);
 	void CalcRaceLine();
 	void UpdateRoadStrip(RoadStrip & road);
+
+	// serialize the loaded road edges, used to key cached race lines
+	bool SerializeRoad(joeserialize::Serializer & s);
+
+	// serialize the calculated race line, fails if it doesn't match the loaded road
+	bool Serialize(joeserialize::Serializer & s);
 };
 
 #endif //_K1999_H
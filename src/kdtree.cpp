@@ -0,0 +1,80 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "kdtree.h"
+#include "unittest.h"
+
+#include <random>
+
+QT_TEST(kdtree_test)
+{
+	KdTree<int> tree;
+	int data = -1;
+	QT_CHECK(!tree.Nearest(0, 0, data));
+
+	// random points, queries have to match brute force search
+	std::mt19937 random(0);
+	std::uniform_real_distribution<float> coord(-500, 500);
+	std::vector<float> x(1000), y(1000);
+	for (int i = 0; i < 1000; ++i)
+	{
+		x[i] = coord(random);
+		y[i] = coord(random);
+		tree.Add(x[i], y[i], i);
+	}
+	tree.Build();
+	QT_CHECK_EQUAL(tree.size(), 1000);
+
+	bool nearest_ok = true;
+	bool query_ok = true;
+	for (int q = 0; q < 200; ++q)
+	{
+		const float qx = coord(random) * 1.2f;
+		const float qy = coord(random) * 1.2f;
+		const float radius = q % 50;
+
+		int best = 0;
+		float best_dist2 = 1E30f;
+		std::vector<int> expected;
+		for (int i = 0; i < 1000; ++i)
+		{
+			const float dist2 = (x[i] - qx) * (x[i] - qx) + (y[i] - qy) * (y[i] - qy);
+			if (dist2 < best_dist2)
+			{
+				best = i;
+				best_dist2 = dist2;
+			}
+			if (dist2 <= radius * radius)
+				expected.push_back(i);
+		}
+
+		tree.Nearest(qx, qy, data);
+		nearest_ok = nearest_ok && (data == best);
+
+		std::vector<int> found;
+		tree.Query(qx, qy, radius, found);
+		std::sort(found.begin(), found.end());
+		query_ok = query_ok && (found == expected);
+	}
+	QT_CHECK(nearest_ok);
+	QT_CHECK(query_ok);
+
+	tree.Clear();
+	QT_CHECK(tree.empty());
+}
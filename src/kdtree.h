@@ -0,0 +1,159 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _KDTREE_H
+#define _KDTREE_H
+
+#include <algorithm>
+#include <vector>
+
+/// Static 2d tree of points with attached data. Points are added, the tree is
+/// built once and then queried. Nearest point and radius queries visit about
+/// log(n) nodes for evenly spread points. The tree is stored implicitly in the
+/// item array, the median of each range is the node splitting it.
+template <typename DataType>
+class KdTree
+{
+public:
+	void Clear()
+	{
+		items.clear();
+	}
+
+	void Add(float x, float y, const DataType & data)
+	{
+		Item item;
+		item.p[0] = x;
+		item.p[1] = y;
+		item.data = data;
+		items.push_back(item);
+	}
+
+	/// build tree from added points
+	void Build()
+	{
+		Build(0, items.size(), 0);
+	}
+
+	size_t size() const
+	{
+		return items.size();
+	}
+
+	bool empty() const
+	{
+		return items.empty();
+	}
+
+	/// get data of the point nearest to x, y, return false if tree is empty
+	bool Nearest(float x, float y, DataType & data) const
+	{
+		if (items.empty())
+			return false;
+
+		const float p[2] = {x, y};
+		unsigned best = 0;
+		float best_dist2 = Dist2(p, items[0]);
+		Nearest(0, items.size(), 0, p, best, best_dist2);
+		data = items[best].data;
+		return true;
+	}
+
+	/// append data of all points within radius of x, y to output
+	void Query(float x, float y, float radius, std::vector<DataType> & output) const
+	{
+		const float p[2] = {x, y};
+		Query(0, items.size(), 0, p, radius, output);
+	}
+
+private:
+	struct Item
+	{
+		float p[2];
+		DataType data;
+	};
+	std::vector<Item> items;
+
+	static float Dist2(const float p[2], const Item & item)
+	{
+		const float dx = p[0] - item.p[0];
+		const float dy = p[1] - item.p[1];
+		return dx * dx + dy * dy;
+	}
+
+	void Build(unsigned lo, unsigned hi, unsigned axis)
+	{
+		if (hi - lo < 2)
+			return;
+
+		const unsigned mid = (lo + hi) / 2;
+		std::nth_element(
+			items.begin() + lo, items.begin() + mid, items.begin() + hi,
+			[axis](const Item & a, const Item & b) { return a.p[axis] < b.p[axis]; });
+		Build(lo, mid, axis ^ 1);
+		Build(mid + 1, hi, axis ^ 1);
+	}
+
+	void Nearest(unsigned lo, unsigned hi, unsigned axis, const float p[2], unsigned & best, float & best_dist2) const
+	{
+		if (lo >= hi)
+			return;
+
+		const unsigned mid = (lo + hi) / 2;
+		const float dist2 = Dist2(p, items[mid]);
+		if (dist2 < best_dist2)
+		{
+			best = mid;
+			best_dist2 = dist2;
+		}
+
+		// near side first, far side only if the splitting line is closer than the best point
+		const float d = p[axis] - items[mid].p[axis];
+		if (d < 0)
+		{
+			Nearest(lo, mid, axis ^ 1, p, best, best_dist2);
+			if (d * d < best_dist2)
+				Nearest(mid + 1, hi, axis ^ 1, p, best, best_dist2);
+		}
+		else
+		{
+			Nearest(mid + 1, hi, axis ^ 1, p, best, best_dist2);
+			if (d * d < best_dist2)
+				Nearest(lo, mid, axis ^ 1, p, best, best_dist2);
+		}
+	}
+
+	void Query(unsigned lo, unsigned hi, unsigned axis, const float p[2], float radius, std::vector<DataType> & output) const
+	{
+		if (lo >= hi)
+			return;
+
+		const unsigned mid = (lo + hi) / 2;
+		if (Dist2(p, items[mid]) <= radius * radius)
+			output.push_back(items[mid].data);
+
+		const float d = p[axis] - items[mid].p[axis];
+		if (d <= radius)
+			Query(lo, mid, axis ^ 1, p, radius, output);
+		if (d >= -radius)
+			Query(mid + 1, hi, axis ^ 1, p, radius, output);
+	}
+};
+
+#endif // _KDTREE_H
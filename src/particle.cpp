@@ -23,12 +23,21 @@
 #include "minmax.h"
 #include "unittest.h"
 
+#include <cmath>
+
 template <typename T>
 static inline T Lerp(T x, T y, T s)
 {
 	return x + Clamp(s, T(0), T(1)) * (y - x);
 }
 
+// position relative to camera origin o after time t, for one axis
+static void Advance(const float p[], const float v[], const float t[], float o, float out[], unsigned n)
+{
+	for (unsigned i = 0; i < n; ++i)
+		out[i] = p[i] + v[i] * t[i] - o;
+}
+
 ParticleSystem::ParticleSystem() :
 	max_particles(512),
 	texture_tiles(9),
@@ -60,26 +69,53 @@ void ParticleSystem::Load(
 	drawref.SetCull(false);
 }
 
+void ParticleSystem::Particles::reserve(unsigned n)
+{
+	x.reserve(n); y.reserve(n); z.reserve(n);
+	vx.reserve(n); vy.reserve(n); vz.reserve(n);
+	transparency.reserve(n);
+	longevity.reserve(n);
+	time.reserve(n);
+	tid.reserve(n);
+}
+
+void ParticleSystem::Particles::resize(unsigned n)
+{
+	x.resize(n); y.resize(n); z.resize(n);
+	vx.resize(n); vy.resize(n); vz.resize(n);
+	transparency.resize(n);
+	longevity.resize(n);
+	time.resize(n);
+	tid.resize(n);
+}
+
+void ParticleSystem::Particles::remove(unsigned i)
+{
+	const unsigned last = size() - 1;
+	x[i] = x[last]; y[i] = y[last]; z[i] = z[last];
+	vx[i] = vx[last]; vy[i] = vy[last]; vz[i] = vz[last];
+	transparency[i] = transparency[last];
+	longevity[i] = longevity[last];
+	time[i] = time[last];
+	tid[i] = tid[last];
+	resize(last);
+}
+
 void ParticleSystem::Update(float dt)
 {
 	//  update particles
-	for (auto & p : particles)
-	{
-		p.time += dt;
-	}
+	float * time = particles.time.data();
+	const unsigned n = particles.size();
+	for (unsigned i = 0; i < n; ++i)
+		time[i] += dt;
 
-	// remove expired particles
-	for (size_t i = 0; i < particles.size(); i++)
+	// remove expired particles, the moved in particle is checked again
+	for (unsigned i = 0; i < particles.size();)
 	{
-		if (particles[i].time > particles[i].longevity)
-		{
-			//only bother to swap if it's not already at the end
-			size_t last = particles.size() - 1;
-			if (i != last)
-				particles[i] = particles[last];
-
-			particles.pop_back();
-		}
+		if (particles.time[i] > particles.longevity[i])
+			particles.remove(i);
+		else
+			++i;
 	}
 }
 
@@ -88,8 +124,8 @@ void ParticleSystem::UpdateGraphics(
 	const Vec3 & campos,
 	float znear,
 	float zfar,
-	float /*fovy*/,
-	float /*fovz*/)
+	float fovy,
+	float aspect)
 {
 	if (max_particles == 0)
 		return;
@@ -97,39 +133,86 @@ void ParticleSystem::UpdateGraphics(
 	node.GetTransform().SetTranslation(campos);
 	node.GetTransform().SetRotation(-camdir);
 
-	// get particle position in camera space
-	distance_from_cam.clear();
-	for (auto & p : particles)
-	{
-		Vec3 pos = p.start_position;
-		pos = pos + p.direction * p.time * p.speed - campos;
-		camdir.RotateVector(pos);
+	// camera rotation as basis vectors, to transform all particles in one pass
+	Vec3 ex(1, 0, 0), ey(0, 1, 0), ez(0, 0, 1);
+	camdir.RotateVector(ex);
+	camdir.RotateVector(ey);
+	camdir.RotateVector(ez);
 
-		// signed distance along z-axis in camera space
-		distance_from_cam.push_back(-pos[2]);
-
-		// store camera space position
-		p.position = pos;
+	// get particle position in camera space and particle alpha, one array at a time
+	const unsigned n = particles.size();
+	cam_x.resize(n);
+	cam_y.resize(n);
+	cam_z.resize(n);
+	alpha.resize(n);
+	const float * tm = particles.time.data();
+	float * cx = cam_x.data();
+	float * cy = cam_y.data();
+	float * cz = cam_z.data();
+	Advance(particles.x.data(), particles.vx.data(), tm, campos[0], cx, n);
+	Advance(particles.y.data(), particles.vy.data(), tm, campos[1], cy, n);
+	Advance(particles.z.data(), particles.vz.data(), tm, campos[2], cz, n);
+	{
+		const float m00 = ex[0], m01 = ey[0], m02 = ez[0];
+		const float m10 = ex[1], m11 = ey[1], m12 = ez[1];
+		const float m20 = ex[2], m21 = ey[2], m22 = ez[2];
+		for (unsigned i = 0; i < n; ++i)
+		{
+			const float wx = cx[i], wy = cy[i], wz = cz[i];
+			cx[i] = m00 * wx + m01 * wy + m02 * wz;
+			cy[i] = m10 * wx + m11 * wy + m12 * wz;
+			cz[i] = m20 * wx + m21 * wy + m22 * wz;
+		}
+	}
+	{
+		const float * tr = particles.transparency.data();
+		const float * lg = particles.longevity.data();
+		float * ca = alpha.data();
+		for (unsigned i = 0; i < n; ++i)
+		{
+			const float f = 1.0f - tm[i] / lg[i];
+			const float f2 = f * f;
+			const float a = tr[i] * f2 * f2;
+			ca[i] = a < 0.0f ? 0.0f : (a > 1.0f ? 1.0f : a);
+		}
 	}
 
-	// sort particles by distance to camera
-
-	// update vertex data
-	varray.Clear();
-	for (size_t i = 0; i < particles.size(); ++i)
+	// cull particles outside of the view frustum, signed distance is along -z in camera space
+	// quad extent is at most 4/3 of the size scale (0.6 for expiring particles)
+	const float radius = 0.6f * 4 / 3.0f;
+	const float ty = (fovy > 0) ? std::tan(fovy * float(M_PI / 360.0)) : 0;
+	const float tx = ty * aspect;
+	const float ry = radius * std::sqrt(1 + ty * ty);
+	const float rx = radius * std::sqrt(1 + tx * tx);
+	visible.clear();
+	visible_distance.clear();
+	for (unsigned i = 0; i < n; ++i)
 	{
-		// cull particles outside of [znear, zfar]
-		// todo: cull particles outside of view frustum
-		if (distance_from_cam[i] < znear || distance_from_cam[i] > zfar)
+		const float distance = -cam_z[i];
+		if (distance < znear || distance > zfar)
 			continue;
+		if (ty > 0 && std::abs(cam_y[i]) > distance * ty + ry)
+			continue;
+		if (tx > 0 && std::abs(cam_x[i]) > distance * tx + rx)
+			continue;
+		visible.push_back(i);
+		visible_distance.push_back(distance);
+	}
 
-		Particle & p = particles[i];
-		Vec3 pos = p.position;
-
-		float trans = p.transparency * std::pow((1.0f - p.time / p.longevity), 4.0f);
-		trans = Clamp(trans, 0.0f, 1.0f);
+	// sort visible particles by distance to camera, draw farthest first
+	const unsigned count = visible.size();
+	if (count > 0)
+		sort.sort(visible_distance, znear > 0);
 
-		float sizescale = 0.2f * (p.time / p.longevity) + 0.4f;
+	// update vertex data
+	vertices.resize(count * 12);
+	texcoords.resize(count * 8);
+	colors.resize(count * 16);
+	for (unsigned k = 0; k < count; ++k)
+	{
+		const unsigned i = visible[sort.getRanks()[count - 1 - k]];
+		const float t = particles.time[i] / particles.longevity[i];
+		const float sizescale = 0.2f * t + 0.4f;
 /*
 		// scale the alpha by the closeness to the camera. if we get too close, don't draw
 		// this prevents major slowdown when there are a lot of particles right next to the camera
@@ -139,42 +222,59 @@ void ParticleSystem::UpdateGraphics(
 		trans = Lerp(0.f, trans, (camdist - camdist_off) / (camdist_full - camdist_off));
 */
 		// assume 9 tiles in texture atlas
-		int vi = p.tid / 3;
-		int ui = p.tid - vi * 3;
+		int vi = particles.tid[i] / 3;
+		int ui = particles.tid[i] - vi * 3;
 		float u1 = ui * 1 / 3.0f;
 		float v1 = vi * 1 / 3.0f;
 		float u2 = u1 + 1 / 3.0f;
 		float v2 = v1 + 1 / 3.0f;
-		float x1 = -sizescale;
-		float y1 = -sizescale * 2 / 3.0f;
-		float x2 = sizescale;
-		float y2 = sizescale * 4 / 3.0f;
-		unsigned char alpha = trans * 255;
-
-		const unsigned int faces[6] = {
-			0, 2, 1,
-			0, 3, 2,
-		};
-		const float uvs[8] = {
-			u1, v1,
-			u2, v1,
-			u2, v2,
-			u1, v2,
-		};
-		const float verts[12] = {
-			pos[0] + x1, pos[1] + y1, pos[2],
-			pos[0] + x2, pos[1] + y1, pos[2],
-			pos[0] + x2, pos[1] + y2, pos[2],
-			pos[0] + x1, pos[1] + y2, pos[2],
-		};
-		const unsigned char cols[16] = {
-			255, 255, 255, alpha,
-			255, 255, 255, alpha,
-			255, 255, 255, alpha,
-			255, 255, 255, alpha,
-		};
-
-		varray.Add(faces, 6, verts, 12, uvs, 8, 0, 0, cols, 16);
+		float x1 = cam_x[i] - sizescale;
+		float y1 = cam_y[i] - sizescale * 2 / 3.0f;
+		float x2 = cam_x[i] + sizescale;
+		float y2 = cam_y[i] + sizescale * 4 / 3.0f;
+		float z = cam_z[i];
+		unsigned char a = alpha[i] * 255;
+
+		float * uv = &texcoords[k * 8];
+		uv[0] = u1; uv[1] = v1;
+		uv[2] = u2; uv[3] = v1;
+		uv[4] = u2; uv[5] = v2;
+		uv[6] = u1; uv[7] = v2;
+
+		float * v = &vertices[k * 12];
+		v[0] = x1; v[1] = y1; v[2] = z;
+		v[3] = x2; v[4] = y1; v[5] = z;
+		v[6] = x2; v[7] = y2; v[8] = z;
+		v[9] = x1; v[10] = y2; v[11] = z;
+
+		unsigned char * c = &colors[k * 16];
+		for (int j = 0; j < 16; j += 4)
+		{
+			c[j + 0] = 255;
+			c[j + 1] = 255;
+			c[j + 2] = 255;
+			c[j + 3] = a;
+		}
+	}
+
+	// faces don't change between frames, only extend them on demand
+	for (unsigned i = faces.size() / 6; i < count; ++i)
+	{
+		const unsigned quad[6] = {0, 2, 1, 0, 3, 2};
+		for (unsigned j = 0; j < 6; ++j)
+			faces.push_back(i * 4 + quad[j]);
+	}
+
+	// one bulk copy into the vertex array
+	varray.Clear();
+	if (count > 0)
+	{
+		varray.Add(
+			faces.data(), count * 6,
+			vertices.data(), count * 12,
+			texcoords.data(), count * 8,
+			0, 0,
+			colors.data(), count * 16);
 	}
 
 	GetDrawList(node).get(draw).SetDrawEnable(varray.GetNumIndices() > 0);
@@ -187,19 +287,22 @@ void ParticleSystem::AddParticle(
 	if (max_particles == 0)
 		return;
 
-	while (particles.size() >= max_particles)
-		particles.pop_back();
+	if (particles.size() >= max_particles)
+		particles.resize(max_particles - 1);
 
-	particles.push_back(Particle());
-	Particle & p = particles.back();
-	p.start_position = position;
-	p.direction = direction;
-	p.transparency = transparency_range.first + newspeed * (transparency_range.second - transparency_range.first);
-	p.speed = speed_range.first + newspeed * (speed_range.second - speed_range.first);
-	p.size = size_range.first + newspeed * (size_range.second - size_range.first);
-	p.longevity = longevity_range.first + newspeed * (longevity_range.second - longevity_range.first);
-	p.time = 0;
-	p.tid = cur_texture_tile;
+	const unsigned i = particles.size();
+	const float speed = speed_range.first + newspeed * (speed_range.second - speed_range.first);
+	particles.resize(i + 1);
+	particles.x[i] = position[0];
+	particles.y[i] = position[1];
+	particles.z[i] = position[2];
+	particles.vx[i] = direction[0] * speed;
+	particles.vy[i] = direction[1] * speed;
+	particles.vz[i] = direction[2] * speed;
+	particles.transparency[i] = transparency_range.first + newspeed * (transparency_range.second - transparency_range.first);
+	particles.longevity[i] = longevity_range.first + newspeed * (longevity_range.second - longevity_range.first);
+	particles.time[i] = 0;
+	particles.tid[i] = cur_texture_tile;
 
 	cur_texture_tile = (cur_texture_tile + 1) % texture_tiles;
 }
@@ -223,7 +326,16 @@ void ParticleSystem::SetParameters(
 {
 	max_particles = maxparticles < 0 ? 0 : (maxparticles > 1024 ? 1024 : maxparticles);
 	particles.reserve(max_particles);
-	distance_from_cam.reserve(max_particles);
+	cam_x.reserve(max_particles);
+	cam_y.reserve(max_particles);
+	cam_z.reserve(max_particles);
+	alpha.reserve(max_particles);
+	visible.reserve(max_particles);
+	visible_distance.reserve(max_particles);
+	vertices.reserve(max_particles * 12);
+	texcoords.reserve(max_particles * 8);
+	colors.reserve(max_particles * 16);
+	faces.reserve(max_particles * 6);
 
 	transparency_range.first = transmin;
 	transparency_range.second = transmax;
@@ -257,3 +369,39 @@ QT_TEST(particle_test)
 	s.Update(0.50);
 	QT_CHECK_EQUAL(s.NumParticles(),0);
 }
+
+QT_TEST(particle_graphics_test)
+{
+	std::ostringstream out;
+	ParticleSystem s;
+	ContentManager c(out);
+	s.SetParameters(8,1.0,1.0,10.0,10.0,1.0,1.0,1.0,1.0,Vec3(0,0,0));
+	s.Load(std::string(), std::string(), 0, c);
+
+	// camera at origin looking down -z, 90 degrees field of view
+	s.AddParticle(Vec3(0,0,-5),0);
+	s.AddParticle(Vec3(0,0,-20),0);
+	s.AddParticle(Vec3(0,0,5),0);	// behind camera
+	s.AddParticle(Vec3(0,0,-10),0);
+	s.AddParticle(Vec3(30,0,-10),0);	// outside of frustum
+	s.AddParticle(Vec3(0,0,-2000),0);	// beyond far plane
+	s.UpdateGraphics(Quat(), Vec3(0,0,0), 0.1, 1000, 90, 1);
+	QT_CHECK_EQUAL(s.NumVisible(),3);
+	QT_CHECK_EQUAL(s.GetVertexArray().GetNumVertices(),3*4);
+	QT_CHECK_EQUAL(s.GetVertexArray().GetNumIndices(),3*6);
+
+	// back to front order
+	const float * verts;
+	unsigned count;
+	s.GetVertexArray().GetVertices(verts, count);
+	QT_CHECK_EQUAL(verts[2],-20);
+	QT_CHECK_EQUAL(verts[12+2],-10);
+	QT_CHECK_EQUAL(verts[24+2],-5);
+
+	// without field of view only near and far planes cull
+	s.UpdateGraphics(Quat(), Vec3(0,0,0), 0.1, 1000);
+	QT_CHECK_EQUAL(s.NumVisible(),4);
+	s.GetVertexArray().GetVertices(verts, count);
+	QT_CHECK_EQUAL(verts[2],-20);
+	QT_CHECK_EQUAL(verts[36+2],-5);
+}
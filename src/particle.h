@@ -24,6 +24,7 @@
 #include "graphics/vertexarray.h"
 #include "mathvector.h"
 #include "quaternion.h"
+#include "radix.h"
 
 #include <memory>
 #include <string>
@@ -54,12 +55,14 @@ public:
 	void Update(float dt);
 
 	/// Partcles graphics update based on last physics state.
-	/// Call once per frame.
+	/// Particles outside of the view frustum are culled, fovy (degrees)
+	/// and aspect (width / height) of zero only cull against znear, zfar.
+	/// Visible particles are drawn back to front. Call once per frame.
 	void UpdateGraphics(
 		const Quat & camdir,
 		const Vec3 & campos,
 		float znear, float zfar,
-		float fovy = 0, float fovz = 0);
+		float fovy = 0, float aspect = 0);
 
 	void Clear();
 
@@ -77,23 +80,49 @@ public:
 
 	unsigned NumParticles() { return particles.size(); }
 
+	/// Number of particles drawn by the last graphics update.
+	unsigned NumVisible() const { return visible.size(); }
+
+	const VertexArray & GetVertexArray() const { return varray; }
+
 	SceneNode & GetNode() { return node; }
 
 private:
-	struct Particle
+	/// Particle state as structure of arrays, element i of each array is particle i.
+	struct Particles
 	{
-		Vec3 start_position; ///< start position in world space
-		Vec3 direction;		///< direction in world space
-		Vec3 position;		///< position in camera space
-		float transparency; ///< transparency factor
-		float speed;		///< initial velocity along direction
-		float size;			///< initial size
-		float longevity;	///< particle age limit
-		float time;			///< particle age, time since the particle was created
-		int tid;			///< particle texture atlas tile id 0-8
+		std::vector<float> x, y, z;			///< start position in world space
+		std::vector<float> vx, vy, vz;		///< velocity (direction * speed) in world space
+		std::vector<float> transparency;	///< transparency factor
+		std::vector<float> longevity;		///< particle age limit
+		std::vector<float> time;			///< particle age, time since the particle was created
+		std::vector<unsigned char> tid;		///< particle texture atlas tile id 0-8
+
+		unsigned size() const { return time.size(); }
+		void reserve(unsigned n);
+		void resize(unsigned n);
+		void clear() { resize(0); }
+
+		/// move the last particle into slot i and shrink by one
+		void remove(unsigned i);
 	};
-	std::vector<Particle> particles;
-	std::vector<float> distance_from_cam;
+	Particles particles;
+
+	// camera space positions and alpha of all particles, rebuilt each graphics update
+	std::vector<float> cam_x, cam_y, cam_z;
+	std::vector<float> alpha;
+
+	// visible particle ids and camera distances, radix sorted back to front
+	std::vector<unsigned> visible;
+	std::vector<float> visible_distance;
+	Radix sort;
+
+	// vertex stream staging, written directly in draw order
+	std::vector<float> vertices;
+	std::vector<float> texcoords;
+	std::vector<unsigned char> colors;
+	std::vector<unsigned> faces;
+
 	unsigned max_particles;
 	unsigned texture_tiles;
 	unsigned cur_texture_tile;
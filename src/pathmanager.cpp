@@ -20,16 +20,18 @@
 #include "definitions.h"
 #include "pathmanager.h"
 
+#include <algorithm>
 #include <fstream>
 #include <cassert>
 #include <cstdlib>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
 #ifdef _WIN32
 #include <windows.h>
 #include <tchar.h>
 #include <direct.h>
 #else
-#include <sys/types.h>
-#include <sys/stat.h>
 #include <dirent.h>
 #include <unistd.h> // rmdir
 #include <errno.h>
@@ -103,6 +105,9 @@ void PathManager::Init(std::ostream & info_output, std::ostream & error_output)
 	MakeDir(GetTrackRecordsPath());
 	MakeDir(GetReplayPath());
 	MakeDir(GetScreenshotPath());
+	MakeDir(GetTextureCachePath());
+	MakeDir(GetRacingLineCachePath());
+	MakeDir(GetTrackMapCachePath());
 	MakeDir(GetTemporaryFolder());
 
 	// Print diagnostic info.
@@ -227,6 +232,48 @@ void PathManager::RemoveFile(const std::string & path)
 	remove(path.c_str());
 }
 
+void PathManager::PruneFiles(const std::string & folderpath, unsigned long long max_size) const
+{
+	std::list <std::string> files;
+	if (!GetFileList(folderpath, files))
+		return;
+
+	struct Entry
+	{
+		std::string path;
+		unsigned long long size;
+		long long used;
+	};
+	std::vector<Entry> entries;
+	unsigned long long total = 0;
+	for (const auto & file : files)
+	{
+		struct stat s;
+		Entry e;
+		e.path = folderpath + "/" + file;
+		if (stat(e.path.c_str(), &s) != 0 || !(s.st_mode & S_IFREG))
+			continue;
+
+		// access time is coarse on relatime mounts, but enough to order cache hits
+		e.size = s.st_size;
+		e.used = std::max<long long>(s.st_atime, s.st_mtime);
+		entries.push_back(e);
+		total += e.size;
+	}
+	if (total <= max_size)
+		return;
+
+	std::sort(entries.begin(), entries.end(),
+		[](const Entry & a, const Entry & b) { return a.used < b.used; });
+	for (const auto & e : entries)
+	{
+		if (total <= max_size)
+			break;
+		RemoveFile(e.path);
+		total -= e.size;
+	}
+}
+
 std::string PathManager::GetDataPath() const
 {
 	return data_directory;
@@ -325,6 +372,21 @@ std::string PathManager::GetScreenshotPath() const
 	return settings_path+"/screenshots";
 }
 
+std::string PathManager::GetTextureCachePath() const
+{
+	return settings_path+"/texturecache";
+}
+
+std::string PathManager::GetRacingLineCachePath() const
+{
+	return settings_path+"/racinglinecache";
+}
+
+std::string PathManager::GetTrackMapCachePath() const
+{
+	return settings_path+"/trackmapcache";
+}
+
 std::string PathManager::GetStaticReflectionMap() const
 {
 	return GetDataPath()+"/textures/weather/cubereflection-nosun.png";
@@ -345,6 +407,11 @@ std::string PathManager::GetUpdateManagerFile() const
 	return settings_path+"/updates.config"+profile_suffix;
 }
 
+std::string PathManager::GetFolderIndexFile() const
+{
+	return settings_path+"/folderindex.txt"+profile_suffix;
+}
+
 std::string PathManager::GetUpdateManagerFileBackup() const
 {
 	return settings_path+"/updates.config.backup"+profile_suffix;
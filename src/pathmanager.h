@@ -41,6 +41,10 @@ public:
 	static void RemoveDir(const std::string & dir);
 	static void RemoveFile(const std::string & path);
 
+	/// Remove the least recently used files of a cache folder until the
+	/// remaining files take at most max_size bytes.
+	void PruneFiles(const std::string & folderpath, unsigned long long max_size) const;
+
 	std::string GetDataPath() const;
 	std::string GetWriteableDataPath() const;
 	std::string GetCarPartsPath() const;
@@ -59,10 +63,14 @@ public:
 	std::string GetDefaultCarControlsFile() const;
 	std::string GetReplayPath() const;
 	std::string GetScreenshotPath() const;
+	std::string GetTextureCachePath() const;
+	std::string GetRacingLineCachePath() const;
+	std::string GetTrackMapCachePath() const;
 	std::string GetStaticReflectionMap() const;
 	std::string GetStaticAmbientMap() const;
 	std::string GetShaderPath() const;
 	std::string GetUpdateManagerFile() const;
+	std::string GetFolderIndexFile() const;
 	std::string GetUpdateManagerFileBackup() const;
 	std::string GetUpdateManagerFileBase() const;
 
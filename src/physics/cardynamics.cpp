@@ -19,11 +19,15 @@
 
 #include "cardynamics.h"
 #include "carinput.h"
+#include "cartiretable.h"
 #include "tracksurface.h"
 #include "dynamicsworld.h"
 #include "fracturebody.h"
 #include "loadcollisionshape.h"
 #include "coordinatesystem.h"
+#include "roadpatch.h"
+#include "speedprofile.h"
+#include "tobullet.h"
 #include "content/contentmanager.h"
 #include "cfg/ptree.h"
 #include "fastmath.h"
@@ -36,8 +40,9 @@
 #include <cmath>
 
 static const btScalar gravity = 9.81;
-static const int substeps = 10;
-static const btScalar rsubsteps = 1.0/substeps;
+
+// linear (m/s) and angular (rad/s) velocity below which a car is considered at rest
+static const btScalar sleep_speed = 0.05;
 
 static inline std::istream & operator >> (std::istream & lhs, btVector3 & rhs)
 {
@@ -509,6 +514,18 @@ struct BodyLoader
 	}
 };
 
+CarDynamics::SolverConfig::SolverConfig() :
+	min_substeps(3),
+	max_substeps(10),
+	min_iterations(2),
+	max_iterations(4),
+	max_residual(0.05),
+	max_slip(0.5),
+	adaptive(true)
+{
+	// ctor
+}
+
 CarDynamics::CarDynamics()
 {
 	Init();
@@ -647,16 +664,16 @@ bool CarDynamics::Load(
 	}
 
 	if (drive == AWD)
-		InitDriveline4(world.getTimeStep() * rsubsteps);
+		InitDriveline4(world.getTimeStep() / solver_substeps);
 	else
-		InitDriveline2(world.getTimeStep() * rsubsteps);
+		InitDriveline2(world.getTimeStep() / solver_substeps);
 
 	transform.setRotation(rotation);
 	transform.setOrigin(position);
 
 	body = new FractureBody(bodyinfo);
 	body->setCenterOfMassTransform(transform);
-	body->setActivationState(DISABLE_DEACTIVATION);
+	body->setSleepingThresholds(sleep_speed, sleep_speed);
 	body->setContactProcessingThreshold(0.0);
 	body->setCollisionFlags(body->getCollisionFlags() | btCollisionObject::CF_CUSTOM_MATERIAL_CALLBACK);
 	world.addRigidBody(body);
@@ -758,6 +775,130 @@ void CarDynamics::SetTCS(bool value)
 	tcs = value;
 }
 
+void CarDynamics::SetSolverConfig(const SolverConfig & value)
+{
+	assert(value.min_substeps > 0 && value.min_substeps <= value.max_substeps);
+	assert(value.min_iterations > 0 && value.min_iterations <= value.max_iterations);
+	solver_config = value;
+}
+
+bool CarDynamics::InitTireTables(ThreadPool & pool, std::ostream & report)
+{
+#if defined(VDRIFTP) || defined(VDRIFTN)
+	report << "Tire tables are not supported by the tire model" << std::endl;
+	return false;
+#else
+	// cover load transfer, downforce and bumps, higher loads fall back to the tire model
+	const btScalar max_load = 4 * gravity / (WHEEL_COUNT * body->getInvMass());
+	const int sample_count = 10000;
+	for (int i = 0; i < WHEEL_COUNT; ++i)
+	{
+		// identical tires share their tables
+		int shared = 0;
+		while (shared < i && !tire[i].shareTables(tire[shared], max_load))
+			shared++;
+		if (shared < i)
+		{
+			report << "Tire " << i << " shares table of tire " << shared << std::endl;
+			continue;
+		}
+
+		tire[i].initTables(max_load, pool);
+
+		CarTireTableError error[3];
+		tire[i].validateTables(sample_count, error);
+
+		const char * name[3] = {"fx", "fy", "mz"};
+		report << "Tire " << i << " table " << tire[i].getTableBytes() / 1024 << " KB";
+		for (int n = 0; n < 3; ++n)
+		{
+			report << ", " << name[n] << " error max " << error[n].max << " mean " << error[n].mean <<
+				" (" << 100 * error[n].max / Max(error[n].peak, btScalar(1E-6)) << "%)";
+		}
+		report << std::endl;
+	}
+	return true;
+#endif
+}
+
+bool CarDynamics::SetKinematic(bool value)
+{
+	if (value == kinematic)
+		return true;
+
+	if (!value)
+	{
+		// velocity, wheel and engine speeds are kept up to date in kinematic mode,
+		// the simulation continues from there
+		kinematic = false;
+		kinematic_patch = 0;
+		return true;
+	}
+
+	// only simplify cars driving upright on track with all wheels attached
+	const RoadPatch * patch = GetContactPatch();
+	if (!patch || !patch->HasRacingline())
+		return false;
+
+	const RoadPatch * next = patch->GetNextPatch();
+	if (!next || !next->HasRacingline())
+		return false;
+
+	for (int i = 0; i < WHEEL_COUNT; ++i)
+	{
+		if (body->getChildBody(i)->isInWorld() || !wheel_contact[i].GetPatch())
+			return false;
+	}
+
+	const btMatrix3x3 & m = transform.getBasis();
+	if (m.getColumn(Direction::UP).dot(Direction::up) < btScalar(0.9))
+		return false;
+
+	const btScalar min_speed = 5;
+	const btScalar max_yaw_rate = 1;
+	const btVector3 & v = body->getLinearVelocity();
+	const btScalar speed = v.length();
+	if (speed < min_speed || v.dot(m.getColumn(Direction::FORWARD)) < btScalar(0.95) * speed ||
+		body->getAngularVelocity().length() > max_yaw_rate)
+		return false;
+
+	// project car onto racing line segment
+	const btVector3 a = ToBulletVector(patch->GetRacingLine());
+	const btVector3 b = ToBulletVector(next->GetRacingLine());
+	const btVector3 ab = b - a;
+	const btScalar length2 = ab.length2();
+	if (length2 < btScalar(1E-4))
+		return false;
+
+	const btVector3 p = transform.getOrigin() - a;
+	const btScalar t = p.dot(ab) / length2;
+	if (t < btScalar(-0.5) || t > btScalar(1.5))
+		return false;
+
+	const btVector3 dir = ab / std::sqrt(length2);
+	const btVector3 right = dir.cross(Direction::up).normalized();
+	const btVector3 up = right.cross(dir);
+
+	kinematic_patch = patch;
+	kinematic_progress = Clamp(t, btScalar(0), btScalar(1));
+	kinematic_speed = speed;
+	kinematic_offset[0] = p.dot(right);
+	kinematic_offset[1] = p.dot(up);
+	kinematic = true;
+
+	for (int i = 0; i < WHEEL_COUNT; ++i)
+	{
+		wheel_velocity[i][0] = 0;
+		wheel_velocity[i][1] = 0;
+		wheel_velocity[i][2] = 0;
+		wheel_slip[i] = 0;
+		abs_active[i] = false;
+		tcs_active[i] = false;
+	}
+
+	return true;
+}
+
 void CarDynamics::Update(const std::vector<float> & inputs)
 {
 	assert(inputs.size() >= CarInput::INVALID);
@@ -844,6 +985,20 @@ void CarDynamics::Update(const std::vector<float> & inputs)
 	// reset car after a rollover
 	if (inputs[CarInput::ROLLOVER])
 		RolloverRecover();
+
+	// wake up on driver input
+	const float input_threshold = 0.01;
+	bool input_changed = inputs[CarInput::THROTTLE] > 0 || last_inputs.size() != inputs.size();
+	for (size_t i = 0; i < last_inputs.size() && !input_changed; ++i)
+		input_changed = std::abs(inputs[i] - last_inputs[i]) > input_threshold;
+	if (input_changed)
+		body->activate();
+	last_inputs = inputs;
+}
+
+bool CarDynamics::IsSleeping() const
+{
+	return !body->isActive();
 }
 
 void CarDynamics::debugDraw(btIDebugDraw*)
@@ -1030,6 +1185,14 @@ btScalar CarDynamics::GetBrakeDistance(btScalar initial_speed, btScalar final_sp
 	return distance;
 }
 
+btScalar CarDynamics::GetMaxAcceleration(btScalar speed) const
+{
+	const btScalar mass = 1 / GetInvMass();
+	const btScalar drag = aero_drag_coeff * speed * speed / mass;
+	const btScalar accel = Min(engine.GetMaxPower() / (mass * Max(speed, btScalar(1))), lon_friction_coeff * gravity);
+	return accel - drag;
+}
+
 std::vector<float> CarDynamics::GetSpecs() const
 {
 	return std::vector<float>{
@@ -1183,6 +1346,19 @@ void CarDynamics::updateAction(btCollisionWorld * /*collisionWorld*/, btScalar d
 	// reset body transform
 	body->setCenterOfMassTransform(transform);
 
+	if (!body->isActive())
+		return;
+
+	if (kinematic)
+	{
+		UpdateKinematic(dt);
+		if (kinematic)
+		{
+			body->activate();
+			return;
+		}
+	}
+
 	if (tcs)
 	{
 		for (int i = 0; i < WHEEL_COUNT; ++i)
@@ -1208,6 +1384,8 @@ void CarDynamics::updateAction(btCollisionWorld * /*collisionWorld*/, btScalar d
 
 	UpdateDriveline(dt);
 
+	UpdateSpeedScale(dt);
+
 	fuel_tank.Consume(engine.FuelRate() * dt);
 	engine.SetOutOfGas(fuel_tank.Empty());
 
@@ -1221,6 +1399,217 @@ void CarDynamics::updateAction(btCollisionWorld * /*collisionWorld*/, btScalar d
 	body->predictIntegratedTransform(dt, transform);
 	body->setCenterOfMassTransform(transform);
 	UpdateWheelTransform();
+
+	UpdateSleeping();
+}
+
+void CarDynamics::UpdateSleeping()
+{
+	// bullet only tracks body velocity, spinning wheels or engine
+	// driving through the clutch have to keep the car awake
+	bool moving = clutch_slipping && transmission.GetGear() != 0;
+	for (int i = 0; i < WHEEL_COUNT && !moving; ++i)
+		moving = std::abs(wheel[i].GetAngularVelocity() * wheel[i].GetRadius()) > sleep_speed;
+	if (moving)
+		body->activate();
+}
+
+// road curvature radius at patch, bounded to keep corner speeds sensible on degenerate patches
+static btScalar GetPatchRadius(const RoadPatch & patch)
+{
+	return Max(std::abs(btScalar(patch.GetTrackRadius())), btScalar(5));
+}
+
+const RoadPatch * CarDynamics::GetContactPatch() const
+{
+	const RoadPatch * patch = wheel_contact[FRONT_LEFT].GetPatch();
+	if (!patch)
+		patch = wheel_contact[FRONT_RIGHT].GetPatch();
+	return patch;
+}
+
+void CarDynamics::UpdateSpeedScale(btScalar dt)
+{
+	// only corners tell how close to the limit the car is driven
+	const RoadPatch * patch = GetContactPatch();
+	if (!patch || !patch->HasRacingline())
+		return;
+
+	const btScalar limit = GetMaxSpeed(GetPatchRadius(*patch), 1);
+	if (limit > maxspeed)
+		return;
+
+	const btScalar time_constant = 5;
+	const btScalar scale = Clamp(GetSpeed() / limit, btScalar(0.5), btScalar(1.2));
+	speed_scale += (scale - speed_scale) * Min(dt / time_constant, btScalar(1));
+}
+
+bool CarDynamics::RestoreDriveline(int substeps)
+{
+	if (substeps < 1)
+		return false;
+
+	SetDrivelineSubsteps(substeps, world->getTimeStep());
+	UpdateDrivelineGearRatio();
+	return true;
+}
+
+int CarDynamics::GetKinematicPatchId() const
+{
+	return kinematic_patch ? world->GetPatchId(kinematic_patch) : -1;
+}
+
+bool CarDynamics::SetKinematicPatchId(int id)
+{
+	kinematic_patch = world->GetPatch(id);
+	return kinematic_patch || !kinematic;
+}
+
+btScalar CarDynamics::GetKinematicSpeedLimit() const
+{
+	const btScalar decel = lon_friction_coeff * gravity * speed_scale;
+	const btScalar brake_distance = kinematic_speed * kinematic_speed / (2 * decel);
+	const int max_patches = 256;
+
+	// corner speeds of the patches within braking distance, the first one from the car position
+	btScalar limit[max_patches];
+	btScalar length[max_patches];
+	const RoadPatch * patch = kinematic_patch;
+	btScalar distance = 0;
+	int count = 0;
+	while (count < max_patches && distance <= brake_distance)
+	{
+		const RoadPatch * next = patch->GetNextPatch();
+		if (!next || !next->HasRacingline())
+			break;
+
+		limit[count] = Min(GetMaxSpeed(GetPatchRadius(*patch), 1) * speed_scale, maxspeed);
+		length[count] = (next->GetRacingLine() - patch->GetRacingLine()).Magnitude();
+		if (count == 0)
+			length[count] *= 1 - kinematic_progress;
+		distance += length[count];
+		patch = next;
+		count++;
+	}
+	if (count == 0)
+		return maxspeed;
+
+	LimitSpeedProfile(limit, length, count, false, [decel](btScalar final_speed, btScalar segment_length)
+	{
+		return std::sqrt(final_speed * final_speed + 2 * decel * segment_length);
+	});
+	return limit[0];
+}
+
+void CarDynamics::UpdateKinematic(btScalar dt)
+{
+	const RoadPatch * next = kinematic_patch->GetNextPatch();
+	btVector3 a = ToBulletVector(kinematic_patch->GetRacingLine());
+	btVector3 b = ToBulletVector(next->GetRacingLine());
+	btVector3 dir = (b - a).normalized();
+	btVector3 right = dir.cross(Direction::up).normalized();
+
+	// collision response of the body changes speed and lateral offset
+	const btVector3 & v = body->getLinearVelocity();
+	const btScalar vg = world->getGravity().dot(dir) * dt;
+	kinematic_speed = Max(v.dot(dir) - vg, btScalar(0));
+	kinematic_offset[0] += v.dot(right) * dt;
+
+	// accelerate towards speed limit
+	const btScalar accel = GetMaxAcceleration(kinematic_speed);
+	const btScalar decel = lon_friction_coeff * gravity;
+	const btScalar target = GetKinematicSpeedLimit();
+	kinematic_speed += Clamp(target - kinematic_speed, -decel * dt, Max(accel, btScalar(0)) * dt);
+
+	// advance along racing line
+	btScalar distance = kinematic_speed * dt;
+	btScalar length = (b - a).length();
+	while (kinematic_progress * length + distance > length)
+	{
+		const RoadPatch * next_next = next->GetNextPatch();
+		if (!next_next || !next_next->HasRacingline())
+		{
+			// end of racing line, hand the car back to the simulation
+			kinematic_progress = 1;
+			SetKinematic(false);
+			return;
+		}
+		distance -= (1 - kinematic_progress) * length;
+		kinematic_progress = 0;
+		kinematic_patch = next;
+		next = next_next;
+		a = b;
+		b = ToBulletVector(next->GetRacingLine());
+		length = (b - a).length();
+	}
+	kinematic_progress += distance / Max(length, btScalar(1E-3));
+	dir = (b - a) / Max(length, btScalar(1E-3));
+	right = dir.cross(Direction::up).normalized();
+	const btVector3 up = right.cross(dir);
+
+	// blend lateral offset into racing line over a couple of seconds
+	const btScalar offset_time = 2;
+	kinematic_offset[0] -= kinematic_offset[0] * Min(dt / offset_time, btScalar(1));
+
+	const btVector3 position = a + (b - a) * kinematic_progress +
+		right * kinematic_offset[0] + up * kinematic_offset[1];
+
+	// turn towards racing line direction
+	const btScalar turn_rate = 5;
+	btQuaternion rotation = transform.getRotation();
+	const btVector3 forward = transform.getBasis().getColumn(Direction::FORWARD);
+	const btQuaternion target_rotation = shortestArcQuat(forward, dir) * rotation;
+	rotation = slerp(rotation, target_rotation, Min(dt * turn_rate, btScalar(1)));
+
+	const btVector3 velocity = dir * kinematic_speed;
+	transform.setOrigin(position);
+	transform.setRotation(rotation.normalized());
+	body->setCenterOfMassTransform(transform);
+	body->setLinearVelocity(velocity);
+	body->setAngularVelocity(btVector3(0, 0, 0));
+
+	// roll wheels, keep engine and gear in sync with wheel speed
+	for (int i = 0; i < WHEEL_COUNT; ++i)
+	{
+		wheel[i].SetAngularVelocity(kinematic_speed / wheel[i].GetRadius());
+		wheel[i].Integrate(dt);
+		wheel_position[i] = transform.getBasis() * (suspension[i].GetWheelPosition() + GetCenterOfMassOffset());
+	}
+
+	if (transmission.GetGear() <= 0)
+	{
+		transmission.Shift(1);
+		UpdateDrivelineGearRatio();
+	}
+	const btScalar wheel_speed = kinematic_speed / wheel[0].GetRadius();
+	btScalar clutch_rpm = wheel_speed * driveline.gear_ratio * btScalar(30 / M_PI);
+	int gear = transmission.GetGear();
+	if (clutch_rpm > engine.GetRedline() && gear < transmission.GetForwardGears())
+		gear++;
+	else if (clutch_rpm < DownshiftRPM(gear) && gear > 1)
+		gear--;
+	if (gear != transmission.GetGear())
+	{
+		transmission.Shift(gear);
+		UpdateDrivelineGearRatio();
+		clutch_rpm = wheel_speed * driveline.gear_ratio * btScalar(30 / M_PI);
+	}
+	const btScalar rpm = Max(clutch_rpm, engine.GetStartRPM());
+	engine.GetShaft().ang_velocity = rpm * btScalar(M_PI / 30);
+	driveshaft_rpm = clutch_rpm / transmission.GetCurrentGearRatio();
+	tacho_rpm += (rpm - tacho_rpm) * btScalar(0.1);
+	feedback = 0;
+
+	// wheel contacts carry the road patch used by lap timing and ai
+	for (int i = 0; i < WHEEL_COUNT; ++i)
+	{
+		const CollisionContact & c = wheel_contact[i];
+		wheel_contact[i] = CollisionContact(
+			position + wheel_position[i], c.GetNormal(), c.GetDepth(),
+			c.GetPatchId(), kinematic_patch, &c.GetSurface(), c.GetObject());
+	}
+
+	UpdateWheelTransform();
 }
 
 void CarDynamics::UpdateWheelContacts()
@@ -1301,6 +1690,8 @@ void CarDynamics::UpdateDrivelineGearRatio()
 
 void CarDynamics::SetupDriveline(const btMatrix3x3 wheel_orientation[WHEEL_COUNT], btScalar dt)
 {
+	const btScalar rsubsteps = btScalar(1) / solver_substeps;
+
 	auto & c = driveline.clutch[0];
 	c.impulse_limit_delta = (clutch.GetTorque() * dt - c.impulse_limit) * rsubsteps;
 
@@ -1449,11 +1840,102 @@ void CarDynamics::UpdateWheelConstraints(btScalar rdt, btScalar sdt)
 	}
 }
 
+void CarDynamics::UpdateSolverEffort(btScalar dt)
+{
+	const SolverConfig & c = solver_config;
+	int substeps = c.max_substeps;
+	int iterations = c.max_iterations;
+	if (c.adaptive)
+	{
+		bool transient = clutch_slipping || remaining_shift_time > 0 || solver_residual > c.max_residual;
+		for (int i = 0; i < WHEEL_COUNT && !transient; ++i)
+		{
+			const auto & t = tire_state[i];
+			transient =
+				std::abs(t.slip) > c.max_slip * t.ideal_slip ||
+				std::abs(t.slip_angle) > c.max_slip * t.ideal_slip_angle;
+		}
+
+		if (!transient)
+		{
+			// relax one step per tick while the residual stays well inside the bound
+			substeps = solver_substeps;
+			iterations = solver_iterations;
+			if (solver_residual < c.max_residual * btScalar(0.5))
+			{
+				substeps--;
+				iterations--;
+			}
+		}
+	}
+	substeps = Clamp(substeps, c.min_substeps, c.max_substeps);
+	iterations = Clamp(iterations, c.min_iterations, c.max_iterations);
+
+	SetDrivelineSubsteps(substeps, dt);
+	solver_iterations = iterations;
+}
+
+void CarDynamics::SetDrivelineSubsteps(int substeps, btScalar dt)
+{
+	if (substeps == solver_substeps)
+		return;
+
+	// interpolated impulse limits are per substep
+	const btScalar scale = btScalar(solver_substeps) / substeps;
+	for (auto & m : driveline.motor)
+		m.impulse_limit *= scale;
+	driveline.clutch[0].impulse_limit *= scale;
+
+	solver_substeps = substeps;
+	if (drive == AWD)
+		InitDriveline4(dt / substeps);
+	else if (drive != NONE)
+		InitDriveline2(dt / substeps);
+}
+
+btScalar CarDynamics::ComputeDrivelineResidual()
+{
+	// saturated rows are sliding or at their torque limit, their error is physical
+	btScalar residual = 0;
+	for (int i = 0; i < WHEEL_COUNT; ++i)
+	{
+		const auto & c = wheel_constraint[i];
+		btScalar v[3];
+		c.getContactVelocity(v);
+		const btScalar error[2] = {v[0] - v[2], v[1] - c.vcam};
+		for (int j = 0; j < 2; ++j)
+		{
+			const auto & row = c.constraint[j];
+			if (row.impulse > row.lower_impulse_limit && row.impulse < row.upper_impulse_limit)
+				residual = Max(residual, std::abs(error[j]));
+		}
+	}
+
+	// transmission error at the wheels
+	const auto & clutch0 = driveline.clutch[0];
+	const bool clutch_engaged = clutch0.impulse_limit > 0;
+	clutch_slipping = clutch_engaged && std::abs(clutch0.impulse) >= clutch0.impulse_limit;
+	if (clutch_engaged && !clutch_slipping && driveline.gear_ratio != 0)
+	{
+		const int n = (drive == AWD) ? 4 : 2;
+		btScalar velocity = 0;
+		for (int i = 1; i <= n; ++i)
+			velocity += driveline.shaft[i]->ang_velocity;
+		velocity /= n;
+		const btScalar error = driveline.shaft[0]->ang_velocity / driveline.gear_ratio - velocity;
+		residual = Max(residual, std::abs(error) * wheel[0].GetRadius());
+	}
+
+	return residual;
+}
+
 void CarDynamics::UpdateDriveline(btScalar dt)
 {
-	const int solver_iterations = 4;
+	UpdateSolverEffort(dt);
+
+	const int substeps = solver_substeps;
 	const btScalar rdt = 1 / dt;
-	const btScalar sdt = dt * rsubsteps;
+	const btScalar sdt = dt / substeps;
 
 	UpdateWheelContacts();
 	btMatrix3x3 wheel_orientation[WHEEL_COUNT];
@@ -1501,6 +1983,11 @@ void CarDynamics::UpdateDriveline(btScalar dt)
 			wheel_constraint[i].solveSuspension();
 	}
 
+	solver_residual = ComputeDrivelineResidual();
+	solver_stats.ticks++;
+	solver_stats.substeps += substeps;
+	solver_stats.iterations += substeps * solver_iterations;
+
 	// update wheel and tire state
 	for (int i = 0; i < WHEEL_COUNT; ++i)
 	{
@@ -1897,11 +2384,25 @@ void CarDynamics::Init()
 	autoshift = false;
 	abs = false;
 	tcs = false;
+	solver_config = SolverConfig();
+	solver_stats = SolverStats();
+	solver_residual = 0;
+	solver_substeps = solver_config.max_substeps;
+	solver_iterations = solver_config.max_iterations;
+	clutch_slipping = false;
+	kinematic_patch = 0;
+	kinematic_progress = 0;
+	kinematic_speed = 0;
+	kinematic_offset[0] = 0;
+	kinematic_offset[1] = 0;
+	speed_scale = 0.8;
+	kinematic = false;
 	for (int i = 0; i < WHEEL_COUNT; ++i)
 	{
 		wheel_velocity[i][0] = 0;
 		wheel_velocity[i][1] = 0;
 		wheel_velocity[i][2] = 0;
+		wheel_position[i].setZero();
 		wheel_slip[i] = 0;
 		abs_active[i] = 0;
 		tcs_active[i] = 0;
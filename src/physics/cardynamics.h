@@ -46,7 +46,9 @@ class btIDebugDraw;
 class DynamicsWorld;
 class FractureBody;
 class ContentManager;
+class RoadPatch;
 class PTree;
+class ThreadPool;
 
 class CarDynamics : public btActionInterface
 {
@@ -88,6 +90,53 @@ public:
 	// update dynamics from car input vector
 	void Update(const std::vector<float> & inputs);
 
+	// driveline solver effort per tick, adaptive mode picks substeps and iterations
+	// from the previous tick constraint residual, tire slip and clutch state
+	struct SolverConfig
+	{
+		int min_substeps;
+		int max_substeps;
+		int min_iterations;
+		int max_iterations;
+		btScalar max_residual;	// unsaturated constraint velocity error bound in m/s
+		btScalar max_slip;		// tire slip bound as fraction of ideal slip
+		bool adaptive;			// use max substeps and iterations if false
+
+		SolverConfig();
+	};
+
+	// solver effort accumulated since last reset
+	struct SolverStats
+	{
+		unsigned ticks;
+		unsigned substeps;
+		unsigned iterations;
+
+		SolverStats() : ticks(0), substeps(0), iterations(0) {}
+	};
+
+	void SetSolverConfig(const SolverConfig & value);
+
+	const SolverStats & GetSolverStats() const {return solver_stats;}
+
+	void ResetSolverStats() {solver_stats = SolverStats();}
+
+	// evaluate tire forces from precomputed tables instead of the tire model,
+	// tables are built on the thread pool, report receives their size and error
+	// returns false if the tire model does not support tables
+	bool InitTireTables(ThreadPool & pool, std::ostream & report);
+
+	// kinematic mode replaces the vehicle simulation by a racing line follower
+	// for cars far away from the viewer, the body keeps colliding with the world
+	// returns false if the car can not be switched in its current state
+	bool SetKinematic(bool value);
+
+	bool IsKinematic() const {return kinematic;}
+
+	// cars at rest are put to sleep by the dynamics world,
+	// driver input and contacts with awake bodies wake them up
+	bool IsSleeping() const;
+
 	// bullet interface
 	void updateAction(btCollisionWorld * collisionWorld, btScalar dt) override;
 	void debugDraw(btIDebugDraw * debugDrawer) override;
@@ -157,6 +206,9 @@ public:
 	// Distance required to reduce initial to final speed
 	btScalar GetBrakeDistance(btScalar initial_speed, btScalar final_speed, btScalar friction) const;
 
+	// Highest forward acceleration at given speed, limited by engine power and traction, minus drag
+	btScalar GetMaxAcceleration(btScalar speed) const;
+
 	// This is needed for ray casts in the AI implementation.
 	DynamicsWorld * getDynamicsWorld() const {return world;}
 
@@ -173,9 +225,14 @@ public:
 	template <class Stream>
 	void DebugPrint(Stream & out, bool p1, bool p2, bool p3, bool p4) const;
 
+	// state stored in replays
 	template <class Serializer>
 	bool Serialize(Serializer & s);
 
+	// complete state for in-memory snapshots, a superset of Serialize
+	template <class Serializer>
+	bool SerializeSnapshot(Serializer & s);
+
 	static bool WheelContactCallback(
 		btManifoldPoint& cp,
 		const btCollisionObjectWrapper* col0,
@@ -242,6 +299,23 @@ protected:
 	btScalar remaining_shift_time;
 	int shift_gear;
 	bool shifted;
+	std::vector<float> last_inputs;
+
+	// driveline solver state
+	SolverConfig solver_config;
+	SolverStats solver_stats;
+	btScalar solver_residual;
+	int solver_substeps;
+	int solver_iterations;
+	bool clutch_slipping;
+
+	// kinematic state, position along racing line segment starting at kinematic_patch
+	const RoadPatch * kinematic_patch;
+	btScalar kinematic_progress;
+	btScalar kinematic_speed;
+	btScalar kinematic_offset[2];	// lateral and vertical offset from racing line
+	btScalar speed_scale;			// cornering speed fraction used by the driver, calibrated while simulated
+	bool kinematic;
 
 	// assists
 	bool steering_assist;
@@ -285,12 +359,45 @@ protected:
 
 	void UpdateWheelConstraints(btScalar rdt, btScalar sdt);
 
+	// choose driveline substeps and iterations for this tick
+	void UpdateSolverEffort(btScalar dt);
+
+	// change driveline substep count, rescales substep dependent joint limits
+	void SetDrivelineSubsteps(int substeps, btScalar dt);
+
+	// max velocity error of unsaturated friction and driveline constraints
+	btScalar ComputeDrivelineResidual();
+
 	// run driveline constraint solver
 	void UpdateDriveline(btScalar dt);
 
+	// road patch below the front wheels
+	const RoadPatch * GetContactPatch() const;
+
+	// track cornering speed used by the driver relative to the car limit
+	void UpdateSpeedScale(btScalar dt);
+
+	// target speed from the cornering speed limits within braking distance
+	btScalar GetKinematicSpeedLimit() const;
+
+	// advance kinematic car along the racing line
+	void UpdateKinematic(btScalar dt);
+
+	// kinematic patch as track patch index for serialization, -1 if none
+	int GetKinematicPatchId() const;
+
+	// set kinematic patch from track patch index, fails if kinematic and index is invalid
+	bool SetKinematicPatchId(int id);
+
+	// reinitialize driveline for deserialized substeps and gear, fails if substeps is invalid
+	bool RestoreDriveline(int substeps);
+
 	// calculate throttle, clutch, gear
 	void UpdateTransmission(btScalar dt);
 
+	// keep body awake while wheels or driveline are moving
+	void UpdateSleeping();
+
 	bool WheelDriven(int i) const;
 
 	btScalar AutoClutch(btScalar clutch_rpm, btScalar dt) const;
@@ -518,4 +625,77 @@ inline bool CarDynamics::Serialize(Serializer & s)
 	return true;
 }
 
+template <class Serializer>
+inline bool CarDynamics::SerializeSnapshot(Serializer & s)
+{
+	if (!Serialize(s))
+		return false;
+	if (!engine.SerializeSnapshot(s))
+		return false;
+
+	// kinematic cars are never recorded, replays disable the physics lod
+	int patch_id = GetKinematicPatchId();
+	_SERIALIZE_(s, kinematic);
+	_SERIALIZE_(s, patch_id);
+	_SERIALIZE_(s, kinematic_progress);
+	_SERIALIZE_(s, kinematic_speed);
+	_SERIALIZE_(s, kinematic_offset[0]);
+	_SERIALIZE_(s, kinematic_offset[1]);
+	_SERIALIZE_(s, speed_scale);
+	const bool input = (s.GetIODirection() == Serializer::DIRECTION_INPUT);
+	if (input && !SetKinematicPatchId(patch_id))
+		return false;
+
+	// driveline solver state, impulse limits are interpolated from the previous tick
+	int substeps = solver_substeps;
+	_SERIALIZE_(s, substeps);
+	_SERIALIZE_(s, solver_iterations);
+	_SERIALIZE_(s, solver_residual);
+	_SERIALIZE_(s, clutch_slipping);
+	if (input && !RestoreDriveline(substeps))
+		return false;
+	for (auto & m : driveline.motor)
+	{
+		_SERIALIZE_(s, m.impulse_limit);
+		_SERIALIZE_(s, m.impulse);
+	}
+	for (auto & c : driveline.clutch)
+	{
+		_SERIALIZE_(s, c.impulse_limit);
+		_SERIALIZE_(s, c.impulse);
+	}
+	for (int i = 0; i < WHEEL_COUNT; ++i)
+	{
+		for (auto & row : wheel_constraint[i].constraint)
+			_SERIALIZE_(s, row.impulse);
+		_SERIALIZE_(s, wheel_velocity[i][0]);
+		_SERIALIZE_(s, wheel_velocity[i][1]);
+		_SERIALIZE_(s, wheel_velocity[i][2]);
+
+		CarTireState & t = tire_state[i];
+		_SERIALIZE_(s, t.friction);
+		_SERIALIZE_(s, t.camber);
+		_SERIALIZE_(s, t.vcam);
+		_SERIALIZE_(s, t.slip);
+		_SERIALIZE_(s, t.slip_angle);
+		_SERIALIZE_(s, t.ideal_slip);
+		_SERIALIZE_(s, t.ideal_slip_angle);
+		_SERIALIZE_(s, t.fx);
+		_SERIALIZE_(s, t.fy);
+		_SERIALIZE_(s, t.mz);
+	}
+	_SERIALIZE_(s, tacho_rpm);
+	_SERIALIZE_(s, feedback);
+
+	// inputs seen by the sleep check
+	int input_count = last_inputs.size();
+	_SERIALIZE_(s, input_count);
+	if (input_count < 0)
+		return false;
+	last_inputs.resize(input_count);
+	for (auto & input : last_inputs)
+		_SERIALIZE_(s, input);
+	return true;
+}
+
 #endif
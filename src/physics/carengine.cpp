@@ -127,6 +127,9 @@ bool CarEngineInfo::Load(const PTree & cfg, std::ostream & error_output)
 		torque_curve.AddPoint(rpm_limit, limit_torque);
 	}
 	torque_curve.Calculate();
+	torque_table.Sample(torque_curve,
+		btMin(torque[0].first, stall_rpm),
+		btMax(torque[torque.size() - 1].first, rpm_limit));
 
 	// calculate idle throttle position
 	for (idle_throttle = 0.0f; idle_throttle < 1.0f; idle_throttle += 0.01f)
@@ -155,7 +158,7 @@ btScalar CarEngineInfo::GetMaxTorque() const
 btScalar CarEngineInfo::GetTorque(const btScalar throttle, const btScalar rpm) const
 {
 	if (rpm < 1) return 0.0;
-	return torque_curve.Interpolate(rpm) * throttle;
+	return torque_table.Interpolate(rpm) * throttle;
 }
 
 btScalar CarEngineInfo::GetFrictionTorque(btScalar throttle, btScalar rpm) const
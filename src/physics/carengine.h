@@ -23,6 +23,7 @@
 #include "driveshaft.h"
 #include "LinearMath/btVector3.h"
 #include "spline.h"
+#include "uniformcurve.h"
 #include "macros.h"
 
 #include <iosfwd>
@@ -43,6 +44,7 @@ struct CarEngineInfo
 	btScalar fuel_rate; ///< fuel rate kg/Ws based on fuel heating value(4E7) and engine efficiency(0.35)
 	btScalar friction[3]; ///< friction torque coefficients
 	Spline<btScalar> torque_curve;
+	UniformCurve<btScalar, 128> torque_table; ///< torque_curve resampled for constant time lookup, linear outside of the curve
 	btVector3 position;
 	btScalar inertia;
 	btScalar mass;
@@ -217,6 +219,18 @@ public:
 		return true;
 	}
 
+	/// state recomputed on the next tick, only needed to resume a snapshot exactly
+	template <class Serializer>
+	bool SerializeSnapshot(Serializer & s)
+	{
+		_SERIALIZE_(s, stalled);
+		_SERIALIZE_(s, nos_mass);
+		_SERIALIZE_(s, nos_boost_factor);
+		_SERIALIZE_(s, combustion_torque);
+		_SERIALIZE_(s, friction_torque);
+		return true;
+	}
+
 private:
 	CarEngineInfo info;
 
@@ -19,12 +19,52 @@
 
 #include "cartire1.h"
 #include "cartirebase.h"
+#include "cartiretable.h"
 #include "fastmath.h"
+#include "thread_pool.h"
+#include "unittest.h"
+#include <algorithm>
 #include <cassert>
+#include <random>
 
 static const btScalar deg2rad = M_PI / 180;
 static const btScalar rad2deg = 180 / M_PI;
 
+// table axes: load in kN, slip ratio, slip angle and camber in deg
+// slip axes are compressed by u = x / (|x| + k) to place most samples around the force peak
+// inputs outside of the table domain are evaluated by the pacejka formulas
+static const btScalar table_slip_k = 0.1;
+static const btScalar table_slip_max = 1;
+static const btScalar table_angle_k = 5;
+static const btScalar table_angle_max = 90;
+static const btScalar table_camber_max = 15;
+static const int table_load_size = 33;
+static const int table_slip_size = 65;
+static const int table_camber_size = 11;
+
+static inline btScalar ToTableAxis(btScalar x, btScalar k)
+{
+	return x / (std::abs(x) + k);
+}
+
+static inline btScalar FromTableAxis(btScalar u, btScalar k)
+{
+	return k * u / (1 - std::abs(u));
+}
+
+struct CarTire1::Tables
+{
+	CarTireTable fx;
+	CarTireTable fy;
+	CarTireTable mz;
+	btScalar max_load;
+
+	bool contains(btScalar Fz, btScalar sigma, btScalar gamma) const
+	{
+		return Fz <= max_load && std::abs(sigma) <= table_slip_max && std::abs(gamma) <= table_camber_max;
+	}
+};
+
 template <class T, int N>
 constexpr int size(const T (&array)[N])
 {
@@ -70,10 +110,21 @@ void CarTire1::ComputeState(
 	btScalar gamma = s.camber * rad2deg;
 
 	// pure slip
-	btScalar camber_alpha;
-	btScalar Fx0 = PacejkaFx(sigma, Fz, s.friction);
-	btScalar Fy0 = PacejkaFy(alpha, Fz, gamma, s.friction, camber_alpha);
-	//btScalar Mz = PacejkaMz(alpha, Fz, gamma, s.friction);
+	btScalar camber_alpha, Fx0, Fy0;
+	if (tables && tables->contains(Fz, sigma, gamma))
+	{
+		btScalar u = ToTableAxis(sigma, table_slip_k);
+		btScalar v = ToTableAxis(alpha, table_angle_k);
+		Fx0 = tables->fx.get(Fz, u) * s.friction;
+		Fy0 = tables->fy.get(Fz, v, gamma) * s.friction;
+		camber_alpha = PacejkaCamberAlpha(Fz, gamma, s.friction);
+	}
+	else
+	{
+		Fx0 = PacejkaFx(sigma, Fz, s.friction);
+		Fy0 = PacejkaFy(alpha, Fz, gamma, s.friction, camber_alpha);
+		//btScalar Mz = PacejkaMz(alpha, Fz, gamma, s.friction);
+	}
 
 	// combined slip
 	btScalar Gx = PacejkaGx(slip, slip_angle);
@@ -101,7 +152,11 @@ void CarTire1::ComputeAligningTorque(
 	btScalar Fz = Min(normal_force * btScalar(1E-3), btScalar(30));
 	btScalar alpha = s.slip_angle * rad2deg;
 	btScalar gamma = s.camber * rad2deg;
-	btScalar Mz = PacejkaMz(alpha, Fz, gamma, s.friction);
+	btScalar Mz;
+	if (tables && tables->contains(Fz, 0, gamma))
+		Mz = tables->mz.get(Fz, ToTableAxis(alpha, table_angle_k), gamma) * s.friction;
+	else
+		Mz = PacejkaMz(alpha, Fz, gamma, s.friction);
 	s.mz = Mz;
 }
 
@@ -283,6 +338,15 @@ btScalar CarTire1::PacejkaMz(btScalar alpha, btScalar Fz, btScalar gamma, btScal
 	return Mz;
 }
 
+btScalar CarTire1::PacejkaCamberAlpha(btScalar Fz, btScalar gamma, btScalar friction_coeff) const
+{
+	auto & a = lateral;
+	btScalar BCD = a[3] * Sin2Atan(Fz, a[4]) * (1 - a[5] * std::abs(gamma));
+	btScalar Sh = a[8] * gamma + a[9] * Fz + a[10];
+	btScalar Sv = ((a[11] * Fz + a[12]) * gamma + a[13]) * Fz + a[14];
+	return Sh + Sv / BCD * friction_coeff;
+}
+
 btScalar CarTire1::PacejkaGx(btScalar sigma, btScalar alpha) const
 {
 	auto & p = combining;
@@ -360,3 +424,187 @@ void CarTire1::initSlipLUT(CarTireSlipLUT & t) const
 		findIdealSlip(load, t.ideal_slip_lut[i]);
 	}
 }
+
+void CarTire1::initTables(btScalar max_load, ThreadPool & pool)
+{
+	auto t = std::make_shared<Tables>();
+	t->max_load = Min(max_load * btScalar(1E-3), btScalar(30));
+	btScalar umax = ToTableAxis(table_slip_max, table_slip_k);
+	btScalar vmax = ToTableAxis(table_angle_max, table_angle_k);
+	CarTireTable::Axis load_axis(0, t->max_load, table_load_size);
+	CarTireTable::Axis slip_axis(-umax, umax, table_slip_size);
+	CarTireTable::Axis angle_axis(-vmax, vmax, table_slip_size);
+	CarTireTable::Axis camber_axis(-table_camber_max, table_camber_max, table_camber_size);
+	t->fx.init(load_axis, slip_axis);
+	t->fy.init(load_axis, angle_axis, camber_axis);
+	t->mz.init(load_axis, angle_axis, camber_axis);
+
+	// one load row per job, rows are written to disjoint samples
+	Tables & tr = *t;
+	pool.ParallelFor(load_axis.size, [this, &tr](unsigned i)
+	{
+		// formulas are singular at zero load, forces vanish there
+		btScalar Fz = Max(tr.fx.axis(0).get(i), btScalar(1E-3));
+		for (int j = 0; j < tr.fx.size(1); ++j)
+		{
+			btScalar sigma = FromTableAxis(tr.fx.axis(1).get(j), table_slip_k);
+			tr.fx.at(i, j) = PacejkaFx(sigma, Fz, 1);
+		}
+		for (int j = 0; j < tr.fy.size(1); ++j)
+		{
+			btScalar alpha = FromTableAxis(tr.fy.axis(1).get(j), table_angle_k);
+			for (int k = 0; k < tr.fy.size(2); ++k)
+			{
+				btScalar gamma = tr.fy.axis(2).get(k);
+				btScalar camber_alpha;
+				tr.fy.at(i, j, k) = PacejkaFy(alpha, Fz, gamma, 1, camber_alpha);
+				tr.mz.at(i, j, k) = PacejkaMz(alpha, Fz, gamma, 1);
+			}
+		}
+	});
+
+	tables = t;
+}
+
+bool CarTire1::shareTables(const CarTire1 & other, btScalar max_load)
+{
+	if (!other.tables || other.tables->max_load != Min(max_load * btScalar(1E-3), btScalar(30)))
+		return false;
+
+	if (!std::equal(longitudinal, longitudinal + size(longitudinal), other.longitudinal) ||
+		!std::equal(lateral, lateral + size(lateral), other.lateral) ||
+		!std::equal(aligning, aligning + size(aligning), other.aligning))
+		return false;
+
+	tables = other.tables;
+	return true;
+}
+
+void CarTire1::clearTables()
+{
+	tables.reset();
+}
+
+unsigned CarTire1::getTableBytes() const
+{
+	if (!tables)
+		return 0;
+	return tables->fx.bytes() + tables->fy.bytes() + tables->mz.bytes();
+}
+
+void CarTire1::validateTables(int sample_count, CarTireTableError error[3]) const
+{
+	for (int n = 0; n < 3; ++n)
+		error[n] = CarTireTableError();
+
+	if (!tables || sample_count <= 0)
+		return;
+
+	// uniform over the table domain, in compressed slip coordinates
+	// the fixed seed keeps reports comparable between runs
+	std::minstd_rand rng(1);
+	auto uniform = [&rng](const CarTireTable::Axis & a)
+	{
+		return a.min + (a.max - a.min) * std::uniform_real_distribution<btScalar>()(rng);
+	};
+
+	btScalar sum[3] = {0, 0, 0};
+	for (int n = 0; n < sample_count; ++n)
+	{
+		btScalar Fz = Max(uniform(tables->fy.axis(0)), btScalar(1E-3));
+		btScalar u = uniform(tables->fx.axis(1));
+		btScalar v = uniform(tables->fy.axis(1));
+		btScalar gamma = uniform(tables->fy.axis(2));
+		btScalar sigma = FromTableAxis(u, table_slip_k);
+		btScalar alpha = FromTableAxis(v, table_angle_k);
+
+		btScalar camber_alpha;
+		btScalar analytic[3] = {
+			PacejkaFx(sigma, Fz, 1),
+			PacejkaFy(alpha, Fz, gamma, 1, camber_alpha),
+			PacejkaMz(alpha, Fz, gamma, 1)};
+		btScalar table[3] = {
+			tables->fx.get(Fz, u),
+			tables->fy.get(Fz, v, gamma),
+			tables->mz.get(Fz, v, gamma)};
+
+		for (int i = 0; i < 3; ++i)
+		{
+			btScalar e = std::abs(table[i] - analytic[i]);
+			error[i].max = Max(error[i].max, e);
+			error[i].peak = Max(error[i].peak, std::abs(analytic[i]));
+			sum[i] += e;
+		}
+	}
+
+	for (int i = 0; i < 3; ++i)
+		error[i].mean = sum[i] / sample_count;
+}
+
+QT_TEST(cartire1_table_test)
+{
+	// asphalt road tire coefficients
+	CarTire1 tire;
+	const btScalar lateral[15] = {1.407, -0, 1659.66, 215.038, 6.9853, 0.013, 0.0312359, -0.0526128,
+		-0.03, -0.006, -0.032, 0, 0, 0, 0};
+	const btScalar longitudinal[11] = {1.41743, 0, 2056.68, 250.996, 229, 0.569282, 0, 0, 0.00705444, 0, 0};
+	const btScalar aligning[18] = {2.07, -6.49, -21.9, -0.416, -21.3, 0.029, 0, -1.2, 5.23, -14.8, 0,
+		0, -0.0035, 0.038, 0, 0, 0.63, 1.69};
+	const btScalar combining[4] = {11.14388, 10.14162, 44.8565, 42.43545};
+	std::copy(lateral, lateral + 15, tire.lateral);
+	std::copy(longitudinal, longitudinal + 11, tire.longitudinal);
+	std::copy(aligning, aligning + 18, tire.aligning);
+	std::copy(combining, combining + 4, tire.combining);
+
+	ThreadPool pool(2);
+	const btScalar max_load = 8000;
+	tire.initTables(max_load, pool);
+	QT_CHECK(tire.hasTables());
+
+	// pure slip interpolation error relative to the peak values
+	CarTireTableError error[3];
+	tire.validateTables(10000, error);
+	const btScalar max_error[3] = {0.01, 0.01, 0.02};
+	const btScalar mean_error[3] = {0.001, 0.001, 0.002};
+	for (int n = 0; n < 3; ++n)
+	{
+		QT_CHECK(error[n].peak > 0);
+		QT_CHECK(error[n].max < max_error[n] * error[n].peak);
+		QT_CHECK(error[n].mean < mean_error[n] * error[n].peak);
+	}
+
+	// combined slip forces through the tire interface, inside and outside of the table domain
+	CarTire1 analytic = tire;
+	analytic.clearTables();
+	std::minstd_rand rng(2);
+	std::uniform_real_distribution<btScalar> uniform(-1, 1);
+	btScalar peak = 0, max_diff = 0;
+	for (int n = 0; n < 1000; ++n)
+	{
+		const btScalar load = (uniform(rng) + 1) * max_load * btScalar(0.6);
+		const btScalar lon_velocity = 5 + 25 * (uniform(rng) + 1);
+		const btScalar rot_velocity = lon_velocity * (1 + btScalar(0.3) * uniform(rng));
+		const btScalar lat_velocity = lon_velocity * btScalar(0.3) * uniform(rng);
+
+		CarTireState s0, s1;
+		s0.friction = s1.friction = 1;
+		s0.camber = s1.camber = btScalar(0.1) * uniform(rng);
+		tire.ComputeState(load, rot_velocity, lon_velocity, lat_velocity, s0);
+		tire.ComputeAligningTorque(load, s0);
+		analytic.ComputeState(load, rot_velocity, lon_velocity, lat_velocity, s1);
+		analytic.ComputeAligningTorque(load, s1);
+
+		peak = Max(peak, Max(std::abs(s1.fx), std::abs(s1.fy)));
+		max_diff = Max(max_diff, Max(std::abs(s0.fx - s1.fx), std::abs(s0.fy - s1.fy)));
+	}
+	QT_CHECK(max_diff < btScalar(0.01) * peak);
+
+	// identical tires share the tables
+	CarTire1 other = analytic;
+	QT_CHECK(other.shareTables(tire, max_load));
+	QT_CHECK(other.hasTables());
+	QT_CHECK(!analytic.shareTables(tire, max_load * 2));
+	analytic.longitudinal[2] *= btScalar(1.1);
+	QT_CHECK(!analytic.shareTables(tire, max_load));
+	QT_CHECK(!analytic.hasTables());
+}
@@ -22,8 +22,12 @@
 
 #include "LinearMath/btScalar.h"
 
+#include <memory>
+
+class ThreadPool;
 struct CarTireState;
 struct CarTireSlipLUT;
+struct CarTireTableError;
 
 class CarTire1
 {
@@ -72,6 +76,30 @@ public:
 	/// init peak force slip lut
 	void initSlipLUT(CarTireSlipLUT & t) const;
 
+	/// bake pure slip fx(load, slip), fy(load, slip angle, camber) and mz(load, slip angle, camber)
+	/// into lookup tables, used by ComputeState and ComputeAligningTorque instead of the pacejka formulas
+	/// tables cover loads up to max_load in N, slip ratios up to 1 and camber up to 15 deg,
+	/// inputs outside of this domain use the formulas
+	/// tables are shared by copies of the tire, coefficient changes require a rebuild
+	void initTables(btScalar max_load, ThreadPool & pool);
+
+	/// use the tables of other tire if they cover max_load and its coefficients are identical
+	/// returns false without changes otherwise
+	bool shareTables(const CarTire1 & other, btScalar max_load);
+
+	/// drop lookup tables, use the pacejka formulas
+	void clearTables();
+
+	bool hasTables() const { return bool(tables); }
+
+	/// table memory in bytes
+	unsigned getTableBytes() const;
+
+	/// compare tables against the pacejka formulas at sample_count points spread over the table domain
+	/// combining factors are not tabulated, pure slip errors bound the combined slip errors
+	/// error: fx, fy, mz
+	void validateTables(int sample_count, CarTireTableError error[3]) const;
+
 	CarTire1();
 
 private:
@@ -84,6 +112,9 @@ private:
 	/// pacejka magic formula for aligning torque
 	btScalar PacejkaMz(btScalar alpha, btScalar Fz, btScalar gamma, btScalar friction_coeff) const;
 
+	/// horizontal shift of the lateral force due to camber and vertical shift, in deg
+	btScalar PacejkaCamberAlpha(btScalar Fz, btScalar gamma, btScalar friction_coeff) const;
+
 	/// pacejka magic formula for the longitudinal combining factor
 	btScalar PacejkaGx(btScalar sigma, btScalar alpha) const;
 
@@ -92,6 +123,9 @@ private:
 
 	void findIdealSlip(btScalar load, btScalar output_slip[2], int iterations = 200) const;
 
+	struct Tables;
+	std::shared_ptr<const Tables> tables;
+
 public:
 	btScalar longitudinal[11]; ///< the parameters of the longitudinal pacejka equation.  this is series b
 	btScalar lateral[15]; ///< the parameters of the lateral pacejka equation.  this is series a
@@ -0,0 +1,99 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "cartiretable.h"
+#include "minmax.h"
+#include "unittest.h"
+
+void CarTireTable::init(const Axis & x, const Axis & y, const Axis & z)
+{
+	axes[0] = x;
+	axes[1] = y;
+	axes[2] = z;
+	for (int n = 0; n < 3; ++n)
+	{
+		const Axis & a = axes[n];
+		scale[n] = (a.size > 1 && a.max > a.min) ? (a.size - 1) / (a.max - a.min) : 0;
+	}
+	samples.clear();
+	samples.resize(x.size * y.size * z.size, 0);
+}
+
+btScalar CarTireTable::get(btScalar x, btScalar y, btScalar z) const
+{
+	btAssert(!samples.empty());
+
+	const btScalar arg[3] = {x, y, z};
+	int index[3];
+	btScalar blend[3];
+	for (int n = 0; n < 3; ++n)
+	{
+		const Axis & a = axes[n];
+		btScalar u = Clamp((arg[n] - a.min) * scale[n], btScalar(0), btScalar(a.size - 1));
+		int i = Min(int(u), Max(a.size - 2, 0));
+		index[n] = i;
+		blend[n] = u - i;
+	}
+
+	// strides are zero along axes with a single sample
+	const int sz = axes[2].size > 1 ? 1 : 0;
+	const int sy = axes[1].size > 1 ? axes[2].size : 0;
+	const int sx = axes[0].size > 1 ? axes[1].size * axes[2].size : 0;
+	const btScalar * s = &samples[(index[0] * axes[1].size + index[1]) * axes[2].size + index[2]];
+
+	btScalar s00 = s[0] + (s[sz] - s[0]) * blend[2];
+	btScalar s01 = s[sy] + (s[sy + sz] - s[sy]) * blend[2];
+	btScalar s10 = s[sx] + (s[sx + sz] - s[sx]) * blend[2];
+	btScalar s11 = s[sx + sy] + (s[sx + sy + sz] - s[sx + sy]) * blend[2];
+	btScalar s0 = s00 + (s01 - s00) * blend[1];
+	btScalar s1 = s10 + (s11 - s10) * blend[1];
+	return s0 + (s1 - s0) * blend[0];
+}
+
+QT_TEST(cartiretable_test)
+{
+	// multilinear functions are interpolated exactly
+	auto f = [](btScalar x, btScalar y, btScalar z)
+	{
+		return 1 + 2 * x - 3 * y + z + x * y - 2 * y * z + x * y * z;
+	};
+	CarTireTable table;
+	QT_CHECK(table.empty());
+	table.init(CarTireTable::Axis(-1, 1, 5), CarTireTable::Axis(0, 2, 3), CarTireTable::Axis(-2, 2, 9));
+	QT_CHECK(!table.empty());
+	for (int i = 0; i < table.size(0); ++i)
+		for (int j = 0; j < table.size(1); ++j)
+			for (int k = 0; k < table.size(2); ++k)
+				table.at(i, j, k) = f(table.axis(0).get(i), table.axis(1).get(j), table.axis(2).get(k));
+
+	const btScalar args[][3] = {{-1, 0, -2}, {1, 2, 2}, {0.3, 1.7, -0.4}, {-0.85, 0.1, 1.95}, {0.5, 1, 0}};
+	for (const auto & a : args)
+		QT_CHECK_CLOSE(table.get(a[0], a[1], a[2]), f(a[0], a[1], a[2]), 1E-4);
+
+	// arguments are clamped to the axis range
+	QT_CHECK_CLOSE(table.get(-3, 5, 0.5), f(-1, 2, 0.5), 1E-4);
+
+	// single sample axes are constant
+	CarTireTable line;
+	line.init(CarTireTable::Axis(0, 10, 11));
+	for (int i = 0; i < line.size(0); ++i)
+		line.at(i) = i * i;
+	QT_CHECK_CLOSE(line.get(2.5, 7, -3), 6.5, 1E-5);
+	QT_CHECK_EQUAL(line.bytes(), 11 * sizeof(btScalar));
+}
@@ -0,0 +1,86 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _CARTIRETABLE_H
+#define _CARTIRETABLE_H
+
+#include "LinearMath/btScalar.h"
+
+#include <vector>
+
+/// Samples of a function over a regular grid of up to three dimensions,
+/// evaluated by multilinear interpolation. Unused axes have a single sample.
+/// Arguments outside of the axis range are clamped.
+class CarTireTable
+{
+public:
+	struct Axis
+	{
+		btScalar min = 0;
+		btScalar max = 0;
+		int size = 1;
+
+		Axis() {}
+
+		Axis(btScalar min, btScalar max, int size) : min(min), max(max), size(size) {}
+
+		/// argument at sample i
+		btScalar get(int i) const
+		{
+			return size > 1 ? min + (max - min) * i / (size - 1) : min;
+		}
+	};
+
+	/// allocate table, samples are zero initialized
+	void init(const Axis & x, const Axis & y = Axis(), const Axis & z = Axis());
+
+	/// number of samples along axis (0 - 2)
+	int size(int axis) const { return axes[axis].size; }
+
+	const Axis & axis(int axis) const { return axes[axis]; }
+
+	/// sample at grid point i, j, k
+	btScalar & at(int i, int j = 0, int k = 0)
+	{
+		return samples[(i * axes[1].size + j) * axes[2].size + k];
+	}
+
+	/// interpolated value at x, y, z
+	btScalar get(btScalar x, btScalar y = 0, btScalar z = 0) const;
+
+	bool empty() const { return samples.empty(); }
+
+	/// sample memory in bytes
+	unsigned bytes() const { return samples.size() * sizeof(btScalar); }
+
+private:
+	Axis axes[3];
+	btScalar scale[3];
+	std::vector<btScalar> samples;
+};
+
+/// table error against the analytic function
+struct CarTireTableError
+{
+	btScalar max = 0; ///< max absolute error
+	btScalar mean = 0; ///< mean absolute error
+	btScalar peak = 0; ///< max absolute analytic value, reference for the errors
+};
+
+#endif
@@ -97,7 +97,8 @@ DynamicsWorld::DynamicsWorld(
 	btDiscreteDynamicsWorld(dispatcher, broadphase, constraintSolver, collisionConfig),
 	track(0),
 	timeStep(timeStep),
-	maxSubSteps(maxSubSteps)
+	maxSubSteps(maxSubSteps),
+	restoreCount(0)
 {
 	setGravity(btVector3(0.0, 0.0, -9.81));
 	setForceUpdateAllAabbs(false);
@@ -113,6 +114,41 @@ const RoadPatch * DynamicsWorld::GetSectorPatch(int i)
 	return track->GetSectorPatch(i);
 }
 
+const RoadPatch * DynamicsWorld::GetNearestPatch(const btVector3 & position) const
+{
+	return track->GetNearestPatch(ToMathVector<float>(position));
+}
+
+int DynamicsWorld::GetPatchId(const RoadPatch * patch) const
+{
+	if (!track)
+		return -1;
+
+	int id = 0;
+	for (const auto & road : track->GetRoadList())
+	{
+		const auto & patches = road.GetPatches();
+		if (!patches.empty() && patch >= &patches.front() && patch <= &patches.back())
+			return id + int(patch - &patches.front());
+		id += patches.size();
+	}
+	return -1;
+}
+
+const RoadPatch * DynamicsWorld::GetPatch(int id) const
+{
+	if (id < 0 || !track)
+		return 0;
+	for (const auto & road : track->GetRoadList())
+	{
+		const auto & patches = road.GetPatches();
+		if (id < int(patches.size()))
+			return &patches[id];
+		id -= patches.size();
+	}
+	return 0;
+}
+
 bool DynamicsWorld::castRay(
 	const btVector3 & origin,
 	const btVector3 & direction,
@@ -189,6 +225,73 @@ void DynamicsWorld::update(btScalar dt)
 	//CProfileManager::dumpAll();
 }
 
+void DynamicsWorld::getActivationStats(int & active, int & sleeping) const
+{
+	active = 0;
+	sleeping = 0;
+	for (int i = 0; i < m_nonStaticRigidBodies.size(); ++i)
+	{
+		if (m_nonStaticRigidBodies[i]->isActive())
+			active++;
+		else
+			sleeping++;
+	}
+}
+
+void DynamicsWorld::saveBodyStates(btAlignedObjectArray<BodyState> & states) const
+{
+	states.resize(m_nonStaticRigidBodies.size());
+	for (int i = 0; i < m_nonStaticRigidBodies.size(); ++i)
+	{
+		const btRigidBody * body = m_nonStaticRigidBodies[i];
+		BodyState & state = states[i];
+		state.body = body;
+		state.transform = body->getCenterOfMassTransform();
+		state.linear_velocity = body->getLinearVelocity();
+		state.angular_velocity = body->getAngularVelocity();
+		state.deactivation_time = body->getDeactivationTime();
+		state.activation_state = body->getActivationState();
+	}
+}
+
+bool DynamicsWorld::restoreBodyStates(const btAlignedObjectArray<BodyState> & states)
+{
+	if (states.size() != m_nonStaticRigidBodies.size())
+		return false;
+
+	for (int i = 0; i < states.size(); ++i)
+	{
+		if (states[i].body != m_nonStaticRigidBodies[i])
+			return false;
+	}
+
+	for (int i = 0; i < states.size(); ++i)
+	{
+		btRigidBody * body = m_nonStaticRigidBodies[i];
+		const BodyState & state = states[i];
+		body->setCenterOfMassTransform(state.transform);
+		body->setInterpolationWorldTransform(body->getWorldTransform());
+		body->setLinearVelocity(state.linear_velocity);
+		body->setAngularVelocity(state.angular_velocity);
+		body->setInterpolationLinearVelocity(state.linear_velocity);
+		body->setInterpolationAngularVelocity(state.angular_velocity);
+		body->clearForces();
+		body->forceActivationState(state.activation_state);
+		body->setDeactivationTime(state.deactivation_time);
+
+		// sleeping bodies are skipped by aabb and motion state updates
+		updateSingleAabb(body);
+		if (body->getMotionState())
+			body->getMotionState()->setWorldTransform(body->getWorldTransform());
+
+		// cached contact points and impulses belong to the replaced state
+		getBroadphase()->getOverlappingPairCache()->cleanProxyFromPairs(body->getBroadphaseHandle(), getDispatcher());
+	}
+	restoreCount++;
+
+	return true;
+}
+
 void DynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 {
 	// todo: after fracture we should run the solver again for better realism
@@ -223,8 +326,10 @@ void DynamicsWorld::reset(const Track & t)
 void DynamicsWorld::reset()
 {
 	getBroadphase()->resetPool(getDispatcher());
+	getConstraintSolver()->reset();
 	m_nonStaticRigidBodies.resize(0);
 	m_collisionObjects.resize(0);
+	m_localTime = 0;
 	track = 0;
 }
 
@@ -50,6 +50,15 @@ public:
 
 	const RoadPatch * GetSectorPatch(int i);
 
+	// road patch nearest to position in the ground plane, null if the track has no roads
+	const RoadPatch * GetNearestPatch(const btVector3 & position) const;
+
+	// road patch index over all track roads, -1 if patch is not part of the track
+	int GetPatchId(const RoadPatch * patch) const;
+
+	// road patch by index, null if out of range
+	const RoadPatch * GetPatch(int id) const;
+
 	// cast ray into collision world, returns first hit, caster is excluded fom hits
 	bool castRay(
 		const btVector3 & position,
@@ -60,6 +69,35 @@ public:
 
 	btScalar getTimeStep() const { return timeStep; };
 
+	// count awake and sleeping non static rigid bodies
+	void getActivationStats(int & active, int & sleeping) const;
+
+	// rigid body state stored in simulation snapshots
+	struct BodyState
+	{
+		const btRigidBody * body;
+		btTransform transform;
+		btVector3 linear_velocity;
+		btVector3 angular_velocity;
+		btScalar deactivation_time;
+		int activation_state;
+	};
+
+	// store state of all non static rigid bodies, reuses states memory
+	void saveBodyStates(btAlignedObjectArray<BodyState> & states) const;
+
+	// restore body states, fails without changes if bodies were added or removed since save
+	// contacts of restored bodies are dropped, they restart without warm starting impulses
+	bool restoreBodyStates(const btAlignedObjectArray<BodyState> & states);
+
+	// number of successful body state restores, lets users of motion states
+	// detect that sleeping bodies have been moved
+	unsigned getRestoreCount() const { return restoreCount; }
+
+	// time accumulated towards the next fixed step
+	btScalar getLocalTime() const { return m_localTime; }
+	void setLocalTime(btScalar value) { m_localTime = value; }
+
 	void update(btScalar dt);
 
 	void draw();
@@ -76,6 +114,7 @@ protected:
 	const Track * track;
 	btScalar timeStep;
 	int maxSubSteps;
+	unsigned restoreCount;
 
 	void reset();
 
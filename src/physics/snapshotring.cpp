@@ -0,0 +1,258 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "snapshotring.h"
+#include "cardynamics.h"
+#include "carinput.h"
+#include "tracksurface.h"
+#include "content/contentmanager.h"
+#include "cfg/ptree.h"
+#include "joeserialize.h"
+#include "unittest.h"
+
+#include "BulletCollision/CollisionDispatch/btDefaultCollisionConfiguration.h"
+#include "BulletCollision/BroadphaseCollision/btDbvtBroadphase.h"
+#include "BulletCollision/CollisionShapes/btBoxShape.h"
+#include "BulletCollision/CollisionShapes/btStaticPlaneShape.h"
+#include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h"
+
+#include <cassert>
+#include <sstream>
+
+SnapshotRing::SnapshotRing() :
+	count(0),
+	next(0)
+{
+	// ctor
+}
+
+void SnapshotRing::Init(unsigned slot_count)
+{
+	slots.clear();
+	slots.resize(slot_count);
+	count = 0;
+	next = 0;
+}
+
+void SnapshotRing::Clear()
+{
+	count = 0;
+	next = 0;
+}
+
+void SnapshotRing::Save(unsigned tick, CarDynamics cars[], int car_count, const DynamicsWorld & world)
+{
+	if (slots.empty())
+		return;
+
+	Snapshot & s = slots[next];
+	s.tick = tick;
+	SaveState(s, cars, car_count, world);
+
+	next = (next + 1) % slots.size();
+	if (count < slots.size())
+		count++;
+}
+
+bool SnapshotRing::Restore(unsigned tick, CarDynamics cars[], int car_count, DynamicsWorld & world)
+{
+	const Snapshot * s = Find(tick);
+	if (!s || s->car_count != car_count)
+		return false;
+
+	if (!world.restoreBodyStates(s->bodies))
+		return false;
+
+	// car state written by Save for the same cars and track always reads back
+	const bool restored = RestoreCars(*s, cars, car_count);
+	assert(restored);
+	world.setLocalTime(s->local_time);
+	return restored;
+}
+
+bool SnapshotRing::GetRange(unsigned & oldest, unsigned & newest) const
+{
+	if (count == 0)
+		return false;
+
+	const unsigned n = slots.size();
+	oldest = slots[(next + n - count) % n].tick;
+	newest = slots[(next + n - 1) % n].tick;
+	return true;
+}
+
+void SnapshotRing::SaveState(Snapshot & s, CarDynamics cars[], int car_count, const DynamicsWorld & world)
+{
+	s.car_count = car_count;
+	s.local_time = world.getLocalTime();
+	s.cars.clear();
+	joeserialize::MemoryOutputSerializer out(s.cars);
+	for (int i = 0; i < car_count; ++i)
+		cars[i].SerializeSnapshot(out);
+	world.saveBodyStates(s.bodies);
+}
+
+bool SnapshotRing::RestoreCars(const Snapshot & s, CarDynamics cars[], int car_count)
+{
+	joeserialize::MemoryInputSerializer in(s.cars.data(), s.cars.size());
+	for (int i = 0; i < car_count; ++i)
+	{
+		if (!cars[i].SerializeSnapshot(in))
+			return false;
+	}
+	return in.GetPosition() == s.cars.size();
+}
+
+const SnapshotRing::Snapshot * SnapshotRing::Find(unsigned tick) const
+{
+	const unsigned n = slots.size();
+	for (unsigned i = 0; i < count; ++i)
+	{
+		const Snapshot & s = slots[(next + n - 1 - i) % n];
+		if (s.tick == tick)
+			return &s;
+	}
+	return 0;
+}
+
+// drive the car for ticks with changing inputs, push the box half way, return car state hash
+static uint64_t SnapshotRingTestRun(CarDynamics & car, btRigidBody & box, DynamicsWorld & world, int ticks)
+{
+	std::vector<float> inputs(CarInput::INVALID, 0.0f);
+	for (int i = 0; i < ticks; ++i)
+	{
+		inputs[CarInput::THROTTLE] = (i % 20 < 15) ? 1.0f : 0.0f;
+		inputs[CarInput::STEER_LEFT] = (i > ticks / 2) ? 0.5f : 0.0f;
+		if (i == ticks / 2)
+		{
+			box.activate();
+			box.setLinearVelocity(btVector3(0, 2, 0));
+		}
+		car.Update(inputs);
+		world.update(world.getTimeStep());
+	}
+	joeserialize::HashSerializer hash;
+	car.SerializeSnapshot(hash);
+	return hash.GetHash();
+}
+
+QT_TEST(snapshotring_test)
+{
+	const btScalar dt = 1 / 90.0;
+	btDefaultCollisionConfiguration config;
+	btCollisionDispatcher dispatcher(&config);
+	btDbvtBroadphase broadphase;
+	btSequentialImpulseConstraintSolver solver;
+	DynamicsWorld world(&dispatcher, &broadphase, &solver, &config, dt);
+
+	// flat asphalt ground
+	TrackSurface surface;
+	surface.type = TrackSurface::ASPHALT;
+	surface.bumpWaveLength = 1;
+	surface.bumpAmplitude = 0;
+	surface.frictionNonTread = 1;
+	surface.frictionTread = 1;
+	surface.rollResistanceCoefficient = 1;
+	surface.rollingDrag = 0;
+	btStaticPlaneShape plane(btVector3(0, 0, 1), 0);
+	plane.setUserPointer(&surface);
+	btCollisionObject ground;
+	ground.setCollisionShape(&plane);
+	ground.setActivationState(DISABLE_SIMULATION);
+	ground.setUserPointer(&surface);
+	world.addCollisionObject(&ground);
+
+	// sleeping track object next to the car
+	btBoxShape box_shape(btVector3(0.5, 0.5, 0.5));
+	btVector3 box_inertia(0, 0, 0);
+	box_shape.calculateLocalInertia(10, box_inertia);
+	btRigidBody box(10, 0, &box_shape, box_inertia);
+	box.setCenterOfMassTransform(btTransform(btQuaternion::getIdentity(), btVector3(20, 0, 0.5)));
+	box.setActivationState(ISLAND_SLEEPING);
+	world.addRigidBody(&box);
+
+	std::ostringstream error;
+	ContentManager content(error);
+	content.getFactory<PTree>().init(read_ini, write_ini, content);
+	content.addPath("data");
+	content.addSharedPath("data/carparts");
+	std::shared_ptr<PTree> cfg;
+	CarDynamics cars[1];
+	const btVector3 position(0, 0, 0.5);
+	const bool loaded = content.load(cfg, "cars/3S", "3S.car") &&
+		cars[0].Load(*cfg, "cars/3S", "", position, btQuaternion::getIdentity(), false, world, content, error);
+	QT_CHECK(loaded);
+	if (!loaded)
+	{
+		world.removeRigidBody(&box);
+		world.removeCollisionObject(&ground);
+		return;
+	}
+	cars[0].SetAutoClutch(true);
+	cars[0].SetAutoShift(true);
+
+	// settle on the suspension
+	std::vector<float> inputs(CarInput::INVALID, 0.0f);
+	for (int i = 0; i < 30; ++i)
+	{
+		cars[0].Update(inputs);
+		world.update(dt);
+	}
+
+	SnapshotRing ring;
+	ring.Init(2);
+	unsigned oldest = 0, newest = 0;
+	QT_CHECK(!ring.GetRange(oldest, newest));
+	ring.Save(30, cars, 1, world);
+	QT_CHECK(ring.GetRange(oldest, newest));
+	QT_CHECK_EQUAL(newest, 30u);
+
+	const btTransform box_transform = box.getCenterOfMassTransform();
+	const uint64_t hash0 = SnapshotRingTestRun(cars[0], box, world, 120);
+	QT_CHECK(box.getCenterOfMassPosition() != box_transform.getOrigin());
+
+	// restore puts the box back to sleep and replays to the same car state,
+	// the car touches the ground through wheel ray casts only, the box rests
+	// on the ground and loses its contacts, its run after the restore differs
+	QT_CHECK(ring.Restore(30, cars, 1, world));
+	QT_CHECK(!box.isActive());
+	QT_CHECK(box.getCenterOfMassPosition() == box_transform.getOrigin());
+	const uint64_t hash1 = SnapshotRingTestRun(cars[0], box, world, 120);
+	QT_CHECK_EQUAL(hash0, hash1);
+
+	// unknown ticks and mismatching car counts fail without changes
+	joeserialize::HashSerializer before;
+	cars[0].SerializeSnapshot(before);
+	QT_CHECK(!ring.Restore(31, cars, 1, world));
+	QT_CHECK(!ring.Restore(30, cars, 0, world));
+	joeserialize::HashSerializer after;
+	cars[0].SerializeSnapshot(after);
+	QT_CHECK_EQUAL(before.GetHash(), after.GetHash());
+
+	// the ring replaces the oldest snapshot
+	ring.Save(31, cars, 1, world);
+	ring.Save(32, cars, 1, world);
+	QT_CHECK(ring.GetRange(oldest, newest));
+	QT_CHECK_EQUAL(oldest, 31u);
+	QT_CHECK_EQUAL(newest, 32u);
+	QT_CHECK(!ring.Restore(30, cars, 1, world));
+
+	world.removeRigidBody(&box);
+	world.removeCollisionObject(&ground);
+}
@@ -0,0 +1,82 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _SNAPSHOTRING_H
+#define _SNAPSHOTRING_H
+
+#include "dynamicsworld.h"
+
+#include <vector>
+
+class CarDynamics;
+
+// Ring of in-memory simulation snapshots for rewinding.
+// A snapshot holds the serialized state of all cars and the state of all
+// non static rigid bodies in the world (cars, dynamic track objects and
+// separated car parts). Snapshot buffers are reused, once the ring has been
+// filled saving does not allocate.
+// Bullet contact caches are not part of a snapshot, restoring drops them.
+// Simulating on from a restored snapshot reproduces the original run only
+// as long as no restored body is in contact with another body, car wheels
+// use ray casts and are exact. Not suited for rollback of networked play.
+class SnapshotRing
+{
+public:
+	SnapshotRing();
+
+	// allocate count snapshot slots, drops stored snapshots
+	void Init(unsigned count);
+
+	// drop stored snapshots, keeps slot memory
+	void Clear();
+
+	// store state for tick, replaces the oldest snapshot if the ring is full
+	void Save(unsigned tick, CarDynamics cars[], int car_count, const DynamicsWorld & world);
+
+	// restore state stored for tick, fails without changes if the tick is
+	// not in the ring or cars or bodies were added or removed since,
+	// snapshots are only valid for the world and cars they were saved from,
+	// clear the ring when loading other cars or another track
+	bool Restore(unsigned tick, CarDynamics cars[], int car_count, DynamicsWorld & world);
+
+	// oldest and newest stored tick, false if the ring is empty
+	bool GetRange(unsigned & oldest, unsigned & newest) const;
+
+private:
+	struct Snapshot
+	{
+		unsigned tick;
+		int car_count;
+		btScalar local_time;
+		std::vector<unsigned char> cars;
+		btAlignedObjectArray<DynamicsWorld::BodyState> bodies;
+	};
+
+	std::vector<Snapshot> slots;
+	unsigned count; // number of stored snapshots
+	unsigned next; // slot to be written next
+
+	const Snapshot * Find(unsigned tick) const;
+
+	static void SaveState(Snapshot & s, CarDynamics cars[], int car_count, const DynamicsWorld & world);
+
+	static bool RestoreCars(const Snapshot & s, CarDynamics cars[], int car_count);
+};
+
+#endif // _SNAPSHOTRING_H
@@ -0,0 +1,45 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _SPEEDPROFILE_H
+#define _SPEEDPROFILE_H
+
+#include <algorithm>
+
+/// Lower speed limits along a path so that the car can brake to the limits ahead.
+/// limit[i] is the speed limit at the start of segment i, length[i] the segment length.
+/// brake_speed(final_speed, distance) returns the highest speed from which the car
+/// can slow down to final_speed within distance.
+/// Closed paths are walked twice around to carry braking zones across the path end.
+template <typename T, class BrakeSpeed>
+void LimitSpeedProfile(T limit[], const T length[], unsigned count, bool closed, BrakeSpeed brake_speed)
+{
+	if (count < 2)
+		return;
+
+	const unsigned steps = closed ? 2 * count : count - 1;
+	for (unsigned k = steps; k-- > 0;)
+	{
+		const unsigned i = k % count;
+		const unsigned j = (i + 1 < count) ? i + 1 : 0;
+		limit[i] = std::min(limit[i], brake_speed(limit[j], length[i]));
+	}
+}
+
+#endif // _SPEEDPROFILE_H
@@ -26,14 +26,14 @@
 
 struct ConstraintRow
 {
-	btVector3 axis;
-	btVector3 inv_inertia;
-	btScalar mass;
-	btScalar rhs;
-	btScalar cfm;
-	btScalar impulse;
-	btScalar lower_impulse_limit;
-	btScalar upper_impulse_limit;
+	btVector3 axis = btVector3(0, 0, 0);
+	btVector3 inv_inertia = btVector3(0, 0, 0);
+	btScalar mass = 0;
+	btScalar rhs = 0;
+	btScalar cfm = 0;
+	btScalar impulse = 0;
+	btScalar lower_impulse_limit = 0;
+	btScalar upper_impulse_limit = 0;
 
 	// update constraint impulse and return correction impulse
 	btScalar solve(btScalar velocity_error)
@@ -65,12 +65,12 @@ struct ConstraintRow
 
 struct WheelConstraint
 {
-	btRigidBody * body;
-	DriveShaft * shaft;
+	btRigidBody * body = 0;
+	DriveShaft * shaft = 0;
 	ConstraintRow constraint[3];
-	btVector3 position;
-	btScalar radius;
-	btScalar vcam;
+	btVector3 position = btVector3(0, 0, 0);
+	btScalar radius = 0;
+	btScalar vcam = 0;
 
 	void init(btScalar softness, btScalar error)
 	{
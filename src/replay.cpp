@@ -29,7 +29,8 @@
 
 Replay::Replay(float framerate) :
 	version_info("VDRIFTREPLAYV17", CarInput::INVALID, framerate),
-	replaymode(IDLE)
+	replaymode(IDLE),
+	deterministic(false)
 {
 	// ctor
 }
@@ -102,7 +103,7 @@ const std::vector<float> & Replay::PlayFrame(unsigned carid, CarDynamics & car)
 	assert(carid < carstate.size());
 	assert(unsigned(version_info.inputs_supported) == CarInput::INVALID);
 
-	if (GetPlaying() && !carstate[carid].PlayFrame(car))
+	if (GetPlaying() && !carstate[carid].PlayFrame(car, !deterministic))
 	{
 		replaymode = IDLE;
 	}
@@ -155,7 +156,7 @@ void Replay::CarState::RecordFrame(const std::vector <float> & inputs, CarDynami
 	frame++;
 }
 
-bool Replay::CarState::PlayFrame(CarDynamics & car)
+bool Replay::CarState::PlayFrame(CarDynamics & car, bool restore_state)
 {
 	frame++;
 
@@ -174,7 +175,7 @@ bool Replay::CarState::PlayFrame(CarDynamics & car)
 			stateframes[cur_stateframe].GetFrame() <= frame)
 	{
 		if (stateframes[cur_stateframe].GetFrame() == frame)
-			ProcessPlayStateFrame(stateframes[cur_stateframe], car);
+			ProcessPlayStateFrame(stateframes[cur_stateframe], car, restore_state);
 		cur_stateframe++;
 	}
 
@@ -190,7 +191,7 @@ void Replay::CarState::ProcessPlayInputFrame(const InputFrame & frame)
 	}
 }
 
-void Replay::CarState::ProcessPlayStateFrame(const StateFrame & frame, CarDynamics & car)
+void Replay::CarState::ProcessPlayStateFrame(const StateFrame & frame, CarDynamics & car, bool restore_state)
 {
 	// process input snapshot
 	for (unsigned i = 0; i < inputbuffer.size() && i < frame.GetInputSnapshot().size(); i++)
@@ -198,6 +199,9 @@ void Replay::CarState::ProcessPlayStateFrame(const StateFrame & frame, CarDynami
 		inputbuffer[i] = frame.GetInputSnapshot()[i];
 	}
 
+	if (!restore_state)
+		return;
+
 	// process binary car state
 	std::istringstream statestream(frame.GetBinaryStateData());
 	joeserialize::BinaryInputSerializer serialize_input(statestream);
@@ -56,6 +56,10 @@ public:
 	/// true if the replay system is currently recording
 	bool GetRecording() const;
 
+	/// deterministic playback relies on the simulation reproducing the
+	/// recorded car states, only inputs are played back
+	void SetDeterministic(bool value);
+
 	/// set car state, return car inputs
 	const std::vector<float> & PlayFrame(unsigned carid, CarDynamics & car);
 
@@ -165,14 +169,14 @@ private:
 		bool Serialize(Serializer & s);
 
 		/// set car, update inputbuffer, false if we are out of frames
-		bool PlayFrame(CarDynamics & car);
+		bool PlayFrame(CarDynamics & car, bool restore_state);
 
 		/// get car state, save input delta frame
 		void RecordFrame(const std::vector<float> & inputs, CarDynamics & car);
 
 		void ProcessPlayInputFrame(const InputFrame & frame);
 
-		void ProcessPlayStateFrame(const StateFrame & frame, CarDynamics & car);
+		void ProcessPlayStateFrame(const StateFrame & frame, CarDynamics & car, bool restore_state);
 	};
 
 	/// serialized
@@ -183,6 +187,7 @@ private:
 
 	/// not serialized
 	enum {IDLE, RECORDING, PLAYING} replaymode;
+	bool deterministic;
 
 	/// load all input and state frames to the stream
 	bool Load(std::istream & instream, std::ostream & error_output);
@@ -203,6 +208,11 @@ inline bool Replay::GetRecording() const
 	return (replaymode == RECORDING);
 }
 
+inline void Replay::SetDeterministic(bool value)
+{
+	deterministic = value;
+}
+
 inline const std::vector<CarInfo> & Replay::GetCarInfo() const
 {
 	return carinfo;
@@ -27,6 +27,9 @@ RoadPatch::RoadPatch():
 	track_curvature(0),
 	length(0),
 	dist_from_start(0),
+	road_start(NULL),
+	road_length(0),
+	road_closed(false),
 	have_racingline(false)
 {
 	// ctor
@@ -86,6 +89,18 @@ void RoadPatch::CalculateDistanceFromStart()
 		total_dist += patch->length;
 		patch = patch->next;
 	}
+
+	road_start = this;
+	road_length = total_dist;
+	road_closed = (patch == this);
+	patch = next;
+	while (patch && patch != this)
+	{
+		patch->road_start = this;
+		patch->road_length = total_dist;
+		patch->road_closed = road_closed;
+		patch = patch->next;
+	}
 }
 
 bool RoadPatch::Collide(
@@ -31,7 +31,7 @@ public:
 	/// note that the other patch will be modified
 	void Attach(RoadPatch & other, bool reverse = false);
 
-	/// calculate distance from this start patch
+	/// calculate distance from this start patch and the road length
 	/// note that attached patches will be modified
 	void CalculateDistanceFromStart();
 
@@ -71,6 +71,25 @@ public:
 		return dist_from_start;
 	}
 
+	/// first patch of the road this patch is on, identifies the road,
+	/// null if distances have not been calculated
+	const RoadPatch * GetRoadStart() const
+	{
+		return road_start;
+	}
+
+	/// length of the road this patch is on, zero if distances have not been calculated
+	float GetRoadLength() const
+	{
+		return road_length;
+	}
+
+	/// true if the road this patch is on loops back to its start, valid once distances have been calculated
+	bool IsRoadClosed() const
+	{
+		return road_closed;
+	}
+
 	bool HasRacingline() const
 	{
 		return have_racingline;
@@ -83,6 +102,9 @@ private:
 	float track_curvature;
 	float length;
 	float dist_from_start;
+	const RoadPatch * road_start;
+	float road_length;
+	bool road_closed;
 	bool have_racingline;
 };
 
@@ -75,7 +75,12 @@ Settings::Settings() :
 	recordreplay(false),
 	selected_replay("none"),
 	texture_size("large"),
+	texture_cache(true),
+	texture_cache_size(1024),
 	texture_compress(true),
+	mesh_optimize(true),
+	mesh_overdraw(false),
+	mesh_lods(3),
 	button_ramp(5),
 	ff_device("/dev/input/event0"),
 	ff_gain(1.0),
@@ -108,6 +113,10 @@ Settings::Settings() :
 	hgateshifter(false),
 	ai_level(1.0),
 	vehicle_damage(false),
+	driveline_adaptive(true),
+	driveline_tolerance(0.05),
+	physics_lod_distance(150),
+	tire_tables(false),
 	particles(512),
 	skidmarks(1024),
 	sky_time(17),
@@ -136,6 +145,10 @@ void Settings::Serialize(bool write, Config & config)
 
 	config.get("game", section);
 	Param(config, write, section, "vehicle_damage", vehicle_damage);
+	Param(config, write, section, "driveline_adaptive", driveline_adaptive);
+	Param(config, write, section, "driveline_tolerance", driveline_tolerance);
+	Param(config, write, section, "physics_lod_distance", physics_lod_distance);
+	Param(config, write, section, "tire_tables", tire_tables);
 	Param(config, write, section, "ai_level", ai_level);
 	Param(config, write, section, "track", track);
 	Param(config, write, section, "antilock", abs);
@@ -176,7 +189,12 @@ void Settings::Serialize(bool write, Config & config)
 	Param(config, write, section, "view_distance", view_distance);
 	Param(config, write, section, "racingline", racingline);
 	Param(config, write, section, "texture_size", texture_size);
+	Param(config, write, section, "texture_cache", texture_cache);
+	Param(config, write, section, "texture_cache_size", texture_cache_size);
 	Param(config, write, section, "texture_compress", texture_compress);
+	Param(config, write, section, "mesh_optimize", mesh_optimize);
+	Param(config, write, section, "mesh_overdraw", mesh_overdraw);
+	Param(config, write, section, "mesh_lods", mesh_lods);
 	Param(config, write, section, "shadows", shadows);
 	Param(config, write, section, "shadow_distance", shadow_distance);
 	Param(config, write, section, "shadow_quality", shadow_quality);
@@ -233,11 +233,36 @@ public:
 		return texture_size;
 	}
 
+	bool GetTextureCache() const
+	{
+		return texture_cache;
+	}
+
+	int GetTextureCacheSize() const
+	{
+		return texture_cache_size;
+	}
+
 	bool GetTextureCompress() const
 	{
 		return texture_compress;
 	}
 
+	bool GetMeshOptimize() const
+	{
+		return mesh_optimize;
+	}
+
+	bool GetMeshOverdraw() const
+	{
+		return mesh_overdraw;
+	}
+
+	int GetMeshLods() const
+	{
+		return mesh_lods;
+	}
+
 	float GetButtonRamp() const
 	{
 		return button_ramp;
@@ -403,6 +428,26 @@ public:
 		return vehicle_damage;
 	}
 
+	bool GetDrivelineAdaptive() const
+	{
+		return driveline_adaptive;
+	}
+
+	float GetDrivelineTolerance() const
+	{
+		return driveline_tolerance;
+	}
+
+	float GetPhysicsLodDistance() const
+	{
+		return physics_lod_distance;
+	}
+
+	bool GetTireTables() const
+	{
+		return tire_tables;
+	}
+
 	void SetResolution(unsigned w, unsigned h)
 	{
 		resolution[0] = w;
@@ -462,7 +507,12 @@ private:
 	bool recordreplay;
 	std::string selected_replay;
 	std::string texture_size;
+	bool texture_cache;
+	int texture_cache_size;
 	bool texture_compress;
+	bool mesh_optimize;
+	bool mesh_overdraw;
+	int mesh_lods;
 	float button_ramp;
 	std::string ff_device;
 	float ff_gain;
@@ -495,6 +545,10 @@ private:
 	bool hgateshifter;
 	float ai_level;
 	bool vehicle_damage;
+	bool driveline_adaptive;
+	float driveline_tolerance;
+	float physics_lod_distance;
+	bool tire_tables;
 	int particles;
 	int skidmarks;
 	int sky_time;
@@ -21,7 +21,10 @@
 #include "content/contentmanager.h"
 #include "graphics/texture.h"
 #include "conecull.h"
+#include "minmax.h"
+#include "unittest.h"
 
+#include <algorithm>
 #include <cassert>
 
 static inline keyed_container<Drawable> & GetDrawList(SceneNode & node)
@@ -58,6 +61,10 @@ void SkidMarks::Clear()
 {
 	marks.clear();
 	emitters.clear();
+	blocks.clear();
+	quad_marks.clear();
+	varray.Clear();
+	stats = Stats();
 	max_marks = 0;
 	first_mark = 0;
 	next_mark = 0;
@@ -69,6 +76,7 @@ void SkidMarks::Reset(int anum_emitters, int amax_marks)
 
 	marks.resize(amax_marks);
 	emitters.resize(anum_emitters);
+	blocks.resize((amax_marks + block_size - 1) / block_size);
 	max_marks = amax_marks;
 }
 
@@ -80,6 +88,23 @@ inline float BoundingRadius(Vec3 corners[4], Vec3 center)
 	return std::sqrt(rs);
 }
 
+// grow sphere (center, radius) to contain sphere (c, r), radius 0 is empty
+inline void MergeSphere(Vec3 & center, float & radius, Vec3 c, float r)
+{
+	const float d = (c - center).Magnitude();
+	if (radius <= 0 || d + radius <= r)
+	{
+		center = c;
+		radius = r;
+	}
+	else if (d + r > radius)
+	{
+		const float nr = (d + radius + r) * 0.5f;
+		center = center + (c - center) * ((nr - radius) / d);
+		radius = nr;
+	}
+}
+
 //#include <fstream>
 //static std::ofstream dlog("log.txt");
 
@@ -108,12 +133,14 @@ void SkidMarks::UpdateEmitter(int id, float intensity, Vec3 corner_left, Vec3 co
 
 		// update mark
 		//dlog << "update " << id << " " << e.markid << " " << e.energy << std::endl;
+		m.dirty = true;
 		m.corners[2] = corner_left;
 		m.corners[3] = corner_right;
 		Vec3 center0 = (m.corners[0] + m.corners[1]) * 0.5f;
 		Vec3 center1 = (m.corners[2] + m.corners[3]) * 0.5f;
 		m.center = (center0 + center1) * 0.5f;
 		m.radius = BoundingRadius(m.corners, m.center);
+		AddToBlock(e.markid);
 
 		// check mark length
 		float cs = (center0 - center1).MagnitudeSquared();
@@ -148,12 +175,10 @@ void SkidMarks::UpdateEmitter(int id, float intensity, Vec3 corner_left, Vec3 co
 	//dlog << "start " << id << " " << e.markid << std::endl;
 }
 
+// quad vertices and texture coordinates of a mark
 template <typename Mark>
-inline void ProccessMark(Cone & c, Mark & m, VertexArray & v)
+inline void GetQuad(const Mark & m, float verts[12], float uvs[8])
 {
-	//dlog << "mark " << m.radius << std::endl;
-	if (m.radius <= 0 || c.cull(m.center, m.radius))
-		return;
 /*
 	unsigned char a1 = 255;//(1 - m.intensity[0]) * 255;
 	unsigned char a2 = 255;//(1 - m.intensity[1]) * 255;
@@ -175,31 +200,65 @@ inline void ProccessMark(Cone & c, Mark & m, VertexArray & v)
 		v1 = 0.5f;
 	}
 
-	const unsigned int faces[6] = {
-		0, 1, 2,
-		2, 1, 3,
-	};
-	const float uvs[8] = {
+	const float quad_uvs[8] = {
 		0.0f, v0,
 		1.0f, v0,
 		0.0f, v1,
 		1.0f, v1,
 	};
-	const float verts[12] = {
-		m.corners[0][0], m.corners[0][1], m.corners[0][2],
-		m.corners[1][0], m.corners[1][1], m.corners[1][2],
-		m.corners[2][0], m.corners[2][1], m.corners[2][2],
-		m.corners[3][0], m.corners[3][1], m.corners[3][2],
-	};
-/*
-	const unsigned char cols[16] = {
-		255, 255, 255, a1,
-		255, 255, 255, a1,
-		255, 255, 255, a2,
-		255, 255, 255, a2,
+	std::copy(quad_uvs, quad_uvs + 8, uvs);
+	for (int i = 0; i < 4; ++i)
+	{
+		verts[i * 3 + 0] = m.corners[i][0];
+		verts[i * 3 + 1] = m.corners[i][1];
+		verts[i * 3 + 2] = m.corners[i][2];
+	}
+}
+
+void SkidMarks::ShowMark(int id)
+{
+	const unsigned int faces[6] = {
+		0, 1, 2,
+		2, 1, 3,
 	};
-*/
-	v.Add(faces, 6, verts, 12, uvs, 8);//0, 0, cols, 16);
+	float verts[12], uvs[8];
+	GetQuad(marks[id], verts, uvs);
+	varray.Add(faces, 6, verts, 12, uvs, 8);
+
+	marks[id].quad = quad_marks.size();
+	quad_marks.push_back(id);
+	stats.quads_written++;
+}
+
+void SkidMarks::HideMark(int id)
+{
+	// move the last quad into the slot of the hidden one
+	const int quad = marks[id].quad;
+	const int last = int(quad_marks.size()) - 1;
+	if (quad != last)
+	{
+		const float * verts, * uvs;
+		unsigned vcount, tcount;
+		varray.GetVertices(verts, vcount);
+		varray.GetTexCoords(uvs, tcount);
+		varray.Update(verts + last * 12, uvs + last * 8, quad * 4, 4);
+
+		quad_marks[quad] = quad_marks[last];
+		marks[quad_marks[quad]].quad = quad;
+		stats.quads_written++;
+	}
+	quad_marks.pop_back();
+	varray.Truncate(last * 4, last * 6);
+
+	marks[id].quad = -1;
+}
+
+void SkidMarks::WriteMark(int id)
+{
+	float verts[12], uvs[8];
+	GetQuad(marks[id], verts, uvs);
+	varray.Update(verts, uvs, marks[id].quad * 4, 4);
+	stats.quads_written++;
 }
 
 void SkidMarks::UpdateGraphics(
@@ -208,28 +267,74 @@ void SkidMarks::UpdateGraphics(
 	float znear, float zfar,
 	float sinfovh)
 {
-	if (first_mark == next_mark)
-	{
-		GetDrawable(node, draw).SetDrawEnable(false);
-		return;
-	}
+	stats.marks = max_marks ? (next_mark - first_mark + max_marks) % max_marks : 0;
+	stats.marks_visible = 0;
+	stats.marks_tested = 0;
+	stats.quads_written = 0;
 
-	varray.Clear();
+	// marks of culled blocks have no quads, they are only visited
+	// when their block has been visible in the last update
 	Cone cone(campos, camdir.AxisY(), sinfovh);
-	if (first_mark < next_mark)
+	for (int b = 0; b < int(blocks.size()); ++b)
 	{
-		for (int i = first_mark; i < next_mark; ++i)
-			ProccessMark(cone, marks[i], varray);
+		Block & block = blocks[b];
+		const bool block_visible = block.radius > 0 && !cone.cull(block.center, block.radius);
+		if (!block_visible && !block.visible)
+			continue;
+		block.visible = block_visible;
+
+		const int begin = b * block_size;
+		const int end = Min(begin + block_size, max_marks);
+		for (int i = begin; i < end; ++i)
+		{
+			Mark & m = marks[i];
+			bool visible = false;
+			if (block_visible && m.radius > 0)
+			{
+				visible = !cone.cull(m.center, m.radius);
+				stats.marks_tested++;
+			}
+
+			if (visible)
+			{
+				if (m.quad < 0)
+					ShowMark(i);
+				else if (m.dirty)
+					WriteMark(i);
+				m.dirty = false;
+				stats.marks_visible++;
+			}
+			else if (m.quad >= 0)
+			{
+				HideMark(i);
+			}
+		}
 	}
-	else
+
+	stats.bytes_written = stats.quads_written * 4 * (3 + 2) * sizeof(float);
+
+	if (texture)
+		GetDrawable(node, draw).SetDrawEnable(varray.GetNumVertices() > 0);
+	//dlog << first_mark << " " << next_mark << " verts " << varray.GetNumVertices() << std::endl;
+}
+
+void SkidMarks::AddToBlock(int id)
+{
+	const Mark & m = marks[id];
+	Block & block = blocks[id / block_size];
+	MergeSphere(block.center, block.radius, m.center, m.radius);
+}
+
+void SkidMarks::ResetBlock(int b)
+{
+	blocks[b].radius = 0;
+	const int begin = b * block_size;
+	const int end = Min(begin + block_size, max_marks);
+	for (int i = begin; i < end; ++i)
 	{
-		for (int i = 0; i < next_mark; ++i)
-			ProccessMark(cone, marks[i], varray);
-		for (int i = first_mark; i < max_marks; ++i)
-			ProccessMark(cone, marks[i], varray);
+		if (marks[i].radius > 0)
+			AddToBlock(i);
 	}
-	GetDrawable(node, draw).SetDrawEnable(varray.GetNumVertices() > 0);
-	//dlog << first_mark << " " << next_mark << " verts " << varray.GetNumVertices() << std::endl;
 }
 
 void SkidMarks::NewMark(Emitter & e, float energy)
@@ -242,6 +347,107 @@ void SkidMarks::NewMark(Emitter & e, float energy)
 	// advance used marks range pointers
 	next_mark++;
 	if (next_mark == max_marks) next_mark = 0;
-	if (next_mark == first_mark) first_mark++;
+	if (next_mark == first_mark)
+	{
+		// drop the oldest mark, its quad is removed by the next update
+		marks[first_mark].radius = 0;
+		first_mark++;
+	}
 	if (first_mark == max_marks) first_mark = 0;
+
+	// block bounds only grow, shrink them to the live marks when
+	// the ring starts reusing the block
+	if (e.markid % block_size == 0)
+		ResetBlock(e.markid / block_size);
+}
+
+QT_TEST(skidmarks_test)
+{
+	// camera behind the marks looking along them, and far beside them
+	const Quat camdir;
+	const Vec3 campos_front(3, -20, 0);
+	const Vec3 campos_away(100, 0, 0);
+	const float sinfovh = 0.5f;
+
+	// every quad of the vertex array is the quad of a visible mark
+	auto has_quad = [](const SkidMarks & s, float x)
+	{
+		const float * verts;
+		unsigned count;
+		s.GetVertexArray().GetVertices(verts, count);
+		for (unsigned i = 0; i < count; i += 3)
+		{
+			if (verts[i] == x && verts[i + 1] == 1)
+				return true;
+		}
+		return false;
+	};
+
+	SkidMarks s;
+	s.Reset(1, 8);
+	s.UpdateGraphics(camdir, campos_front, 0.1f, 1000, sinfovh);
+	QT_CHECK_EQUAL(s.GetStats().marks, 0);
+	QT_CHECK_EQUAL(s.GetStats().quads_written, 0);
+	QT_CHECK_EQUAL(s.GetVertexArray().GetNumVertices(), 0);
+
+	// start a trail, the new mark has no extent yet and no quad
+	s.UpdateEmitter(0, 10, Vec3(0, 1, 0), Vec3(0, -1, 0));
+	s.UpdateGraphics(camdir, campos_front, 0.1f, 1000, sinfovh);
+	QT_CHECK_EQUAL(s.GetStats().marks, 1);
+	QT_CHECK_EQUAL(s.GetStats().quads_written, 0);
+	QT_CHECK_EQUAL(s.GetVertexArray().GetNumVertices(), 0);
+
+	// extend the trail past the ring size, only the extended mark and
+	// the quad moved in place of a dropped mark are written per update
+	for (int i = 1; i <= 20; ++i)
+	{
+		const float x = i * 0.3f;
+		s.UpdateEmitter(0, 10, Vec3(x, 1, 0), Vec3(x, -1, 0));
+		s.UpdateGraphics(camdir, campos_front, 0.1f, 1000, sinfovh);
+		QT_CHECK(s.GetStats().quads_written >= 1 && s.GetStats().quads_written <= 2);
+		QT_CHECK_EQUAL(s.GetStats().bytes_written, s.GetStats().quads_written * 4 * 5 * sizeof(float));
+		QT_CHECK_EQUAL(s.GetVertexArray().GetNumVertices(), s.GetStats().marks_visible * 4);
+		QT_CHECK_EQUAL(s.GetVertexArray().GetNumIndices(), s.GetStats().marks_visible * 6);
+		QT_CHECK(has_quad(s, x));
+	}
+	QT_CHECK_EQUAL(s.GetStats().marks, 7);
+	QT_CHECK_EQUAL(s.GetStats().marks_visible, 6);
+
+	// nothing changed, nothing written
+	s.UpdateGraphics(camdir, campos_front, 0.1f, 1000, sinfovh);
+	QT_CHECK_EQUAL(s.GetStats().quads_written, 0);
+	QT_CHECK_EQUAL(s.GetStats().bytes_written, 0);
+
+	// moving away culls the block, its quads are removed once
+	s.UpdateGraphics(camdir, campos_away, 0.1f, 1000, sinfovh);
+	QT_CHECK_EQUAL(s.GetStats().marks_visible, 0);
+	QT_CHECK_EQUAL(s.GetStats().marks_tested, 0);
+	QT_CHECK_EQUAL(s.GetVertexArray().GetNumVertices(), 0);
+	s.UpdateGraphics(camdir, campos_away, 0.1f, 1000, sinfovh);
+	QT_CHECK_EQUAL(s.GetStats().quads_written, 0);
+
+	// moving back adds them again
+	s.UpdateGraphics(camdir, campos_front, 0.1f, 1000, sinfovh);
+	QT_CHECK_EQUAL(s.GetStats().marks_visible, 6);
+	QT_CHECK_EQUAL(s.GetStats().quads_written, 6);
+	QT_CHECK_EQUAL(s.GetVertexArray().GetNumVertices(), 6 * 4);
+	QT_CHECK(has_quad(s, 20 * 0.3f));
+
+	// a long trail, only the marks of blocks near the view cone are tested
+	s.Reset(1, 256);
+	s.UpdateEmitter(0, 10, Vec3(0, 1, 0), Vec3(0, -1, 0));
+	for (int i = 1; i <= 250; ++i)
+	{
+		const float x = i * 0.3f;
+		s.UpdateEmitter(0, 10, Vec3(x, 1, 0), Vec3(x, -1, 0));
+	}
+	s.UpdateGraphics(camdir, campos_front, 0.1f, 1000, sinfovh);
+	QT_CHECK_EQUAL(s.GetStats().marks, 251);
+	QT_CHECK(s.GetStats().marks_visible > 0);
+	QT_CHECK(s.GetStats().marks_tested < s.GetStats().marks / 2);
+	QT_CHECK_EQUAL(s.GetVertexArray().GetNumVertices(), s.GetStats().marks_visible * 4);
+	QT_CHECK(!has_quad(s, 250 * 0.3f));
+
+	s.Clear();
+	QT_CHECK_EQUAL(s.GetVertexArray().GetNumVertices(), 0);
 }
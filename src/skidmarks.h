@@ -32,9 +32,23 @@
 class ContentManager;
 class Texture;
 
+/// Skid marks are kept in a ring of max_marks marks. The vertex array holds one
+/// quad per mark inside the view cone, quads are added, rewritten and removed as
+/// marks are created, extended or change visibility. Marks are culled in blocks of
+/// consecutive ring slots first, so per frame work scales with the marks near the
+/// view cone instead of all live marks.
 class SkidMarks
 {
 public:
+	struct Stats
+	{
+		unsigned marks = 0; ///< live marks
+		unsigned marks_visible = 0; ///< live marks inside the view cone
+		unsigned marks_tested = 0; ///< marks tested against the view cone by last update
+		unsigned quads_written = 0; ///< quads added or rewritten by last update
+		unsigned bytes_written = 0; ///< vertex data bytes written by last update
+	};
+
 	/// Load texture
 	void Load(
 		const std::string & texpath,
@@ -48,12 +62,17 @@ public:
 
 	void UpdateEmitter(int id, float intensity, Vec3 corner_left, Vec3 corner_right);
 
+	/// Cull marks against the view cone and update the quads of the visible marks
 	void UpdateGraphics(
 		const Quat & camdir,
 		const Vec3 & campos,
 		float znear, float zfar,
 		float sinfovh);
 
+	const Stats & GetStats() const { return stats; }
+
+	const VertexArray & GetVertexArray() const { return varray; }
+
 	SceneNode & GetNode() { return node; }
 
 private:
@@ -61,16 +80,30 @@ private:
 	{
 		Vec3 corners[4];
 		Vec3 center;
-		float radius;
-		float fade;
+		float radius = 0;
+		float fade = 0;
+		int quad = -1; ///< quad of the mark in the vertex array, -1 if not visible
+		bool dirty = false; ///< mark changed since its quad was written
 	};
 	struct Emitter
 	{
 		float energy = 0;
 		int markid = -1;
 	};
+	/// Bounds of the marks of block_size consecutive ring slots
+	struct Block
+	{
+		Vec3 center;
+		float radius = 0;
+		bool visible = false; ///< marks of the block may have quads
+	};
+	static const int block_size = 32;
+
 	std::vector<Mark> marks;
 	std::vector<Emitter> emitters;
+	std::vector<Block> blocks;
+	std::vector<int> quad_marks; ///< mark of each quad
+	Stats stats;
 
 	SceneNode::DrawableHandle draw;
 	std::shared_ptr<Texture> texture;
@@ -84,6 +117,18 @@ private:
 	float min_emission_energy = 5.0f;
 
 	void NewMark(Emitter & e, float energy = 0);
+
+	/// Grow the block bounds to contain the mark
+	void AddToBlock(int id);
+
+	/// Recompute the block bounds from its live marks
+	void ResetBlock(int block);
+
+	void ShowMark(int id);
+
+	void HideMark(int id);
+
+	void WriteMark(int id);
 };
 
 #endif // _SKIDMARKS_H
@@ -20,9 +20,12 @@
 #include "sound.h"
 #include "minmax.h"
 #include "coordinatesystem.h"
+#include "unittest.h"
 #include <SDL2/SDL_audio.h>
 #include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <random>
 
 //static std::ofstream logso("logso.txt");
 //static std::ofstream logsa("logsa.txt");
@@ -31,6 +34,7 @@
 #define FRACTIONONE  (1<<FRACTIONBITS)
 #define FRACTIONMASK (FRACTIONONE-1)
 #define MAXGAINDELTA (FRACTIONONE * 173 / 44100) // 256 samples from min to max gain
+#define REALSOURCEBIAS (1.25f) // loudness bonus of mixed sources to avoid toggling at the active limit
 
 // add item to a compactifying vector
 template <class T>
@@ -126,8 +130,8 @@ static inline const T & GetItem(size_t id, const std::vector<T> & items, size_t
 
 bool Sound::SourceActive::operator<(const Sound::SourceActive & other) const
 {
-	// reverse op as partial sort sorts for the smallest elemets
-	return this->gain > other.gain;
+	// reverse op as nth_element partitions for the smallest elements
+	return this->loudness > other.loudness;
 }
 
 bool Sound::SamplersUpdate::empty() const
@@ -139,9 +143,12 @@ Sound::Sound() :
 	deviceinfo(0, 0, 0, 0),
 	sound_volume(0),
 	initdone(false),
+	offline(false),
 	disable(false),
 	max_active_sources(64),
 	sources_num(0),
+	sources_playing(0),
+	sources_real(0),
 	update_id(0),
 	sources_pause(true),
 	samplers_num(0),
@@ -159,7 +166,7 @@ Sound::Sound() :
 
 Sound::~Sound()
 {
-	if (initdone)
+	if (initdone && !offline)
 		SDL_CloseAudio();
 }
 
@@ -217,8 +224,6 @@ bool Sound::Init(unsigned short buffersize, std::ostream & info_output, std::ost
 	}
 
 	deviceinfo = SoundInfo(samples, frequency, channels, bytespersample);
-	buffer[0].reserve(samples);
-	buffer[1].reserve(samples);
 	initdone = true;
 	SetVolume(1);
 
@@ -228,6 +233,31 @@ bool Sound::Init(unsigned short buffersize, std::ostream & info_output, std::ost
 	return true;
 }
 
+bool Sound::InitOffline(const SoundInfo & info, std::ostream & error_output)
+{
+	if (disable || initdone)
+		return false;
+
+	if (((info.bytespersample != 2) && (info.bytespersample != 4)) || (info.channels != 2))
+	{
+		error_output << "Offline sound has unsupported format or channel count." << std::endl;
+		return false;
+	}
+
+	deviceinfo = info;
+	initdone = true;
+	offline = true;
+	SetVolume(1);
+
+	return true;
+}
+
+void Sound::Render(unsigned char stream[], unsigned len)
+{
+	assert(offline);
+	CallbackWrapper(this, stream, len);
+}
+
 const SoundInfo & Sound::GetDeviceInfo() const
 {
 	return deviceinfo;
@@ -248,6 +278,12 @@ void Sound::SetMaxActiveSources(size_t value)
 	max_active_sources = value;
 }
 
+void Sound::GetVoiceStats(size_t & real, size_t & virtual_sources) const
+{
+	real = sources_real;
+	virtual_sources = sources_playing - sources_real;
+}
+
 void Sound::SetAttenuation(const float nattenuation[4])
 {
 	attenuation[0] = nattenuation[0];
@@ -265,9 +301,11 @@ size_t Sound::AddSource(std::shared_ptr<SoundBuffer> buffer, float offset, bool
 	src.offset = offset;
 	src.pitch = 1;
 	src.gain = 0;
+	src.priority = 1;
 	src.is3d = is3d;
 	src.playing = true;
 	src.loop = loop;
+	src.real = false;
 	size_t id = AddItem(src, sources, sources_num);
 
 	// notify sound thread
@@ -327,6 +365,11 @@ void Sound::SetSourceGain(size_t id, float value)
 	GetItem(id, sources, sources_num).gain = value;
 }
 
+void Sound::SetSourcePriority(size_t id, float value)
+{
+	GetItem(id, sources, sources_num).priority = value;
+}
+
 void Sound::SetListenerVelocity(float x, float y, float z)
 {
 	listener_vel.Set(x, y, z);
@@ -400,11 +443,16 @@ void Sound::ProcessSources()
 	sset.resize(sources_num);
 
 	sources_active.clear();
+	sources_playing = 0;
 	for (size_t i = 0; i < sources_num; ++i)
 	{
 		Source & src = sources[i];
+		bool real = src.real;
+		src.real = false;
 		if (!src.playing) continue;
 
+		sources_playing++;
+
 		float gain1 = 0.0, gain2 = 0.0;
 		if (src.gain > 0)
 		{
@@ -439,7 +487,7 @@ void Sound::ProcessSources()
 			if (maxgain > 0)
 			{
 				SourceActive sa;
-				sa.gain = maxgain;
+				sa.loudness = maxgain * src.priority * (real ? REALSOURCEBIAS : 1.0f);
 				sa.id = i;
 				sources_active.push_back(sa);
 			}
@@ -462,22 +510,29 @@ void Sound::ProcessSources()
 void Sound::LimitActiveSources()
 {
 	// limit active sources to max active sources
-	if (sources_active.size() <= max_active_sources)
-		return;
-
-	// get loudest max_active_sources
-	std::partial_sort(
-		sources_active.begin(),
-		sources_active.begin() + max_active_sources,
-		sources_active.end());
+	if (sources_active.size() > max_active_sources)
+	{
+		// get loudest max_active_sources, order within the partitions is irrelevant
+		std::nth_element(
+			sources_active.begin(),
+			sources_active.begin() + max_active_sources,
+			sources_active.end());
+
+		// mute remaining sources, their samplers only advance play position
+		auto & sset = samplers_update.back().sset;
+		for (size_t i = max_active_sources; i < sources_active.size(); ++i)
+		{
+			sset[sources_active[i].id].gain1 = 0;
+			sset[sources_active[i].id].gain2 = 0;
+		}
+		sources_active.resize(max_active_sources);
+	}
 
-	// mute remaining sources
-	auto & sset = samplers_update.back().sset;
-	for (size_t i = max_active_sources; i < sources_active.size(); ++i)
+	for (const auto & sa : sources_active)
 	{
-		sset[sources_active[i].id].gain1 = 0;
-		sset[sources_active[i].id].gain2 = 0;
+		sources[sa.id].real = true;
 	}
+	sources_real = sources_active.size();
 }
 
 void Sound::SetSamplerChanges()
@@ -534,15 +589,9 @@ void Sound::ProcessSamplers(unsigned char stream[], unsigned len)
 
 	auto & sstop = sources_stop.back();
 
-	// init sampling buffers
-	auto samples = len / (2 * sizeof(stream_type));
-	buffer[0].resize(samples);
-	buffer[1].resize(samples);
-
 	// run samplers
+	auto samples = len / (2 * sizeof(stream_type));
 	auto sstream = (stream_type*)stream;
-	auto buffer0 = (buffer_type*)buffer[0].data();
-	auto buffer1 = (buffer_type*)buffer[1].data();
 	for (size_t i = 0; i < samplers_num; ++i)
 	{
 		Sampler & smp = samplers[i];
@@ -551,20 +600,7 @@ void Sound::ProcessSamplers(unsigned char stream[], unsigned len)
 
 		if (smp.gain1 | smp.gain2 | smp.last_gain1 | smp.last_gain2)
 		{
-			SampleAndAdvanceWithPitch<stream_type>(smp, buffer0, buffer1, samples);
-
-			for (unsigned n = 0; n < samples; ++n)
-			{
-				unsigned pos = n * 2;
-				buffer_type val1 = sstream[pos] + buffer0[n];
-				buffer_type val2 = sstream[pos + 1] + buffer1[n];
-
-				val1 = Clamp<buffer_type>(val1, vmin, vmax);
-				val2 = Clamp<buffer_type>(val2, vmin, vmax);
-
-				sstream[pos] = val1;
-				sstream[pos + 1] = val2;
-			}
+			MixAndAdvanceWithPitch<stream_type, buffer_type, vmin, vmax>(smp, sstream, samples);
 		}
 		else
 		{
@@ -676,6 +712,133 @@ template <typename T> T Scale(T v, T s);
 template <> inline int Scale<int>(int v, int s) { return v * s / FRACTIONONE; }
 template <> inline float Scale<float>(float v, float s) { return v * s; }
 
+template <typename sample_type, typename buffer_type, int vmin, int vmax>
+void Sound::MixAndAdvanceWithPitch(Sampler & sampler, sample_type stream[], unsigned len)
+{
+	assert(sampler.buffer);
+	assert(sampler.playing);
+
+	const unsigned channels = sampler.buffer->GetInfo().channels;
+	const unsigned chaninc = channels - 1;
+	const unsigned samples_per_channel = sampler.samples_per_channel;
+	const unsigned samples = samples_per_channel * channels;
+	const unsigned pitch = sampler.pitch;
+	const bool loop = sampler.loop;
+	auto nr = sampler.sample_pos_remainder;
+	auto ni = sampler.sample_pos;
+
+	// looping position is kept inside the buffer, (ni * channels) % samples becomes ni * channels
+	if (loop)
+		ni = ni % samples_per_channel;
+
+	auto buf = (const sample_type *)sampler.buffer->GetRawBuffer();
+	auto gain1 = Cast<buffer_type>(sampler.gain1);
+	auto gain2 = Cast<buffer_type>(sampler.gain2);
+	auto last_gain1 = Cast<buffer_type>(sampler.last_gain1);
+	auto last_gain2 = Cast<buffer_type>(sampler.last_gain2);
+	auto max_gain_delta = Cast<buffer_type>(MAXGAINDELTA);
+
+	unsigned i = 0;
+	while (i < len && (loop || ni < samples_per_channel))
+	{
+		// frames at constant gain with both interpolation samples in front of the buffer end
+		// are mixed in blocks of four, gain ramps and wraparound are handled per frame below
+		unsigned run = 0;
+		if (last_gain1 == gain1 && last_gain2 == gain2 && ni + 1 < samples_per_channel)
+		{
+			unsigned long long avail = ((unsigned long long)(samples_per_channel - 1 - ni) << FRACTIONBITS) - nr;
+			unsigned long long frames = pitch ? (avail + pitch - 1) / pitch : len;
+			run = Min<unsigned long long>(frames, len - i) & ~3ull;
+		}
+
+		for (unsigned end = i + run; i < end; i += 4)
+		{
+			// gather samples, interpolation and accumulation run on all four frames at once
+			buffer_type samp1[8], samp2[8], f[4];
+			for (unsigned k = 0; k < 4; ++k)
+			{
+				unsigned q = nr + k * pitch;
+				unsigned id1 = (ni + (q >> FRACTIONBITS)) * channels;
+				unsigned id2 = id1 + channels;
+				samp1[k * 2] = buf[id1];
+				samp1[k * 2 + 1] = buf[id1 + chaninc];
+				samp2[k * 2] = buf[id2];
+				samp2[k * 2 + 1] = buf[id2 + chaninc];
+				f[k] = Cast<buffer_type>(q & FRACTIONMASK);
+			}
+
+			auto out = stream + i * 2;
+			for (unsigned k = 0; k < 8; ++k)
+			{
+				auto val = samp1[k] + Scale(samp2[k] - samp1[k], f[k / 2]);
+				buffer_type sum = out[k] + Scale(val, (k & 1) ? gain2 : gain1);
+				out[k] = Clamp<buffer_type>(sum, vmin, vmax);
+			}
+
+			nr += 4 * pitch;
+			ni += nr >> FRACTIONBITS;
+			nr &= FRACTIONMASK;
+		}
+
+		if (run)
+		{
+			if (loop && ni >= samples_per_channel)
+				ni = ni % samples_per_channel;
+			continue;
+		}
+
+		// limit gain change rate
+		auto gain_delta1 = gain1 - last_gain1;
+		auto gain_delta2 = gain2 - last_gain2;
+		gain_delta1 = Clamp(gain_delta1, -max_gain_delta, max_gain_delta);
+		gain_delta2 = Clamp(gain_delta2, -max_gain_delta, max_gain_delta);
+		last_gain1 += gain_delta1;
+		last_gain2 += gain_delta2;
+
+		// the samples to the left and right of the playback position, channel 0 and 1
+		unsigned id1 = ni * channels;
+		unsigned id2 = (id1 + channels) % samples;
+		buffer_type samp10 = buf[id1];
+		buffer_type samp11 = buf[id1 + chaninc];
+		buffer_type samp20 = buf[id2];
+		buffer_type samp21 = buf[id2 + chaninc];
+
+		auto f = Cast<buffer_type>(nr);
+		auto val1 = samp10 + Scale(samp20 - samp10, f);
+		auto val2 = samp11 + Scale(samp21 - samp11, f);
+
+		unsigned pos = i * 2;
+		buffer_type out1 = stream[pos] + Scale(val1, last_gain1);
+		buffer_type out2 = stream[pos + 1] + Scale(val2, last_gain2);
+		stream[pos] = Clamp<buffer_type>(out1, vmin, vmax);
+		stream[pos + 1] = Clamp<buffer_type>(out2, vmin, vmax);
+
+		nr += pitch;
+		ni += nr >> FRACTIONBITS;
+		nr &= FRACTIONMASK;
+		if (loop && ni >= samples_per_channel)
+			ni = ni % samples_per_channel;
+		++i;
+	}
+
+	// finished buffer contributes silence, the gain ramp goes on
+	for (; i < len && (last_gain1 != gain1 || last_gain2 != gain2); ++i)
+	{
+		auto gain_delta1 = gain1 - last_gain1;
+		auto gain_delta2 = gain2 - last_gain2;
+		gain_delta1 = Clamp(gain_delta1, -max_gain_delta, max_gain_delta);
+		gain_delta2 = Clamp(gain_delta2, -max_gain_delta, max_gain_delta);
+		last_gain1 += gain_delta1;
+		last_gain2 += gain_delta2;
+	}
+
+	sampler.last_gain1 = Cast<unsigned>(last_gain1);
+	sampler.last_gain2 = Cast<unsigned>(last_gain2);
+	sampler.sample_pos = ni;
+	sampler.sample_pos_remainder = nr;
+	sampler.playing = loop || ni < samples_per_channel;
+}
+
 template <typename sample_type, typename buffer_type>
 void Sound::SampleAndAdvanceWithPitch(Sampler & sampler, buffer_type chan1[], buffer_type chan2[], unsigned len)
 {
@@ -777,3 +940,78 @@ void Sound::AdvanceWithPitch(Sampler & sampler, unsigned len)
 		sampler.sample_pos = sampler.sample_pos % sampler.samples_per_channel;
 	}
 }
+
+// mix random sampler configurations into prefilled streams, the blocked mixer
+// has to match the two pass reference bit for bit, sampler state included
+struct SoundMixerTest
+{
+	template <typename sample_type, typename buffer_type, int vmin, int vmax>
+	static bool Run(unsigned seed)
+	{
+		std::mt19937 random(seed);
+		for (int test = 0; test < 500; ++test)
+		{
+			const unsigned channels = 1 + random() % 2;
+			const unsigned samples_per_channel = 1 + random() % 300;
+			std::vector<sample_type> data(samples_per_channel * channels);
+			for (auto & value : data)
+				value = sample_type(vmin + (vmax - vmin) * (random() / float(random.max())));
+
+			SoundBuffer buffer;
+			SoundInfo info(data.size(), 44100, channels, sizeof(sample_type));
+			buffer.Load((const char *)data.data(), info, "test");
+
+			Sound::Sampler smp;
+			smp.buffer = &buffer;
+			smp.samples_per_channel = samples_per_channel;
+			smp.sample_pos = random() % (2 * samples_per_channel);
+			smp.sample_pos_remainder = random() & FRACTIONMASK;
+			smp.pitch = (test % 8 == 0) ? 0 : random() % ((test % 8 == 1) ? 64 * FRACTIONONE : 2 * FRACTIONONE);
+			smp.gain1 = random() % (FRACTIONONE + 1);
+			smp.gain2 = (test % 4 == 0) ? 0 : random() % (FRACTIONONE + 1);
+			smp.last_gain1 = (test % 2) ? smp.gain1 : random() % (FRACTIONONE + 1);
+			smp.last_gain2 = (test % 3) ? smp.gain2 : random() % (FRACTIONONE + 1);
+			smp.playing = true;
+			smp.loop = random() % 2;
+			smp.id = 0;
+
+			Sound::Sampler ref = smp;
+			for (int call = 0; call < 3 && smp.playing; ++call)
+			{
+				const unsigned len = random() % 600;
+				std::vector<sample_type> stream(len * 2), expected(len * 2);
+				for (unsigned n = 0; n < len * 2; ++n)
+					stream[n] = expected[n] = sample_type(vmin + (vmax - vmin) * (random() / float(random.max())));
+
+				std::vector<buffer_type> chan1(len), chan2(len);
+				Sound::SampleAndAdvanceWithPitch<sample_type>(ref, chan1.data(), chan2.data(), len);
+				for (unsigned n = 0; n < len; ++n)
+				{
+					buffer_type val1 = expected[n * 2] + chan1[n];
+					buffer_type val2 = expected[n * 2 + 1] + chan2[n];
+					expected[n * 2] = Clamp<buffer_type>(val1, vmin, vmax);
+					expected[n * 2 + 1] = Clamp<buffer_type>(val2, vmin, vmax);
+				}
+
+				Sound::MixAndAdvanceWithPitch<sample_type, buffer_type, vmin, vmax>(smp, stream.data(), len);
+
+				if (memcmp(stream.data(), expected.data(), stream.size() * sizeof(sample_type)) ||
+					smp.sample_pos != ref.sample_pos ||
+					smp.sample_pos_remainder != ref.sample_pos_remainder ||
+					smp.last_gain1 != ref.last_gain1 ||
+					smp.last_gain2 != ref.last_gain2 ||
+					smp.playing != ref.playing)
+					return false;
+			}
+		}
+		return true;
+	}
+};
+
+QT_TEST(sound_mixer_test)
+{
+	bool short_exact = SoundMixerTest::Run<short, int, -32768, 32767>(1);
+	bool float_exact = SoundMixerTest::Run<float, float, -1, 1>(2);
+	QT_CHECK(short_exact);
+	QT_CHECK(float_exact);
+}
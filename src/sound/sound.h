@@ -40,6 +40,12 @@ public:
 	// init sound device
 	bool Init(unsigned short buffersize, std::ostream & info, std::ostream & error);
 
+	// init without sound device, stereo 16 bit or float format, samples are pulled by Render
+	bool InitOffline(const SoundInfo & info, std::ostream & error);
+
+	// run sound thread on an offline sound, fill len bytes of interleaved stream
+	void Render(unsigned char stream[], unsigned len);
+
 	// get device info
 	const SoundInfo & GetDeviceInfo() const;
 
@@ -52,6 +58,10 @@ public:
 	// active sources limit can be adjusted at runtime
 	void SetMaxActiveSources(size_t value);
 
+	// playing sources after the last update, real sources are mixed,
+	// virtual sources are silent or culled and only advance their play position
+	void GetVoiceStats(size_t & real, size_t & virtual_sources) const;
+
 	// attenuation: y = a * (x - b)^c + d
 	void SetAttenuation(const float attenuation[4]);
 
@@ -71,6 +81,9 @@ public:
 
 	void SetSourceGain(size_t id, float value);
 
+	// loudness weight when culling sources above the active limit, default 1
+	void SetSourcePriority(size_t id, float value);
+
 	void SetListenerVelocity(float x, float y, float z);
 
 	void SetListenerPosition(float x, float y, float z);
@@ -90,13 +103,15 @@ private:
 	float attenuation[4];
 	float sound_volume;
 	bool initdone;
+	bool offline;
 	bool disable;
 
 	// state structs
 	struct SourceActive
 	{
 		bool operator<(const SourceActive & other) const;
-		int gain, id;
+		float loudness;
+		int id;
 	};
 
 	struct Source
@@ -107,9 +122,11 @@ private:
 		float offset;
 		float pitch;
 		float gain;
+		float priority;
 		bool is3d;
 		bool playing;
 		bool loop;
+		bool real;
 		size_t id;
 	};
 
@@ -159,6 +176,8 @@ private:
 	std::vector<Source> sources;
 	size_t max_active_sources;
 	size_t sources_num;
+	size_t sources_playing;
+	size_t sources_real;
 	size_t update_id;
 	bool sources_pause;
 
@@ -167,7 +186,6 @@ private:
 	TrippleBuffer<std::vector<size_t> > sources_stop;
 
 	// sound thread state
-	std::vector<int> buffer[2];
 	std::vector<Sampler> samplers;
 	size_t samplers_num;
 	bool samplers_pause;
@@ -203,10 +221,17 @@ private:
 
 	static void CallbackWrapper(void * sound, unsigned char stream[], int len);
 
+	// mix sampler into interleaved stereo stream, saturating the sum to [vmin, vmax]
+	template <typename sample_type, typename buffer_type, int vmin, int vmax>
+	static void MixAndAdvanceWithPitch(Sampler & sampler, sample_type stream[], unsigned len);
+
+	// two pass reference for MixAndAdvanceWithPitch, samples into separate channel buffers
 	template <typename sample_type, typename buffer_type>
 	static void SampleAndAdvanceWithPitch(Sampler & sampler, buffer_type chan1[], buffer_type chan2[], unsigned len);
 
 	static void AdvanceWithPitch(Sampler & sampler, unsigned len);
+
+	friend struct SoundMixerTest;
 };
 
 #endif
@@ -57,6 +57,19 @@ bool SoundBuffer::Load(const std::string & filename, const SoundInfo & sound_dev
 	}
 }
 
+void SoundBuffer::Load(const char samples[], const SoundInfo & sample_info, const std::string & sample_name)
+{
+	if (loaded)
+		Unload();
+
+	const unsigned size = sample_info.samples * sample_info.bytespersample;
+	sound_buffer = new char[size];
+	memcpy(sound_buffer, samples, size);
+	info = sample_info;
+	name = sample_name;
+	loaded = true;
+}
+
 void SoundBuffer::Unload()
 {
 	if (loaded && sound_buffer)
@@ -34,6 +34,9 @@ public:
 
 	bool Load(const std::string & filename, const SoundInfo & sound_device_info, std::ostream & error_output);
 
+	/// copy interleaved samples, 16 bit integer or float as given by info
+	void Load(const char samples[], const SoundInfo & info, const std::string & name);
+
 	void Unload();
 
 	const SoundInfo & GetInfo() const
@@ -0,0 +1,389 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "soundrender.h"
+#include "sound.h"
+#include "soundbuffer.h"
+#include "soundfilter.h"
+#include "unittest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <memory>
+#include <random>
+#include <sstream>
+
+SoundRenderScript::SoundRenderScript() :
+	voices(32),
+	max_active(64),
+	seconds(10),
+	seed(0)
+{
+	// ctor
+}
+
+SoundRenderStats::SoundRenderStats() :
+	voices(0),
+	real_voices(0),
+	audio_seconds(0),
+	cpu_seconds(0)
+{
+	// ctor
+}
+
+double SoundRenderStats::Throughput() const
+{
+	return cpu_seconds > 0 ? voices * audio_seconds / cpu_seconds : 0;
+}
+
+template <typename T> T ToSample(float v);
+template <> inline short ToSample<short>(float v) { return v * 32767; }
+template <> inline float ToSample<float>(float v) { return v; }
+
+enum SoundRenderBuffer
+{
+	ENGINE, // looping mono harmonics
+	TIRE,   // looping stereo noise
+	CRASH,  // one shot mono decaying noise
+	BUFFER_COUNT
+};
+
+template <typename T>
+static std::shared_ptr<SoundBuffer> CreateBuffer(SoundRenderBuffer type, unsigned seed)
+{
+	const unsigned frequency = 44100;
+	const float pi2 = 2 * M_PI;
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> noise(-1, 1);
+
+	unsigned channels = 1;
+	std::vector<T> samples;
+	if (type == ENGINE)
+	{
+		// whole number of periods to loop seamlessly
+		samples.resize(frequency);
+		for (unsigned i = 0; i < samples.size(); ++i)
+		{
+			float t = float(i) / frequency;
+			float v = std::sin(pi2 * 50 * t) + 0.5f * std::sin(pi2 * 100 * t) + 0.25f * std::sin(pi2 * 150 * t);
+			samples[i] = ToSample<T>(0.3f * v);
+		}
+	}
+	else if (type == TIRE)
+	{
+		channels = 2;
+		samples.resize(frequency);
+		float v[2] = {0, 0};
+		for (unsigned i = 0; i < samples.size(); ++i)
+		{
+			float & vc = v[i % 2];
+			vc += 0.1f * (noise(random) - vc);
+			samples[i] = ToSample<T>(0.6f * vc);
+		}
+	}
+	else
+	{
+		samples.resize(frequency * 3 / 10);
+		for (unsigned i = 0; i < samples.size(); ++i)
+		{
+			float t = float(i) / frequency;
+			samples[i] = ToSample<T>(0.8f * std::exp(-10 * t) * noise(random));
+		}
+	}
+
+	const char * names[] = {"engine", "tire", "crash"};
+	auto buffer = std::make_shared<SoundBuffer>();
+	SoundInfo info(samples.size(), frequency, channels, sizeof(T));
+	buffer->Load((const char *)samples.data(), info, names[type]);
+	return buffer;
+}
+
+bool SoundRender(
+	const SoundRenderScript & script,
+	const SoundInfo & device,
+	std::vector<unsigned char> * stream,
+	SoundRenderStats & stats,
+	std::ostream & error)
+{
+	if (device.samples == 0 || device.frequency == 0)
+	{
+		error << "Offline sound has no buffer size or frequency." << std::endl;
+		return false;
+	}
+
+	// buffers are stored in device sample format
+	std::shared_ptr<SoundBuffer> buffers[BUFFER_COUNT];
+	for (int i = 0; i < BUFFER_COUNT; ++i)
+	{
+		auto type = SoundRenderBuffer(i);
+		buffers[i] = (device.bytespersample == 2) ?
+			CreateBuffer<short>(type, script.seed + i) :
+			CreateBuffer<float>(type, script.seed + i);
+	}
+
+	Sound sound;
+	if (!sound.InitOffline(device, error))
+		return false;
+	sound.SetMaxActiveSources(script.max_active);
+
+	struct Voice
+	{
+		size_t id;
+		float radius;
+		float speed;
+		float phase;
+		float pitch_rate;
+		float gain_rate;
+		bool loop;
+	};
+
+	std::mt19937 random(script.seed);
+	std::uniform_real_distribution<float> uniform(0, 1);
+	auto add_voice = [&]()
+	{
+		auto type = SoundRenderBuffer(random() % BUFFER_COUNT);
+		Voice v;
+		v.loop = (type != CRASH);
+		v.id = sound.AddSource(buffers[type], uniform(random), true, v.loop);
+		v.radius = 2 + 50 * uniform(random);
+		v.speed = 4 * uniform(random) - 2;
+		v.phase = 2 * M_PI * uniform(random);
+		v.pitch_rate = 4 * uniform(random);
+		v.gain_rate = 2 * uniform(random);
+		return v;
+	};
+
+	std::vector<Voice> voices;
+	for (unsigned i = 0; i < script.voices; ++i)
+		voices.push_back(add_voice());
+
+	const float dt = float(device.samples) / device.frequency;
+	const unsigned blocks = std::ceil(script.seconds / dt);
+	const unsigned replace_period = std::max(1u, unsigned(0.5f / dt));
+	std::vector<unsigned char> block(device.samples * device.channels * device.bytespersample);
+	if (stream)
+		stream->reserve(stream->size() + blocks * block.size());
+
+	size_t real_sum = 0;
+	const std::clock_t start = std::clock();
+	for (unsigned b = 0; b < blocks; ++b)
+	{
+		const float time = b * dt;
+		if (b % replace_period == replace_period - 1 && !voices.empty())
+		{
+			Voice & v = voices[random() % voices.size()];
+			sound.RemoveSource(v.id);
+			v = add_voice();
+		}
+
+		for (const auto & v : voices)
+		{
+			const float angle = v.phase + v.speed * time;
+			sound.SetSourcePosition(v.id, v.radius * std::cos(angle), v.radius * std::sin(angle), 0);
+			sound.SetSourcePitch(v.id, 1 + 0.5f * std::sin(v.pitch_rate * time + v.phase));
+			sound.SetSourceGain(v.id, 0.5f + 0.5f * std::sin(v.gain_rate * time + v.phase));
+			if (!v.loop && !sound.GetSourcePlaying(v.id))
+				sound.ResetSource(v.id);
+		}
+		sound.Update(false);
+
+		size_t real, virtual_sources;
+		sound.GetVoiceStats(real, virtual_sources);
+		real_sum += real;
+
+		sound.Render(block.data(), block.size());
+		if (stream)
+			stream->insert(stream->end(), block.begin(), block.end());
+	}
+	stats.cpu_seconds = double(std::clock() - start) / CLOCKS_PER_SEC;
+	stats.audio_seconds = blocks * dt;
+	stats.voices = script.voices;
+	stats.real_voices = blocks ? float(real_sum) / blocks : 0;
+
+	return true;
+}
+
+static void Write(std::ostream & out, unsigned value, unsigned bytes)
+{
+	for (unsigned i = 0; i < bytes; ++i)
+		out.put(char((value >> (i * 8)) & 0xFF));
+}
+
+void SoundWriteWav(
+	const SoundInfo & device,
+	const std::vector<unsigned char> & stream,
+	std::ostream & out)
+{
+	const unsigned size = stream.size();
+	const unsigned block_align = device.channels * device.bytespersample;
+	out.write("RIFF", 4);
+	Write(out, 36 + size, 4);
+	out.write("WAVE", 4);
+	out.write("fmt ", 4);
+	Write(out, 16, 4);
+	Write(out, (device.bytespersample == 4) ? 3 : 1, 2); // ieee float or pcm
+	Write(out, device.channels, 2);
+	Write(out, device.frequency, 4);
+	Write(out, device.frequency * block_align, 4);
+	Write(out, block_align, 2);
+	Write(out, device.bytespersample * 8, 2);
+	out.write("data", 4);
+	Write(out, size, 4);
+
+	// stream is in native byte order, wav is little endian
+	for (unsigned i = 0; i + device.bytespersample <= size; i += device.bytespersample)
+	{
+		if (device.bytespersample == 2)
+		{
+			unsigned short v;
+			std::memcpy(&v, &stream[i], 2);
+			Write(out, v, 2);
+		}
+		else
+		{
+			unsigned v;
+			std::memcpy(&v, &stream[i], 4);
+			Write(out, v, 4);
+		}
+	}
+}
+
+void SoundBenchmark(std::ostream & out)
+{
+	const SoundInfo formats[] = {
+		SoundInfo(512, 44100, 2, 2),
+		SoundInfo(512, 44100, 2, 4)};
+	const unsigned voices[] = {8, 32, 64, 128, 256};
+
+	std::ostringstream error;
+	SoundRenderScript script;
+
+	out << "Offline sound mixer, " << script.seconds << "s at 44100 Hz stereo, 512 frame buffers, "
+		<< script.max_active << " active sources" << std::endl;
+	out << "format  voices    real  voice s/cpu s  realtime x" << std::endl;
+	out << std::fixed << std::setprecision(1);
+	for (const auto & format : formats)
+	{
+		for (unsigned n : voices)
+		{
+			SoundRenderStats stats;
+			script.voices = n;
+			if (!SoundRender(script, format, 0, stats, error))
+			{
+				out << error.str();
+				return;
+			}
+			out << ((format.bytespersample == 2) ? "s16   " : "f32   ")
+				<< std::setw(8) << n
+				<< std::setw(8) << stats.real_voices
+				<< std::setw(15) << stats.Throughput()
+				<< std::setw(12) << stats.audio_seconds / stats.cpu_seconds << std::endl;
+		}
+	}
+
+	// sound filter on a rendered stream, deinterleaved into channel buffers
+	SoundRenderStats stats;
+	std::vector<unsigned char> stream;
+	script.voices = 64;
+	SoundRender(script, formats[0], &stream, stats, error);
+
+	const unsigned frames = stream.size() / 4;
+	std::vector<int> chan1(frames), chan2(frames);
+	const short * samples = (const short *)stream.data();
+	for (unsigned i = 0; i < frames; ++i)
+	{
+		chan1[i] = samples[i * 2];
+		chan2[i] = samples[i * 2 + 1];
+	}
+
+	SoundFilter filter;
+	filter.SetFilterOrder1(0.1f, 0.1f, 0.8f);
+	const std::clock_t start = std::clock();
+	for (unsigned i = 0; i < frames; i += 512)
+		filter.Filter(&chan1[i], &chan2[i], std::min(512u, frames - i));
+	const double cpu_seconds = double(std::clock() - start) / CLOCKS_PER_SEC;
+
+	out << "sound filter order 1" << std::setw(19)
+		<< (cpu_seconds > 0 ? stats.audio_seconds / cpu_seconds : 0) << std::endl;
+}
+
+QT_TEST(soundrender_test)
+{
+	SoundRenderScript script;
+	script.voices = 12;
+	script.max_active = 8;
+	script.seconds = 0.6;
+
+	// rendering is deterministic and produces device buffers of audio
+	{
+		SoundInfo device(256, 44100, 2, 2);
+		std::ostringstream error;
+		SoundRenderStats stats;
+		std::vector<unsigned char> stream1, stream2;
+		QT_CHECK(SoundRender(script, device, &stream1, stats, error));
+		QT_CHECK(SoundRender(script, device, &stream2, stats, error));
+		QT_CHECK_EQUAL(stream1.size() % (256 * 4), 0);
+		QT_CHECK_EQUAL(stream1.size() / 4, 104 * 256);
+		QT_CHECK(stream1 == stream2);
+		QT_CHECK_EQUAL(stats.voices, 12);
+		QT_CHECK_CLOSE(stats.audio_seconds, 104 * 256 / 44100.0, 0.0001);
+		QT_CHECK_GREATER(stats.real_voices, 4);
+		QT_CHECK_LESS_OR_EQUAL(stats.real_voices, 8);
+
+		unsigned loud = 0;
+		const short * samples = (const short *)stream1.data();
+		for (unsigned i = 0; i < stream1.size() / 2; ++i)
+			loud += (std::abs(samples[i]) > 1000);
+		QT_CHECK_GREATER(loud, stream1.size() / 20);
+
+		std::ostringstream wav;
+		SoundWriteWav(device, stream1, wav);
+		const std::string data = wav.str();
+		QT_CHECK_EQUAL(data.size(), 44 + stream1.size());
+		QT_CHECK_EQUAL(data.substr(0, 4), "RIFF");
+		QT_CHECK_EQUAL(data.substr(36, 4), "data");
+	}
+
+	// float output stays within full scale
+	{
+		SoundInfo device(512, 48000, 2, 4);
+		std::ostringstream error;
+		SoundRenderStats stats;
+		std::vector<unsigned char> stream;
+		QT_CHECK(SoundRender(script, device, &stream, stats, error));
+		const float * samples = (const float *)stream.data();
+		float peak = 0;
+		for (unsigned i = 0; i < stream.size() / 4; ++i)
+			peak = std::max(peak, std::abs(samples[i]));
+		QT_CHECK_GREATER(peak, 0.05);
+		QT_CHECK_LESS(peak, 1.0001);
+	}
+
+	// unsupported formats are rejected
+	{
+		SoundInfo device(512, 44100, 1, 2);
+		std::ostringstream error;
+		SoundRenderStats stats;
+		QT_CHECK(!SoundRender(script, device, 0, stats, error));
+		QT_CHECK(!error.str().empty());
+	}
+}
@@ -0,0 +1,82 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _SOUNDRENDER_H
+#define _SOUNDRENDER_H
+
+#include "soundinfo.h"
+
+#include <iosfwd>
+#include <vector>
+
+/// Scripted scene for offline rendering. Voices are 3d sources circling the
+/// listener with pitch and gain sweeps, a mix of looping engine and tire
+/// sounds and one shot crash sounds that are reset when they stop. Every
+/// half second a voice is removed and replaced by a new one.
+struct SoundRenderScript
+{
+	/// concurrently playing sources
+	unsigned voices;
+
+	/// mixer active source limit, the quietest voices above it are muted
+	unsigned max_active;
+
+	/// rendered audio length
+	float seconds;
+
+	/// seed of the source motion and sweeps
+	unsigned seed;
+
+	SoundRenderScript();
+};
+
+struct SoundRenderStats
+{
+	unsigned voices;
+	float real_voices; ///< average mixed voices, the others are virtual
+	double audio_seconds;
+	double cpu_seconds;
+
+	SoundRenderStats();
+
+	/// mixer throughput in voices times seconds of audio per cpu second
+	double Throughput() const;
+};
+
+/// Render script through the same source update and sampler path the audio
+/// device callback uses. The sources are updated once per device buffer of
+/// device.samples frames. Device format has to be stereo with 16 bit integer
+/// or float samples. The interleaved output is appended to stream if not null.
+bool SoundRender(
+	const SoundRenderScript & script,
+	const SoundInfo & device,
+	std::vector<unsigned char> * stream,
+	SoundRenderStats & stats,
+	std::ostream & error);
+
+/// Write interleaved device format stream as wav file.
+void SoundWriteWav(
+	const SoundInfo & device,
+	const std::vector<unsigned char> & stream,
+	std::ostream & out);
+
+/// Measure mixer and sound filter throughput for a range of voice counts.
+void SoundBenchmark(std::ostream & out);
+
+#endif // _SOUNDRENDER_H
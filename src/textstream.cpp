@@ -0,0 +1,101 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "textstream.h"
+#include "unittest.h"
+
+#include <clocale>
+#include <cstdio>
+#include <iomanip>
+#include <locale>
+#include <sstream>
+
+TextStream::TextStream() :
+	std::ostream(this)
+{
+	std::ostream::imbue(std::locale::classic());
+	Reset();
+}
+
+void TextStream::Reset()
+{
+	setp(buffer, buffer + sizeof(buffer) - 1);
+	clear();
+	flags(std::ios_base::skipws | std::ios_base::dec);
+	precision(6);
+	width(0);
+	fill(' ');
+}
+
+const char * TextStream::c_str()
+{
+	*pptr() = 0;
+	return buffer;
+}
+
+float ParseFloat(const std::string & value)
+{
+	// the stream is reused to avoid locale copies on every call
+	static thread_local std::istringstream s = []
+	{
+		std::istringstream s;
+		s.imbue(std::locale::classic());
+		return s;
+	}();
+	s.clear();
+	s.str(value);
+	float v = 0;
+	s >> v;
+	return s.fail() ? 0 : v;
+}
+
+QT_TEST(textstream_test)
+{
+	// use a locale with a decimal comma if one is installed
+	const std::string old_locale = std::setlocale(LC_ALL, 0);
+	const char * comma_locales[] = {
+		"de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "fr_FR.utf8", "fr_FR", "German"};
+	for (auto name : comma_locales)
+	{
+		if (std::setlocale(LC_ALL, name))
+			break;
+	}
+
+	TextStream s;
+	s << std::setfill('0') << std::setw(2) << 1 << ":";
+	s << std::fixed << std::setprecision(3) << std::setw(6) << 2.5f;
+	QT_CHECK_EQUAL(std::string(s.c_str()), "01:02.500");
+
+	s.Reset();
+	s << 0.25f << " " << 1234567.0f;
+	QT_CHECK_EQUAL(std::string(s.c_str()), "0.25 1.23457e+06");
+
+	// overflow is truncated
+	s.Reset();
+	for (int i = 0; i < 100; ++i)
+		s << 'x';
+	QT_CHECK_EQUAL(std::string(s.c_str()), std::string(63, 'x'));
+
+	QT_CHECK_EQUAL(ParseFloat("0.75"), 0.75f);
+	QT_CHECK_EQUAL(ParseFloat("-2.5e1"), -25.0f);
+	QT_CHECK_EQUAL(ParseFloat("abc"), 0.0f);
+	QT_CHECK_EQUAL(ParseFloat(""), 0.0f);
+
+	std::setlocale(LC_ALL, old_locale.c_str());
+}
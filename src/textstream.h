@@ -0,0 +1,47 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _TEXTSTREAM_H
+#define _TEXTSTREAM_H
+
+#include <ostream>
+#include <string>
+
+/// Output stream formatting into a fixed size char buffer with the classic locale,
+/// so numbers are written with a decimal point whatever the process C locale is.
+/// Text exceeding the buffer is dropped.
+class TextStream : private std::streambuf, public std::ostream
+{
+public:
+	TextStream();
+
+	/// clear text and restore default formatting
+	void Reset();
+
+	/// zero terminated text
+	const char * c_str();
+
+private:
+	char buffer[64];
+};
+
+/// parse a float with the classic locale, returns 0 if value does not start with a number
+float ParseFloat(const std::string & value);
+
+#endif // _TEXTSTREAM_H
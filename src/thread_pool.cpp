@@ -0,0 +1,167 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+
+#include "thread_pool.h"
+#include "unittest.h"
+
+ThreadPool::ThreadPool(unsigned thread_count) :
+	pending(0),
+	fenv_version(0),
+	quit(false)
+{
+	if (thread_count == 0)
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+	threads.reserve(thread_count);
+	for (unsigned i = 0; i < thread_count; ++i)
+		threads.push_back(std::thread(&ThreadPool::Run, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	job_added.notify_all();
+	for (auto & thread : threads)
+		thread.join();
+}
+
+ThreadPool & ThreadPool::Shared()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+unsigned ThreadPool::GetThreadCount() const
+{
+	return threads.size();
+}
+
+void ThreadPool::Push(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(std::move(job));
+		++pending;
+	}
+	job_added.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	job_done.wait(lock, [this]() { return pending == 0; });
+}
+
+unsigned ThreadPool::GetPending() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return pending;
+}
+
+void ThreadPool::SetFloatingPointEnvironment()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::fegetenv(&fenv);
+	++fenv_version;
+}
+
+void ThreadPool::Run()
+{
+	unsigned version = 0;
+	while (true)
+	{
+		std::function<void()> job;
+		std::fenv_t job_fenv;
+		bool set_fenv = false;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			job_added.wait(lock, [this]() { return quit || !jobs.empty(); });
+			if (jobs.empty())
+				return;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+			if (version != fenv_version)
+			{
+				version = fenv_version;
+				job_fenv = fenv;
+				set_fenv = true;
+			}
+		}
+
+		if (set_fenv)
+			std::fesetenv(&job_fenv);
+
+		job();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			--pending;
+		}
+		job_done.notify_all();
+	}
+}
+
+QT_TEST(thread_pool_test)
+{
+	ThreadPool pool(3);
+	QT_CHECK_EQUAL(pool.GetThreadCount(), 3u);
+
+	// jobs
+	std::atomic<unsigned> sum(0);
+	for (unsigned i = 1; i <= 100; ++i)
+		pool.Push([&sum, i]() { sum += i; });
+	pool.Wait();
+	QT_CHECK_EQUAL(pool.GetPending(), 0u);
+	QT_CHECK_EQUAL(sum, 5050u);
+
+	// parallel for writes each index once
+	std::vector<unsigned> values(1000, 0);
+	pool.ParallelFor(values.size(), [&values](unsigned i) { values[i] += i; });
+	bool all = true;
+	for (unsigned i = 0; i < values.size(); ++i)
+		all = all && values[i] == i;
+	QT_CHECK(all);
+
+	// fewer items than threads
+	unsigned one = 0;
+	pool.ParallelFor(1, [&one](unsigned i) { one += i + 1; });
+	QT_CHECK_EQUAL(one, 1u);
+
+	// workers take over the rounding mode of the caller
+	const int rounding = std::fegetround();
+	std::fesetround(FE_UPWARD);
+	pool.SetFloatingPointEnvironment();
+	std::fesetround(rounding);
+	std::atomic<unsigned> upward(0);
+	for (unsigned i = 0; i < 100; ++i)
+		pool.Push([&upward]() { upward += (std::fegetround() == FE_UPWARD); });
+	pool.Wait();
+	QT_CHECK_EQUAL(upward, 100u);
+
+	pool.SetFloatingPointEnvironment();
+	std::atomic<unsigned> nearest(0);
+	for (unsigned i = 0; i < 100; ++i)
+		pool.Push([&nearest, rounding]() { nearest += (std::fegetround() == rounding); });
+	pool.Wait();
+	QT_CHECK_EQUAL(nearest, 100u);
+}
@@ -0,0 +1,115 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+
+#ifndef _THREAD_POOL_H
+#define _THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cfenv>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Fixed size pool of worker threads executing queued jobs in fifo order.
+class ThreadPool
+{
+public:
+	/// thread_count 0 uses the number of hardware threads
+	explicit ThreadPool(unsigned thread_count = 0);
+
+	/// finishes queued jobs
+	~ThreadPool();
+
+	/// pool shared by subsystems with short lived parallel work
+	static ThreadPool & Shared();
+
+	unsigned GetThreadCount() const;
+
+	/// queue job for execution on a worker thread
+	void Push(std::function<void()> job);
+
+	/// block until all queued jobs are done
+	void Wait();
+
+	/// number of queued and running jobs
+	unsigned GetPending() const;
+
+	/// workers switch to the floating point environment of the calling thread
+	/// (rounding mode, denormal handling) before they run their next job
+	void SetFloatingPointEnvironment();
+
+	/// call fn(i) for i in [0, count) on the worker threads and the calling thread
+	/// returns when all calls are done, must not be called from a worker thread
+	template <typename Fn>
+	void ParallelFor(unsigned count, Fn fn);
+
+private:
+	std::vector<std::thread> threads;
+	std::deque<std::function<void()> > jobs;
+	mutable std::mutex mutex;
+	std::condition_variable job_added;
+	std::condition_variable job_done;
+	unsigned pending;
+	unsigned fenv_version;
+	std::fenv_t fenv;
+	bool quit;
+
+	void Run();
+};
+
+template <typename Fn>
+void ThreadPool::ParallelFor(unsigned count, Fn fn)
+{
+	if (count == 0)
+		return;
+
+	std::atomic<unsigned> next(0);
+	auto work = [&]()
+	{
+		for (unsigned i = next++; i < count; i = next++)
+			fn(i);
+	};
+
+	const unsigned helpers = std::min<unsigned>(threads.size(), count - 1);
+	std::mutex wait_mutex;
+	std::condition_variable wait_done;
+	unsigned helpers_done = 0;
+	for (unsigned i = 0; i < helpers; ++i)
+	{
+		Push([&]()
+		{
+			work();
+			std::lock_guard<std::mutex> lock(wait_mutex);
+			++helpers_done;
+			wait_done.notify_one();
+		});
+	}
+	work();
+
+	// helpers reference local state, wait for all of them
+	std::unique_lock<std::mutex> lock(wait_mutex);
+	wait_done.wait(lock, [&]() { return helpers_done == helpers; });
+}
+
+#endif // _THREAD_POOL_H
@@ -25,6 +25,7 @@
 
 #include "BulletCollision/CollisionShapes/btCollisionShape.h"
 #include "BulletCollision/CollisionShapes/btStridingMeshInterface.h"
+#include "BulletDynamics/Dynamics/btRigidBody.h"
 
 Track::Track() : racingline_visible(false)
 {
@@ -45,6 +46,7 @@ bool Track::DeferredLoad(
 	const std::string & trackdir,
 	const std::string & texturedir,
 	const std::string & sharedobjectpath,
+	const std::string & racinglinecachepath,
 	const int anisotropy,
 	const bool reverse,
 	const bool dynamicobjects,
@@ -61,6 +63,7 @@ bool Track::DeferredLoad(
 			info_output, error_output,
 			trackpath, trackdir,
 			texturedir,	sharedobjectpath,
+			racinglinecachepath,
 			anisotropy, reverse,
 			dynamicobjects,
 			dynamicshadows));
@@ -117,9 +120,11 @@ void Track::Clear()
 	data.models.clear();
 	data.dynamic_node.Clear();
 	data.body_nodes.clear();
+	data.bodies.clear();
 	data.body_transforms.clear();
 	data.lap.clear();
 	data.roads.clear();
+	data.patch_index.Clear();
 	data.start_positions.clear();
 	data.racingline_node.Clear();
 	data.loaded = false;
@@ -157,9 +162,18 @@ void Track::Update()
 {
 	if (!data.loaded) return;
 
+	// restored snapshots move sleeping bodies too
+	const unsigned restore_count = data.world->getRestoreCount();
+	const bool restored = restore_count != data.body_restore_count;
+	data.body_restore_count = restore_count;
+
 	auto t = data.body_transforms.begin();
 	for (int i = 0, e = data.body_nodes.size(); i < e; ++i, ++t)
 	{
+		// sleeping bodies have not moved
+		if (!data.bodies[i]->isActive() && !restored)
+			continue;
+
 		Transform & vt = data.dynamic_node.GetNode(data.body_nodes[i]).GetTransform();
 		vt.SetRotation(ToQuaternion<float>(t->rotation));
 		vt.SetTranslation(ToMathVector<float>(t->position));
@@ -183,6 +197,7 @@ std::pair <Vec3, Quat > Track::GetStart(unsigned int index) const
 
 Track::Data::Data() :
 	world(0),
+	body_restore_count(0),
 	sun_direction(-0.250, -0.588, 0.769),
 	reverse(false),
 	loaded(false),
@@ -21,6 +21,7 @@
 #define _TRACK_H
 
 #include "roadstrip.h"
+#include "kdtree.h"
 #include "mathvector.h"
 #include "quaternion.h"
 #include "graphics/scenenode.h"
@@ -42,6 +43,7 @@ class ContentManager;
 class btStridingMeshInterface;
 class btCollisionShape;
 class btCollisionObject;
+class btRigidBody;
 
 class Track
 {
@@ -52,6 +54,7 @@ public:
 	/// Only begins loading the track.
     /// The track won't be loaded until more calls to ContinueDeferredLoad().
     /// Use Loaded() to see if loading is complete yet.
+    /// Racing lines are cached in racinglinecachepath, empty path disables the cache.
     /// Returns true if successful.
 	bool DeferredLoad(
 		ContentManager & content,
@@ -62,6 +65,7 @@ public:
 		const std::string & trackdir,
 		const std::string & effects_texturepath,
 		const std::string & sharedobjectpath,
+		const std::string & racinglinecachepath,
 		const int anisotropy,
 		const bool reverse,
 		const bool dynamicobjects,
@@ -118,6 +122,20 @@ public:
 		return data.lap[sector];
 	}
 
+	/// road patch with center nearest to position in the ground plane, null if there are no roads
+	const RoadPatch * GetNearestPatch(const Vec3 & position) const
+	{
+		const RoadPatch * patch = 0;
+		data.patch_index.Nearest(position[0], position[1], patch);
+		return patch;
+	}
+
+	/// append road patches with center within radius of position in the ground plane
+	void GetPatches(const Vec3 & position, float radius, std::vector<const RoadPatch *> & patches) const
+	{
+		data.patch_index.Query(position[0], position[1], radius, patches);
+	}
+
 	void SetRacingLineVisibility(bool newvis)
 	{
 		racingline_visible = newvis;
@@ -180,11 +198,14 @@ private:
 		// dynamic track objects
 		SceneNode dynamic_node;
 		std::vector<SceneNode::Handle> body_nodes;
+		std::vector<btRigidBody*> bodies;
 		std::list<MotionState> body_transforms;
+		unsigned body_restore_count;	// world restore count at the last node update
 
 		// road information
 		std::vector<const RoadPatch*> lap;
 		std::vector<RoadStrip> roads;
+		KdTree<const RoadPatch *> patch_index;
 		std::vector<std::pair<Vec3, Quat > > start_positions;
 
 		SceneNode racingline_node;
@@ -23,7 +23,9 @@
 #include "coordinatesystem.h"
 #include "tobullet.h"
 #include "k1999.h"
+#include "joeserialize.h"
 #include "minmax.h"
+#include "thread_pool.h"
 #include "content/contentmanager.h"
 #include "graphics/texture.h"
 #include "graphics/model.h"
@@ -34,10 +36,16 @@
 #include "BulletCollision/CollisionShapes/btTriangleIndexVertexArray.h"
 #include "BulletDynamics/Dynamics/btRigidBody.h"
 
+#include <cstdio>
+#include <iomanip>
+
 #define EXTBULLET
 
 static const float deg2rad = M_PI / 180;
 
+// bump to invalidate racing line cache files written by older versions
+static const int racingline_cache_version = 2;
+
 static inline std::istream & operator >> (std::istream & lhs, btVector3 & rhs)
 {
 	std::string str;
@@ -108,6 +116,7 @@ Track::Loader::Loader(
 	const std::string & trackdir,
 	const std::string & texturedir,
 	const std::string & sharedobjectpath,
+	const std::string & racinglinecachepath,
 	const int anisotropy,
 	const bool reverse,
 	const bool dynamic_objects,
@@ -121,6 +130,7 @@ Track::Loader::Loader(
 	trackdir(trackdir),
 	texturedir(texturedir),
 	sharedobjectpath(sharedobjectpath),
+	racinglinecachepath(racinglinecachepath),
 	anisotropy(anisotropy),
 	dynamic_objects(dynamic_objects),
 	dynamic_shadows(dynamic_shadows),
@@ -174,6 +184,8 @@ bool Track::Loader::BeginLoad()
 		return false;
 	}
 
+	CreatePatchIndex();
+
 	// load info
 	std::string info_path = trackpath + "/track.txt";
 	std::ifstream file(info_path.c_str());
@@ -436,6 +448,7 @@ Track::Loader::body_iterator Track::Loader::LoadBody(const PTree & cfg)
 	if ((packload && content.load(model, objectdir, model_name, pack)) ||
 		content.load(model, objectdir, model_name))
 	{
+		content.getFactory<Model>().genLods(*model);
 		data.models.insert(model);
 	}
 	else
@@ -594,9 +607,13 @@ bool Track::Loader::LoadNode(const PTree & sec)
 			btRigidBody::btRigidBodyConstructionInfo info(body.mass, &data.body_transforms.back(), body.shape, body.inertia);
 			info.m_friction = 0.9;
 
+			// objects are placed at rest, let them sleep until hit by an awake body
 			btRigidBody * object = new btRigidBody(info);
 			object->setContactProcessingThreshold(0.0);
+			object->setSleepingThresholds(0.2, 0.2);
+			object->setActivationState(ISLAND_SLEEPING);
 			data.objects.push_back(object);
+			data.bodies.push_back(object);
 			world.addRigidBody(object);
 
 			SceneNode::Handle node_handle = data.dynamic_node.AddNode();
@@ -696,6 +713,7 @@ bool Track::Loader::BeginOld()
 
 bool Track::Loader::AddObject(const Object & object)
 {
+	content.getFactory<Model>().genLods(*object.model);
 	data.models.insert(object.model);
 
 	TextureInfo texinfo;
@@ -941,21 +959,112 @@ bool Track::Loader::LoadRoads()
 
 bool Track::Loader::CreateRacingLines()
 {
-	K1999 k1999;
+	// K1999 requires a closed circuit
+	std::vector<RoadStrip *> roads;
 	for (auto & road : data.roads)
 	{
-		// K1999 requires a closed circuit
 		if (road.GetClosed())
+			roads.push_back(&road);
+	}
+	if (roads.empty())
+		return true;
+
+	std::vector<K1999> lines(roads.size());
+	for (size_t i = 0; i < roads.size(); ++i)
+		lines[i].LoadData(*roads[i]);
+
+	// cache file is keyed by the road edges and the reverse flag
+	std::string cachefile;
+	if (!racinglinecachepath.empty())
+	{
+		joeserialize::HashSerializer hash;
+		int version = racingline_cache_version;
+		bool reverse = data.reverse;
+		hash.Serialize("version", version);
+		hash.Serialize("reverse", reverse);
+		for (auto & line : lines)
+			line.SerializeRoad(hash);
+
+		std::ostringstream s;
+		s << racinglinecachepath << "/" << std::hex << std::setw(16) << std::setfill('0') << hash.GetHash() << ".rln";
+		cachefile = s.str();
+	}
+
+	bool cached = false;
+	if (!cachefile.empty())
+	{
+		std::ifstream file(cachefile.c_str(), std::ifstream::in | std::ifstream::binary);
+		if (file)
 		{
-			k1999.LoadData(road);
-			k1999.CalcRaceLine();
-			k1999.UpdateRoadStrip(road);
-			CreateRacingLine(road);
+			joeserialize::BinaryInputSerializer s(file);
+			cached = true;
+			for (size_t i = 0; i < lines.size() && cached; ++i)
+				cached = lines[i].Serialize(s);
+
+			if (cached)
+			{
+				info_output << "Loaded racing line from cache: " << cachefile << std::endl;
+			}
+			else
+			{
+				// partially read lines have to be reset
+				for (size_t i = 0; i < lines.size(); ++i)
+					lines[i].LoadData(*roads[i]);
+			}
 		}
 	}
+
+	if (!cached)
+	{
+		ThreadPool::Shared().ParallelFor(lines.size(), [&lines](unsigned i)
+		{
+			lines[i].CalcRaceLine();
+		});
+
+		if (!cachefile.empty())
+		{
+			// write to a temporary file first, a concurrent loader never sees a partial cache file
+			const std::string tempfile = cachefile + ".tmp";
+			bool written;
+			{
+				std::ofstream file(tempfile.c_str(), std::ofstream::out | std::ofstream::binary);
+				joeserialize::BinaryOutputSerializer s(file);
+				written = bool(file);
+				for (size_t i = 0; i < lines.size() && written; ++i)
+					written = lines[i].Serialize(s);
+				written = written && file.flush();
+			}
+
+			if (!written || std::rename(tempfile.c_str(), cachefile.c_str()) != 0)
+			{
+				error_output << "Failed to write racing line cache: " << cachefile << std::endl;
+				std::remove(tempfile.c_str());
+			}
+		}
+	}
+
+	for (size_t i = 0; i < roads.size(); ++i)
+	{
+		lines[i].UpdateRoadStrip(*roads[i]);
+		CreateRacingLine(*roads[i]);
+	}
 	return true;
 }
 
+void Track::Loader::CreatePatchIndex()
+{
+	data.patch_index.Clear();
+	for (const auto & road : data.roads)
+	{
+		for (const auto & patch : road.GetPatches())
+		{
+			Vec3 center = (patch.GetFL() + patch.GetFR() + patch.GetBL() + patch.GetBR()) * 0.25f;
+			data.patch_index.Add(center[0], center[1], &patch);
+		}
+	}
+	data.patch_index.Build();
+}
+
 template <bool set_faces>
 static void AddRacingLineSegment(
 	const RoadPatch & patch,
@@ -65,6 +65,7 @@ public:
 		const std::string & trackdir,
 		const std::string & texturedir,
 		const std::string & sharedobjectpath,
+		const std::string & racinglinecachepath,
 		const int anisotropy,
 		const bool reverse,
 		const bool dynamic_shadows,
@@ -91,6 +92,7 @@ private:
 	const std::string & trackdir;
 	const std::string & texturedir;
 	const std::string & sharedobjectpath;
+	const std::string racinglinecachepath;
 	const int anisotropy;
 	const bool dynamic_objects;
 	const bool dynamic_shadows;
@@ -144,6 +146,8 @@ private:
 
 	bool CreateRacingLines();
 
+	void CreatePatchIndex();
+
 	void CreateRacingLine(const RoadStrip & strip);
 
 	bool LoadStartPositions(const PTree & info);
@@ -20,43 +20,25 @@
 #include "trackmap.h"
 #include "content/contentmanager.h"
 #include "graphics/texture.h"
+#include "joeserialize.h"
 #include "minmax.h"
+#include "thread_pool.h"
+#include "unittest.h"
 
-TrackMap::TrackMap() :
-	map_width(256),
-	map_height(256),
-	map_scale(1.0)
-{
-	// ctor
-}
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
 
-TrackMap::~TrackMap()
-{
-	Unload();
-}
+// bump to invalidate map cache files written by older versions
+static const int map_cache_version = 1;
 
-void TrackMap::Unload()
-{
-	dotlist.clear();
-	mapnode.Clear();
-	mapdraw.invalidate();
-}
+// map tile size in pixels, multiple of the rasterizer block size
+static const int map_tile_size = 64;
 
-bool TrackMap::BuildMap(
-	const int screen_width,
-	const int screen_height,
-	const std::vector <RoadStrip> & roads,
-	const std::string & trackname,
-	const std::string & texturepath,
-	ContentManager & content,
-	std::ostream & /*error_output*/)
+static void GetTrackBounds(const std::vector<RoadStrip> & roads, Vec2 & track_min, Vec2 & track_max)
 {
-	Unload();
-
-	pixel_size[0] = 1.0f / screen_width;
-	pixel_size[1] = 1.0f / screen_height;
-
-	// track aabb
 	track_min[0] = +1E6;
 	track_min[1] = +1E6;
 	track_max[0] = -1E6;
@@ -91,111 +73,126 @@ bool TrackMap::BuildMap(
 			}
 		}
 	}
+}
 
-	// determine the scaling factor
-	// we will leave a 1 pixel border
+// we will leave a 1 pixel border
+static float GetMapScale(const Vec2 & track_min, const Vec2 & track_max, int map_width, int map_height)
+{
 	const float track_width = track_max[0] - track_min[0];
 	const float track_height = track_max[1] - track_min[1];
 	const float map_scale_w = (map_width - 2) / track_width;
 	const float map_scale_h = (map_height - 2) / track_height;
-	map_scale = Min(map_scale_w, map_scale_h);
-
-	std::vector<unsigned> pixels(map_width * map_height, 0);
-	const unsigned color = 0xffffffff;
+	return Min(map_scale_w, map_scale_h);
+}
 
+// cache file is keyed by the map settings and the road patch corners
+static std::string GetMapCacheFile(
+	const std::string & cachepath,
+	const std::vector<RoadStrip> & roads,
+	Vec2 offset, float scale,
+	int width, int height, int samples)
+{
+	joeserialize::HashSerializer hash;
+	int version = map_cache_version;
+	hash.Serialize("version", version);
+	hash.Serialize("width", width);
+	hash.Serialize("height", height);
+	hash.Serialize("samples", samples);
+	hash.Serialize("offset0", offset[0]);
+	hash.Serialize("offset1", offset[1]);
+	hash.Serialize("scale", scale);
 	for (const auto & road : roads)
 	{
 		for (const auto & p : road.GetPatches())
 		{
-			const Vec3 & bl = p.GetBL();
-			const Vec3 & br = p.GetBR();
-			const Vec3 & fl = p.GetFL();
-			const Vec3 & fr = p.GetFR();
-
-			float x[6], y[6];
-			x[2] = (bl[1] - track_min[0]) * map_scale + 1;
-			y[2] = (bl[0] - track_min[1]) * map_scale + 1;
-			x[1] = (fl[1] - track_min[0]) * map_scale + 1;
-			y[1] = (fl[0] - track_min[1]) * map_scale + 1;
-			x[0] = (fr[1] - track_min[0]) * map_scale + 1;
-			y[0] = (fr[0] - track_min[1]) * map_scale + 1;
-			x[3] = x[2];
-			y[3] = y[2];
-			x[4] = (br[1] - track_min[0]) * map_scale + 1;
-			y[4] = (br[0] - track_min[1]) * map_scale + 1;
-			x[5] = x[0];
-			y[5] = y[0];
-
-			RasterizeTriangle(x, y, color, pixels.data(), map_width);
-			RasterizeTriangle(x + 3, y + 3, color, pixels.data(), map_width);
-		}
-	}
-/*
-	// should operate on alpha only or on each channel?
-	// horizontal blur 3x3
-	for (int y = 1; y < map_height - 1; ++y)
-	{
-		unsigned * line = pixels.data() + y * map_width;
-		unsigned p = line[0];
-		for (int x = 1; x < map_width - 1; ++x)
-		{
-			//unsigned v = (line0[x] + (line1[x] << 1) + line2[x]) >> 2;
-			unsigned v = (line[x-1] >> 2) + (line[x] >> 1) + (line[x+1] >> 2);
-			line[x-1] = p;
-			p = v;
+			const Vec3 * corners[4] = {&p.GetBL(), &p.GetBR(), &p.GetFL(), &p.GetFR()};
+			for (auto c : corners)
+			{
+				float x = (*c)[0], y = (*c)[1];
+				hash.Serialize("x", x);
+				hash.Serialize("y", y);
+			}
 		}
-		line[map_width - 2] = p;
 	}
-	// vertical blur 3x3
-	std::vector<unsigned> linep(map_width, 0);
-	for (int y = 1; y < map_height - 1; ++y)
+
+	std::ostringstream s;
+	s << cachepath << "/" << std::hex << std::setw(16) << std::setfill('0') << hash.GetHash() << ".map";
+	return s.str();
+}
+
+TrackMap::TrackMap() :
+	map_width(256),
+	map_height(256),
+	map_samples(2),
+	map_scale(1.0)
+{
+	// ctor
+}
+
+TrackMap::~TrackMap()
+{
+	Unload();
+}
+
+void TrackMap::Unload()
+{
+	dotlist.clear();
+	mapnode.Clear();
+	mapdraw.invalidate();
+}
+
+bool TrackMap::BuildMap(
+	const int screen_width,
+	const int screen_height,
+	const std::vector <RoadStrip> & roads,
+	const std::string & trackname,
+	const std::string & texturepath,
+	const std::string & cachepath,
+	ContentManager & content,
+	std::ostream & error_output)
+{
+	Unload();
+
+	pixel_size[0] = 1.0f / screen_width;
+	pixel_size[1] = 1.0f / screen_height;
+
+	GetTrackBounds(roads, track_min, track_max);
+	map_scale = GetMapScale(track_min, track_max, map_width, map_height);
+	const float track_width = track_max[0] - track_min[0];
+	const float track_height = track_max[1] - track_min[1];
+
+	std::vector<unsigned> pixels;
+	std::string cachefile;
+	if (!cachepath.empty())
 	{
-		unsigned * line0 = pixels.data() + (y - 1) * map_width;
-		unsigned * line1 = pixels.data() + y * map_width;
-		unsigned * line2 = pixels.data() + (y + 1) * map_width;
-		for (int x = 1; x < map_width - 1; ++x)
+		cachefile = GetMapCacheFile(cachepath, roads, track_min, map_scale, map_width, map_height, map_samples);
+		std::ifstream file(cachefile.c_str(), std::ifstream::in | std::ifstream::binary);
+		if (file)
 		{
-			//unsigned v = (line0[x] + (line1[x] << 1) + line2[x]) >> 2;
-			unsigned v = (line0[x] >> 2) + (line1[x] >> 1) + (line2[x] >> 2);
-			line0[x] = linep[x];
-			linep[x] = v;
+			pixels.resize(map_width * map_height);
+			file.read((char *)pixels.data(), pixels.size() * sizeof(unsigned));
+			if (file.gcount() != std::streamsize(pixels.size() * sizeof(unsigned)))
+				pixels.clear();
 		}
 	}
-*/
-	// draw a black border around the track
-	const unsigned rgbmask = 0x00ffffff;
-	const unsigned amask = 0xff000000;
-	for (int x = 0; x < map_width; x++)
+
+	if (pixels.empty())
 	{
-		for (int y = 0; y < map_height; y++)
+		RasterizeRoads(roads, track_min, map_scale, map_width, map_height, map_samples, &ThreadPool::Shared(), pixels);
+
+		if (!cachefile.empty())
 		{
-			// if this pixel is black
-			if (pixels[map_width * y + x] == 0)
+			// write to a temporary file first, a concurrent loader never sees a partial cache file
+			const std::string tempfile = cachefile + ".tmp";
+			bool written;
 			{
-				// if the pixel above this one is non-black
-				if ((y > 0) && ((pixels[map_width * (y-1) + x] & rgbmask) > 0))
-				{
-					// set this pixel to non-transparent
-					pixels[map_width * y + x] |= amask;
-				}
-				// if the pixel left of this one is non-black
-				if ((x > 0) && ((pixels[map_width * y + x - 1] & rgbmask) > 0))
-				{
-					// set this pixel to non-transparent
-					pixels[map_width * y + x] |= amask;
-				}
-				// if the pixel right of this one is non-black
-				if ((x < (map_width - 1)) && ((pixels[map_width * y + x + 1] & rgbmask) > 0))
-				{
-					// set this pixel to non-transparent
-					pixels[map_width * y + x] |= amask;
-				}
-				// if the pixel below this one is non-black
-				if ((y < (map_height - 1)) && ((pixels[map_width * (y+1) + x] & rgbmask) > 0))
-				{
-					// set this pixel to non-transparent
-					pixels[map_width * y + x] |= amask;
-				}
+				std::ofstream file(tempfile.c_str(), std::ofstream::out | std::ofstream::binary);
+				written = bool(file.write((const char *)pixels.data(), pixels.size() * sizeof(unsigned)).flush());
+			}
+			if (!written || std::rename(tempfile.c_str(), cachefile.c_str()) != 0)
+			{
+				error_output << "Failed to write track map cache: " << cachefile << std::endl;
+				std::remove(tempfile.c_str());
 			}
 		}
 	}
@@ -303,7 +300,8 @@ void TrackMap::RasterizeTriangle(
 	const float vy[3],
 	unsigned color,
 	unsigned color_buffer[],
-	unsigned buffer_width)
+	unsigned buffer_width,
+	const int clip[4])
 {
 	// Triangle rasterizer (8x8 block) by Nicolas Capens
 	// see http://devmaster.net/posts/6145/advanced-rasterization
@@ -344,6 +342,13 @@ void TrackMap::RasterizeTriangle(
 	// Block size, standard 8x8 (must be power of two)
 	const int q = 8;
 
+	// Clip to the destination rectangle
+	minx = Max(minx, clip[0]);
+	miny = Max(miny, clip[1]);
+	maxx = Min(maxx, clip[2]);
+	maxy = Min(maxy, clip[3]);
+	if (minx >= maxx || miny >= maxy) return;
+
 	// Start in corner of 8x8 block
 	minx &= ~(q - 1);
 	miny &= ~(q - 1);
@@ -414,22 +419,16 @@ void TrackMap::RasterizeTriangle(
 				int CY2 = C2 + DX23 * y0 - DY23 * x0;
 				int CY3 = C3 + DX31 * y0 - DY31 * x0;
 
+				// Branch free edge tests with a select mask, the inner loop is vectorized
 				for (int iy = y; iy < y + q; iy++)
 				{
-					int CX1 = CY1;
-					int CX2 = CY2;
-					int CX3 = CY3;
-
-					for (int ix = x; ix < x + q; ix++)
+					for (int ix = 0; ix < q; ix++)
 					{
-						if (CX1 > 0 && CX2 > 0 && CX3 > 0)
-						{
-							buffer[ix] = color;
-						}
-
-						CX1 -= FDY12;
-						CX2 -= FDY23;
-						CX3 -= FDY31;
+						const unsigned inside = -unsigned(
+							(CY1 - ix * FDY12 > 0) &
+							(CY2 - ix * FDY23 > 0) &
+							(CY3 - ix * FDY31 > 0));
+						buffer[x + ix] = (buffer[x + ix] & ~inside) | (color & inside);
 					}
 
 					CY1 += FDX12;
@@ -444,3 +443,355 @@ void TrackMap::RasterizeTriangle(
 		color_buffer += q * buffer_width;
 	}
 }
+
+void TrackMap::RasterizeRoads(
+	const std::vector<RoadStrip> & roads,
+	const Vec2 & offset,
+	float scale,
+	int width,
+	int height,
+	int samples,
+	ThreadPool * pool,
+	std::vector<unsigned> & pixels)
+{
+	samples = Clamp(samples, 1, 4);
+	const int sample_width = width * samples;
+	const int sample_height = height * samples;
+	const float sample_scale = scale * samples;
+	const float sample_offset = samples;
+
+	// road patch triangles in sample space
+	std::vector<float> tris;
+	for (const auto & road : roads)
+	{
+		for (const auto & p : road.GetPatches())
+		{
+			const Vec3 * v[6] = {
+				&p.GetFR(), &p.GetFL(), &p.GetBL(),
+				&p.GetBL(), &p.GetBR(), &p.GetFR()};
+			for (auto c : v)
+			{
+				tris.push_back(((*c)[1] - offset[0]) * sample_scale + sample_offset);
+				tris.push_back(((*c)[0] - offset[1]) * sample_scale + sample_offset);
+			}
+		}
+	}
+	const unsigned tri_count = tris.size() / 6;
+
+	// bin triangles into map tiles by their bounding box
+	const int tile_size = map_tile_size * samples;
+	const int tiles_x = (sample_width + tile_size - 1) / tile_size;
+	const int tiles_y = (sample_height + tile_size - 1) / tile_size;
+	std::vector<std::vector<unsigned>> bins(tiles_x * tiles_y);
+	for (unsigned i = 0; i < tri_count; ++i)
+	{
+		const float * t = &tris[i * 6];
+		const float minx = Min(t[0], t[2], t[4]);
+		const float maxx = Max(t[0], t[2], t[4]);
+		const float miny = Min(t[1], t[3], t[5]);
+		const float maxy = Max(t[1], t[3], t[5]);
+		const int tx0 = Clamp(int(minx) / tile_size, 0, tiles_x - 1);
+		const int tx1 = Clamp(int(maxx + 1) / tile_size, 0, tiles_x - 1);
+		const int ty0 = Clamp(int(miny) / tile_size, 0, tiles_y - 1);
+		const int ty1 = Clamp(int(maxy + 1) / tile_size, 0, tiles_y - 1);
+		for (int ty = ty0; ty <= ty1; ++ty)
+		{
+			for (int tx = tx0; tx <= tx1; ++tx)
+			{
+				bins[ty * tiles_x + tx].push_back(i);
+			}
+		}
+	}
+
+	// rasterize tiles, each tile owns its part of the sample buffer
+	std::vector<unsigned> sample_buffer(sample_width * sample_height, 0);
+	auto rasterize_tile = [&](unsigned n)
+	{
+		const int tx = n % tiles_x;
+		const int ty = n / tiles_x;
+		const int clip[4] = {
+			tx * tile_size,
+			ty * tile_size,
+			Min((tx + 1) * tile_size, sample_width),
+			Min((ty + 1) * tile_size, sample_height)};
+		for (unsigned i : bins[n])
+		{
+			const float vx[3] = {tris[i * 6 + 0], tris[i * 6 + 2], tris[i * 6 + 4]};
+			const float vy[3] = {tris[i * 6 + 1], tris[i * 6 + 3], tris[i * 6 + 5]};
+			RasterizeTriangle(vx, vy, 0xffffffff, sample_buffer.data(), sample_width, clip);
+		}
+	};
+	const unsigned tile_count = tiles_x * tiles_y;
+	if (pool)
+	{
+		pool->ParallelFor(tile_count, rasterize_tile);
+	}
+	else
+	{
+		for (unsigned n = 0; n < tile_count; ++n)
+			rasterize_tile(n);
+	}
+
+	// resolve sample coverage into road color
+	pixels.resize(width * height);
+	if (samples == 1)
+	{
+		pixels.swap(sample_buffer);
+	}
+	else
+	{
+		const unsigned sample_count = samples * samples;
+		for (int y = 0; y < height; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				const unsigned * s = &sample_buffer[(y * samples) * sample_width + x * samples];
+				unsigned count = 0;
+				for (int j = 0; j < samples; ++j)
+				{
+					for (int i = 0; i < samples; ++i)
+					{
+						count += s[i] & 1;
+					}
+					s += sample_width;
+				}
+				const unsigned c = count * 255 / sample_count;
+				pixels[y * width + x] = c ? (0xff000000 | (c * 0x010101)) : 0;
+			}
+		}
+	}
+
+	// draw a black border around the track
+	const unsigned rgbmask = 0x00ffffff;
+	const unsigned amask = 0xff000000;
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			// if this pixel is black
+			if (pixels[width * y + x] == 0)
+			{
+				// if the pixel above this one is non-black
+				if ((y > 0) && ((pixels[width * (y-1) + x] & rgbmask) > 0))
+				{
+					// set this pixel to non-transparent
+					pixels[width * y + x] |= amask;
+				}
+				// if the pixel left of this one is non-black
+				if ((x > 0) && ((pixels[width * y + x - 1] & rgbmask) > 0))
+				{
+					// set this pixel to non-transparent
+					pixels[width * y + x] |= amask;
+				}
+				// if the pixel right of this one is non-black
+				if ((x < (width - 1)) && ((pixels[width * y + x + 1] & rgbmask) > 0))
+				{
+					// set this pixel to non-transparent
+					pixels[width * y + x] |= amask;
+				}
+				// if the pixel below this one is non-black
+				if ((y < (height - 1)) && ((pixels[width * (y+1) + x] & rgbmask) > 0))
+				{
+					// set this pixel to non-transparent
+					pixels[width * y + x] |= amask;
+				}
+			}
+		}
+	}
+}
+
+void TrackMap::Benchmark(
+	const std::string & trackspath,
+	const std::list<std::string> & tracks,
+	std::ostream & out)
+{
+	const int width = 256;
+	const int height = 256;
+	const int iterations = 20;
+
+	// tiled timings depend on the pool size, report it with the results
+	out << "pool threads: " << ThreadPool::Shared().GetThreadCount() << std::endl;
+	out << std::left << std::setw(24) << "track" << std::right
+		<< std::setw(12) << "serial 1x"
+		<< std::setw(12) << "tiled 1x"
+		<< std::setw(12) << "tiled 2x"
+		<< std::setw(12) << "tiled 4x"
+		<< "  (ms per map)" << std::endl;
+
+	for (const auto & track : tracks)
+	{
+		std::ifstream file((trackspath + "/" + track + "/roads.trk").c_str());
+		if (!file)
+			continue;
+
+		int numroads = 0;
+		file >> numroads;
+		std::vector<RoadStrip> roads;
+		std::ostringstream error;
+		for (int i = 0; i < numroads && file; ++i)
+		{
+			roads.push_back(RoadStrip());
+			roads.back().ReadFrom(file, false, error);
+		}
+		if (roads.empty())
+			continue;
+
+		Vec2 track_min, track_max;
+		GetTrackBounds(roads, track_min, track_max);
+		const float scale = GetMapScale(track_min, track_max, width, height);
+
+		struct Run { int samples; ThreadPool * pool; };
+		const Run runs[] = {{1, 0}, {1, &ThreadPool::Shared()}, {2, &ThreadPool::Shared()}, {4, &ThreadPool::Shared()}};
+
+		out << std::left << std::setw(24) << track << std::right << std::fixed << std::setprecision(3);
+		std::vector<unsigned> pixels;
+		for (const auto & run : runs)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < iterations; ++i)
+			{
+				RasterizeRoads(roads, track_min, scale, width, height, run.samples, run.pool, pixels);
+			}
+			const auto end = std::chrono::steady_clock::now();
+			const double ms = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+			out << std::setw(12) << ms;
+		}
+		out << std::endl;
+	}
+}
+
+// reference rasterizer, evaluates the block rasterizer edge functions
+// for every pixel of the buffer, without blocks or clipping
+static void RasterizeTriangleReference(
+	const float vx[3],
+	const float vy[3],
+	unsigned color,
+	unsigned color_buffer[],
+	int buffer_width,
+	int buffer_height)
+{
+	int X[3], Y[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		X[i] = 16.0f * vx[i] + 0.5f;
+		Y[i] = 16.0f * vy[i] + 0.5f;
+	}
+
+	int DX[3], DY[3], C[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		const int j = (i + 1) % 3;
+		DX[i] = X[i] - X[j];
+		DY[i] = Y[i] - Y[j];
+		C[i] = DY[i] * X[i] - DX[i] * Y[i];
+		if (DY[i] < 0 || (DY[i] == 0 && DX[i] > 0)) C[i]++;
+	}
+
+	for (int y = 0; y < buffer_height; ++y)
+	{
+		for (int x = 0; x < buffer_width; ++x)
+		{
+			bool inside = true;
+			for (int i = 0; i < 3; ++i)
+				inside = inside && C[i] + DX[i] * (y << 4) - DY[i] * (x << 4) > 0;
+			if (inside)
+				color_buffer[y * buffer_width + x] = color;
+		}
+	}
+}
+
+// road brightness per pixel from the reference rasterizer at samples per pixel axis
+static std::vector<unsigned> GetReferenceCoverage(
+	const std::vector<RoadStrip> & roads,
+	const Vec2 & offset,
+	float scale,
+	int width,
+	int height,
+	int samples)
+{
+	const int sample_width = width * samples;
+	const int sample_height = height * samples;
+	std::vector<unsigned> sample_buffer(sample_width * sample_height, 0);
+	for (const auto & road : roads)
+	{
+		for (const auto & p : road.GetPatches())
+		{
+			const Vec3 * v[6] = {
+				&p.GetFR(), &p.GetFL(), &p.GetBL(),
+				&p.GetBL(), &p.GetBR(), &p.GetFR()};
+			for (int t = 0; t < 2; ++t)
+			{
+				float vx[3], vy[3];
+				for (int i = 0; i < 3; ++i)
+				{
+					const Vec3 & c = *v[t * 3 + i];
+					vx[i] = (c[1] - offset[0]) * scale * samples + samples;
+					vy[i] = (c[0] - offset[1]) * scale * samples + samples;
+				}
+				RasterizeTriangleReference(vx, vy, 1, sample_buffer.data(), sample_width, sample_height);
+			}
+		}
+	}
+
+	std::vector<unsigned> coverage(width * height, 0);
+	for (int y = 0; y < sample_height; ++y)
+	{
+		for (int x = 0; x < sample_width; ++x)
+		{
+			coverage[(y / samples) * width + x / samples] += sample_buffer[y * sample_width + x];
+		}
+	}
+	for (auto & c : coverage)
+		c = c * 255 / (samples * samples);
+	return coverage;
+}
+
+QT_TEST(trackmap_test)
+{
+	// a strip of two slanted patches crossing several map tiles
+	RoadStrip road;
+	road.GetPatches().resize(2);
+	road.GetPatches()[0].SetFromCorners(Vec3(100, 40, 0), Vec3(100, 20, 0), Vec3(0, 30, 0), Vec3(0, 10, 0));
+	road.GetPatches()[1].SetFromCorners(Vec3(200, 70, 0), Vec3(200, 50, 0), Vec3(100, 40, 0), Vec3(100, 20, 0));
+	std::vector<RoadStrip> roads(1, road);
+
+	Vec2 track_min, track_max;
+	GetTrackBounds(roads, track_min, track_max);
+	const float scale = GetMapScale(track_min, track_max, 256, 256);
+	QT_CHECK_EQUAL(track_min[0], 10);
+	QT_CHECK_EQUAL(track_max[1], 200);
+
+	// tiled rasterization matches the serial one
+	std::vector<unsigned> serial, tiled;
+	TrackMap::RasterizeRoads(roads, track_min, scale, 256, 256, 1, 0, serial);
+	TrackMap::RasterizeRoads(roads, track_min, scale, 256, 256, 1, &ThreadPool::Shared(), tiled);
+	QT_CHECK(serial == tiled);
+
+	// road center at (50, 25) is white, corners are transparent
+	const unsigned center = 64 * 256 + 20;
+	QT_CHECK_EQUAL(serial[center], 0xffffffff);
+	QT_CHECK_EQUAL(serial[0], 0);
+	QT_CHECK_EQUAL(serial[256 * 256 - 1], 0);
+
+	// antialiased map has the same interior and partially covered edge pixels
+	std::vector<unsigned> aa;
+	TrackMap::RasterizeRoads(roads, track_min, scale, 256, 256, 4, &ThreadPool::Shared(), aa);
+	QT_CHECK_EQUAL(aa[center], 0xffffffff);
+	QT_CHECK_EQUAL(aa[0], 0);
+	unsigned partial = 0;
+	for (unsigned p : aa)
+		partial += ((p & 0xff) > 0 && (p & 0xff) < 0xff);
+	QT_CHECK(partial > 0);
+
+	// road brightness matches the unclipped reference rasterizer for all sample counts
+	for (int samples = 1; samples <= 4; ++samples)
+	{
+		std::vector<unsigned> pixels;
+		TrackMap::RasterizeRoads(roads, track_min, scale, 256, 256, samples, &ThreadPool::Shared(), pixels);
+		const std::vector<unsigned> coverage = GetReferenceCoverage(roads, track_min, scale, 256, 256, samples);
+		unsigned mismatch = 0;
+		for (unsigned i = 0; i < pixels.size(); ++i)
+			mismatch += (pixels[i] & 0xff) != coverage[i];
+		QT_CHECK_EQUAL(mismatch, 0);
+	}
+}
@@ -28,10 +28,12 @@
 
 #include <memory>
 #include <iosfwd>
+#include <list>
 #include <string>
 #include <vector>
 
 class ContentManager;
+class ThreadPool;
 
 class TrackMap
 {
@@ -41,6 +43,7 @@ public:
 	~TrackMap();
 
 	/// w and h are the display device dimensions in pixels
+	/// the map image is cached in cachepath, empty path disables the cache
 	/// returns true if successful
 	bool BuildMap(
 		const int screen_width,
@@ -48,6 +51,7 @@ public:
 		const std::vector <RoadStrip> & roads,
 		const std::string & trackname,
 		const std::string & texturepath,
+		const std::string & cachepath,
 		ContentManager & content,
 		std::ostream & error_output);
 
@@ -58,19 +62,45 @@ public:
 
 	SceneNode & GetNode() {return mapnode;}
 
-	/// raterize vxy triangle into 32bit rgba color buffer, stride is in bytes
+	/// raterize vxy triangle into 32bit rgba color buffer, buffer width is in pixels
+	/// only pixels inside of the clip rectangle (x0, y0, x1, y1) are written,
+	/// clip rectangle corners have to be multiples of 8
 	static void RasterizeTriangle(
 		const float vx[3],
 		const float vy[3],
 		unsigned color,
 		unsigned color_buffer[],
-		unsigned buffer_width);
+		unsigned buffer_width,
+		const int clip[4]);
+
+	/// rasterize road patches into a width x height rgba map, roads are white with a black border
+	/// world position (x, y) is mapped to pixel ((y - offset[0]) * scale + 1, (x - offset[1]) * scale + 1)
+	/// samples (1 - 4) per pixel axis give antialiased road edges, width and height have to be multiples of 8
+	/// map tiles are rasterized on the pool if provided
+	static void RasterizeRoads(
+		const std::vector<RoadStrip> & roads,
+		const Vec2 & offset,
+		float scale,
+		int width,
+		int height,
+		int samples,
+		ThreadPool * pool,
+		std::vector<unsigned> & pixels);
+
+	/// rasterize the road data of the listed tracks and report timings
+	static void Benchmark(
+		const std::string & trackspath,
+		const std::list<std::string> & tracks,
+		std::ostream & out);
 
 private:
 	// map texture size
 	const int map_width;
 	const int map_height;
 
+	// antialiasing samples per map pixel axis
+	const int map_samples;
+
 	// track to map scale factor
 	float map_scale;
 
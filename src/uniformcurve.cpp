@@ -0,0 +1,191 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "uniformcurve.h"
+#include "linearinterp.h"
+#include "spline.h"
+#include "unittest.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <ostream>
+#include <random>
+#include <vector>
+
+// torque curve of a 1.8l four cylinder, rpm and Nm
+static const float benchmark_curve[][2] = {
+	{1000, 120}, {1600, 136}, {2000, 147}, {2400, 150}, {2800, 150},
+	{3200, 150}, {3500, 155}, {4000, 165}, {4400, 164}, {4800, 165},
+	{5000, 161}, {5500, 155}, {6000, 150}, {6400, 175}, {6800, 180},
+	{7600, 170}};
+
+template <class Curve>
+static double BenchmarkLookup(const Curve & curve, const std::vector<float> & x, float & sum)
+{
+	typedef std::chrono::steady_clock Clock;
+	const double min_time = 0.25;
+	unsigned count = 0;
+	double time = 0;
+	const Clock::time_point start = Clock::now();
+	while (time < min_time)
+	{
+		for (float xi : x)
+			sum += curve.Interpolate(xi);
+		count += x.size();
+		time = std::chrono::duration<double>(Clock::now() - start).count();
+	}
+	return 1E9 * time / count;
+}
+
+template <int N>
+static void BenchmarkUniformCurve(
+	const Spline<float> & spline, float x0, float x1,
+	const std::vector<float> & x, double spline_time,
+	std::ostream & out, float & sum)
+{
+	UniformCurve<float, N> curve;
+	curve.Sample(spline, x0, x1);
+
+	float peak = 0, max_error = 0;
+	for (float xi = x0; xi <= x1; xi += 1)
+	{
+		float y = spline.Interpolate(xi);
+		peak = std::max(peak, std::abs(y));
+		max_error = std::max(max_error, std::abs(curve.Interpolate(xi) - y));
+	}
+
+	double time = BenchmarkLookup(curve, x, sum);
+	out << "uniform " << std::setw(3) << N
+		<< std::setw(10) << time
+		<< std::setw(10) << spline_time / time
+		<< std::setw(10) << 100 * max_error / peak << std::endl;
+}
+
+void UniformCurveBenchmark(std::ostream & out)
+{
+	Spline<float> spline;
+	for (const auto & p : benchmark_curve)
+		spline.AddPoint(p[0], p[1]);
+	spline.Calculate();
+
+	const float x0 = benchmark_curve[0][0];
+	const float x1 = benchmark_curve[sizeof(benchmark_curve) / sizeof(benchmark_curve[0]) - 1][0];
+
+	// engines of a field of cars revving independently
+	std::mt19937 random(0);
+	std::uniform_real_distribution<float> start(x0, x1);
+	std::uniform_real_distribution<float> step(-50, 50);
+	std::vector<float> x(64 * 256);
+	for (size_t car = 0; car < 64; ++car)
+	{
+		float rpm = start(random);
+		for (size_t tick = 0; tick < 256; ++tick)
+		{
+			rpm = std::min(std::max(rpm + step(random), x0), x1);
+			x[tick * 64 + car] = rpm;
+		}
+	}
+
+	float sum = 0;
+	const double spline_time = BenchmarkLookup(spline, x, sum);
+
+	out << "Torque curve lookup, " << sizeof(benchmark_curve) / sizeof(benchmark_curve[0]) << " control points" << std::endl;
+	out << "curve       ns/call  speedup  max error %" << std::endl;
+	out << std::fixed << std::setprecision(2);
+	out << "spline     " << std::setw(10) << spline_time << std::setw(10) << 1.0 << std::setw(10) << 0.0 << std::endl;
+	BenchmarkUniformCurve<32>(spline, x0, x1, x, spline_time, out, sum);
+	BenchmarkUniformCurve<64>(spline, x0, x1, x, spline_time, out, sum);
+	BenchmarkUniformCurve<128>(spline, x0, x1, x, spline_time, out, sum);
+
+	// keep the lookups from being optimized away
+	if (sum == 0)
+		out << std::endl;
+}
+
+QT_TEST(uniformcurve_test)
+{
+	// linear curve is reproduced exactly, also outside of the sampled range
+	{
+		LinearInterp<float> l;
+		l.AddPoint(1, 2);
+		l.AddPoint(3, 6);
+		UniformCurve<float, 5> c;
+		c.Sample(l, 1, 3);
+		QT_CHECK_CLOSE(c.GetMinX(), 1, 0.0001);
+		QT_CHECK_CLOSE(c.GetMaxX(), 3, 0.0001);
+		QT_CHECK_CLOSE(c.Interpolate(1), 2, 0.0001);
+		QT_CHECK_CLOSE(c.Interpolate(1.7), 3.4, 0.0001);
+		QT_CHECK_CLOSE(c.Interpolate(2.5), 5, 0.0001);
+		QT_CHECK_CLOSE(c.Interpolate(3), 6, 0.0001);
+		QT_CHECK_CLOSE(c.Interpolate(0), 0, 0.0001);
+		QT_CHECK_CLOSE(c.Interpolate(4), 8, 0.0001);
+	}
+
+	// spline is matched at the samples and closely in between
+	{
+		Spline<float> s;
+		for (const auto & p : benchmark_curve)
+			s.AddPoint(p[0], p[1]);
+		s.Calculate();
+		UniformCurve<float, 67> c;
+		c.Sample(s, 1000, 7600);
+		QT_CHECK_CLOSE(c.Interpolate(1000), s.Interpolate(1000), 0.001);
+		QT_CHECK_CLOSE(c.Interpolate(1100), s.Interpolate(1100), 0.001);
+		QT_CHECK_CLOSE(c.Interpolate(7600), s.Interpolate(7600), 0.001);
+		float max_error = 0;
+		for (float x = 1000; x <= 7600; x += 10)
+			max_error = std::max(max_error, std::abs(c.Interpolate(x) - s.Interpolate(x)));
+		QT_CHECK_LESS(max_error, 0.5);
+	}
+
+	// engine torque table, the curve is extended linearly to the stall rpm
+	// and the rev limit like CarEngineInfo::Load does before sampling
+	{
+		const float stall = 800, limit = 8000;
+		const int n = sizeof(benchmark_curve) / sizeof(benchmark_curve[0]);
+		const float * p0 = benchmark_curve[0], * p1 = benchmark_curve[1];
+		const float * q0 = benchmark_curve[n - 2], * q1 = benchmark_curve[n - 1];
+		Spline<float> s;
+		s.AddPoint(stall, p0[1] + (p1[1] - p0[1]) / (p1[0] - p0[0]) * (stall - p0[0]));
+		for (const auto & p : benchmark_curve)
+			s.AddPoint(p[0], p[1]);
+		s.AddPoint(limit, q0[1] + (q1[1] - q0[1]) / (q1[0] - q0[0]) * (limit - q0[0]));
+		s.Calculate();
+		UniformCurve<float, 128> c;
+		c.Sample(s, stall, limit);
+
+		// whole sampled range within 0.5 Nm of the spline
+		float max_error = 0;
+		for (float x = stall; x <= limit; x += 1)
+			max_error = std::max(max_error, std::abs(c.Interpolate(x) - s.Interpolate(x)));
+		QT_CHECK_LESS(max_error, 0.5);
+
+		// outside of it the end intervals continue as straight lines, the spline
+		// extrapolates its end cubics and reaches 469 Nm at 0 rpm instead
+		const float h = (limit - stall) / 127;
+		const float low_slope = (c.Interpolate(stall + h) - c.Interpolate(stall)) / h;
+		const float high_slope = (c.Interpolate(limit) - c.Interpolate(limit - h)) / h;
+		QT_CHECK_CLOSE(c.Interpolate(0), c.Interpolate(stall) - low_slope * stall, 0.01);
+		QT_CHECK_CLOSE(c.Interpolate(9000), c.Interpolate(limit) + high_slope * 1000, 0.01);
+		QT_CHECK_LESS(std::abs(c.Interpolate(0) - s.Interpolate(stall)), 25);
+		QT_CHECK_LESS(std::abs(c.Interpolate(9000) - s.Interpolate(limit)), 25);
+	}
+}
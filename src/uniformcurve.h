@@ -0,0 +1,78 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _UNIFORMCURVE_H
+#define _UNIFORMCURVE_H
+
+#include <cassert>
+#include <iosfwd>
+
+/// Curve resampled at N evenly spaced arguments with linear interpolation in between.
+/// Lookup is a multiply and a blend instead of a bisection of the control points,
+/// samples are stored inline. Arguments outside of the sampled range are
+/// extrapolated linearly from the first or last sample interval.
+template <typename T, int N>
+class UniformCurve
+{
+public:
+	UniformCurve() : xmin(0), xmax(0), scale(0)
+	{
+		for (int i = 0; i < N; ++i)
+			values[i] = 0;
+	}
+
+	/// sample curve.Interpolate(x) for x in [x0, x1]
+	template <class Curve>
+	void Sample(const Curve & curve, T x0, T x1)
+	{
+		assert(x1 > x0);
+		xmin = x0;
+		xmax = x1;
+		scale = (N - 1) / (x1 - x0);
+		for (int i = 0; i < N; ++i)
+			values[i] = curve.Interpolate(x0 + (x1 - x0) * i / (N - 1));
+	}
+
+	T Interpolate(T x) const
+	{
+		T u = (x - xmin) * scale;
+		int i = 0;
+		if (u >= N - 1)
+			i = N - 2;
+		else if (u > 0)
+			i = u;
+		T blend = u - i;
+		return values[i] + (values[i + 1] - values[i]) * blend;
+	}
+
+	T GetMinX() const { return xmin; }
+
+	T GetMaxX() const { return xmax; }
+
+private:
+	T values[N];
+	T xmin;
+	T xmax;
+	T scale;
+};
+
+/// compare spline and uniform curve lookup cost and error on a torque curve
+void UniformCurveBenchmark(std::ostream & out);
+
+#endif